@@ -72,6 +72,45 @@ export async function getGatewayMetrics(req, res) {
         packets_dropped: m.packets_dropped || 0,
         http_errors: m.http_errors || 0,
         queue_full_count: m.queue_full_count || 0,
+        http_reused: m.http_reused || 0,
+        http_reconnects: m.http_reconnects || 0,
+        batches_sent: m.batches_sent || 0,
+        retry_pending: m.retry_pending || 0,
+        retry_scheduled: m.retry_scheduled || 0,
+        retry_expired: m.retry_expired || 0,
+        retry_overflow: m.retry_overflow || 0,
+        queue_peak: m.queue_peak || 0,
+        flash_pending: m.flash_pending || 0,
+        flash_spooled: m.flash_spooled || 0,
+        flash_drained: m.flash_drained || 0,
+        flash_overwritten: m.flash_overwritten || 0,
+        flash_max_erase: m.flash_max_erase || 0,
+        binary_frames: m.binary_frames || 0,
+        crc_errors: m.crc_errors || 0,
+        mqtt_connected: m.mqtt_connected || false,
+        mqtt_inflight: m.mqtt_inflight || 0,
+        mqtt_acked: m.mqtt_acked || 0,
+        mqtt_deleted: m.mqtt_deleted || 0,
+        mqtt_connects: m.mqtt_connects || 0,
+        uplink_state: m.uplink_state || "closed",
+        uplink_transitions: m.uplink_transitions || 0,
+        uplink_opens: m.uplink_opens || 0,
+        uplink_probes: m.uplink_probes || 0,
+        uplink_closed_ms: m.uplink_closed_ms || 0,
+        uplink_open_ms: m.uplink_open_ms || 0,
+        uplink_half_open_ms: m.uplink_half_open_ms || 0,
+        uplink_diverted: m.uplink_diverted || 0,
+        uplink_throttled: m.uplink_throttled || 0,
+        uplink_batch: m.uplink_batch || 0,
+        uplink_interval_ms: m.uplink_interval_ms || 0,
+        nodes_tracked: m.nodes_tracked || 0,
+        nodes_untracked: m.nodes_untracked || 0,
+        dup_dropped: m.dup_dropped || 0,
+        edge_dropped: m.edge_dropped || 0,
+        edge_holds: m.edge_holds || 0,
+        lane_yields: m.lane_yields || 0,
+        lanes: Array.isArray(m.lanes) ? m.lanes : [],
+        nodes: Array.isArray(m.nodes) ? m.nodes : [],
         queue_usage_percent: m.queue_usage_percent || 0,
         wifi_connected: m.wifi_connected || false,
         last_packet_time: m.last_packet_time,
@@ -12,15 +12,22 @@ import queueService from "../services/queue.service.js";
 import duplicateService from "../services/duplicate.service.js";
 import metricsService from "../services/metrics.service.js";
 import statusService from "../services/status.service.js";
+import aguadaBinaryService from "../services/aguada-binary.service.js";
+import predictionService from "../services/prediction.service.js";
 import logger from "../config/logger.js";
 import { broadcastReading } from "../websocket/wsHandler.js";
 
+// Limite de leituras por lote (gateway envia até BATCH_MAX_PACKETS)
+const MAX_BATCH_ITEMS = parseInt(process.env.TELEMETRY_BATCH_MAX || "200");
+
 /**
  * POST /api/telemetry
  * Endpoint para receber telemetria dos nodes ESP32
- * Suporta dois formatos:
+ * Suporta três formatos:
  * 1. Individual: {"mac":"...","type":"distance_cm","value":24480,"battery":5000,"uptime":3,"rssi":-50}
  * 2. Agregado: {"node_mac":"...","datetime":"...","data":[...],"meta":{...}}
+ * 3. Binário AGUADA-1 (hex): {"bin":"01ad...","rssi":-60}
+ * 4. Multicanal: {"mac":"...","vcc_bat_mv":4900,"channels":[{"mac":"...","distance_mm":1850},...]}
  */
 export async function receiveTelemetry(req, res) {
   const startTime = Date.now();
@@ -32,11 +39,15 @@ export async function receiveTelemetry(req, res) {
     // Detectar formato baseado na presença do campo 'mac' vs 'node_mac'
     // Formato AGUADA-1 tem 'mac' e 'distance_mm' (sem 'type')
     // Formato antigo tem 'mac' e 'type'
+    // Frame binário encaminhado pelo gateway tem 'bin' (o MAC está no frame)
     const isIndividualFormat =
-      "mac" in req.body && ("type" in req.body || "distance_mm" in req.body);
+      aguadaBinaryService.isBinaryItem(req.body) ||
+      ("mac" in req.body && ("type" in req.body || "distance_mm" in req.body));
 
     let result;
-    if (isIndividualFormat) {
+    if (aguadaBinaryService.isMultiChannelItem(req.body)) {
+      result = await receiveMultiChannelTelemetry(req, res);
+    } else if (isIndividualFormat) {
       result = await receiveIndividualTelemetry(req, res);
     } else {
       result = await receiveAggregatedTelemetry(req, res);
@@ -81,26 +92,231 @@ export async function receiveTelemetry(req, res) {
   }
 }
 
+/**
+ * POST /api/telemetry/batch
+ * Lote de leituras individuais enviado pelo gateway (modo batch)
+ * Aceita dois formatos de corpo:
+ * 1. JSON array: [{"mac":"...","distance_mm":2450,...},{...}]
+ * 2. NDJSON (Content-Type: application/x-ndjson): um objeto JSON por linha
+ *
+ * Cada item é processado como uma leitura individual; itens multicanal são
+ * expandidos antes (uma leitura por canal). Itens recusados (4xx) não
+ * derrubam o lote, que é aceito (200): erros de validação não se resolvem
+ * com reenvio. Se algum item falhar por erro do servidor (5xx) a resposta
+ * é 503, e o gateway reenvia o lote.
+ */
+export async function receiveTelemetryBatch(req, res) {
+  const startTime = Date.now();
+
+  try {
+    let items;
+    if (Array.isArray(req.body)) {
+      items = req.body;
+    } else if (typeof req.body === "string") {
+      items = [];
+      for (const line of req.body.split("\n")) {
+        const trimmed = line.trim();
+        if (!trimmed) continue;
+        try {
+          items.push(JSON.parse(trimmed));
+        } catch {
+          items.push(null); // Linha inválida - reportada como erro do item
+        }
+      }
+    } else {
+      return res.status(400).json({
+        success: false,
+        error: "Lote deve ser um JSON array ou NDJSON",
+      });
+    }
+
+    items = items.flatMap((item) =>
+      aguadaBinaryService.isMultiChannelItem(item)
+        ? aguadaBinaryService.expandMultiChannel(item) || [null]
+        : [item]
+    );
+
+    if (items.length > MAX_BATCH_ITEMS) {
+      return res.status(413).json({
+        success: false,
+        error: `Lote excede ${MAX_BATCH_ITEMS} leituras`,
+      });
+    }
+
+    const results = [];
+    let processed = 0;
+    let serverErrors = 0;
+
+    // Sequencial: preserva a ordem das leituras de um mesmo node
+    for (let index = 0; index < items.length; index++) {
+      metricsService.recordTelemetryReceived();
+
+      let result;
+      try {
+        result =
+          items[index] && typeof items[index] === "object"
+            ? await processIndividualTelemetry(items[index])
+            : { status: 400, body: { success: false, error: "JSON inválido" } };
+      } catch (error) {
+        metricsService.recordError("telemetry_error", error.message);
+        result = { status: 500, body: { success: false, error: error.message } };
+      }
+
+      if (result.status < 400) {
+        processed++;
+        metricsService.recordTelemetryProcessed();
+      } else {
+        metricsService.recordTelemetryFailed();
+        if (result.status >= 500) {
+          serverErrors++;
+        }
+      }
+      results.push({ index, status: result.status, ...result.body });
+    }
+
+    // Falha do servidor em algum item (ex.: banco fora): 503 faz o gateway
+    // reenviar o lote (retry/flash log); os itens já gravados voltam como
+    // duplicados pela chave "idem" ou pelo hash no Redis
+    const status = serverErrors > 0 ? 503 : 200;
+    const latency = Date.now() - startTime;
+    metricsService.recordLatency(latency);
+    metricsService.recordEndpointRequest("POST", "/api/telemetry/batch", status, latency);
+
+    logger.info("Lote de telemetria recebido", {
+      items: items.length,
+      processed,
+      server_errors: serverErrors,
+      latency_ms: latency,
+    });
+
+    return res.status(status).json({
+      success: serverErrors === 0,
+      received: items.length,
+      processed,
+      failed: items.length - processed,
+      results,
+    });
+  } catch (error) {
+    const latency = Date.now() - startTime;
+    metricsService.recordLatency(latency);
+    metricsService.recordEndpointRequest("POST", "/api/telemetry/batch", 500, latency);
+    metricsService.recordError("telemetry_error", error.message);
+
+    logger.error("Erro ao receber lote de telemetria:", error);
+    return res.status(500).json({
+      success: false,
+      error: "Erro interno do servidor",
+    });
+  }
+}
+
+/**
+ * Frame multicanal (node com vários sensores): expande em uma leitura
+ * AGUADA-1 por canal e processa cada uma como individual, na ordem.
+ * Responde 200 se ao menos um canal foi aceito; cada canal tem o seu status.
+ * Falha do servidor em algum canal responde 503, como o lote: o gateway
+ * reenvia o frame e os canais já gravados voltam como duplicados.
+ */
+async function receiveMultiChannelTelemetry(req, res) {
+  const readings = aguadaBinaryService.expandMultiChannel(req.body);
+  if (!readings) {
+    return res.status(400).json({
+      success: false,
+      error: "Frame multicanal inválido",
+      format: "AGUADA-1-MULTI",
+    });
+  }
+
+  const results = [];
+  let processed = 0;
+  let serverErrors = 0;
+  for (let index = 0; index < readings.length; index++) {
+    let result;
+    try {
+      result = await processIndividualTelemetry(readings[index]);
+    } catch (error) {
+      metricsService.recordError("telemetry_error", error.message);
+      result = { status: 500, body: { success: false, error: error.message } };
+    }
+
+    if (result.status < 400) {
+      processed++;
+    } else if (result.status >= 500) {
+      serverErrors++;
+    }
+    results.push({ index, status: result.status, ...result.body });
+  }
+
+  let status = processed > 0 ? 200 : results[0].status;
+  if (serverErrors > 0) {
+    status = 503;
+  }
+  return res.status(status).json({
+    success: processed > 0 && serverErrors === 0,
+    mac: req.body.mac,
+    received: readings.length,
+    processed,
+    failed: readings.length - processed,
+    results,
+  });
+}
+
 /**
  * Processa telemetria individual (formato firmware)
- * Suporta dois formatos:
+ * Suporta três formatos:
  * 1. Formato antigo: {"mac":"...","type":"distance_cm","value":2448,"battery":5000,"rssi":-50}
  * 2. Formato AGUADA-1: {"mac":"...","distance_mm":2450,"vcc_bat_mv":4900,"rssi":-50}
+ * 3. Binário AGUADA-1: {"bin":"<16 bytes em hex>","rssi":-50} - decodificado para (2)
+ *
+ * Leituras desempacotadas de frames em lote chegam como (2) com "age_ms",
+ * e as drenadas do flash log do gateway (qualquer formato) somam a ele o
+ * tempo guardado: o datetime é recuado por essa idade. Nodes em predição dupla mandam
+ * "slope_mm_h": os pontos previstos desde o envio anterior são gravados antes.
  */
 async function receiveIndividualTelemetry(req, res) {
+  const { status, body } = await processIndividualTelemetry(req.body);
+  return res.status(status).json(body);
+}
+
+/**
+ * Valida e persiste uma leitura individual.
+ * Usado pelo endpoint individual, pelo endpoint de lote e pelo MQTT Bridge.
+ *
+ * @returns {Promise<{status: number, body: object}>}
+ */
+export async function processIndividualTelemetry(payload) {
   try {
+    // Frame binário: validar CRC e converter para AGUADA-1 JSON
+    if (aguadaBinaryService.isBinaryItem(payload)) {
+      const decoded = aguadaBinaryService.expand(payload);
+      if (!decoded) {
+        return {
+          status: 400,
+          body: {
+            success: false,
+            error: "Frame binário inválido",
+            format: "AGUADA-1-BIN",
+          },
+        };
+      }
+      payload = decoded;
+    }
+
     // Validar payload
-    const validation = validateIndividualTelemetry(req.body);
+    const validation = validateIndividualTelemetry(payload);
 
     if (!validation.success) {
       logger.warn("Telemetria individual inválida", {
         errors: validation.error.errors,
       });
-      return res.status(400).json({
-        success: false,
-        error: "Validação falhou",
-        details: validation.error.errors,
-      });
+      return {
+        status: 400,
+        body: {
+          success: false,
+          error: "Validação falhou",
+          details: validation.error.errors,
+        },
+      };
     }
 
     const data = validation.data;
@@ -129,12 +345,15 @@ async function receiveIndividualTelemetry(req, res) {
 
       if (!sensor) {
         logger.warn(`Sensor não encontrado (AGUADA-1): MAC=${mac}`);
-        return res.status(404).json({
-          success: false,
-          error: "Sensor não registrado",
-          mac,
-          format: "AGUADA-1",
-        });
+        return {
+          status: 404,
+          body: {
+            success: false,
+            error: "Sensor não registrado",
+            mac,
+            format: "AGUADA-1",
+          },
+        };
       }
 
       logger.info("Telemetria AGUADA-1 recebida", {
@@ -157,12 +376,15 @@ async function receiveIndividualTelemetry(req, res) {
 
       if (!sensor) {
         logger.warn(`Sensor desconhecido: MAC=${mac}, type=${type}`);
-        return res.status(404).json({
-          success: false,
-          error: "Sensor não registrado",
-          mac,
-          type,
-        });
+        return {
+          status: 404,
+          body: {
+            success: false,
+            error: "Sensor não registrado",
+            mac,
+            type,
+          },
+        };
       }
 
       // Converter valor conforme tipo
@@ -177,49 +399,74 @@ async function receiveIndividualTelemetry(req, res) {
       }
     }
 
-    const datetime = new Date();
-
-    // Verificar duplicata antes de inserir
-    const isDup = await duplicateService.isDuplicate(
-      sensor.sensor_id,
-      datetime,
-      valorReal
-    );
+    // Leitura de lote ou do flash log: instante da medição = agora - idade
+    // informada pelo gateway
+    const ageMs = data.age_ms || 0;
+    const datetime = new Date(Date.now() - ageMs);
+
+    // Verificar duplicata antes de inserir: pela chave do gateway (memória)
+    // ou, sem ela, pelo hash sensor/segundo/valor no Redis
+    const idemKey = isAguada1Format && data.idem ? data.idem : null;
+    const isDup = idemKey
+      ? duplicateService.isDuplicateKey(idemKey)
+      : await duplicateService.isDuplicate(sensor.sensor_id, datetime, valorReal);
     if (isDup) {
       logger.warn("Leitura duplicada ignorada", {
         sensor_id: sensor.sensor_id,
         type,
         valor: valorReal,
       });
-      return res.status(200).json({
-        success: true,
-        message: "Leitura duplicada ignorada",
+      return {
+        status: 200,
+        body: {
+          success: true,
+          message: "Leitura duplicada ignorada",
+          sensor_id: sensor.sensor_id,
+          duplicate: true,
+        },
+      };
+    }
+
+    // A marca de duplicata fica só se a leitura for gravada: senão o reenvio
+    // do gateway (dentro da janela) seria descartado como duplicado
+    try {
+      // Predição dupla: pontos da reta desde o envio anterior, depois reancora
+      if (isAguada1Format) {
+        await predictionService.recordReading(sensor, data, datetime);
+      }
+
+      // Inserir leitura bruta
+      await readingService.insertRawReading({
         sensor_id: sensor.sensor_id,
-        duplicate: true,
+        elemento_id: sensor.elemento_id,
+        variavel: type,
+        valor: valorReal,
+        unidade,
+        meta: {
+          battery_mv: battery,
+          rssi_dbm: rssi,
+          uptime_sec: uptime,
+          node_mac: mac,
+          raw_value: value,
+          slope_mm_h: isAguada1Format ? data.slope_mm_h : undefined,
+          seq: isAguada1Format ? data.seq : undefined,
+          edge: isAguada1Format ? data.edge : undefined,
+        },
+        fonte: "sensor",
+        autor: mac,
+        modo: "automatica",
+        observacao: null,
+        datetime,
       });
+    } catch (error) {
+      if (idemKey) {
+        duplicateService.forgetKey(idemKey);
+      } else {
+        await duplicateService.forget(sensor.sensor_id, datetime, valorReal);
+      }
+      throw error;
     }
 
-    // Inserir leitura bruta
-    await readingService.insertRawReading({
-      sensor_id: sensor.sensor_id,
-      elemento_id: sensor.elemento_id,
-      variavel: type,
-      valor: valorReal,
-      unidade,
-      meta: {
-        battery_mv: battery,
-        rssi_dbm: rssi,
-        uptime_sec: uptime,
-        node_mac: mac,
-        raw_value: value,
-      },
-      fonte: "sensor",
-      autor: mac,
-      modo: "automatica",
-      observacao: null,
-      datetime,
-    });
-
     // Registrar heartbeat no status service (sensor online)
     statusService.recordSensorHeartbeat(sensor.sensor_id, {
       mac,
@@ -237,21 +484,19 @@ async function receiveIndividualTelemetry(req, res) {
         elementoParametros: sensor.elemento_parametros,
         datetime,
         type,
+        edge: isAguada1Format ? data.edge : undefined,
       })
       .catch((err) => {
         logger.error("Erro ao adicionar leitura à fila:", err);
         // Fallback: processar diretamente se a fila falhar
         if (type === "distance_cm") {
-          compressionService
-            .processCompression(
-              sensor,
-              valorReal,
-              sensor.elemento_parametros,
-              datetime
-            )
-            .catch((compErr) => {
-              logger.error("Erro no processamento de fallback:", compErr);
-            });
+          const compress =
+            isAguada1Format && data.edge === "hold"
+              ? compressionService.extendHold
+              : compressionService.processCompression;
+          compress(sensor, valorReal, sensor.elemento_parametros, datetime).catch((compErr) => {
+            logger.error("Erro no processamento de fallback:", compErr);
+          });
         }
       });
 
@@ -267,13 +512,16 @@ async function receiveIndividualTelemetry(req, res) {
       sensor_id: sensor.sensor_id,
     });
 
-    return res.status(200).json({
-      success: true,
-      message: "Telemetria recebida com sucesso",
-      sensor_id: sensor.sensor_id,
-      type,
-      value: valorReal,
-    });
+    return {
+      status: 200,
+      body: {
+        success: true,
+        message: "Telemetria recebida com sucesso",
+        sensor_id: sensor.sensor_id,
+        type,
+        value: valorReal,
+      },
+    };
   } catch (error) {
     logger.error("Erro ao processar telemetria individual:", error);
     throw error;
@@ -585,6 +833,7 @@ export async function receiveCalibration(req, res) {
 
 export default {
   receiveTelemetry,
+  receiveTelemetryBatch,
   receiveManualReading,
   receiveCalibration,
 };
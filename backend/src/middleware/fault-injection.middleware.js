@@ -0,0 +1,40 @@
+import logger from '../config/logger.js';
+
+const FAULT_RATE = parseFloat(process.env.TELEMETRY_FAULT_RATE || '0');
+const FAULT_DELAY_MS = parseInt(process.env.TELEMETRY_FAULT_DELAY_MS || '0');
+const FAULT_RETRY_AFTER_S = parseInt(process.env.TELEMETRY_FAULT_RETRY_AFTER_S || '0');
+
+/**
+ * Middleware de injeção de falhas para simular backend instável
+ *
+ * Usado para testar o retry scheduler do gateway (fila, retries, descartes).
+ * Desativado em produção e quando TELEMETRY_FAULT_RATE=0 (padrão).
+ *
+ * - TELEMETRY_FAULT_RATE: fração das requisições que recebem 503 (0.0-1.0)
+ * - TELEMETRY_FAULT_DELAY_MS: atraso antes da falha (simula timeout do gateway)
+ * - TELEMETRY_FAULT_RETRY_AFTER_S: Retry-After enviado com o 503 (0 = sem header),
+ *   para testar o ritmo AIMD e o circuit breaker do gateway
+ */
+export function faultInjectionMiddleware(req, res, next) {
+  if (process.env.NODE_ENV === 'production' || FAULT_RATE <= 0) {
+    return next();
+  }
+
+  if (Math.random() >= FAULT_RATE) {
+    return next();
+  }
+
+  logger.warn(`[Fault Injection] ${req.method} ${req.path} → 503`);
+
+  setTimeout(() => {
+    if (FAULT_RETRY_AFTER_S > 0) {
+      res.set('Retry-After', String(FAULT_RETRY_AFTER_S));
+    }
+    res.status(503).json({
+      success: false,
+      error: 'Falha simulada (TELEMETRY_FAULT_RATE)',
+    });
+  }, FAULT_DELAY_MS);
+}
+
+export default faultInjectionMiddleware;
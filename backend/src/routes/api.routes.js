@@ -10,6 +10,7 @@ import databaseController from "../controllers/database.controller.js";
 import firmwareController from "../controllers/firmware.controller.js";
 import statusController from "../controllers/status.controller.js";
 import exportService from "../services/export.service.js";
+import faultInjectionMiddleware from "../middleware/fault-injection.middleware.js";
 
 const router = express.Router();
 
@@ -21,7 +22,22 @@ const router = express.Router();
  * POST /api/telemetry
  * Recebe telemetria dos nodes ESP32 via MQTT/HTTP
  */
-router.post("/telemetry", telemetryController.receiveTelemetry);
+router.post(
+  "/telemetry",
+  faultInjectionMiddleware,
+  telemetryController.receiveTelemetry
+);
+
+/**
+ * POST /api/telemetry/batch
+ * Recebe lote de leituras do gateway (JSON array ou NDJSON)
+ */
+router.post(
+  "/telemetry/batch",
+  faultInjectionMiddleware,
+  express.text({ type: "application/x-ndjson", limit: "1mb" }),
+  telemetryController.receiveTelemetryBatch
+);
 
 /**
  * POST /api/manual-reading
@@ -6,10 +6,21 @@ const macRegex = /^([0-9A-Fa-f]{2}:){5}[0-9A-Fa-f]{2}$/;
 // ISO8601 datetime validation
 const iso8601Regex = /^\d{4}-\d{2}-\d{2}T\d{2}:\d{2}:\d{2}(\.\d{3})?Z?$/;
 
+// Idade máxima de uma leitura: as drenadas do flash log do gateway carregam
+// o tempo da queda inteira (rejeitar com 400 faria o gateway apagá-las)
+const AGE_MS_MAX = 30 * 24 * 3600 * 1000;
+
 // Individual variable transmission schema (firmware format)
 // Suporta dois formatos:
 // 1. Formato antigo: {"mac":"...","type":"distance_cm","value":2448,"battery":5000,"uptime":3,"rssi":-50}
 // 2. Formato AGUADA-1: {"mac":"...","distance_mm":2450,"vcc_bat_mv":4900,"rssi":-50}
+//    Leituras vindas de frames em lote trazem "age_ms" (idade na chegada ao gateway)
+//    e as drenadas do flash log somam o tempo guardado (nos dois formatos)
+//    Nodes em predição dupla trazem "slope_mm_h" (inclinação da reta compartilhada)
+//    Frames v2 trazem "seq" (sequência de 8 bits do rádio do node) e o gateway
+//    acrescenta "idem" (chave de idempotência "<MAC do rádio>/<seq>/<índice>")
+//    Com compressão na borda o gateway marca "edge": "change" (abre período novo)
+//    ou "hold" (keep-alive de um sensor estável: só estende o período)
 export const individualTelemetrySchema = z.union([
   // Formato antigo (com type)
   z.object({
@@ -23,6 +34,7 @@ export const individualTelemetrySchema = z.union([
     battery: z.number().int().min(0).max(6000).optional(), // mV (0-6V)
     rssi: z.number().int().min(-120).max(0).optional(), // dBm
     uptime: z.number().int().nonnegative().optional(), // seconds
+    age_ms: z.number().int().min(0).max(AGE_MS_MAX).optional(), // Drenada do flash log
   }),
   // Formato AGUADA-1 (sem type, sempre distance_mm)
   z.object({
@@ -33,6 +45,11 @@ export const individualTelemetrySchema = z.union([
       .refine((val) => val >= 0, 'Distância deve ser não-negativa'),
     vcc_bat_mv: z.number().int().min(0).max(6000).optional(), // mV (0-6V)
     rssi: z.number().int().min(-120).max(0).optional(), // dBm
+    age_ms: z.number().int().min(0).max(AGE_MS_MAX).optional(), // Leitura de lote ou do flash log
+    slope_mm_h: z.number().int().min(-1000000).max(1000000).optional(), // Predição dupla
+    seq: z.number().int().min(0).max(255).optional(), // Sequência do frame
+    idem: z.string().max(40).optional(), // Chave de idempotência (gateway)
+    edge: z.enum(['change', 'hold']).optional(), // Veredito da compressão na borda
   }),
 ]);
 
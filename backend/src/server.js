@@ -120,6 +120,7 @@ app.use((err, req, res, next) => {
 import http from "http";
 import { initWebSocket } from "./websocket/wsHandler.js";
 import SerialBridge from "./services/serial-bridge.js";
+import MqttBridge from "./services/mqtt-bridge.js";
 import {
   initializeQueue,
   getReadingsWorker,
@@ -147,6 +148,11 @@ async function startServer() {
     // Create HTTP server
     const server = http.createServer(app);
 
+    // Keep-alive longo para o gateway reaproveitar a conexão TCP entre pacotes
+    // (padrão do Node é 5s; headersTimeout deve ser maior que keepAliveTimeout)
+    server.keepAliveTimeout = parseInt(process.env.HTTP_KEEPALIVE_TIMEOUT_MS || "65000");
+    server.headersTimeout = server.keepAliveTimeout + 1000;
+
     // Initialize WebSocket
     initWebSocket(server);
 
@@ -174,6 +180,18 @@ async function startServer() {
     // Exportar serialBridge para uso em outros módulos (ex: health check)
     global.serialBridge = serialBridge;
 
+    // Initialize MQTT Bridge (gateway com UPLINK_SINK_MQTT)
+    if (process.env.MQTT_ENABLED === "true") {
+      const mqttBridge = new MqttBridge({
+        brokerUrl: process.env.MQTT_BROKER || "mqtt://localhost:1883",
+        topic: process.env.MQTT_TOPIC_TELEMETRY || "aguada/telemetry/+",
+        username: process.env.MQTT_USERNAME,
+        password: process.env.MQTT_PASSWORD,
+      });
+      mqttBridge.connect();
+      global.mqttBridge = mqttBridge;
+    }
+
     // Start HTTP server
     server.listen(PORT, () => {
       logger.info(`🚀 Servidor rodando na porta ${PORT}`);
@@ -194,6 +212,11 @@ async function startServer() {
 async function gracefulShutdown() {
   logger.info("Encerrando servidor graciosamente...");
 
+  // Fechar MQTT Bridge
+  if (global.mqttBridge) {
+    global.mqttBridge.disconnect();
+  }
+
   // Parar sistema de alertas
   alertService.stopMonitoring();
   logger.info("Sistema de alertas encerrado");
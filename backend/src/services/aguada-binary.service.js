@@ -0,0 +1,179 @@
+import logger from '../config/logger.js';
+
+// Frame binário AGUADA-1 (node_sensor_11, USE_BINARY_PAYLOAD=1)
+// Layout little-endian, 16 bytes:
+//   0  magic     u16  0xAD02 (bytes 02 AD); 0xAD01 = v1
+//   2  mac       6 bytes
+//   8  distance  i16  mm (negativo = erro de leitura)
+//  10  vcc       u16  mV
+//  12  seq       u8   sequência do frame (v1: rssi i8 estimado pelo node)
+//  13  flags     u8
+//  14  crc16     u16  CRC16-CCITT (init 0xFFFF) dos bytes 0..13
+export const AGUADA_BIN_MAGIC = 0xad02;
+export const AGUADA_BIN_MAGIC_RSSI = 0xad01;
+export const AGUADA_BIN_SIZE = 16;
+
+export const AGUADA_BIN_FLAGS = {
+  HEARTBEAT: 0x01,
+  DELTA: 0x02,
+  ERROR: 0x04,
+  AGGREGATED: 0x08,
+  LOW_BATTERY: 0x10,
+};
+
+const HEX_FRAME = /^[0-9a-fA-F]{32}$/;
+
+// Frame multicanal (node_sensor_21, USE_MULTI_FRAME=1) - o gateway valida o
+// CRC e encaminha como JSON: campos do node uma vez + um item por canal
+//   {"mac":"<rádio>","vcc_bat_mv":4900,"rssi":-50,"delivery_pct":98,
+//    "channels":[{"mac":"<canal>","distance_mm":1850,"rle":3},...],
+//    "idem":"<rádio>/<seq>"}
+// A chave de idempotência de cada canal é "<rádio>/<seq>/<índice>" - a mesma
+// que o gateway_esp_idf põe em cada leitura ao expandir o frame.
+export const AGUADA_MULTI_MAX_CHANNELS = 21;
+const NODE_FIELDS = ['vcc_bat_mv', 'rssi', 'delivery_pct', 'age_ms', 'seq'];
+
+/**
+ * Decodifica frames binários AGUADA-1 encaminhados pelos gateways
+ * como {"bin":"<32 hex>","rssi":-60} e expande frames multicanal
+ * ({"channels":[...]}) em leituras por sensor
+ */
+class AguadaBinaryService {
+  /**
+   * CRC16-CCITT (poly 0x1021, init 0xFFFF, sem reflexão) - igual ao firmware
+   */
+  crc16(buffer, length = buffer.length) {
+    let crc = 0xffff;
+    for (let i = 0; i < length; i++) {
+      crc ^= buffer[i] << 8;
+      for (let bit = 0; bit < 8; bit++) {
+        crc = crc & 0x8000 ? ((crc << 1) ^ 0x1021) & 0xffff : (crc << 1) & 0xffff;
+      }
+    }
+    return crc;
+  }
+
+  /**
+   * Verifica se o item é um frame binário encaminhado pelo gateway
+   */
+  isBinaryItem(item) {
+    return item !== null && typeof item === 'object' && typeof item.bin === 'string';
+  }
+
+  /**
+   * Decodifica um frame de 16 bytes
+   *
+   * @returns {{mac, distance_mm, vcc_bat_mv, rssi|seq, flags}|null} null se
+   *          o frame for inválido (tamanho, magic ou CRC)
+   */
+  decode(buffer) {
+    if (!Buffer.isBuffer(buffer) || buffer.length !== AGUADA_BIN_SIZE) {
+      return null;
+    }
+    const magic = buffer.readUInt16LE(0);
+    if (magic !== AGUADA_BIN_MAGIC && magic !== AGUADA_BIN_MAGIC_RSSI) {
+      return null;
+    }
+    if (buffer.readUInt16LE(14) !== this.crc16(buffer, 14)) {
+      return null;
+    }
+
+    const mac = Array.from(buffer.subarray(2, 8), (byte) =>
+      byte.toString(16).padStart(2, '0').toUpperCase()
+    ).join(':');
+
+    const decoded = {
+      mac,
+      distance_mm: buffer.readInt16LE(8),
+      vcc_bat_mv: buffer.readUInt16LE(10),
+      flags: buffer.readUInt8(13),
+    };
+    if (magic === AGUADA_BIN_MAGIC) {
+      decoded.seq = buffer.readUInt8(12);
+    } else {
+      decoded.rssi = buffer.readInt8(12);
+    }
+    return decoded;
+  }
+
+  /**
+   * Converte {"bin":"<hex>",...} para o formato AGUADA-1 JSON.
+   * O MAC vem do próprio frame; o RSSI medido pelo gateway (se presente)
+   * tem prioridade sobre a estimativa do node (v1; o v2 não traz RSSI).
+   *
+   * @returns {object|null} null se o frame for inválido
+   */
+  expand(item) {
+    if (!HEX_FRAME.test(item.bin)) {
+      return null;
+    }
+
+    const decoded = this.decode(Buffer.from(item.bin, 'hex'));
+    if (!decoded) {
+      logger.warn('Frame binário AGUADA-1 inválido (magic/CRC)', { bin: item.bin });
+      return null;
+    }
+
+    if (item.mac && item.mac.toUpperCase() !== decoded.mac) {
+      logger.debug('MAC do frame difere do remetente ESP-NOW', {
+        frame_mac: decoded.mac,
+        src_mac: item.mac,
+      });
+    }
+
+    const rssi = Number.isInteger(item.rssi) ? item.rssi : decoded.rssi;
+    const reading = rssi === undefined ? decoded : { ...decoded, rssi };
+    if (typeof item.idem === 'string') {
+      reading.idem = item.idem;
+    }
+    return reading;
+  }
+
+  /**
+   * Verifica se o item é um frame multicanal encaminhado pelo gateway
+   */
+  isMultiChannelItem(item) {
+    return item !== null && typeof item === 'object' && Array.isArray(item.channels);
+  }
+
+  /**
+   * Expande um frame multicanal em leituras AGUADA-1, uma por sensor: o MAC
+   * e a distância vêm do canal, VCC/RSSI/entrega do node. Cada leitura segue
+   * a validação normal (sensor identificado pelo MAC do canal).
+   *
+   * @returns {object[]|null} null se a estrutura for inválida
+   */
+  expandMultiChannel(item) {
+    const { channels } = item;
+    if (channels.length === 0 || channels.length > AGUADA_MULTI_MAX_CHANNELS) {
+      logger.warn('Frame multicanal com número de canais inválido', {
+        mac: item.mac,
+        channels: channels.length,
+      });
+      return null;
+    }
+
+    const shared = {};
+    for (const field of NODE_FIELDS) {
+      if (item[field] !== undefined) {
+        shared[field] = item[field];
+      }
+    }
+
+    const readings = [];
+    for (const [index, channel] of channels.entries()) {
+      if (channel === null || typeof channel !== 'object' || typeof channel.mac !== 'string') {
+        logger.warn('Canal inválido em frame multicanal', { mac: item.mac, channel });
+        return null;
+      }
+      const reading = { ...shared, ...channel };
+      if (typeof item.idem === 'string') {
+        reading.idem = `${item.idem}/${index}`;
+      }
+      readings.push(reading);
+    }
+    return readings;
+  }
+}
+
+export default new AguadaBinaryService();
@@ -7,6 +7,14 @@ const DEADBAND_CM = parseFloat(process.env.DEADBAND_CM || '2.0');
 const WINDOW_SIZE = parseInt(process.env.WINDOW_SIZE || '11');
 const STABILITY_STDDEV = parseFloat(process.env.STABILITY_STDDEV || '0.5');
 
+// proc_id do período aberto por elemento/variável: leituras "hold" do gateway
+// estendem o período sem o SELECT da última leitura processada
+const openPeriods = new Map();
+
+function periodKey(elementoId, variavel) {
+  return `${elementoId}:${variavel}`;
+}
+
 /**
  * Processador de compressão com algoritmo de deadband
  */
@@ -28,7 +36,7 @@ export async function processCompression(sensor, valor, elementoParametros, date
     
     if (!lastProcessed) {
       // Primeira leitura - inserir nova
-      await readingService.insertProcessedReading({
+      const inserted = await readingService.insertProcessedReading({
         elemento_id,
         variavel,
         valor: valorAjustado,
@@ -43,10 +51,12 @@ export async function processCompression(sensor, valor, elementoParametros, date
         autor: 'compression_engine',
         meta: null,
       });
+      openPeriods.set(periodKey(elemento_id, variavel), inserted.proc_id);
       
       logger.info('Primeira leitura processada inserida', { elemento_id, valor: valorAjustado });
       return;
     }
+    openPeriods.set(periodKey(elemento_id, variavel), lastProcessed.proc_id);
     
     // Calcular variação
     const delta = Math.abs(valorAjustado - lastProcessed.valor);
@@ -74,7 +84,7 @@ export async function processCompression(sensor, valor, elementoParametros, date
     }
     
     // Mudança significativa - inserir nova leitura processada
-    await readingService.insertProcessedReading({
+    const inserted = await readingService.insertProcessedReading({
       elemento_id,
       variavel,
       valor: valorAjustado,
@@ -89,6 +99,7 @@ export async function processCompression(sensor, valor, elementoParametros, date
       autor: 'compression_engine',
       meta: { stddev, window_size: recentReadings.length },
     });
+    openPeriods.set(periodKey(elemento_id, variavel), inserted.proc_id);
     
     logger.info('Nova leitura processada (mudança significativa)', {
       elemento_id,
@@ -107,6 +118,29 @@ export async function processCompression(sensor, valor, elementoParametros, date
   }
 }
 
+/**
+ * Leitura "hold" da compressão na borda: o gateway já aplicou o deadband e a
+ * janela de estabilidade, então ela só estende o período aberto. Sem o
+ * proc_id em memória (backend reiniciado), segue o caminho completo.
+ */
+export async function extendHold(sensor, valor, elementoParametros, datetime) {
+  const procId = openPeriods.get(periodKey(sensor.elemento_id, sensor.variavel));
+  if (procId === undefined) {
+    return processCompression(sensor, valor, elementoParametros, datetime);
+  }
+
+  try {
+    await readingService.extendProcessedReading(procId, datetime);
+    logger.debug('Keep-alive do gateway - período estendido', {
+      elemento_id: sensor.elemento_id,
+      proc_id: procId,
+    });
+  } catch (error) {
+    logger.error('Erro ao estender período (hold):', error);
+    throw error;
+  }
+}
+
 /**
  * Detecta eventos após mudança de volume
  */
@@ -128,4 +162,5 @@ async function detectEvents(elementoId, volumeAnteriorM3, volumeAtualM3, percent
 
 export default {
   processCompression,
+  extendHold,
 };
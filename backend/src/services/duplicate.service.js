@@ -4,10 +4,54 @@ import logger from '../config/logger.js';
 const DUPLICATE_WINDOW_MS = 1000; // 1 segundo
 const DUPLICATE_PREFIX = 'dup:';
 
+// Chaves de idempotência ("<MAC do rádio>/<seq>/<índice>", vindas do gateway):
+// memória local, sem ida ao Redis. O seq tem 8 bits e dá a volta, então a
+// janela fica bem abaixo de 256 frames de um node.
+const IDEMPOTENCY_TTL_MS = parseInt(process.env.TELEMETRY_IDEMPOTENCY_TTL_MS || '60000');
+const IDEMPOTENCY_MAX_KEYS = 20000;
+
 /**
  * Serviço para detectar e prevenir duplicatas de leituras
  */
 class DuplicateService {
+  constructor() {
+    this.seenKeys = new Map(); // chave -> expira em (ms); ordem de inserção = ordem de expiração
+  }
+
+  /**
+   * Verifica uma leitura pela chave de idempotência do gateway.
+   * A mesma leitura recebida por dois gateways (ou reenviada) tem a mesma
+   * chave. Retorna true se a chave já foi vista dentro da janela; senão a
+   * registra (forgetKey desfaz se a gravação falhar).
+   */
+  isDuplicateKey(key, now = Date.now()) {
+    // Expirar do início (todas as chaves têm o mesmo TTL)
+    for (const [oldKey, expiresAt] of this.seenKeys) {
+      if (expiresAt > now && this.seenKeys.size < IDEMPOTENCY_MAX_KEYS) {
+        break;
+      }
+      this.seenKeys.delete(oldKey);
+    }
+
+    const expiresAt = this.seenKeys.get(key);
+    if (expiresAt !== undefined && expiresAt > now) {
+      logger.debug('Leitura duplicada detectada (idem)', { idem: key });
+      return true;
+    }
+
+    this.seenKeys.delete(key); // Reinserir no fim mantém a ordem de expiração
+    this.seenKeys.set(key, now + IDEMPOTENCY_TTL_MS);
+    return false;
+  }
+
+  /**
+   * Desfaz o registro de isDuplicateKey quando a leitura não foi gravada,
+   * para o reenvio passar
+   */
+  forgetKey(key) {
+    this.seenKeys.delete(key);
+  }
+
   /**
    * Gera hash único para uma leitura
    */
@@ -60,6 +104,20 @@ class DuplicateService {
     }
   }
 
+  /**
+   * Desfaz a marca de isDuplicate quando a leitura não foi gravada
+   */
+  async forget(sensorId, datetime, valor) {
+    try {
+      if (!redisClient.isOpen) {
+        await redisClient.connect();
+      }
+      await redisClient.del(`${DUPLICATE_PREFIX}${this.generateHash(sensorId, datetime, valor)}`);
+    } catch (error) {
+      logger.error('Erro ao remover marca de duplicata:', error);
+    }
+  }
+
   /**
    * Limpa hashes antigos (manutenção periódica)
    */
@@ -0,0 +1,196 @@
+import mqtt from 'mqtt';
+import logger from '../config/logger.js';
+import metricsService from './metrics.service.js';
+import { processIndividualTelemetry } from '../controllers/telemetry.controller.js';
+
+/**
+ * MQTT Bridge - Consome telemetria publicada pelo gateway (UPLINK_SINK_MQTT)
+ *
+ * Gateway publica em aguada/telemetry/<MAC> um JSON array com as leituras
+ * de um node (ou um objeto único). Sessão persistente (clean: false) e
+ * QoS1: o broker guarda as mensagens enquanto o backend está fora, e o
+ * PUBACK só é enviado depois que o lote foi persistido. Se alguma leitura
+ * falha no servidor (ex.: banco fora), a mensagem fica sem PUBACK e a
+ * conexão cai: o broker a reentrega ao reconectar (as leituras já gravadas
+ * voltam como duplicadas pela chave "idem").
+ */
+
+const REDELIVERY_DELAY_MS = 5000; // Espera antes de reconectar após falha
+
+class MqttBridge {
+  constructor(config = {}) {
+    this.client = null;
+    this.isConnected = false;
+    this.redelivering = false;
+    this.stopping = false;
+
+    // Configurações
+    this.brokerUrl = config.brokerUrl || 'mqtt://localhost:1883';
+    this.topic = config.topic || 'aguada/telemetry/+';
+    this.clientId = config.clientId || 'aguada-backend';
+    this.username = config.username || undefined;
+    this.password = config.password || undefined;
+
+    // Estatísticas
+    this.stats = {
+      messagesReceived: 0,
+      readingsReceived: 0,
+      readingsProcessed: 0,
+      errors: 0,
+      lastMessageTime: null,
+      startTime: Date.now(),
+    };
+  }
+
+  /**
+   * Conecta ao broker e assina o tópico de telemetria
+   */
+  connect() {
+    logger.info(`[MQTT Bridge] Conectando a ${this.brokerUrl} (tópico ${this.topic})...`);
+
+    this.client = mqtt.connect(this.brokerUrl, {
+      clientId: this.clientId,
+      clean: false,
+      username: this.username,
+      password: this.password,
+      reconnectPeriod: 5000,
+      // PUBACK manual: só confirma depois de persistir
+      customHandleAcks: (topic, message, packet, done) => {
+        this.handleMessage(topic, message)
+          .catch(() => false)
+          .then((persisted) => {
+            if (persisted) {
+              done(0);
+              return;
+            }
+            done(new Error(`Mensagem de ${topic} não persistida - sem PUBACK`));
+            this.redeliver();
+          });
+      },
+    });
+
+    this.client.on('connect', (connack) => {
+      this.isConnected = true;
+      logger.info(
+        `[MQTT Bridge] ✅ Conectado (sessão ${connack.sessionPresent ? 'retomada' : 'nova'})`
+      );
+      this.client.subscribe(this.topic, { qos: 1 }, (err) => {
+        if (err) {
+          logger.error(`[MQTT Bridge] Erro ao assinar ${this.topic}:`, err.message);
+        }
+      });
+    });
+
+    this.client.on('close', () => {
+      if (this.isConnected) {
+        logger.warn(`[MQTT Bridge] Conexão com o broker perdida`);
+      }
+      this.isConnected = false;
+    });
+
+    this.client.on('error', (err) => {
+      this.stats.errors++;
+      logger.error(`[MQTT Bridge] Erro:`, err.message);
+    });
+  }
+
+  /**
+   * Derruba a conexão com PUBACKs pendentes: na sessão persistente o broker
+   * reentrega as mensagens não confirmadas quando o bridge reconecta
+   */
+  redeliver() {
+    if (this.redelivering || this.stopping || !this.client) {
+      return;
+    }
+    this.redelivering = true;
+    logger.warn(`[MQTT Bridge] Falha ao persistir - reconectando em ${REDELIVERY_DELAY_MS / 1000}s para reentrega`);
+
+    this.client.end(true, () => {
+      setTimeout(() => {
+        this.redelivering = false;
+        if (!this.stopping) {
+          this.client.reconnect();
+        }
+      }, REDELIVERY_DELAY_MS);
+    });
+  }
+
+  /**
+   * Processa uma mensagem (JSON array ou objeto) em ordem
+   *
+   * @returns {Promise<boolean>} false se alguma leitura falhou no servidor
+   *          (a mensagem deve ser reentregue); mensagem ou leitura inválida
+   *          não se resolve com reentrega e conta como processada
+   */
+  async handleMessage(topic, message) {
+    this.stats.messagesReceived++;
+    this.stats.lastMessageTime = new Date();
+
+    let items;
+    try {
+      const data = JSON.parse(message.toString());
+      items = Array.isArray(data) ? data : [data];
+    } catch {
+      this.stats.errors++;
+      logger.warn(`[MQTT Bridge] Mensagem inválida em ${topic} (${message.length} bytes)`);
+      return true;
+    }
+
+    let persisted = true;
+    for (const item of items) {
+      this.stats.readingsReceived++;
+      metricsService.recordTelemetryReceived();
+
+      try {
+        const result =
+          item && typeof item === 'object'
+            ? await processIndividualTelemetry(item)
+            : { status: 400, body: { error: 'Leitura inválida' } };
+
+        if (result.status < 400) {
+          this.stats.readingsProcessed++;
+          metricsService.recordTelemetryProcessed();
+        } else {
+          metricsService.recordTelemetryFailed();
+          if (result.status >= 500) {
+            persisted = false;
+          }
+        }
+      } catch (error) {
+        this.stats.errors++;
+        metricsService.recordTelemetryFailed();
+        persisted = false;
+        logger.error(`[MQTT Bridge] Erro ao processar leitura de ${topic}:`, error.message);
+      }
+    }
+
+    logger.debug(`[MQTT Bridge] ${topic}: ${items.length} leitura(s)`);
+    return persisted;
+  }
+
+  /**
+   * Desconecta do broker
+   */
+  disconnect() {
+    this.stopping = true;
+    if (this.client) {
+      logger.info(`[MQTT Bridge] Desconectando...`);
+      this.client.end();
+      this.isConnected = false;
+    }
+  }
+
+  /**
+   * Retorna estatísticas
+   */
+  getStats() {
+    return {
+      ...this.stats,
+      uptime: Math.floor((Date.now() - this.stats.startTime) / 1000),
+      isConnected: this.isConnected,
+      brokerUrl: this.brokerUrl,
+    };
+  }
+}
+
+export default MqttBridge;
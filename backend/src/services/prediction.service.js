@@ -0,0 +1,127 @@
+import readingService from './reading.service.js';
+import logger from '../config/logger.js';
+
+// Espaçamento dos pontos previstos gravados entre dois envios do node
+const PREDICTION_FILL_MS = parseInt(process.env.PREDICTION_FILL_MS || '10000');
+// Lacuna máxima preenchida: acima disso o node perdeu heartbeats (fora do ar)
+// e a reta não vale mais
+const PREDICTION_MAX_GAP_MS = parseInt(process.env.PREDICTION_MAX_GAP_MS || '600000');
+
+const MS_PER_HOUR = 3600000;
+
+/**
+ * Predição dupla (firmware: components/aguada_dsp, aguada_predict.h)
+ *
+ * O node só transmite quando a leitura sai da reta ancorada no último envio
+ * (distance_mm, slope_mm_h). Aqui a mesma reta é repetida, com a mesma
+ * truncagem, para gravar os pontos previstos entre os envios em
+ * leituras_raw (modo "prevista"). A inclinação vem no pacote: o backend não
+ * estima nada. Modelos ficam em memória; após um restart a primeira leitura
+ * de cada node reancora a reta.
+ */
+class PredictionService {
+  constructor() {
+    this.models = new Map(); // sensor_id -> { distance_mm, slope_mm_h, anchorMs }
+  }
+
+  /**
+   * Valor previsto (mm) no instante atMs - igual a aguada_predict_value()
+   */
+  predict(model, atMs) {
+    return model.distance_mm + Math.trunc((model.slope_mm_h * (atMs - model.anchorMs)) / MS_PER_HOUR);
+  }
+
+  /**
+   * Pontos previstos entre a âncora do sensor e `datetime` (exclusive),
+   * a cada PREDICTION_FILL_MS
+   */
+  pointsUntil(sensorId, datetime) {
+    const model = this.models.get(sensorId);
+    if (!model) {
+      return [];
+    }
+
+    const untilMs = datetime.getTime();
+    const gapMs = untilMs - model.anchorMs;
+    if (gapMs > PREDICTION_MAX_GAP_MS) {
+      logger.warn('Predição: lacuna longa demais, pontos não preenchidos', {
+        sensor_id: sensorId,
+        gap_ms: gapMs,
+      });
+      return [];
+    }
+
+    const points = [];
+    for (let t = model.anchorMs + PREDICTION_FILL_MS; t < untilMs; t += PREDICTION_FILL_MS) {
+      points.push({
+        datetime: new Date(t),
+        distance_mm: this.predict(model, t),
+        slope_mm_h: model.slope_mm_h,
+      });
+    }
+    return points;
+  }
+
+  /**
+   * Leitura AGUADA-1 aceita: grava os pontos previstos desde o envio
+   * anterior e reancora a reta. Leitura sem slope_mm_h (node sem predição
+   * ou erro de leitura) só descarta o modelo. Leitura fora de ordem (flash
+   * log, lote com age_ms, retry) anterior à âncora não mexe no modelo: o
+   * intervalo já foi preenchido a partir de uma âncora mais nova.
+   *
+   * @returns {Promise<number>} pontos previstos gravados
+   */
+  async recordReading(sensor, data, datetime) {
+    const { sensor_id, elemento_id } = sensor;
+    let inserted = 0;
+
+    const model = this.models.get(sensor_id);
+    if (model && datetime.getTime() <= model.anchorMs) {
+      return 0;
+    }
+
+    try {
+      for (const point of this.pointsUntil(sensor_id, datetime)) {
+        await readingService.insertRawReading({
+          sensor_id,
+          elemento_id,
+          variavel: 'distance_cm',
+          valor: point.distance_mm / 10.0,
+          unidade: 'cm',
+          meta: {
+            node_mac: data.mac,
+            raw_value: point.distance_mm,
+            predicted: true,
+            slope_mm_h: point.slope_mm_h,
+          },
+          fonte: 'sistema',
+          autor: 'dual_prediction',
+          modo: 'prevista',
+          observacao: null,
+          datetime: point.datetime,
+        });
+        inserted++;
+      }
+    } catch (error) {
+      // Pontos previstos são complemento: a leitura medida segue adiante
+      logger.error('Erro ao gravar pontos previstos:', error);
+    }
+
+    if (typeof data.slope_mm_h === 'number') {
+      this.models.set(sensor_id, {
+        distance_mm: data.distance_mm,
+        slope_mm_h: data.slope_mm_h,
+        anchorMs: datetime.getTime(),
+      });
+    } else {
+      this.models.delete(sensor_id);
+    }
+
+    if (inserted > 0) {
+      logger.debug('Pontos previstos gravados', { sensor_id, points: inserted });
+    }
+    return inserted;
+  }
+}
+
+export default new PredictionService();
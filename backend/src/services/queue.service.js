@@ -56,7 +56,7 @@ export async function initializeQueue() {
     readingsWorker = new Worker(
       'readings-processing',
       async (job) => {
-        const { sensor, valorReal, elementoParametros, datetime, type } = job.data;
+        const { sensor, valorReal, elementoParametros, datetime, type, edge } = job.data;
         
         logger.info('Processando leitura na fila', {
           jobId: job.id,
@@ -65,14 +65,11 @@ export async function initializeQueue() {
         });
 
         try {
-          // Processar compressão se for distance_cm
+          // Processar compressão se for distance_cm ("hold" do gateway só estende)
           if (type === 'distance_cm') {
-            await compressionService.processCompression(
-              sensor,
-              valorReal,
-              elementoParametros,
-              datetime
-            );
+            const compress =
+              edge === 'hold' ? compressionService.extendHold : compressionService.processCompression;
+            await compress(sensor, valorReal, elementoParametros, datetime);
           }
 
           // Invalidar cache
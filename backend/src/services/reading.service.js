@@ -138,13 +138,14 @@ export async function insertProcessedReading(data) {
 }
 
 /**
- * Atualiza data_fim da última leitura processada (compressão)
+ * Atualiza data_fim da última leitura processada (compressão). Só avança:
+ * uma leitura atrasada (flash log, retry, hold) não recua o fim do período
  */
 export async function extendProcessedReading(procId, dataFim) {
   try {
     const query = `
       UPDATE aguada.leituras_processadas
-      SET data_fim = $1
+      SET data_fim = GREATEST(data_fim, $1)
       WHERE proc_id = $2
       RETURNING *
     `;
@@ -160,7 +161,8 @@ export async function extendProcessedReading(procId, dataFim) {
 }
 
 /**
- * Busca janela de leituras recentes para calcular estabilidade
+ * Busca janela de leituras recentes para calcular estabilidade (só medidas:
+ * os pontos da predição dupla seguem a reta e mascarariam a instabilidade)
  */
 export async function getRecentReadings(elementoId, variavel, windowSize = 11) {
   try {
@@ -168,6 +170,7 @@ export async function getRecentReadings(elementoId, variavel, windowSize = 11) {
       SELECT valor, datetime
       FROM aguada.leituras_raw
       WHERE elemento_id = $1 AND variavel = $2
+        AND modo IS DISTINCT FROM 'prevista'
       ORDER BY datetime DESC
       LIMIT $3
     `;
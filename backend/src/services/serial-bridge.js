@@ -2,6 +2,7 @@ import { SerialPort } from 'serialport';
 import { ReadlineParser } from '@serialport/parser-readline';
 import logger from '../config/logger.js';
 import fetch from 'node-fetch';
+import aguadaBinaryService from './aguada-binary.service.js';
 
 /**
  * Serial Bridge - Captura dados do Gateway ESP32 via USB
@@ -143,18 +144,42 @@ class SerialBridge {
       // Validar estrutura esperada
       // Formato antigo: {mac, type, value}
       // Formato AGUADA-1: {mac, distance_mm, vcc_bat_mv, rssi}
+      // Binário AGUADA-1: {mac, bin, rssi} - decodificado pelo backend
+      // Multicanal: {mac, vcc_bat_mv, rssi, channels: [{mac, distance_mm}, ...]}
       const isAguada1Format = data.mac && data.distance_mm !== undefined;
       const isOldFormat = data.mac && data.type && data.value !== undefined;
+      const isBinaryFormat = typeof data.bin === 'string';
+      const isMultiFormat = aguadaBinaryService.isMultiChannelItem(data);
       
-      if (!isAguada1Format && !isOldFormat) {
+      if (!isAguada1Format && !isOldFormat && !isBinaryFormat && !isMultiFormat) {
         logger.warn(`[Serial Bridge] JSON recebido mas estrutura inválida:`, data);
         return;
       }
 
+      // Multicanal: uma leitura por sensor, cada uma com o MAC do canal
+      const readings = isMultiFormat ? aguadaBinaryService.expandMultiChannel(data) : null;
+      if (isMultiFormat && !readings) {
+        this.stats.errors++;
+        return;
+      }
+
       this.stats.packetsReceived++;
       this.stats.lastPacketTime = new Date();
 
-      if (isAguada1Format) {
+      if (isMultiFormat) {
+        logger.info(`[Serial Bridge] 📡 Frame multicanal recebido (${readings.length} canais):`, {
+          mac: data.mac,
+          vcc_bat_mv: data.vcc_bat_mv,
+          rssi: data.rssi,
+          channels: readings.map((reading) => `${reading.mac}=${reading.distance_mm}`),
+        });
+      } else if (isBinaryFormat) {
+        logger.info(`[Serial Bridge] 📡 Frame binário AGUADA-1 recebido:`, {
+          mac: data.mac,
+          bin: data.bin,
+          rssi: data.rssi,
+        });
+      } else if (isAguada1Format) {
         logger.info(`[Serial Bridge] 📡 Telemetria AGUADA-1 recebida:`, {
           mac: data.mac,
           distance_mm: data.distance_mm,
@@ -169,8 +194,14 @@ class SerialBridge {
         });
       }
 
-      // Enviar ao backend
-      await this.sendToBackend(data);
+      // Enviar ao backend (multicanal: um POST por sensor)
+      if (readings) {
+        for (const reading of readings) {
+          await this.sendToBackend(reading);
+        }
+      } else {
+        await this.sendToBackend(data);
+      }
 
     } catch (error) {
       // Não é JSON ou erro no parse - ignorar silenciosamente
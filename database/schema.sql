@@ -123,7 +123,7 @@ CREATE TABLE leituras_raw (
   meta JSONB,  -- {battery, rssi, temperature, etc.}
   fonte VARCHAR(20) NOT NULL,  -- 'sensor', 'usuario', 'sistema'
   autor VARCHAR(100),  -- node_mac, username, process_name
-  modo VARCHAR(20),  -- 'automatica', 'manual'
+  modo VARCHAR(20),  -- 'automatica', 'manual', 'prevista' (predição dupla)
   observacao TEXT,
   datetime TIMESTAMPTZ NOT NULL,
   processed BOOLEAN DEFAULT FALSE,
@@ -0,0 +1,65 @@
+/**
+ * AGUADA - Densidade de amostragem adaptativa
+ */
+
+#include "aguada_adapt.h"
+
+#include <string.h>
+
+static void apply_level(aguada_adapt_t *adapt)
+{
+    const aguada_adapt_config_t *cfg = adapt->cfg;
+
+    // Mantém ímpar para a mediana cair numa amostra real
+    uint8_t samples = (uint8_t)((cfg->dense_samples >> adapt->level) | 1);
+    if (samples < cfg->sparse_samples)
+    {
+        samples = cfg->sparse_samples;
+    }
+    if (samples > cfg->dense_samples)
+    {
+        samples = cfg->dense_samples;
+    }
+
+    adapt->samples = samples;
+    adapt->interval_ms = cfg->base_interval_ms << adapt->level;
+}
+
+void aguada_adapt_init(aguada_adapt_t *adapt, const aguada_adapt_config_t *cfg)
+{
+    memset(adapt, 0, sizeof(*adapt));
+    adapt->cfg = cfg;
+    apply_level(adapt);
+}
+
+bool aguada_adapt_stable(aguada_adapt_t *adapt)
+{
+    if (adapt->level >= adapt->cfg->max_stretch_log2)
+    {
+        return false;
+    }
+
+    if (++adapt->stable_run < adapt->cfg->stable_reads)
+    {
+        return false;
+    }
+
+    adapt->stable_run = 0;
+    adapt->level++;
+    apply_level(adapt);
+    return true;
+}
+
+bool aguada_adapt_change(aguada_adapt_t *adapt)
+{
+    adapt->stable_run = 0;
+    if (adapt->level == 0)
+    {
+        return false;
+    }
+
+    adapt->level = 0;
+    adapt->dense_ramps++;
+    apply_level(adapt);
+    return true;
+}
@@ -0,0 +1,135 @@
+/**
+ * AGUADA - Pipeline de filtragem em ponto fixo
+ */
+
+#include "aguada_dsp.h"
+
+#include <string.h>
+
+// ============================================================================
+// AUXILIARES
+// ============================================================================
+
+static inline int32_t abs32(int32_t v)
+{
+    return (v < 0) ? -v : v;
+}
+
+void aguada_dsp_init(aguada_dsp_t *dsp, const aguada_dsp_config_t *cfg)
+{
+    memset(dsp, 0, sizeof(*dsp));
+    dsp->cfg = cfg;
+}
+
+// ============================================================================
+// HAMPEL
+// ============================================================================
+
+int32_t aguada_dsp_hampel(aguada_dsp_t *dsp, int32_t x)
+{
+    const aguada_dsp_config_t *cfg = dsp->cfg;
+    uint8_t window = cfg->hampel_window;
+    if (window == 0)
+    {
+        return x;
+    }
+    if (window > AGUADA_DSP_HAMPEL_MAX)
+    {
+        window = AGUADA_DSP_HAMPEL_MAX;
+    }
+
+    int32_t out = x;
+
+    // Só julga com histórico mínimo (3 leituras)
+    if (dsp->hist_len >= 3)
+    {
+        int32_t tmp[AGUADA_DSP_HAMPEL_MAX];
+        memcpy(tmp, dsp->hist, dsp->hist_len * sizeof(int32_t));
+        int32_t med = aguada_select_median(tmp, dsp->hist_len);
+
+        for (uint8_t i = 0; i < dsp->hist_len; i++)
+        {
+            tmp[i] = abs32(dsp->hist[i] - med);
+        }
+        int32_t mad = aguada_select_median(tmp, dsp->hist_len);
+
+        int32_t limit = (int32_t)(((int64_t)mad * cfg->hampel_k_q8) >> 8);
+        if (limit < cfg->hampel_min_mm)
+        {
+            limit = cfg->hampel_min_mm;
+        }
+
+        if (abs32(x - med) > limit)
+        {
+            dsp->outliers++;
+            out = med;
+        }
+    }
+
+    dsp->hist[dsp->hist_pos] = x;
+    dsp->hist_pos = (uint8_t)((dsp->hist_pos + 1) % window);
+    if (dsp->hist_len < window)
+    {
+        dsp->hist_len++;
+    }
+
+    return out;
+}
+
+// ============================================================================
+// EMA Q15
+// ============================================================================
+
+int32_t aguada_dsp_ema(aguada_dsp_t *dsp, int32_t x)
+{
+    uint16_t alpha = dsp->cfg->ema_alpha_q15;
+    if (alpha == 0)
+    {
+        return x;
+    }
+
+    int32_t x_q8 = x * (1 << AGUADA_DSP_EMA_FRAC);
+
+    if (!dsp->ema_initialized)
+    {
+        dsp->ema_q8 = x_q8;
+        dsp->ema_initialized = true;
+        return x;
+    }
+
+    // y += alpha · (x - y)
+    dsp->ema_q8 += aguada_dsp_mul_fix(x_q8 - dsp->ema_q8, alpha, 15);
+
+    // Arredondar para mm
+    return (dsp->ema_q8 + (1 << (AGUADA_DSP_EMA_FRAC - 1))) >> AGUADA_DSP_EMA_FRAC;
+}
+
+int32_t aguada_dsp_filter(aguada_dsp_t *dsp, int32_t median)
+{
+    return aguada_dsp_ema(dsp, aguada_dsp_hampel(dsp, median));
+}
+
+// ============================================================================
+// DEADBAND / HISTERESE
+// ============================================================================
+
+bool aguada_dsp_deadband(aguada_dsp_t *dsp, int32_t value, int32_t reference)
+{
+    const aguada_dsp_config_t *cfg = dsp->cfg;
+    int32_t delta = value - reference;
+    int32_t threshold = cfg->deadband_mm;
+
+    // Inversão de tendência (ou partida do repouso) exige delta + histerese
+    if ((delta > 0 && dsp->trend <= 0) || (delta < 0 && dsp->trend >= 0))
+    {
+        threshold += cfg->hysteresis_mm;
+    }
+
+    if (abs32(delta) >= threshold)
+    {
+        dsp->trend = (delta > 0) ? 1 : -1;
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,142 @@
+/**
+ * AGUADA - Compressão por deadband na borda (gateway), espelho do backend
+ */
+
+#include "aguada_edge.h"
+
+#include <string.h>
+
+// Códigos de erro do sensor em distance_mm (timeout, fora de alcance)
+#define EDGE_ERROR_MAX_MM 1
+
+void aguada_edge_init(aguada_edge_t *edge, const aguada_edge_config_t *cfg)
+{
+    memset(edge, 0, sizeof(*edge));
+    edge->cfg = cfg;
+}
+
+/**
+ * Entrada do sensor (nova, ou a vista há mais tempo se a tabela encheu)
+ */
+static aguada_edge_sensor_t *sensor_slot(aguada_edge_t *edge, const uint8_t *mac)
+{
+    aguada_edge_sensor_t *free_slot = NULL;
+    aguada_edge_sensor_t *oldest = &edge->sensors[0];
+
+    for (int i = 0; i < AGUADA_EDGE_TABLE_SIZE; i++)
+    {
+        aguada_edge_sensor_t *sensor = &edge->sensors[i];
+        if (!sensor->used)
+        {
+            if (!free_slot)
+            {
+                free_slot = sensor;
+            }
+            continue;
+        }
+        if (memcmp(sensor->mac, mac, 6) == 0)
+        {
+            return sensor;
+        }
+        if (sensor->seen_us < oldest->seen_us)
+        {
+            oldest = sensor;
+        }
+    }
+
+    aguada_edge_sensor_t *sensor = free_slot;
+    if (!sensor)
+    {
+        sensor = oldest;
+        edge->evictions++;
+    }
+    memset(sensor, 0, sizeof(*sensor));
+    memcpy(sensor->mac, mac, 6);
+    sensor->used = true;
+    return sensor;
+}
+
+/**
+ * Desvio padrão populacional da janela > limite, sem raiz:
+ * n·Σx² - (Σx)² > (n·limite)²
+ */
+static bool window_unstable(const aguada_edge_sensor_t *sensor, int32_t stability_mm)
+{
+    int64_t sum = 0;
+    int64_t sum_sq = 0;
+    for (int i = 0; i < sensor->count; i++)
+    {
+        sum += sensor->window[i];
+        sum_sq += (int64_t)sensor->window[i] * sensor->window[i];
+    }
+    int64_t n = sensor->count;
+    int64_t limit = n * stability_mm;
+    return n * sum_sq - sum * sum > limit * limit;
+}
+
+aguada_edge_verdict_t aguada_edge_filter(aguada_edge_t *edge, const uint8_t *mac, int32_t distance_mm,
+                                         int64_t now_us)
+{
+    const aguada_edge_config_t *cfg = edge->cfg;
+
+    if (distance_mm <= EDGE_ERROR_MAX_MM)
+    {
+        return AGUADA_EDGE_PASS;
+    }
+
+    aguada_edge_sensor_t *sensor = sensor_slot(edge, mac);
+    uint8_t window_size = (cfg->window_size > AGUADA_EDGE_WINDOW_MAX) ? AGUADA_EDGE_WINDOW_MAX : cfg->window_size;
+
+    // A janela inclui a leitura atual (no backend ela já está em leituras_raw)
+    sensor->window[sensor->head] = distance_mm;
+    sensor->head = (uint8_t)((sensor->head + 1) % window_size);
+    if (sensor->count < window_size)
+    {
+        sensor->count++;
+    }
+    sensor->seen_us = now_us;
+
+    bool extend = false;
+    if (sensor->valid)
+    {
+        int32_t delta = distance_mm - sensor->ref_mm;
+        if (delta < 0)
+        {
+            delta = -delta;
+        }
+        extend = delta <= cfg->deadband_mm ||
+                 (sensor->count < window_size && window_unstable(sensor, cfg->stability_mm));
+    }
+
+    if (!extend)
+    {
+        sensor->valid = true;
+        sensor->ref_mm = distance_mm;
+        sensor->forwarded_us = now_us;
+        edge->changes++;
+        return AGUADA_EDGE_CHANGE;
+    }
+
+    if (now_us - sensor->forwarded_us >= (int64_t)cfg->keepalive_ms * 1000)
+    {
+        sensor->forwarded_us = now_us;
+        edge->holds++;
+        return AGUADA_EDGE_HOLD;
+    }
+
+    edge->dropped++;
+    return AGUADA_EDGE_DROP;
+}
+
+const char *aguada_edge_tag(aguada_edge_verdict_t verdict)
+{
+    switch (verdict)
+    {
+    case AGUADA_EDGE_CHANGE:
+        return "change";
+    case AGUADA_EDGE_HOLD:
+        return "hold";
+    default:
+        return NULL;
+    }
+}
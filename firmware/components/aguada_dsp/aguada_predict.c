@@ -0,0 +1,78 @@
+/**
+ * AGUADA - Predição dupla (modelo linear compartilhado node ↔ backend)
+ */
+
+#include "aguada_predict.h"
+
+#include <string.h>
+
+void aguada_predict_init(aguada_predict_t *pred, const aguada_predict_config_t *cfg)
+{
+    memset(pred, 0, sizeof(*pred));
+    pred->cfg = cfg;
+}
+
+int32_t aguada_predict_value(const aguada_predict_t *pred, uint32_t now_ms)
+{
+    if (!pred->valid)
+    {
+        return 0;
+    }
+
+    // Divisão C trunca em direção a zero - o backend usa Math.trunc
+    uint32_t dt_ms = now_ms - pred->anchor_ms;
+    int64_t drift = (int64_t)pred->slope_mm_h * dt_ms / AGUADA_PREDICT_MS_PER_H;
+    return pred->value_mm + (int32_t)drift;
+}
+
+bool aguada_predict_deviates(aguada_predict_t *pred, int32_t value, uint32_t now_ms)
+{
+    if (!pred->valid)
+    {
+        return true;
+    }
+
+    int32_t error = value - aguada_predict_value(pred, now_ms);
+    if (error < 0)
+    {
+        error = -error;
+    }
+    if (error >= pred->cfg->deadband_mm)
+    {
+        return true;
+    }
+
+    pred->suppressed++;
+    return false;
+}
+
+int32_t aguada_predict_slope(const aguada_predict_t *pred, int32_t value, uint32_t now_ms)
+{
+    uint32_t dt_ms = now_ms - pred->anchor_ms;
+    if (!pred->valid || !pred->has_base || dt_ms == 0)
+    {
+        return 0;
+    }
+
+    int64_t slope = (int64_t)(value - pred->value_mm) * AGUADA_PREDICT_MS_PER_H / dt_ms;
+    int32_t max = pred->cfg->max_slope_mm_h;
+    return (slope > max) ? max : (slope < -max) ? -max : (int32_t)slope;
+}
+
+void aguada_predict_commit(aguada_predict_t *pred, int32_t value, int32_t slope_mm_h, uint32_t now_ms)
+{
+    pred->valid = true;
+    pred->has_base = true;
+    pred->value_mm = value;
+    pred->slope_mm_h = slope_mm_h;
+    pred->anchor_ms = now_ms;
+}
+
+void aguada_predict_hold(aguada_predict_t *pred, int32_t value, uint32_t now_ms)
+{
+    pred->valid = true;
+    pred->has_base = false;
+    pred->value_mm = value;
+    pred->slope_mm_h = 0;
+    pred->anchor_ms = now_ms;
+}
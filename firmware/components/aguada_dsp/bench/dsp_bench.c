@@ -0,0 +1,473 @@
+/**
+ * AGUADA - Bench de host do pipeline de filtragem
+ *
+ * Confere o pipeline em ponto fixo contra o caminho float antigo dos nodes
+ * (qsort + EMA float), aborta se divergirem mais que 1 mm, e mede ciclos/op
+ * (rdtsc no x86, rdcycle no RISC-V) e ns/op de cada um.
+ *
+ * No host o float roda em FPU; no ESP32-C3 (sem FPU) o caminho float paga
+ * soft-float, então a diferença no alvo é maior que a medida aqui.
+ *
+ * Uso: dsp_bench [iterações]   (padrão 1000000)
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "aguada_adapt.h"
+#include "aguada_dsp.h"
+#include "aguada_edge.h"
+#include "aguada_predict.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define SAMPLES 11 // SAMPLES_PER_READ dos nodes
+
+static volatile int32_t sink; // Impede o compilador de eliminar os laços
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint64_t cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__riscv)
+    uint64_t c;
+    __asm__ volatile("rdcycle %0" : "=r"(c));
+    return c;
+#else
+    return 0;
+#endif
+}
+
+static void report(const char *name, double elapsed_ns, uint64_t elapsed_cycles, long iterations)
+{
+    printf("  %-28s %8.1f ns/op", name, elapsed_ns / (double)iterations);
+    if (elapsed_cycles > 0)
+    {
+        printf("  %8.1f ciclos/op", (double)elapsed_cycles / (double)iterations);
+    }
+    printf("\n");
+}
+
+#define CHECK(cond)                                                     \
+    do                                                                  \
+    {                                                                   \
+        if (!(cond))                                                    \
+        {                                                               \
+            fprintf(stderr, "FALHA %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                    \
+        }                                                               \
+    } while (0)
+
+// ============================================================================
+// REFERÊNCIA (caminho float antigo dos nodes)
+// ============================================================================
+
+#define EMA_ALPHA 0.3
+
+typedef struct
+{
+    float ema_distance_mm;
+    int ema_initialized;
+} float_state_t;
+
+static int compare_int(const void *a, const void *b)
+{
+    return (*(int *)a - *(int *)b);
+}
+
+static int float_process(float_state_t *st, int *samples, int n)
+{
+    qsort(samples, n, sizeof(int), compare_int);
+    int median = samples[n / 2];
+
+    if (!st->ema_initialized)
+    {
+        st->ema_distance_mm = (float)median;
+        st->ema_initialized = 1;
+        return median;
+    }
+    st->ema_distance_mm = EMA_ALPHA * (float)median + (1.0f - EMA_ALPHA) * st->ema_distance_mm;
+    return (int)(st->ema_distance_mm + 0.5f);
+}
+
+// ============================================================================
+// SINAL SINTÉTICO
+// ============================================================================
+
+static uint32_t rng_state = 12345;
+
+static uint32_t rng(void)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 16;
+}
+
+// Nível descendo devagar (tanque esvaziando) com ruído de ±6 mm
+static void make_read(int32_t *out, long t)
+{
+    int32_t level = 2500 - (int32_t)(t % 2000) / 4;
+    for (int i = 0; i < SAMPLES; i++)
+    {
+        out[i] = level + (int32_t)(rng() % 13) - 6;
+    }
+}
+
+// ============================================================================
+// PREDIÇÃO DUPLA (envios: deadband fixo × reta compartilhada)
+// ============================================================================
+
+#define PREDICT_READ_MS 2000 // READ_INTERVAL_MS dos nodes
+
+// Perfil de tanque: enche 300 mm/h por 1 h, parado 1 h, esvazia 600 mm/h
+// por 30 min; ruído de ±3 mm depois da EMA
+static int32_t tank_level(long t_ms)
+{
+    int32_t level;
+    if (t_ms < 3600000L)
+    {
+        level = 1000 + (int32_t)(t_ms * 300 / 3600000L);
+    }
+    else if (t_ms < 7200000L)
+    {
+        level = 1300;
+    }
+    else
+    {
+        level = 1300 - (int32_t)((t_ms - 7200000L) * 600 / 3600000L);
+    }
+    return level + (int32_t)(rng() % 7) - 3;
+}
+
+typedef struct
+{
+    uint32_t deadband_sends;
+    uint32_t predict_sends;
+    int32_t predict_max_error; // |leitura - previsto| nas leituras suprimidas
+} predict_run_t;
+
+static predict_run_t predict_simulate(void)
+{
+    static const aguada_dsp_config_t db = AGUADA_DSP_CONFIG(0.3, 0, 3.0, 30, 15, 3);
+    static const aguada_predict_config_t pcfg = {.deadband_mm = 15, .max_slope_mm_h = 100000};
+    aguada_dsp_t dsp;
+    aguada_predict_t pred;
+    predict_run_t run = {0};
+    int32_t last_sent = 0;
+
+    aguada_dsp_init(&dsp, &db);
+    aguada_predict_init(&pred, &pcfg);
+    rng_state = 4242;
+
+    for (long t = 0; t < 9000000L; t += PREDICT_READ_MS)
+    {
+        int32_t v = tank_level(t);
+
+        if (t == 0 || aguada_dsp_deadband(&dsp, v, last_sent))
+        {
+            last_sent = v;
+            run.deadband_sends++;
+        }
+
+        if (aguada_predict_deviates(&pred, v, (uint32_t)t))
+        {
+            aguada_predict_commit(&pred, v, aguada_predict_slope(&pred, v, (uint32_t)t), (uint32_t)t);
+            run.predict_sends++;
+        }
+        else
+        {
+            int32_t error = abs(v - aguada_predict_value(&pred, (uint32_t)t));
+            if (error > run.predict_max_error)
+            {
+                run.predict_max_error = error;
+            }
+        }
+    }
+    return run;
+}
+
+// ============================================================================
+// COMPRESSÃO NA BORDA (frames recebidos × repassados pelo gateway)
+// ============================================================================
+
+#define EDGE_KEEPALIVE_MS 55000
+
+typedef struct
+{
+    uint32_t received;
+    uint32_t forwarded;   // "change" + "hold"
+    uint32_t max_gap_ms;  // Maior silêncio entre repasses
+} edge_run_t;
+
+// O mesmo perfil de tanque, cada leitura chegando ao gateway
+static edge_run_t edge_simulate(void)
+{
+    static const aguada_edge_config_t cfg = {
+        .deadband_mm = 20,
+        .stability_mm = 5,
+        .window_size = 11,
+        .keepalive_ms = EDGE_KEEPALIVE_MS,
+    };
+    static aguada_edge_t edge;
+    static const uint8_t mac[6] = {0x20, 0x6e, 0xf1, 0x00, 0x00, 0x01};
+    edge_run_t run = {0};
+    long last_ms = 0;
+
+    aguada_edge_init(&edge, &cfg);
+    rng_state = 4242;
+
+    for (long t = 0; t < 9000000L; t += PREDICT_READ_MS)
+    {
+        run.received++;
+        if (aguada_edge_filter(&edge, mac, tank_level(t), (int64_t)t * 1000) != AGUADA_EDGE_DROP)
+        {
+            if ((uint32_t)(t - last_ms) > run.max_gap_ms)
+            {
+                run.max_gap_ms = (uint32_t)(t - last_ms);
+            }
+            last_ms = t;
+            run.forwarded++;
+        }
+    }
+    return run;
+}
+
+// ============================================================================
+// CONFERÊNCIA
+// ============================================================================
+
+static void self_check(void)
+{
+    CHECK(AGUADA_DSP_Q15(0.3) == 9830);
+    CHECK(aguada_dsp_mul_fix(2457, AGUADA_DSP_FIX(2.0, 10), 10) == 4914);
+
+    int32_t v[] = {5, 1, 4, 2, 3};
+    CHECK(aguada_select_median(v, 5) == 3);
+
+    // EMA fixa acompanha a float em ±1 mm (sem Hampel, mesma entrada)
+    static const aguada_dsp_config_t ema_only = AGUADA_DSP_CONFIG(EMA_ALPHA, 0, 3.0, 30, 15, 3);
+    aguada_dsp_t dsp;
+    float_state_t fst = {0};
+    aguada_dsp_init(&dsp, &ema_only);
+    for (long t = 0; t < 20000; t++)
+    {
+        int32_t a[SAMPLES];
+        int b[SAMPLES];
+        make_read(a, t);
+        for (int i = 0; i < SAMPLES; i++)
+        {
+            b[i] = a[i];
+        }
+        int32_t fixed = aguada_dsp_process(&dsp, a, SAMPLES);
+        int ref = float_process(&fst, b, SAMPLES);
+        CHECK(abs(fixed - ref) <= 1);
+    }
+
+    // Hampel troca um pico isolado e deixa um degrau real passar
+    static const aguada_dsp_config_t hampel = AGUADA_DSP_CONFIG(1.0, 5, 3.0, 30, 15, 3);
+    aguada_dsp_init(&dsp, &hampel);
+    for (int i = 0; i < 5; i++)
+    {
+        CHECK(aguada_dsp_hampel(&dsp, 2000 + i) == 2000 + i);
+    }
+    CHECK(aguada_dsp_hampel(&dsp, 900) != 900 && dsp.outliers == 1);
+    CHECK(aguada_dsp_hampel(&dsp, 1500) != 1500);
+    CHECK(aguada_dsp_hampel(&dsp, 1500) != 1500);
+    CHECK(aguada_dsp_hampel(&dsp, 1500) == 1500);
+
+    // Deadband: 15 mm; na inversão exige 15 + 3
+    static const aguada_dsp_config_t db = AGUADA_DSP_CONFIG(0.3, 0, 3.0, 30, 15, 3);
+    aguada_dsp_init(&dsp, &db);
+    CHECK(!aguada_dsp_deadband(&dsp, 1016, 1000));
+    CHECK(aguada_dsp_deadband(&dsp, 1018, 1000) && dsp.trend == 1);
+    CHECK(aguada_dsp_deadband(&dsp, 1033, 1018));
+    CHECK(!aguada_dsp_deadband(&dsp, 1016, 1033));
+    CHECK(aguada_dsp_deadband(&dsp, 1015, 1033) && dsp.trend == -1);
+
+    // Amostragem adaptativa: 11 → 5 → 3 amostras, 2 s → 4 s → 8 s, volta ao denso
+    static const aguada_adapt_config_t adapt_cfg = {
+        .dense_samples = 11,
+        .sparse_samples = 3,
+        .base_interval_ms = 2000,
+        .max_stretch_log2 = 2,
+        .stable_reads = 4,
+    };
+    aguada_adapt_t adapt;
+    aguada_adapt_init(&adapt, &adapt_cfg);
+    CHECK(adapt.samples == 11 && adapt.interval_ms == 2000);
+    for (int i = 0; i < 3; i++)
+    {
+        CHECK(!aguada_adapt_stable(&adapt));
+    }
+    CHECK(aguada_adapt_stable(&adapt) && adapt.samples == 5 && adapt.interval_ms == 4000);
+    for (int i = 0; i < 4; i++)
+    {
+        aguada_adapt_stable(&adapt);
+    }
+    CHECK(adapt.level == 2 && adapt.samples == 3 && adapt.interval_ms == 8000);
+    CHECK(!aguada_adapt_stable(&adapt) && adapt.level == 2);
+    CHECK(aguada_adapt_change(&adapt) && adapt.samples == 11 && adapt.dense_ramps == 1);
+    CHECK(!aguada_adapt_change(&adapt));
+
+    // Predição dupla: sem âncora sempre envia; inclinação = taxa desde a âncora
+    static const aguada_predict_config_t pcfg = {.deadband_mm = 15, .max_slope_mm_h = 100000};
+    aguada_predict_t pred;
+    aguada_predict_init(&pred, &pcfg);
+    CHECK(aguada_predict_deviates(&pred, 1000, 0));
+    CHECK(aguada_predict_slope(&pred, 1000, 0) == 0);
+    aguada_predict_commit(&pred, 1000, 0, 0);
+    CHECK(!aguada_predict_deviates(&pred, 1014, 10000) && pred.suppressed == 1);
+    CHECK(aguada_predict_deviates(&pred, 1015, 20000));
+    CHECK(aguada_predict_slope(&pred, 1015, 20000) == 2700);
+    aguada_predict_commit(&pred, 1015, 2700, 20000);
+    CHECK(aguada_predict_value(&pred, 60000) == 1045);
+    CHECK(!aguada_predict_deviates(&pred, 1050, 60000));
+    CHECK(aguada_predict_slope(&pred, 1000, 240000) == -245);
+    aguada_predict_commit(&pred, 1000, -245, 240000);
+    CHECK(aguada_predict_value(&pred, 241000) == 1000); // -0,07 mm trunca para 0
+    CHECK(aguada_predict_value(&pred, 255000) == 999);
+
+    // Código de erro: reta parada; a próxima âncora não usa o erro como base
+    aguada_predict_hold(&pred, 0, 300000);
+    CHECK(!aguada_predict_deviates(&pred, 0, 310000));
+    CHECK(aguada_predict_deviates(&pred, 1000, 320000));
+    CHECK(aguada_predict_slope(&pred, 1000, 320000) == 0);
+
+    // Relógio de 32 bits dando a volta e teto da inclinação
+    aguada_predict_commit(&pred, 1000, 0, UINT32_MAX - 999);
+    CHECK(aguada_predict_slope(&pred, 1100, 1000) == 100000);
+    aguada_predict_commit(&pred, 1100, 100000, 1000);
+    CHECK(aguada_predict_value(&pred, 37000) == 2100);
+
+    // Enchimento/esvaziamento a taxa constante: vários envios a menos, mesmo erro
+    predict_run_t run = predict_simulate();
+    CHECK(run.predict_max_error < 15);
+    CHECK(run.predict_sends * 3 <= run.deadband_sends);
+
+    // Borda: deadband de 20 mm; instável com a janela incompleta só estende
+    static const aguada_edge_config_t edge_cfg = {
+        .deadband_mm = 20,
+        .stability_mm = 5,
+        .window_size = 4,
+        .keepalive_ms = 10000,
+    };
+    static aguada_edge_t edge;
+    static const uint8_t mac_a[6] = {1, 2, 3, 4, 5, 6};
+    uint8_t mac_n[6] = {9, 9, 9, 9, 0, 0};
+    aguada_edge_init(&edge, &edge_cfg);
+    CHECK(aguada_edge_filter(&edge, mac_a, 1000, 0) == AGUADA_EDGE_CHANGE);
+    CHECK(aguada_edge_filter(&edge, mac_a, 1010, 1000000) == AGUADA_EDGE_DROP);
+    CHECK(aguada_edge_filter(&edge, mac_a, 1030, 2000000) == AGUADA_EDGE_DROP);
+    CHECK(aguada_edge_filter(&edge, mac_a, 1030, 3000000) == AGUADA_EDGE_CHANGE);
+    CHECK(aguada_edge_filter(&edge, mac_a, 1050, 4000000) == AGUADA_EDGE_DROP);
+    CHECK(aguada_edge_filter(&edge, mac_a, 1051, 5000000) == AGUADA_EDGE_CHANGE);
+    CHECK(aguada_edge_filter(&edge, mac_a, 1045, 15000000) == AGUADA_EDGE_HOLD);
+    CHECK(aguada_edge_filter(&edge, mac_a, 1045, 16000000) == AGUADA_EDGE_DROP);
+    CHECK(aguada_edge_filter(&edge, mac_a, 1, 17000000) == AGUADA_EDGE_PASS);
+    CHECK(edge.changes == 3 && edge.holds == 1 && edge.dropped == 4);
+    CHECK(strcmp(aguada_edge_tag(AGUADA_EDGE_HOLD), "hold") == 0 && !aguada_edge_tag(AGUADA_EDGE_DROP));
+
+    // Tabela cheia: sai o sensor visto há mais tempo (mac_a, em 16 s)
+    for (int i = 0; i < AGUADA_EDGE_TABLE_SIZE; i++)
+    {
+        mac_n[5] = (uint8_t)i;
+        CHECK(aguada_edge_filter(&edge, mac_n, 2000, 20000000 + i) == AGUADA_EDGE_CHANGE);
+    }
+    CHECK(edge.evictions == 1);
+    CHECK(aguada_edge_filter(&edge, mac_a, 1045, 30000000) == AGUADA_EDGE_CHANGE && edge.evictions == 2);
+
+    // Perfil de tanque: poucos repasses, silêncio limitado pelo keep-alive
+    edge_run_t edge_run = edge_simulate();
+    CHECK(edge_run.max_gap_ms <= EDGE_KEEPALIVE_MS + PREDICT_READ_MS); // Hold sai na primeira leitura após o keep-alive
+    CHECK(edge_run.forwarded * 5 <= edge_run.received);
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main(int argc, char **argv)
+{
+    long iterations = (argc > 1) ? atol(argv[1]) : 1000000;
+    if (iterations <= 0)
+    {
+        iterations = 1000000;
+    }
+
+    self_check();
+    printf("aguada_dsp bench (%ld leituras de %d amostras)\n", iterations, SAMPLES);
+
+    // Entradas pré-geradas (o gerador não entra na medição)
+    enum { SET = 1024 };
+    static int32_t reads[SET][SAMPLES];
+    for (long t = 0; t < SET; t++)
+    {
+        make_read(reads[t], t);
+    }
+
+    static const aguada_dsp_config_t cfg = AGUADA_DSP_CONFIG(EMA_ALPHA, 5, 3.0, 30, 15, 3);
+    aguada_dsp_t dsp;
+    float_state_t fst = {0};
+    int32_t a[SAMPLES];
+    int b[SAMPLES];
+    double t0;
+    uint64_t c0;
+
+    aguada_dsp_init(&dsp, &cfg);
+    t0 = now_ns();
+    c0 = cycles();
+    for (long i = 0; i < iterations; i++)
+    {
+        memcpy(a, reads[i & (SET - 1)], sizeof(a));
+        sink += aguada_dsp_process(&dsp, a, SAMPLES);
+    }
+    report("ponto fixo (med+hampel+ema)", now_ns() - t0, cycles() - c0, iterations);
+    uint32_t outliers = dsp.outliers;
+
+    aguada_dsp_init(&dsp, &cfg);
+    t0 = now_ns();
+    c0 = cycles();
+    for (long i = 0; i < iterations; i++)
+    {
+        memcpy(a, reads[i & (SET - 1)], sizeof(a));
+        sink += aguada_dsp_ema(&dsp, aguada_select_median(a, SAMPLES));
+    }
+    report("ponto fixo (med+ema)", now_ns() - t0, cycles() - c0, iterations);
+
+    t0 = now_ns();
+    c0 = cycles();
+    for (long i = 0; i < iterations; i++)
+    {
+        const int32_t *src = reads[i & (SET - 1)];
+        for (int k = 0; k < SAMPLES; k++)
+        {
+            b[k] = src[k];
+        }
+        sink += float_process(&fst, b, SAMPLES);
+    }
+    report("float (qsort+ema)", now_ns() - t0, cycles() - c0, iterations);
+
+    printf("  outliers trocados pelo Hampel: %" PRIu32 "\n", outliers);
+
+    predict_run_t run = predict_simulate();
+    printf("  envios em 2,5 h de enche/para/esvazia: deadband %" PRIu32 ", predição dupla %" PRIu32
+           " (erro máx. %" PRId32 " mm)\n",
+           run.deadband_sends, run.predict_sends, run.predict_max_error);
+
+    edge_run_t edge_run = edge_simulate();
+    printf("  gateway, mesmo perfil: %" PRIu32 " leituras recebidas, %" PRIu32
+           " repassadas (maior silêncio %" PRIu32 " s)\n",
+           edge_run.received, edge_run.forwarded, edge_run.max_gap_ms / 1000);
+    return 0;
+}
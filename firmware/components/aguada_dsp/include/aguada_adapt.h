@@ -0,0 +1,54 @@
+/**
+ * AGUADA - Densidade de amostragem adaptativa
+ *
+ * Tanque parado é o caso comum: não faz sentido gastar 11 ecos a cada 2 s.
+ * O controlador desce um degrau de economia a cada `stable_reads` leituras
+ * estáveis seguidas (RLE sem reset, sem delta no should_send):
+ *
+ *   nível 0: dense_samples,  base_interval_ms        (denso)
+ *   nível n: amostras / 2^n (ímpar, >= sparse_samples), intervalo × 2^n
+ *   ...até max_stretch_log2
+ *
+ * Qualquer mudança detectada (reset do RLE, delta/inversão de tendência)
+ * volta direto ao nível 0. Só inteiros: pode ficar em RTC RAM.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct
+{
+    uint8_t dense_samples;     // Amostras por leitura no nível 0
+    uint8_t sparse_samples;    // Mínimo de amostras por leitura
+    uint32_t base_interval_ms; // Intervalo entre leituras no nível 0
+    uint8_t max_stretch_log2;  // Intervalo máximo = base × 2^max_stretch_log2
+    uint16_t stable_reads;     // Leituras estáveis por degrau
+} aguada_adapt_config_t;
+
+typedef struct
+{
+    const aguada_adapt_config_t *cfg;
+    uint8_t level;        // 0 = denso
+    uint16_t stable_run;  // Leituras estáveis desde o último degrau
+    uint8_t samples;      // Amostras da próxima leitura
+    uint32_t interval_ms; // Espera até a próxima leitura
+    uint32_t dense_ramps; // Vezes que uma mudança forçou o nível 0
+} aguada_adapt_t;
+
+void aguada_adapt_init(aguada_adapt_t *adapt, const aguada_adapt_config_t *cfg);
+
+/**
+ * Leitura sem mudança
+ *
+ * @return true se desceu um degrau (menos amostras / intervalo maior)
+ */
+bool aguada_adapt_stable(aguada_adapt_t *adapt);
+
+/**
+ * Mudança detectada: volta ao denso imediatamente
+ *
+ * @return true se não estava no denso
+ */
+bool aguada_adapt_change(aguada_adapt_t *adapt);
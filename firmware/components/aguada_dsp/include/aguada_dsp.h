@@ -0,0 +1,147 @@
+/**
+ * AGUADA - Pipeline de filtragem em ponto fixo
+ *
+ * O ESP32-C3 não tem FPU: float/double viram chamadas de soft-float. Este
+ * componente faz toda a cadeia de filtragem da distância só com inteiros:
+ *
+ *   amostras → mediana → Hampel (entre leituras) → EMA Q15 → deadband/histerese
+ *
+ * - Mediana: das amostras de uma leitura (rejeita ecos perdidos), por rede
+ *   de seleção (aguada_select) ou mediana móvel entre leituras
+ * - Hampel: compara a mediana com o histórico das últimas leituras e troca
+ *   picos (|x - med| > k·1,4826·MAD) pela mediana do histórico
+ * - EMA: alpha em Q15, estado em mm Q8 (sem perda de resolução sub-mm)
+ * - Deadband: decide se o valor mudou o bastante desde o último envio, com
+ *   histerese na inversão de tendência
+ *
+ * Os parâmetros vêm de um aguada_dsp_config_t constante, montado a partir do
+ * config.h de cada firmware (AGUADA_DSP_Q15/AGUADA_DSP_FIX convertem as
+ * constantes em tempo de compilação). Sem dependências do ESP-IDF: compila
+ * também no host (ver bench/).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aguada_select.h"
+
+// ============================================================================
+// PONTO FIXO
+// ============================================================================
+
+// Constante real → ponto fixo com `bits` bits fracionários (dobra na compilação)
+#define AGUADA_DSP_FIX(x, bits) ((int32_t)((x) * (double)(1L << (bits)) + 0.5))
+#define AGUADA_DSP_Q15(x) AGUADA_DSP_FIX(x, 15)
+
+// Fator que converte MAD em desvio padrão (distribuição normal)
+#define AGUADA_DSP_MAD_SIGMA 1.4826
+
+// Histórico máximo do Hampel (leituras)
+#ifndef AGUADA_DSP_HAMPEL_MAX
+#define AGUADA_DSP_HAMPEL_MAX 9
+#endif
+
+// Bits fracionários do estado da EMA
+#define AGUADA_DSP_EMA_FRAC 8
+
+/**
+ * Multiplica por uma constante em ponto fixo, com arredondamento
+ */
+static inline int32_t aguada_dsp_mul_fix(int32_t value, int32_t fix, int bits)
+{
+    int64_t p = (int64_t)value * fix;
+    return (int32_t)((p + (1LL << (bits - 1))) >> bits);
+}
+
+// ============================================================================
+// CONFIGURAÇÃO E ESTADO
+// ============================================================================
+
+typedef struct
+{
+    uint16_t ema_alpha_q15;   // Peso do valor novo; 0 = EMA desligada
+    uint8_t hampel_window;    // Leituras no histórico; 0 = Hampel desligado
+    uint16_t hampel_k_q8;     // Limiar em MADs, já com 1,4826 (Q8)
+    int32_t hampel_min_mm;    // Piso do limiar (MAD = 0 com nível parado)
+    int32_t deadband_mm;      // Delta mínimo para envio
+    int32_t hysteresis_mm;    // Acréscimo ao delta na inversão de tendência
+} aguada_dsp_config_t;
+
+/**
+ * Config a partir de constantes reais: alpha (0-1], janela, k (em sigmas),
+ * piso do Hampel, deadband e histerese em mm
+ */
+#define AGUADA_DSP_CONFIG(alpha, window, k, min_mm, deadband, hysteresis) \
+    {                                                                       \
+        .ema_alpha_q15 = (uint16_t)AGUADA_DSP_Q15(alpha),                  \
+        .hampel_window = (window),                                          \
+        .hampel_k_q8 = (uint16_t)AGUADA_DSP_FIX((k) * AGUADA_DSP_MAD_SIGMA, 8), \
+        .hampel_min_mm = (min_mm),                                          \
+        .deadband_mm = (deadband),                                          \
+        .hysteresis_mm = (hysteresis),                                      \
+    }
+
+/**
+ * Estado de um canal (um sensor). Só inteiros: pode ficar em RTC RAM.
+ */
+typedef struct
+{
+    const aguada_dsp_config_t *cfg;
+    int32_t hist[AGUADA_DSP_HAMPEL_MAX]; // Medianas anteriores (circular)
+    uint8_t hist_len;
+    uint8_t hist_pos;
+    bool ema_initialized;
+    int32_t ema_q8;                      // Estado da EMA em mm Q8
+    int8_t trend;                        // -1 descendo, 0 estável, +1 subindo
+    uint32_t outliers;                   // Leituras trocadas pelo Hampel
+} aguada_dsp_t;
+
+void aguada_dsp_init(aguada_dsp_t *dsp, const aguada_dsp_config_t *cfg);
+
+// ============================================================================
+// ESTÁGIOS
+// ============================================================================
+
+/**
+ * Hampel causal: devolve x, ou a mediana do histórico se x for um pico.
+ * x entra no histórico de qualquer forma (um degrau real passa depois de
+ * hampel_window/2 + 1 leituras).
+ */
+int32_t aguada_dsp_hampel(aguada_dsp_t *dsp, int32_t x);
+
+/**
+ * EMA com alpha Q15 (a primeira leitura inicializa o estado)
+ */
+int32_t aguada_dsp_ema(aguada_dsp_t *dsp, int32_t x);
+
+/**
+ * Hampel → EMA sobre uma mediana já calculada (ex.: mediana móvel)
+ */
+int32_t aguada_dsp_filter(aguada_dsp_t *dsp, int32_t median);
+
+/**
+ * Pipeline completo sobre as amostras de uma leitura:
+ * mediana → Hampel → EMA. Reordena `samples`.
+ */
+static inline int32_t aguada_dsp_process(aguada_dsp_t *dsp, int32_t *samples, size_t n)
+{
+    return aguada_dsp_filter(dsp, aguada_select_median(samples, n));
+}
+
+/**
+ * Deadband com histerese: true se |value - reference| passou do delta.
+ * Na inversão de tendência o delta ganha hysteresis_mm. Atualiza a
+ * tendência quando dispara.
+ */
+bool aguada_dsp_deadband(aguada_dsp_t *dsp, int32_t value, int32_t reference);
+
+/**
+ * Zera a tendência (ex.: após um heartbeat)
+ */
+static inline void aguada_dsp_reset_trend(aguada_dsp_t *dsp)
+{
+    dsp->trend = 0;
+}
@@ -0,0 +1,85 @@
+/**
+ * AGUADA - Compressão por deadband na borda (gateway), espelho do backend
+ *
+ * O backend (compression.service.js) compara cada leitura com o último
+ * período de leituras_processadas: dentro de DEADBAND_CM o período só é
+ * estendido; fora dele, se a janela das últimas WINDOW_SIZE leituras ainda
+ * está instável (desvio padrão > STABILITY_STDDEV) e incompleta, também só
+ * estende; senão abre um período novo. Para isso ele faz um SELECT por
+ * leitura, depois de a leitura cruzar WiFi e HTTP.
+ *
+ * Aqui a mesma regra roda por sensor (MAC da leitura) na RAM do gateway,
+ * em mm inteiros:
+ * - leitura que abriria um período novo sai marcada "change";
+ * - leitura que só estenderia o período é descartada, exceto uma a cada
+ *   keepalive_ms, que sai marcada "hold" (o backend estende o período sem
+ *   o SELECT e vê o sensor vivo).
+ * Códigos de erro do sensor (0/1 mm) não passam pela compressão.
+ *
+ * Tabela de capacidade fixa com busca linear (poucos sensores por
+ * gateway); cheia, o sensor visto há mais tempo sai - o próximo frame dele
+ * volta a ser "change". Sem dependências do ESP-IDF.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef AGUADA_EDGE_TABLE_SIZE
+#define AGUADA_EDGE_TABLE_SIZE 32 // Sensores acompanhados
+#endif
+
+#define AGUADA_EDGE_WINDOW_MAX 16 // Teto de window_size
+
+typedef struct
+{
+    int32_t deadband_mm;   // DEADBAND_CM do backend, em mm
+    int32_t stability_mm;  // STABILITY_STDDEV do backend, em mm (desvio padrão)
+    uint8_t window_size;   // WINDOW_SIZE do backend (≤ AGUADA_EDGE_WINDOW_MAX)
+    uint32_t keepalive_ms; // Máximo sem repassar nada de um sensor estável
+} aguada_edge_config_t;
+
+typedef enum
+{
+    AGUADA_EDGE_DROP = 0, // Só estenderia o período: não repassar
+    AGUADA_EDGE_CHANGE,   // Abre um período novo (ou primeira leitura)
+    AGUADA_EDGE_HOLD,     // Keep-alive: o backend só estende o período
+    AGUADA_EDGE_PASS,     // Fora da compressão (código de erro): repassar sem marca
+} aguada_edge_verdict_t;
+
+typedef struct
+{
+    uint8_t mac[6];
+    bool used;
+    bool valid;                                // ref_mm válido
+    uint8_t count;                             // Leituras na janela
+    uint8_t head;                              // Próxima posição da janela
+    int32_t ref_mm;                            // Valor do período aberto
+    int32_t window[AGUADA_EDGE_WINDOW_MAX];    // Últimas leituras (ring)
+    int64_t forwarded_us;                      // Último repasse
+    int64_t seen_us;                           // Última leitura
+} aguada_edge_sensor_t;
+
+typedef struct
+{
+    const aguada_edge_config_t *cfg;
+    aguada_edge_sensor_t sensors[AGUADA_EDGE_TABLE_SIZE];
+    uint32_t changes;   // Leituras repassadas como "change"
+    uint32_t holds;     // Keep-alives repassados
+    uint32_t dropped;   // Leituras descartadas
+    uint32_t evictions; // Sensores substituídos (tabela cheia)
+} aguada_edge_t;
+
+void aguada_edge_init(aguada_edge_t *edge, const aguada_edge_config_t *cfg);
+
+/**
+ * Decide o destino de uma leitura de distance_mm do sensor mac
+ */
+aguada_edge_verdict_t aguada_edge_filter(aguada_edge_t *edge, const uint8_t *mac, int32_t distance_mm,
+                                         int64_t now_us);
+
+/**
+ * Marca do veredito no JSON ("change"/"hold"; NULL para DROP/PASS)
+ */
+const char *aguada_edge_tag(aguada_edge_verdict_t verdict);
@@ -0,0 +1,77 @@
+/**
+ * AGUADA - Predição dupla (modelo linear compartilhado node ↔ backend)
+ *
+ * O deadband fixo compara com o último valor enviado: num enchimento ou
+ * esvaziamento constante ainda sai um pacote a cada deadband_mm de
+ * variação. Aqui node e backend rodam a mesma reta, ancorada no último
+ * envio (valor, inclinação):
+ *
+ *   previsto(t) = valor + inclinação_mm_h × (t - t_envio) / 3 600 000
+ *
+ * O node só transmite quando a leitura se afasta da previsão por
+ * deadband_mm ou mais; o backend preenche os pontos previstos entre
+ * envios. O erro máximo continua sendo deadband_mm, e numa taxa constante
+ * a reta acompanha o nível sem novos envios.
+ *
+ * A inclinação de cada envio é a taxa média desde a âncora anterior
+ * (valor_novo - valor_ancora) / Δt: robusta ao ruído porque Δt é o tempo
+ * entre envios, não entre leituras. Ela viaja no pacote ("slope_mm_h"),
+ * então o backend não estima nada - só repete a conta acima, com a mesma
+ * truncagem. Só inteiros: pode ficar em RTC RAM.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Milissegundos por hora (unidade da inclinação: mm/h)
+#define AGUADA_PREDICT_MS_PER_H 3600000
+
+typedef struct
+{
+    int32_t deadband_mm;    // Desvio da previsão que força um envio
+    int32_t max_slope_mm_h; // Teto do |slope| transmitido
+} aguada_predict_config_t;
+
+typedef struct
+{
+    const aguada_predict_config_t *cfg;
+    bool valid;          // Há âncora (senão toda leitura desvia)
+    bool has_base;       // A âncora serve de base para a próxima inclinação
+    int32_t value_mm;    // Valor transmitido na âncora
+    int32_t slope_mm_h;  // Inclinação transmitida na âncora
+    uint32_t anchor_ms;  // Relógio do node no envio
+    uint32_t suppressed; // Leituras dentro da previsão (envios evitados)
+} aguada_predict_t;
+
+void aguada_predict_init(aguada_predict_t *pred, const aguada_predict_config_t *cfg);
+
+/**
+ * Valor previsto no instante now_ms (relógio do node; wrap de 32 bits ok)
+ */
+int32_t aguada_predict_value(const aguada_predict_t *pred, uint32_t now_ms);
+
+/**
+ * true se |value - previsto| >= deadband_mm (ou sem âncora). Leituras
+ * dentro da previsão contam em `suppressed`.
+ */
+bool aguada_predict_deviates(aguada_predict_t *pred, int32_t value, uint32_t now_ms);
+
+/**
+ * Inclinação que sai com um envio de `value` agora: taxa média desde a
+ * âncora, limitada a ±max_slope_mm_h (0 sem base). Não altera a âncora.
+ */
+int32_t aguada_predict_slope(const aguada_predict_t *pred, int32_t value, uint32_t now_ms);
+
+/**
+ * Envio confirmado: (value, slope) vira a nova âncora - a mesma que o
+ * backend recebeu no pacote
+ */
+void aguada_predict_commit(aguada_predict_t *pred, int32_t value, int32_t slope_mm_h, uint32_t now_ms);
+
+/**
+ * Âncora plana sem base para inclinação (ex.: código de erro do sensor):
+ * a reta fica parada e o próximo envio sai com inclinação 0
+ */
+void aguada_predict_hold(aguada_predict_t *pred, int32_t value, uint32_t now_ms);
@@ -0,0 +1,411 @@
+/**
+ * AGUADA - Envio ESP-NOW com entrega confirmada
+ *
+ * Cada transmissão arma a espera (waiter) antes de esp_now_send e desarma
+ * ao terminar, então um callback atrasado de uma tentativa que estourou o
+ * timeout não acorda ninguém. A sonda é um broadcast; o gateway responde com
+ * um beacon em broadcast endereçado ao MAC do node, cuja origem é o gateway.
+ *
+ * Potência de TX: um envio perdido (todas as tentativas) volta ao teto;
+ * entrega abaixo da meta (ou perda alta no relatório) sobe um passo; um
+ * relatório com folga de RSSI de pelo menos um passo desce um passo. Depois
+ * de cada mudança a potência fica parada por tx_settle envios, para a EWMA
+ * da entrega e o RSSI do gateway refletirem o novo nível.
+ */
+
+#include "aguada_link.h"
+
+#include <string.h>
+
+#include "aguada_proto.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_wifi.h"
+
+#define TAG "LINK"
+
+#define LINK_SEND_NONE 0
+#define LINK_SEND_OK 1
+#define LINK_SEND_FAIL 2
+
+#define RATIO_SHIFT 3 // EWMA com peso 1/8 por transmissão
+
+static const uint8_t BROADCAST_MAC[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+static esp_err_t add_peer(const uint8_t *mac)
+{
+    if (esp_now_is_peer_exist(mac))
+    {
+        return ESP_OK;
+    }
+
+    esp_now_peer_info_t peer = {0};
+    memcpy(peer.peer_addr, mac, 6);
+    peer.channel = 0; // Canal atual do rádio
+    peer.encrypt = false;
+    return esp_now_add_peer(&peer);
+}
+
+static void tx_apply(aguada_link_t *link, int8_t power)
+{
+    esp_err_t err = esp_wifi_set_max_tx_power(power);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "esp_wifi_set_max_tx_power(%d): %s", power, esp_err_to_name(err));
+        return;
+    }
+    link->tx_power = power;
+}
+
+/**
+ * Ajusta a potência de TX após um envio unicast (ver topo do arquivo)
+ */
+static void tx_adapt(aguada_link_t *link, bool delivered)
+{
+    const aguada_link_config_t *cfg = &link->cfg;
+    int power = link->tx_power;
+
+    if (cfg->tx_power_max == 0)
+    {
+        return;
+    }
+
+    if (!delivered)
+    {
+        power = cfg->tx_power_max;
+    }
+    else if (link->tx_hold > 0)
+    {
+        link->tx_hold--;
+        return;
+    }
+    else
+    {
+        bool fresh = link->report;
+        if (fresh)
+        {
+            link->report = false;
+            link->gateway_rssi = link->report_rssi;
+            link->gateway_loss = link->report_loss;
+        }
+
+        if (aguada_link_delivery_pct(link) < cfg->delivery_target_pct ||
+            (fresh && link->gateway_loss > 100 - cfg->delivery_target_pct))
+        {
+            power += cfg->tx_power_step;
+        }
+        else if (fresh && link->gateway_rssi - cfg->tx_power_step / 4 >= cfg->rssi_target_dbm)
+        {
+            power -= cfg->tx_power_step;
+        }
+    }
+
+    if (power > cfg->tx_power_max)
+    {
+        power = cfg->tx_power_max;
+    }
+    if (power < cfg->tx_power_min)
+    {
+        power = cfg->tx_power_min;
+    }
+    if (power == link->tx_power)
+    {
+        return;
+    }
+
+    bool raise = power > link->tx_power;
+    ESP_LOGI(TAG, "TX %d → %d (x0,25 dBm): entrega %u%%, RSSI no gateway %d dBm", link->tx_power, power,
+             aguada_link_delivery_pct(link), link->gateway_rssi);
+    tx_apply(link, (int8_t)power);
+    link->tx_hold = cfg->tx_settle;
+    if (raise)
+    {
+        link->tx_raised++;
+    }
+    else
+    {
+        link->tx_lowered++;
+    }
+}
+
+static void ratio_update(aguada_link_t *link, bool delivered)
+{
+    link->ratio_q16 -= link->ratio_q16 >> RATIO_SHIFT;
+    if (delivered)
+    {
+        link->ratio_q16 += AGUADA_LINK_RATIO_ONE >> RATIO_SHIFT;
+    }
+}
+
+/**
+ * Espera pelo callback de envio (ou timeout). O waiter já está armado.
+ */
+static uint8_t wait_send(aguada_link_t *link)
+{
+    TickType_t wait = pdMS_TO_TICKS(link->cfg.ack_timeout_ms) + 1;
+    ulTaskNotifyTake(pdTRUE, wait);
+    link->waiter = NULL;
+    return link->send_status;
+}
+
+static void arm(aguada_link_t *link)
+{
+    link->send_status = LINK_SEND_NONE;
+    ulTaskNotifyTake(pdTRUE, 0);
+    link->waiter = xTaskGetCurrentTaskHandle();
+}
+
+/**
+ * Backoff exponencial com jitter: a tentativa n (n ≥ 1) espera um tempo
+ * uniforme em [d/2, d], d = base << (n - 1). Nodes que perderam o mesmo
+ * slot não voltam a colidir no mesmo instante.
+ */
+static void backoff(const aguada_link_t *link, int attempt)
+{
+    uint32_t delay_ms = (uint32_t)link->cfg.backoff_base_ms << (attempt - 1);
+    uint32_t half = delay_ms / 2;
+    uint32_t wait_ms = half + esp_random() % (delay_ms - half + 1);
+    vTaskDelay(pdMS_TO_TICKS(wait_ms) + 1);
+}
+
+/**
+ * Sonda em broadcast e espera por um beacon endereçado a este node
+ */
+static bool probe(aguada_link_t *link)
+{
+    aguada_link_msg_t msg = {.type = AGUADA_LINK_PROBE};
+    uint8_t frame[AGUADA_LINK_SIZE];
+
+    memcpy(msg.mac, link->self_mac, 6);
+    aguada_link_encode(&msg, frame);
+
+    link->probes++;
+    link->since_probe = 0;
+    link->beacon = false;
+    link->probing = true;
+
+    arm(link);
+    esp_err_t err = esp_now_send(BROADCAST_MAC, frame, sizeof(frame));
+    if (err == ESP_OK)
+    {
+        // Callback do broadcast primeiro (sempre "sucesso"), depois o beacon
+        TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(link->cfg.probe_timeout_ms) + 1;
+        while (!link->beacon)
+        {
+            TickType_t now = xTaskGetTickCount();
+            if ((int32_t)(deadline - now) <= 0)
+            {
+                break;
+            }
+            ulTaskNotifyTake(pdTRUE, deadline - now);
+        }
+    }
+    link->probing = false;
+    link->waiter = NULL;
+
+    if (!link->beacon)
+    {
+        ESP_LOGW(TAG, "Sonda sem resposta (%s)", err == ESP_OK ? "timeout" : esp_err_to_name(err));
+        return false;
+    }
+
+    memcpy(link->gateway, link->beacon_mac, 6);
+    link->gateway_rssi = link->beacon_rssi;
+    link->report_rssi = link->beacon_rssi; // Vale como 1º relatório
+    link->report_loss = 0;
+    link->report = true;
+    link->fail_streak = 0;
+    if (add_peer(link->gateway) != ESP_OK)
+    {
+        return false;
+    }
+    link->has_gateway = true;
+
+    char mac_str[AGUADA_MAC_STR_LEN];
+    aguada_mac_to_string(link->gateway, mac_str);
+    ESP_LOGI(TAG, "Gateway %s descoberto (RSSI no gateway: %d dBm)", mac_str, link->gateway_rssi);
+    return true;
+}
+
+/**
+ * Sem gateway: broadcast único, sem ACK (o callback só diz que saiu do rádio)
+ */
+static esp_err_t send_broadcast(aguada_link_t *link, const uint8_t *data, size_t len)
+{
+    arm(link);
+    esp_err_t err = esp_now_send(BROADCAST_MAC, data, len);
+    if (err != ESP_OK)
+    {
+        link->waiter = NULL;
+        return err;
+    }
+    if (wait_send(link) == LINK_SEND_NONE)
+    {
+        link->timeouts++;
+    }
+    link->unconfirmed++;
+    link->since_probe++;
+    return ESP_OK;
+}
+
+void aguada_link_init(aguada_link_t *link, const aguada_link_config_t *cfg)
+{
+    memset(link, 0, sizeof(*link));
+    link->cfg = *cfg;
+    if (link->cfg.max_attempts == 0)
+    {
+        link->cfg.max_attempts = 1;
+    }
+
+    link->discover = memcmp(cfg->gateway, BROADCAST_MAC, 6) == 0;
+    if (!link->discover)
+    {
+        memcpy(link->gateway, cfg->gateway, 6);
+        link->has_gateway = true;
+    }
+    link->ratio_q16 = AGUADA_LINK_RATIO_ONE;
+    link->tx_power = cfg->tx_power_max;
+}
+
+esp_err_t aguada_link_start(aguada_link_t *link)
+{
+    link->waiter = NULL;
+    link->send_status = LINK_SEND_NONE;
+    link->probing = false;
+    link->beacon = false;
+
+    esp_err_t err = esp_wifi_get_mac(WIFI_IF_STA, link->self_mac);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    if (link->cfg.tx_power_max != 0)
+    {
+        tx_apply(link, link->tx_power); // Rádio recém-ligado volta ao padrão
+    }
+    if ((err = add_peer(BROADCAST_MAC)) != ESP_OK)
+    {
+        return err;
+    }
+    return link->has_gateway ? add_peer(link->gateway) : ESP_OK;
+}
+
+void aguada_link_on_send(aguada_link_t *link, esp_now_send_status_t status)
+{
+    link->send_status = (status == ESP_NOW_SEND_SUCCESS) ? LINK_SEND_OK : LINK_SEND_FAIL;
+
+    TaskHandle_t waiter = link->waiter;
+    if (waiter != NULL)
+    {
+        xTaskNotifyGive(waiter);
+    }
+}
+
+bool aguada_link_on_recv(aguada_link_t *link, const esp_now_recv_info_t *info, const uint8_t *data, int len)
+{
+    aguada_link_msg_t msg;
+
+    if (len <= 0 || !aguada_link_detect(data, (size_t)len))
+    {
+        return false;
+    }
+    if (aguada_link_decode(data, (size_t)len, &msg) != AGUADA_PROTO_OK)
+    {
+        return true;
+    }
+
+    if (msg.type == AGUADA_LINK_BEACON && link->probing && memcmp(msg.mac, link->self_mac, 6) == 0)
+    {
+        memcpy(link->beacon_mac, info->src_addr, 6);
+        link->beacon_rssi = msg.rssi;
+        link->beacon = true;
+
+        TaskHandle_t waiter = link->waiter;
+        if (waiter != NULL)
+        {
+            xTaskNotifyGive(waiter);
+        }
+    }
+    else if (msg.type == AGUADA_LINK_REPORT && memcmp(msg.mac, link->self_mac, 6) == 0 &&
+             link->has_gateway && memcmp(info->src_addr, link->gateway, 6) == 0)
+    {
+        // Consumido pela task no próximo envio (tx_adapt)
+        link->report_rssi = msg.rssi;
+        link->report_loss = msg.loss_pct;
+        link->report = true;
+        link->reports++;
+    }
+    return true;
+}
+
+esp_err_t aguada_link_send(aguada_link_t *link, const uint8_t *data, size_t len)
+{
+    if (!link->has_gateway)
+    {
+        if (link->since_probe == 0 || link->since_probe >= link->cfg.probe_every)
+        {
+            probe(link);
+        }
+        if (!link->has_gateway)
+        {
+            return send_broadcast(link, data, len);
+        }
+    }
+
+    esp_err_t err = ESP_FAIL;
+    for (int attempt = 0; attempt < link->cfg.max_attempts; attempt++)
+    {
+        if (attempt > 0)
+        {
+            link->retries++;
+            backoff(link, attempt);
+        }
+
+        arm(link);
+        err = esp_now_send(link->gateway, data, len);
+        if (err != ESP_OK)
+        {
+            // Fila do rádio cheia/sem memória: não chegou a transmitir
+            link->waiter = NULL;
+            ESP_LOGW(TAG, "esp_now_send: %s (%d/%d)", esp_err_to_name(err), attempt + 1, link->cfg.max_attempts);
+            continue;
+        }
+
+        uint8_t status = wait_send(link);
+        if (status == LINK_SEND_OK)
+        {
+            link->transmissions++;
+            link->delivered++;
+            link->fail_streak = 0;
+            ratio_update(link, true);
+            tx_adapt(link, true);
+            return ESP_OK;
+        }
+
+        if (status == LINK_SEND_FAIL)
+        {
+            link->transmissions++;
+            link->failed++;
+            ratio_update(link, false);
+        }
+        else
+        {
+            link->timeouts++;
+        }
+        err = ESP_FAIL;
+        ESP_LOGW(TAG, "Sem ACK do gateway (%d/%d)", attempt + 1, link->cfg.max_attempts);
+    }
+
+    tx_adapt(link, false);
+
+    // Gateway descoberto que parou de responder: voltar a sondar
+    if (link->discover && ++link->fail_streak >= link->cfg.rediscover_after)
+    {
+        ESP_LOGW(TAG, "Gateway perdido após %d envios sem ACK", link->fail_streak);
+        esp_now_del_peer(link->gateway);
+        link->has_gateway = false;
+        link->since_probe = 0;
+        link->fail_streak = 0;
+    }
+    return err;
+}
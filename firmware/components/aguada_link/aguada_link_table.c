@@ -0,0 +1,138 @@
+/**
+ * AGUADA - Qualidade do enlace por node, vista pelo gateway
+ *
+ * A perda do relatório é a fração de frames rejeitados desde o relatório
+ * anterior (janela). Frames que nem chegaram não aparecem aqui; essa parte
+ * o node já mede pelo ACK (delivery_pct).
+ */
+
+#include "aguada_link_table.h"
+
+#include <string.h>
+
+static aguada_link_node_t *find(aguada_link_table_t *table, const uint8_t *mac)
+{
+    for (int i = 0; i < AGUADA_LINK_TABLE_SIZE; i++)
+    {
+        aguada_link_node_t *node = &table->nodes[i];
+        if (node->used && memcmp(node->mac, mac, 6) == 0)
+        {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Entrada livre ou, com a tabela cheia, a do node visto há mais tempo
+ */
+static aguada_link_node_t *claim(aguada_link_table_t *table, const uint8_t *mac, int64_t now_us)
+{
+    aguada_link_node_t *oldest = &table->nodes[0];
+
+    for (int i = 0; i < AGUADA_LINK_TABLE_SIZE; i++)
+    {
+        aguada_link_node_t *node = &table->nodes[i];
+        if (!node->used)
+        {
+            oldest = node;
+            break;
+        }
+        if (node->last_seen_us < oldest->last_seen_us)
+        {
+            oldest = node;
+        }
+    }
+
+    if (oldest->used)
+    {
+        table->evictions++;
+    }
+    memset(oldest, 0, sizeof(*oldest));
+    memcpy(oldest->mac, mac, 6);
+    oldest->last_seen_us = now_us;
+    oldest->used = true;
+    return oldest;
+}
+
+_Static_assert((AGUADA_LINK_BAD_QUEUE & (AGUADA_LINK_BAD_QUEUE - 1)) == 0, "AGUADA_LINK_BAD_QUEUE deve ser potência de 2");
+
+/**
+ * [Callback] Aplica as rejeições enfileiradas pela task de validação
+ */
+static void drain_bad(aguada_link_table_t *table)
+{
+    uint32_t head = __atomic_load_n(&table->bad_head, __ATOMIC_ACQUIRE);
+    uint32_t tail = table->bad_tail;
+
+    while (tail != head)
+    {
+        aguada_link_node_t *node = find(table, table->bad_macs[tail & (AGUADA_LINK_BAD_QUEUE - 1)]);
+        if (node != NULL)
+        {
+            node->bad++;
+        }
+        tail++;
+    }
+    __atomic_store_n(&table->bad_tail, tail, __ATOMIC_RELEASE);
+}
+
+void aguada_link_table_init(aguada_link_table_t *table, uint32_t report_interval_ms)
+{
+    memset(table, 0, sizeof(*table));
+    table->report_interval_us = (int64_t)report_interval_ms * 1000;
+}
+
+bool aguada_link_table_rx(aguada_link_table_t *table, const uint8_t *mac, int rssi, int64_t now_us,
+                          aguada_link_msg_t *report)
+{
+    drain_bad(table);
+
+    aguada_link_node_t *node = find(table, mac);
+    if (node == NULL)
+    {
+        node = claim(table, mac, now_us);
+        node->rssi_q4 = (int16_t)(rssi * 16);
+    }
+    else
+    {
+        node->rssi_q4 += (int16_t)((rssi * 16 - node->rssi_q4) / 4);
+    }
+    node->rx++;
+    node->last_seen_us = now_us;
+
+    if (node->last_report_us != 0 && now_us - node->last_report_us < table->report_interval_us)
+    {
+        return false;
+    }
+
+    uint32_t rx = node->rx - node->rx_reported;
+    uint32_t bad = node->bad - node->bad_reported;
+    uint32_t loss = (rx > 0) ? (bad * 100 + rx / 2) / rx : 0;
+
+    memset(report, 0, sizeof(*report));
+    report->type = AGUADA_LINK_REPORT;
+    memcpy(report->mac, mac, 6);
+    report->rssi = (int8_t)((node->rssi_q4 - 8) / 16); // Arredonda (RSSI é negativo)
+    report->loss_pct = (uint8_t)(loss > 100 ? 100 : loss);
+
+    node->rx_reported = node->rx;
+    node->bad_reported = node->bad;
+    node->last_report_us = now_us;
+    table->reports++;
+    return true;
+}
+
+void aguada_link_table_bad(aguada_link_table_t *table, const uint8_t *mac)
+{
+    uint32_t head = table->bad_head;
+    uint32_t tail = __atomic_load_n(&table->bad_tail, __ATOMIC_ACQUIRE);
+
+    if (head - tail >= AGUADA_LINK_BAD_QUEUE)
+    {
+        table->bad_dropped++;
+        return;
+    }
+    memcpy(table->bad_macs[head & (AGUADA_LINK_BAD_QUEUE - 1)], mac, 6);
+    __atomic_store_n(&table->bad_head, head + 1, __ATOMIC_RELEASE);
+}
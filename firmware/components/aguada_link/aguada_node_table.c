@@ -0,0 +1,228 @@
+/**
+ * AGUADA - Estado por node no gateway (sequência, perda, intervalo, RSSI)
+ *
+ * Hash FNV-1a dos 6 bytes do MAC. Sem remoção, a sondagem linear nunca
+ * precisa de tombstones: uma busca para no primeiro slot livre.
+ */
+
+#include "aguada_node_table.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "aguada_proto.h"
+
+#define LOSS_ONE_Q16 65536u
+#define LOSS_WEIGHT 16 // EWMA da perda: peso 1/16 por frame
+#define GAP_SHIFT 3    // EWMA do intervalo: peso 1/8
+
+static uint32_t mac_hash(const uint8_t *mac)
+{
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 6; i++)
+    {
+        h = (h ^ mac[i]) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * Slot de mac ou o primeiro livre da sondagem (NULL: tabela sem slot livre)
+ */
+static aguada_node_entry_t *probe(aguada_node_table_t *table, const uint8_t *mac)
+{
+    uint32_t mask = AGUADA_NODE_TABLE_SIZE - 1;
+    uint32_t slot = mac_hash(mac) & mask;
+
+    for (int i = 0; i < AGUADA_NODE_TABLE_SIZE; i++)
+    {
+        aguada_node_entry_t *entry = &table->entries[slot];
+        if (!entry->used || memcmp(entry->mac, mac, 6) == 0)
+        {
+            return entry;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+void aguada_node_table_init(aguada_node_table_t *table)
+{
+    memset(table, 0, sizeof(*table));
+}
+
+aguada_node_entry_t *aguada_node_table_find(aguada_node_table_t *table, const uint8_t *mac)
+{
+    aguada_node_entry_t *entry = probe(table, mac);
+    return (entry && entry->used) ? entry : NULL;
+}
+
+/**
+ * k perdas seguidas de um recebimento, de uma vez: a amostra é k/(k+1) e o
+ * peso cresce com o trecho (k+1 frames), até substituir a média
+ */
+static void loss_update(aguada_node_entry_t *entry, uint32_t missing)
+{
+    uint32_t span = missing + 1;
+    uint32_t sample = (uint32_t)((uint64_t)missing * LOSS_ONE_Q16 / span);
+    uint32_t weight = (span < LOSS_WEIGHT) ? span : LOSS_WEIGHT;
+    int64_t delta = (int64_t)sample - (int64_t)entry->loss_q16;
+    entry->loss_q16 = (uint32_t)((int64_t)entry->loss_q16 + delta * weight / LOSS_WEIGHT);
+}
+
+aguada_node_rx_t aguada_node_table_rx(aguada_node_table_t *table, const uint8_t *mac, bool has_seq, uint8_t seq,
+                                      int rssi, int64_t now_us, aguada_node_entry_t **out)
+{
+    aguada_node_entry_t *entry = probe(table, mac);
+    if (out)
+    {
+        *out = NULL;
+    }
+
+    if (entry && !entry->used)
+    {
+        if (table->count >= AGUADA_NODE_TABLE_MAX_NODES)
+        {
+            entry = NULL;
+        }
+        else
+        {
+            memset(entry, 0, sizeof(*entry));
+            memcpy(entry->mac, mac, 6);
+            entry->used = true;
+            table->count++;
+        }
+    }
+    if (!entry)
+    {
+        table->untracked++;
+        return AGUADA_NODE_UNTRACKED;
+    }
+    if (out)
+    {
+        *out = entry;
+    }
+
+    if (rssi != 0)
+    {
+        entry->last_rssi = (int8_t)rssi;
+    }
+
+    aguada_node_rx_t result = AGUADA_NODE_NEXT;
+    if (entry->frames == 0)
+    {
+        result = AGUADA_NODE_FIRST;
+    }
+    else if (has_seq && entry->has_seq)
+    {
+        uint8_t delta = (uint8_t)(seq - entry->last_seq);
+        uint8_t back = (uint8_t)(entry->last_seq - seq);
+        bool recent = (now_us - entry->last_us) <= (int64_t)AGUADA_NODE_DUP_WINDOW_MS * 1000;
+
+        if (delta > 0 && delta < 128)
+        {
+            loss_update(entry, delta - 1u);
+            entry->lost += delta - 1u;
+            entry->window = (delta < AGUADA_NODE_WINDOW_BITS) ? (entry->window << delta) | 1u : 1u;
+            result = (delta > 1) ? AGUADA_NODE_GAP : AGUADA_NODE_NEXT;
+        }
+        else if (recent && back < AGUADA_NODE_WINDOW_BITS)
+        {
+            uint32_t bit = 1u << back;
+            if (entry->window & bit)
+            {
+                entry->dups++;
+                return AGUADA_NODE_DUP;
+            }
+            // Atrasado: já contado como perdido no salto, agora chegou
+            entry->window |= bit;
+            if (entry->lost > 0)
+            {
+                entry->lost--;
+            }
+            entry->frames++;
+            return AGUADA_NODE_LATE;
+        }
+        else
+        {
+            // Igual/atrás fora da janela: node reiniciou a sequência
+            entry->resets++;
+            entry->window = 1u;
+            result = AGUADA_NODE_RESET;
+        }
+    }
+
+    if (entry->frames > 0)
+    {
+        int64_t gap_ms = (now_us - entry->last_us) / 1000;
+        uint32_t gap = (gap_ms < 0) ? 0 : (gap_ms > UINT32_MAX) ? UINT32_MAX : (uint32_t)gap_ms;
+        if (entry->gap_ewma_ms == 0)
+        {
+            entry->gap_ewma_ms = gap;
+        }
+        else
+        {
+            int64_t diff = (int64_t)gap - (int64_t)entry->gap_ewma_ms;
+            entry->gap_ewma_ms = (uint32_t)((int64_t)entry->gap_ewma_ms + diff / (1 << GAP_SHIFT));
+        }
+    }
+
+    if (has_seq && !entry->has_seq)
+    {
+        entry->window = 1u;
+    }
+    entry->has_seq = has_seq;
+    entry->last_seq = seq;
+    entry->last_us = now_us;
+    entry->frames++;
+    return result;
+}
+
+int aguada_node_table_json(const aguada_node_table_t *table, int64_t now_us, char *out, size_t size)
+{
+    size_t len = 0;
+
+    if (size < 3)
+    {
+        return -1;
+    }
+    out[len++] = '[';
+
+    for (int i = 0; i < AGUADA_NODE_TABLE_SIZE; i++)
+    {
+        const aguada_node_entry_t *entry = &table->entries[i];
+        if (!entry->used)
+        {
+            continue;
+        }
+
+        char mac[AGUADA_MAC_STR_LEN];
+        char seq[12] = "";
+        aguada_mac_to_string(entry->mac, mac);
+        if (entry->has_seq)
+        {
+            snprintf(seq, sizeof(seq), "\"seq\":%u,", entry->last_seq);
+        }
+
+        int n = snprintf(out + len, size - len,
+                         "%s{\"mac\":\"%s\",%s\"frames\":%lu,\"lost\":%lu,\"loss_pct\":%u,\"dups\":%lu,"
+                         "\"resets\":%lu,\"rssi\":%d,\"gap_ms\":%lu,\"age_s\":%lld}",
+                         (len > 1) ? "," : "", mac, seq, (unsigned long)entry->frames,
+                         (unsigned long)entry->lost, aguada_node_loss_pct(entry), (unsigned long)entry->dups,
+                         (unsigned long)entry->resets, entry->last_rssi, (unsigned long)entry->gap_ewma_ms,
+                         (long long)((now_us - entry->last_us) / 1000000));
+        if (n < 0 || (size_t)n >= size - len)
+        {
+            return -1;
+        }
+        len += (size_t)n;
+    }
+
+    if (len + 2 > size)
+    {
+        return -1;
+    }
+    out[len++] = ']';
+    out[len] = '\0';
+    return (int)len;
+}
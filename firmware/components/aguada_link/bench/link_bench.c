@@ -0,0 +1,168 @@
+/**
+ * AGUADA - Bench de host da tabela por node do gateway (aguada_node_table)
+ *
+ * Confere os veredictos de aguada_node_table_rx (primeiro, seguinte, salto,
+ * repetido, atrasado, reinício), inclusive na volta do seq de 8 bits e na
+ * borda de AGUADA_NODE_DUP_WINDOW_MS, e o limite de nodes acompanhados.
+ * Aborta se qualquer conferência falhar. Depois mede ns/op com a tabela
+ * cheia (AGUADA_NODE_TABLE_MAX_NODES nodes intercalados).
+ *
+ * Uso: link_bench [iterações]   (padrão 1000000)
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "aguada_node_table.h"
+
+static volatile uint32_t sink; // Impede o compilador de eliminar os laços
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+#define CHECK(cond)                                                     \
+    do                                                                  \
+    {                                                                   \
+        if (!(cond))                                                    \
+        {                                                               \
+            fprintf(stderr, "FALHA %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                    \
+        }                                                               \
+    } while (0)
+
+#define MS(x) ((int64_t)(x) * 1000)
+
+static aguada_node_table_t table;
+
+static aguada_node_rx_t rx(const uint8_t *mac, uint8_t seq, int64_t now_us)
+{
+    return aguada_node_table_rx(&table, mac, true, seq, -60, now_us, NULL);
+}
+
+// ============================================================================
+// CONFERÊNCIAS
+// ============================================================================
+
+static void self_check(void)
+{
+    static const uint8_t mac[6] = {0x20, 0x6E, 0xF1, 0x6B, 0x77, 0x58};
+    aguada_node_entry_t *entry;
+
+    aguada_node_table_init(&table);
+    CHECK(aguada_node_table_find(&table, mac) == NULL);
+
+    // Primeiro frame, seguinte, reenvio do mesmo seq
+    CHECK(rx(mac, 250, MS(0)) == AGUADA_NODE_FIRST);
+    entry = aguada_node_table_find(&table, mac);
+    CHECK(entry && table.count == 1 && entry->last_rssi == -60);
+    CHECK(rx(mac, 251, MS(1000)) == AGUADA_NODE_NEXT);
+    CHECK(rx(mac, 251, MS(1500)) == AGUADA_NODE_DUP);
+    CHECK(entry->dups == 1 && entry->frames == 2);
+
+    // Salto de 3 (252 e 253 perdidos); 252 chega atrasado, depois repetido
+    CHECK(rx(mac, 254, MS(2000)) == AGUADA_NODE_GAP);
+    CHECK(entry->lost == 2 && entry->loss_q16 > 0);
+    CHECK(rx(mac, 252, MS(2500)) == AGUADA_NODE_LATE);
+    CHECK(entry->lost == 1 && entry->frames == 4);
+    CHECK(rx(mac, 252, MS(2600)) == AGUADA_NODE_DUP);
+    CHECK(entry->dups == 2);
+
+    // Volta do seq: 255 → 0 é o seguinte, 0 → 2 é salto; 1 atrasado e
+    // 255 (antes da volta) repetido
+    CHECK(rx(mac, 255, MS(3000)) == AGUADA_NODE_NEXT);
+    CHECK(rx(mac, 0, MS(4000)) == AGUADA_NODE_NEXT);
+    CHECK(rx(mac, 2, MS(5000)) == AGUADA_NODE_GAP);
+    CHECK(entry->lost == 2);
+    CHECK(rx(mac, 1, MS(5500)) == AGUADA_NODE_LATE);
+    CHECK(entry->lost == 1);
+    CHECK(rx(mac, 255, MS(6000)) == AGUADA_NODE_DUP);
+    CHECK(entry->dups == 3 && entry->last_seq == 2);
+
+    // Borda da janela de tempo, contada do frame com o maior seq (5000 ms):
+    // exatamente AGUADA_NODE_DUP_WINDOW_MS ainda é repetido, 1 µs depois
+    // é reinício
+    CHECK(rx(mac, 2, MS(5000 + AGUADA_NODE_DUP_WINDOW_MS)) == AGUADA_NODE_DUP);
+    CHECK(rx(mac, 2, MS(5000 + AGUADA_NODE_DUP_WINDOW_MS) + 1) == AGUADA_NODE_RESET);
+    CHECK(entry->resets == 1 && entry->window == 1u);
+    int64_t t = MS(5000 + AGUADA_NODE_DUP_WINDOW_MS) + 1;
+
+    // Dentro do tempo, mas atrás da janela de 32 bits: reinício
+    CHECK(rx(mac, (uint8_t)(2 - AGUADA_NODE_WINDOW_BITS), t + MS(100)) == AGUADA_NODE_RESET);
+    CHECK(entry->resets == 2);
+    // Salto de 128 ou mais também não é adiante: reinício
+    CHECK(rx(mac, (uint8_t)(2 - AGUADA_NODE_WINDOW_BITS + 128), t + MS(200)) == AGUADA_NODE_RESET);
+    CHECK(entry->resets == 3);
+    // Salto de 127 ainda é adiante
+    CHECK(rx(mac, (uint8_t)(2 - AGUADA_NODE_WINDOW_BITS + 255), t + MS(300)) == AGUADA_NODE_GAP);
+    CHECK(entry->lost == 1 + 126);
+
+    // Frame sem seq (JSON v1): sempre seguinte, e o próximo com seq não é
+    // comparado ao antigo
+    CHECK(aguada_node_table_rx(&table, mac, false, 0, 0, t + MS(400), NULL) == AGUADA_NODE_NEXT);
+    CHECK(!entry->has_seq && entry->last_rssi == -60);
+    CHECK(rx(mac, 7, t + MS(500)) == AGUADA_NODE_NEXT);
+    CHECK(entry->has_seq && entry->window == 1u);
+
+    // Acima de 3/4 da capacidade nodes novos não entram
+    uint8_t other[6] = {0xAA, 0xBB, 0xCC, 0xDD, 0x00, 0x00};
+    for (int i = 1; i < AGUADA_NODE_TABLE_MAX_NODES; i++)
+    {
+        other[5] = (uint8_t)i;
+        CHECK(rx(other, 0, t) == AGUADA_NODE_FIRST);
+    }
+    CHECK(table.count == AGUADA_NODE_TABLE_MAX_NODES);
+    other[4] = 0xFF;
+    aguada_node_table_rx(&table, other, true, 0, -60, t, &entry);
+    CHECK(entry == NULL && table.untracked == 1);
+    CHECK(aguada_node_table_find(&table, other) == NULL);
+    CHECK(rx(mac, 8, t + MS(600)) == AGUADA_NODE_NEXT);
+
+    // Exportação: o buffer documentado basta para a tabela cheia
+    static char json[AGUADA_NODE_TABLE_MAX_NODES * AGUADA_NODE_JSON_MAX + 3];
+    int len = aguada_node_table_json(&table, t + MS(600), json, sizeof(json));
+    CHECK(len > 0 && json[0] == '[' && json[len - 1] == ']');
+    CHECK(strstr(json, "\"mac\":\"20:6E:F1:6B:77:58\",\"seq\":8,") != NULL);
+    CHECK(aguada_node_table_json(&table, t, json, 64) == -1);
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = (argc > 1) ? atol(argv[1]) : 1000000;
+    if (iterations <= 0)
+    {
+        iterations = 1000000;
+    }
+
+    self_check();
+    printf("aguada_node_table bench (%ld iterações, %d nodes)\n", iterations, AGUADA_NODE_TABLE_MAX_NODES);
+
+    // Tabela cheia, frames intercalados entre os nodes, 1 em 16 com salto
+    uint8_t macs[AGUADA_NODE_TABLE_MAX_NODES][6];
+    uint8_t seqs[AGUADA_NODE_TABLE_MAX_NODES] = {0};
+    aguada_node_table_init(&table);
+    for (int n = 0; n < AGUADA_NODE_TABLE_MAX_NODES; n++)
+    {
+        uint8_t mac[6] = {0x20, 0x6E, 0xF1, (uint8_t)(n * 7), (uint8_t)(n * 13), (uint8_t)n};
+        memcpy(macs[n], mac, 6);
+    }
+
+    double t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        int n = (int)(i % AGUADA_NODE_TABLE_MAX_NODES);
+        seqs[n] += ((i & 15) == 15) ? 2 : 1;
+        sink += aguada_node_table_rx(&table, macs[n], true, seqs[n], -60, (int64_t)i * 1000, NULL);
+    }
+    printf("  %-28s %8.1f ns/op\n", "aguada_node_table_rx", (now_ns() - t0) / (double)iterations);
+
+    CHECK(table.count == AGUADA_NODE_TABLE_MAX_NODES && table.untracked == 0);
+    printf("OK\n");
+    return 0;
+}
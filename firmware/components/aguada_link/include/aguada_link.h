@@ -0,0 +1,137 @@
+/**
+ * AGUADA - Envio ESP-NOW com entrega confirmada (node → gateway)
+ *
+ * esp_now_send() devolver ESP_OK só quer dizer "enfileirado"; o resultado da
+ * camada MAC (ACK do gateway) chega depois no callback de envio. Este motor:
+ * - descobre o gateway com uma sonda em broadcast (aguada_link_msg_t) e passa
+ *   a mandar unicast para ele - broadcast não tem ACK;
+ * - a cada tentativa espera o callback (task notification, com timeout) e só
+ *   repete em falha real, com backoff exponencial e jitter;
+ * - mantém a taxa de entrega do enlace (EWMA por transmissão unicast), que o
+ *   node reporta como "delivery_pct" no lugar do RSSI inventado;
+ * - opcionalmente ajusta a potência de TX (esp_wifi_set_max_tx_power) para o
+ *   mínimo que mantém a entrega acima da meta, usando os relatórios de RSSI
+ *   e perda que o gateway manda (aguada_link_table.h).
+ *
+ * Os callbacks do ESP-NOW não têm argumento: o app registra os seus e repassa
+ * para aguada_link_on_send()/aguada_link_on_recv(). A task que chama
+ * aguada_link_send() usa a notificação (índice 0) durante o envio. O estado
+ * pode ficar em RTC RAM (deep sleep); aguada_link_start() a cada esp_now_init.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_now.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define AGUADA_LINK_RATIO_ONE 65536 // Taxa de entrega 1.0 em Q16
+
+typedef struct
+{
+    uint8_t gateway[6];         // MAC fixo; FF:FF:FF:FF:FF:FF = descobrir por sonda
+    uint8_t max_attempts;       // Transmissões por envio (1 = sem retry)
+    uint16_t ack_timeout_ms;    // Espera pelo callback de envio
+    uint16_t backoff_base_ms;   // 1º retry em [base/2, base], depois dobra
+    uint16_t probe_timeout_ms;  // Espera pelo beacon após a sonda
+    uint16_t probe_every;       // Envios em broadcast entre sondas (sem gateway)
+    uint8_t rediscover_after;   // Envios falhos seguidos até esquecer o gateway
+
+    // Potência de TX adaptativa (unidades de 0,25 dBm; tx_power_max 0 = fixa)
+    int8_t tx_power_min;        // Piso (≥ 8 = 2 dBm)
+    int8_t tx_power_max;        // Teto e valor inicial (≤ 84 = 21 dBm)
+    int8_t tx_power_step;       // Passo de subida/descida
+    uint8_t delivery_target_pct; // Abaixo disso a potência sobe
+    int8_t rssi_target_dbm;     // RSSI no gateway que basta; acima dele desce
+    uint8_t tx_settle;          // Envios entre uma descida e a próxima
+} aguada_link_config_t;
+
+typedef struct
+{
+    aguada_link_config_t cfg;
+    uint8_t self_mac[6];
+    uint8_t gateway[6];           // Destino unicast atual
+    bool discover;                // Gateway vem de sonda (não fixo)
+    bool has_gateway;             // Há destino unicast
+    uint8_t fail_streak;          // Envios seguidos sem ACK
+    uint16_t since_probe;         // Envios em broadcast desde a última sonda
+    uint32_t ratio_q16;           // EWMA da entrega (1/8 por transmissão)
+    int8_t gateway_rssi;          // RSSI no gateway (beacon/relatório; 0 = nenhum)
+    uint8_t gateway_loss;         // Perda no gateway (último relatório)
+    int8_t tx_power;              // Potência de TX atual (0,25 dBm)
+    uint8_t tx_hold;              // Envios até poder descer de novo
+
+    // Escritos pelos callbacks (task do WiFi)
+    volatile TaskHandle_t waiter; // Task em aguada_link_send (NULL = ninguém)
+    volatile uint8_t send_status; // LINK_SEND_* do último callback
+    volatile bool probing;        // Aceitando beacon
+    volatile bool beacon;         // Beacon recebido para este node
+    uint8_t beacon_mac[6];
+    volatile int8_t beacon_rssi;
+    volatile bool report;         // Relatório novo do gateway
+    volatile int8_t report_rssi;
+    volatile uint8_t report_loss;
+
+    // Contadores
+    uint32_t transmissions;       // Unicast com resultado (ACK ou falha)
+    uint32_t delivered;
+    uint32_t failed;
+    uint32_t timeouts;            // Sem callback dentro de ack_timeout_ms
+    uint32_t retries;
+    uint32_t unconfirmed;         // Envios em broadcast (sem gateway)
+    uint32_t probes;
+    uint32_t reports;             // Relatórios do gateway recebidos
+    uint32_t tx_raised;           // Subidas de potência
+    uint32_t tx_lowered;          // Descidas de potência
+} aguada_link_t;
+
+/**
+ * Estado inicial (power-on). Não toca no rádio.
+ */
+void aguada_link_init(aguada_link_t *link, const aguada_link_config_t *cfg);
+
+/**
+ * Após esp_now_init(): registra os peers (broadcast e gateway conhecido),
+ * reaplica a potência de TX e limpa o que os callbacks deixaram. Chamar a
+ * cada (re)inicialização do ESP-NOW.
+ */
+esp_err_t aguada_link_start(aguada_link_t *link);
+
+/**
+ * Repassar do callback de envio do app
+ */
+void aguada_link_on_send(aguada_link_t *link, esp_now_send_status_t status);
+
+/**
+ * Repassar do callback de recepção do app
+ *
+ * @return true se o pacote era uma mensagem de enlace (consumido)
+ */
+bool aguada_link_on_recv(aguada_link_t *link, const esp_now_recv_info_t *info, const uint8_t *data, int len);
+
+/**
+ * Envia o payload: unicast com ACK e retries (ou broadcast sem confirmação
+ * enquanto não há gateway). Bloqueia até o resultado.
+ *
+ * @return ESP_OK entregue (ou enviado em broadcast), ESP_FAIL sem ACK após
+ *         max_attempts, ou o erro de esp_now_send
+ */
+esp_err_t aguada_link_send(aguada_link_t *link, const uint8_t *data, size_t len);
+
+/**
+ * Taxa de entrega em % (1-100), ou 0 se ainda não houve unicast
+ */
+static inline uint8_t aguada_link_delivery_pct(const aguada_link_t *link)
+{
+    if (link->transmissions == 0)
+    {
+        return 0;
+    }
+    uint32_t pct = (link->ratio_q16 * 100u + AGUADA_LINK_RATIO_ONE / 2) / AGUADA_LINK_RATIO_ONE;
+    return (uint8_t)(pct < 1 ? 1 : pct);
+}
@@ -0,0 +1,77 @@
+/**
+ * AGUADA - Qualidade do enlace por node, vista pelo gateway
+ *
+ * O gateway é quem mede o RSSI real (rx_ctrl) de cada frame. Esta tabela
+ * guarda, por MAC de origem, o RSSI suavizado e quantos frames chegaram e
+ * quantos foram rejeitados na validação. De tempos em tempos (no máximo um
+ * a cada report_interval_ms por node) ela monta um relatório aguada_link
+ * (AGUADA_LINK_REPORT) que o gateway manda em broadcast logo após o frame
+ * do node, enquanto o rádio dele ainda está ligado. O node usa o relatório
+ * para ajustar a potência de transmissão.
+ *
+ * aguada_link_table_rx() roda no callback de recepção e
+ * aguada_link_table_bad() na task que valida os frames. As entradas têm um
+ * só escritor, o callback: a task só põe o MAC rejeitado numa fila SPSC
+ * (head/tail atômicos), que o próximo aguada_link_table_rx() aplica antes
+ * de contar o frame. Com a fila cheia o "bad" se perde (`bad_dropped`).
+ * Sem dependências do ESP-IDF.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "aguada_proto.h"
+
+#ifndef AGUADA_LINK_TABLE_SIZE
+#define AGUADA_LINK_TABLE_SIZE 16 // Nodes acompanhados (o mais antigo sai)
+#endif
+
+#define AGUADA_LINK_BAD_QUEUE 16 // Rejeições aguardando o callback (potência de 2)
+
+typedef struct
+{
+    uint8_t mac[6];
+    bool used;
+    int16_t rssi_q4;        // EWMA do RSSI em 1/16 dBm (peso 1/4)
+    uint32_t rx;            // Frames recebidos (callback)
+    uint32_t bad;           // Frames rejeitados (aplicados da fila de rejeições)
+    uint32_t rx_reported;   // rx no último relatório
+    uint32_t bad_reported;  // bad no último relatório
+    int64_t last_seen_us;
+    int64_t last_report_us; // 0 = nunca
+} aguada_link_node_t;
+
+typedef struct
+{
+    aguada_link_node_t nodes[AGUADA_LINK_TABLE_SIZE];
+    int64_t report_interval_us;
+    uint32_t reports;       // Relatórios montados
+    uint32_t evictions;     // Entradas reaproveitadas (tabela cheia)
+    uint8_t bad_macs[AGUADA_LINK_BAD_QUEUE][6];
+    uint32_t bad_head;      // Escrito só pela task de validação
+    uint32_t bad_tail;      // Escrito só pelo callback
+    uint32_t bad_dropped;   // Rejeições perdidas (fila cheia)
+} aguada_link_table_t;
+
+/**
+ * Tabela vazia. report_interval_ms = intervalo mínimo entre relatórios do
+ * mesmo node (o primeiro frame de um node sempre gera relatório).
+ */
+void aguada_link_table_init(aguada_link_table_t *table, uint32_t report_interval_ms);
+
+/**
+ * Registra um frame recebido de mac
+ *
+ * @return true se é hora de um relatório para o node (report preenchido,
+ *         pronto para aguada_link_encode)
+ */
+bool aguada_link_table_rx(aguada_link_table_t *table, const uint8_t *mac, int rssi, int64_t now_us,
+                          aguada_link_msg_t *report);
+
+/**
+ * Registra um frame de mac rejeitado na validação (CRC, versão, tamanho).
+ * Só enfileira: a contagem entra no próximo aguada_link_table_rx().
+ */
+void aguada_link_table_bad(aguada_link_table_t *table, const uint8_t *mac);
@@ -0,0 +1,116 @@
+/**
+ * AGUADA - Estado por node no gateway (sequência, perda, intervalo, RSSI)
+ *
+ * Tabela hash de endereçamento aberto (sondagem linear) com capacidade fixa,
+ * chaveada pelo MAC de origem: cada frame válido atualiza a entrada do node
+ * em O(1), sem alocação. Com o seq dos frames v2 / JSON "seq" (aguada_proto)
+ * a tabela separa frames novos, perdidos (salto na sequência) e repetidos
+ * (reenvio com o mesmo seq).
+ *
+ * Repetidos: uma janela deslizante de 32 bits marca os seqs já vistos atrás
+ * do último (bit i = last_seq - i). Um seq igual ou atrás do último só é
+ * repetido se chegou até AGUADA_NODE_DUP_WINDOW_MS depois do último frame
+ * e o bit dele está marcado; fora disso o node reiniciou a sequência. Os
+ * reenvios do aguada_link saem em menos de 1 s, então a janela de tempo não
+ * confunde reenvio com reinício.
+ *
+ * A perda recente é uma EWMA por frame (peso 1/16) em Q16: um salto de k
+ * frames conta como k perdas seguidas de um recebimento, numa só conta. O
+ * intervalo entre frames é outra EWMA (peso 1/8). Repetidos não mexem no
+ * intervalo nem na perda.
+ *
+ * Entradas não são removidas: acima de 3/4 da capacidade nodes novos não
+ * entram (contados em `untracked`). Um só escritor (a task que valida os
+ * frames); a exportação por outra task pode ver uma entrada meio
+ * atualizada. Sem dependências do ESP-IDF.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef AGUADA_NODE_TABLE_SIZE
+#define AGUADA_NODE_TABLE_SIZE 64 // Slots (potência de 2); até 48 nodes acompanhados
+#endif
+
+#ifndef AGUADA_NODE_DUP_WINDOW_MS
+#define AGUADA_NODE_DUP_WINDOW_MS 5000 // Repetido só até este tempo após o último frame
+#endif
+
+#define AGUADA_NODE_WINDOW_BITS 32
+#define AGUADA_NODE_TABLE_MAX_NODES (AGUADA_NODE_TABLE_SIZE * 3 / 4)
+#define AGUADA_NODE_JSON_MAX 192 // Uma entrada em aguada_node_table_json, com a vírgula
+
+_Static_assert((AGUADA_NODE_TABLE_SIZE & (AGUADA_NODE_TABLE_SIZE - 1)) == 0,
+               "AGUADA_NODE_TABLE_SIZE deve ser potência de 2");
+
+typedef enum
+{
+    AGUADA_NODE_FIRST = 0, // Primeiro frame do node
+    AGUADA_NODE_NEXT,      // Seq seguinte ao último (ou frame sem seq)
+    AGUADA_NODE_GAP,       // Faltaram frames entre o último e este
+    AGUADA_NODE_DUP,       // Seq já visto na janela (reenvio ou outra cópia)
+    AGUADA_NODE_LATE,      // Seq atrás do último, ainda não visto (fora de ordem)
+    AGUADA_NODE_RESET,     // Seq voltou (node reiniciou ou frame atrasado)
+    AGUADA_NODE_UNTRACKED, // Tabela cheia: node não acompanhado
+} aguada_node_rx_t;
+
+typedef struct
+{
+    uint8_t mac[6];
+    bool used;
+    bool has_seq;         // last_seq válido
+    uint8_t last_seq;     // Maior seq visto (frame mais novo)
+    int8_t last_rssi;     // dBm do último frame
+    uint32_t frames;      // Frames aceitos (sem os repetidos)
+    uint32_t window;      // Bit i: seq last_seq - i já visto
+    uint32_t lost;        // Frames que faltaram na sequência (menos os que chegaram atrasados)
+    uint32_t dups;        // Frames repetidos
+    uint32_t resets;      // Sequências reiniciadas
+    uint32_t loss_q16;    // EWMA da perda por frame (65536 = 100%)
+    uint32_t gap_ewma_ms; // EWMA do intervalo entre frames (0 = um frame só)
+    int64_t last_us;      // Frame com o maior seq
+} aguada_node_entry_t;
+
+typedef struct
+{
+    aguada_node_entry_t entries[AGUADA_NODE_TABLE_SIZE];
+    uint16_t count;     // Nodes acompanhados
+    uint32_t untracked; // Frames de nodes que não couberam
+} aguada_node_table_t;
+
+void aguada_node_table_init(aguada_node_table_t *table);
+
+/**
+ * Registra um frame válido de mac. has_seq = o frame trouxe seq.
+ * AGUADA_NODE_DUP = descartar o frame; os demais seguem adiante.
+ *
+ * @param entry Saída opcional: entrada do node (NULL se não acompanhado)
+ */
+aguada_node_rx_t aguada_node_table_rx(aguada_node_table_t *table, const uint8_t *mac, bool has_seq, uint8_t seq,
+                                      int rssi, int64_t now_us, aguada_node_entry_t **entry);
+
+/**
+ * Entrada de mac (NULL se o node não está na tabela)
+ */
+aguada_node_entry_t *aguada_node_table_find(aguada_node_table_t *table, const uint8_t *mac);
+
+/**
+ * Perda recente em % (arredondada)
+ */
+static inline uint8_t aguada_node_loss_pct(const aguada_node_entry_t *entry)
+{
+    return (uint8_t)((entry->loss_q16 * 100 + 32768) >> 16);
+}
+
+/**
+ * JSON array das entradas em uso:
+ * [{"mac":"..","seq":N,"frames":N,"lost":N,"loss_pct":N,"dups":N,"resets":N,
+ *   "rssi":N,"gap_ms":N,"age_s":N},...] ("seq" só com has_seq)
+ * Um buffer de AGUADA_NODE_TABLE_MAX_NODES * AGUADA_NODE_JSON_MAX + 3 sempre basta.
+ *
+ * @return comprimento escrito (sem '\0') ou -1 se não coube
+ */
+int aguada_node_table_json(const aguada_node_table_t *table, int64_t now_us, char *out, size_t size);
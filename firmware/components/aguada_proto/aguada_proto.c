@@ -0,0 +1,1081 @@
+/**
+ * AGUADA - Protocolo AGUADA-1 (codecs compartilhados)
+ *
+ * Os encoders evitam snprintf: inteiros e MAC são formatados à mão (ver a
+ * comparação em bench/). O decoder JSON é um scanner de objeto plano -
+ * suficiente para o AGUADA-1, não um parser JSON genérico.
+ */
+
+#include "aguada_proto.h"
+
+#include <string.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "aguada_bin_frame_t assume little-endian (ESP32/x86/ARM)"
+#endif
+
+// Pior caso do encoder JSON - AGUADA_JSON_MAX deve acompanhar o formato
+#define JSON_WORST_CASE                                                              \
+    "{\"mac\":\"XX:XX:XX:XX:XX:XX\",\"distance_mm\":-2147483648,"                   \
+    "\"vcc_bat_mv\":-2147483648,\"rssi\":-2147483648,\"rle\":65535,"                \
+    "\"min_mm\":-2147483648,\"max_mm\":-2147483648,\"avg_mm\":-2147483648,"   \
+    "\"age_ms\":2147483647,\"delivery_pct\":255,\"slope_mm_h\":-2147483648,"     \
+    "\"seq\":255}"
+
+_Static_assert(sizeof(JSON_WORST_CASE) <= AGUADA_JSON_MAX, "AGUADA_JSON_MAX menor que o pior caso");
+
+// Pior caso da forma JSON multicanal (cabeçalho, um canal, fechamento "]}")
+#define MULTI_JSON_HEAD_WORST_CASE                                                   \
+    "{\"mac\":\"XX:XX:XX:XX:XX:XX\",\"vcc_bat_mv\":-2147483648,"                   \
+    "\"rssi\":-2147483648,\"delivery_pct\":255,\"seq\":255,\"channels\":["
+#define MULTI_JSON_CHANNEL_WORST_CASE                                                \
+    "{\"mac\":\"XX:XX:XX:XX:XX:XX\",\"distance_mm\":-2147483648,\"rle\":65535},"
+
+_Static_assert(sizeof(MULTI_JSON_HEAD_WORST_CASE) - 1 <= AGUADA_MULTI_JSON_HEAD_MAX, "AGUADA_MULTI_JSON_HEAD_MAX menor que o pior caso");
+_Static_assert(sizeof(MULTI_JSON_CHANNEL_WORST_CASE) - 1 <= AGUADA_MULTI_JSON_CHANNEL_MAX, "AGUADA_MULTI_JSON_CHANNEL_MAX menor que o pior caso");
+
+// ============================================================================
+// CRC16-CCITT (tabela de 256 entradas, 512 bytes em flash)
+// ============================================================================
+
+static const uint16_t crc16_table[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0,
+};
+
+uint16_t aguada_crc16_update(uint16_t crc, const void *data, size_t len)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc = (uint16_t)(crc << 8) ^ crc16_table[(crc >> 8) ^ bytes[i]];
+    }
+    return crc;
+}
+
+// ============================================================================
+// MAC / HEX
+// ============================================================================
+
+static const char hex_upper[] = "0123456789ABCDEF";
+static const char hex_lower[] = "0123456789abcdef";
+
+void aguada_mac_to_string(const uint8_t *mac, char *out)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        out[i * 3] = hex_upper[mac[i] >> 4];
+        out[i * 3 + 1] = hex_upper[mac[i] & 0x0F];
+        out[i * 3 + 2] = (i < 5) ? ':' : '\0';
+    }
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool aguada_mac_parse(const char *str, uint8_t *mac)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        int hi = hex_value(str[i * 3]);
+        int lo = hex_value(str[i * 3 + 1]);
+        if (hi < 0 || lo < 0 || (i < 5 && str[i * 3 + 2] != ':'))
+        {
+            return false;
+        }
+        mac[i] = (uint8_t)((hi << 4) | lo);
+    }
+    return true;
+}
+
+int aguada_hex_encode(const uint8_t *data, size_t len, char *out, size_t size)
+{
+    if (size < len * 2 + 1)
+    {
+        return AGUADA_PROTO_ERR_SIZE;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        out[i * 2] = hex_lower[data[i] >> 4];
+        out[i * 2 + 1] = hex_lower[data[i] & 0x0F];
+    }
+    out[len * 2] = '\0';
+    return (int)(len * 2);
+}
+
+// ============================================================================
+// CODEC JSON
+// ============================================================================
+
+/**
+ * Anexa um literal; o chamador garante espaço (buffer >= AGUADA_JSON_MAX)
+ */
+static char *put_str(char *p, const char *s, size_t len)
+{
+    memcpy(p, s, len);
+    return p + len;
+}
+
+#define PUT_LITERAL(p, lit) put_str((p), (lit), sizeof(lit) - 1)
+
+static char *put_i32(char *p, int32_t value)
+{
+    char digits[10];
+    int n = 0;
+    uint32_t magnitude = (value < 0) ? (uint32_t)0 - (uint32_t)value : (uint32_t)value;
+
+    if (value < 0)
+    {
+        *p++ = '-';
+    }
+    do
+    {
+        digits[n++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+
+    while (n > 0)
+    {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+int aguada_json_encode(const aguada_reading_t *reading, char *out, size_t size)
+{
+    // Buffer do chamador com o pior caso: escreve direto, sem cópia
+    char buf[AGUADA_JSON_MAX];
+    char *start = (size >= AGUADA_JSON_MAX) ? out : buf;
+    char *p = start;
+
+    p = PUT_LITERAL(p, "{\"mac\":\"");
+    aguada_mac_to_string(reading->mac, p);
+    p += AGUADA_MAC_STR_LEN - 1;
+    p = PUT_LITERAL(p, "\",\"distance_mm\":");
+    p = put_i32(p, reading->distance_mm);
+    p = PUT_LITERAL(p, ",\"vcc_bat_mv\":");
+    p = put_i32(p, reading->vcc_bat_mv);
+
+    if (reading->rssi != 0)
+    {
+        p = PUT_LITERAL(p, ",\"rssi\":");
+        p = put_i32(p, reading->rssi);
+    }
+
+    if (reading->rle > 0)
+    {
+        p = PUT_LITERAL(p, ",\"rle\":");
+        p = put_i32(p, reading->rle);
+    }
+
+    if (reading->has_agg)
+    {
+        p = PUT_LITERAL(p, ",\"min_mm\":");
+        p = put_i32(p, reading->min_mm);
+        p = PUT_LITERAL(p, ",\"max_mm\":");
+        p = put_i32(p, reading->max_mm);
+        p = PUT_LITERAL(p, ",\"avg_mm\":");
+        p = put_i32(p, reading->avg_mm);
+    }
+
+    if (reading->age_ms > 0)
+    {
+        p = PUT_LITERAL(p, ",\"age_ms\":");
+        p = put_i32(p, reading->age_ms);
+    }
+
+    if (reading->delivery_pct > 0)
+    {
+        p = PUT_LITERAL(p, ",\"delivery_pct\":");
+        p = put_i32(p, reading->delivery_pct);
+    }
+
+    if (reading->has_slope)
+    {
+        p = PUT_LITERAL(p, ",\"slope_mm_h\":");
+        p = put_i32(p, reading->slope_mm_h);
+    }
+
+    if (reading->has_seq)
+    {
+        p = PUT_LITERAL(p, ",\"seq\":");
+        p = put_i32(p, reading->seq);
+    }
+    *p++ = '}';
+
+    size_t len = (size_t)(p - start);
+    if (start == buf)
+    {
+        if (size < len + 1)
+        {
+            return AGUADA_PROTO_ERR_SIZE;
+        }
+        memcpy(out, buf, len);
+    }
+    out[len] = '\0';
+    return (int)len;
+}
+
+typedef struct
+{
+    const char *p;
+    const char *end;
+} json_scan_t;
+
+static void skip_ws(json_scan_t *s)
+{
+    while (s->p < s->end && (*s->p == ' ' || *s->p == '\t' || *s->p == '\r' || *s->p == '\n'))
+    {
+        s->p++;
+    }
+}
+
+static bool expect_char(json_scan_t *s, char c)
+{
+    skip_ws(s);
+    if (s->p < s->end && *s->p == c)
+    {
+        s->p++;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Lê uma string (após a aspa de abertura); escapes são pulados, não traduzidos
+ */
+static bool scan_string(json_scan_t *s, const char **start, size_t *len)
+{
+    *start = s->p;
+    while (s->p < s->end && *s->p != '"')
+    {
+        if (*s->p == '\\')
+        {
+            s->p++;
+        }
+        s->p++;
+    }
+    if (s->p >= s->end)
+    {
+        return false;
+    }
+    *len = (size_t)(s->p - *start);
+    s->p++;
+    return true;
+}
+
+/**
+ * Lê um número; a parte fracionária/expoente é descartada (truncamento)
+ */
+static bool scan_int(json_scan_t *s, int32_t *value)
+{
+    bool negative = false;
+    int64_t acc = 0;
+    const char *digits_start;
+
+    if (s->p < s->end && (*s->p == '-' || *s->p == '+'))
+    {
+        negative = (*s->p == '-');
+        s->p++;
+    }
+    digits_start = s->p;
+    while (s->p < s->end && *s->p >= '0' && *s->p <= '9')
+    {
+        if (acc <= INT32_MAX)
+        {
+            acc = acc * 10 + (*s->p - '0');
+        }
+        s->p++;
+    }
+    if (s->p == digits_start)
+    {
+        return false;
+    }
+    while (s->p < s->end && ((*s->p >= '0' && *s->p <= '9') || *s->p == '.' ||
+                             *s->p == 'e' || *s->p == 'E' || *s->p == '-' || *s->p == '+'))
+    {
+        s->p++;
+    }
+
+    if (negative)
+    {
+        acc = -acc;
+    }
+    *value = (acc > INT32_MAX) ? INT32_MAX : (acc < INT32_MIN) ? INT32_MIN : (int32_t)acc;
+    return true;
+}
+
+static bool key_is(const char *key, size_t key_len, const char *name)
+{
+    size_t name_len = strlen(name);
+    return key_len == name_len && memcmp(key, name, name_len) == 0;
+}
+
+aguada_proto_err_t aguada_json_decode(const char *json, size_t len, aguada_reading_t *out)
+{
+    json_scan_t s = {json, json + len};
+    bool has_mac = false;
+    bool has_distance = false;
+    uint8_t agg_fields = 0;
+
+    memset(out, 0, sizeof(*out));
+
+    if (!expect_char(&s, '{'))
+    {
+        return AGUADA_PROTO_ERR_FORMAT;
+    }
+    if (expect_char(&s, '}'))
+    {
+        return AGUADA_PROTO_ERR_FORMAT;
+    }
+
+    while (1)
+    {
+        const char *key;
+        size_t key_len;
+
+        if (!expect_char(&s, '"') || !scan_string(&s, &key, &key_len) || !expect_char(&s, ':'))
+        {
+            return AGUADA_PROTO_ERR_FORMAT;
+        }
+        skip_ws(&s);
+        if (s.p >= s.end)
+        {
+            return AGUADA_PROTO_ERR_FORMAT;
+        }
+
+        if (*s.p == '"')
+        {
+            const char *value;
+            size_t value_len;
+            s.p++;
+            if (!scan_string(&s, &value, &value_len))
+            {
+                return AGUADA_PROTO_ERR_FORMAT;
+            }
+            if (key_is(key, key_len, "mac"))
+            {
+                if (value_len != AGUADA_MAC_STR_LEN - 1 || !aguada_mac_parse(value, out->mac))
+                {
+                    return AGUADA_PROTO_ERR_FORMAT;
+                }
+                has_mac = true;
+            }
+        }
+        else if (*s.p == '-' || *s.p == '+' || (*s.p >= '0' && *s.p <= '9'))
+        {
+            int32_t value;
+            if (!scan_int(&s, &value))
+            {
+                return AGUADA_PROTO_ERR_FORMAT;
+            }
+            if (key_is(key, key_len, "distance_mm"))
+            {
+                out->distance_mm = value;
+                has_distance = true;
+            }
+            else if (key_is(key, key_len, "vcc_bat_mv"))
+            {
+                out->vcc_bat_mv = value;
+            }
+            else if (key_is(key, key_len, "rssi"))
+            {
+                out->rssi = value;
+            }
+            else if (key_is(key, key_len, "rle"))
+            {
+                out->rle = (value < 0) ? 0 : (value > UINT16_MAX) ? UINT16_MAX : (uint16_t)value;
+            }
+            else if (key_is(key, key_len, "min_mm"))
+            {
+                out->min_mm = value;
+                agg_fields |= 0x1;
+            }
+            else if (key_is(key, key_len, "max_mm"))
+            {
+                out->max_mm = value;
+                agg_fields |= 0x2;
+            }
+            else if (key_is(key, key_len, "avg_mm"))
+            {
+                out->avg_mm = value;
+                agg_fields |= 0x4;
+            }
+            else if (key_is(key, key_len, "age_ms"))
+            {
+                out->age_ms = (value < 0) ? 0 : value;
+            }
+            else if (key_is(key, key_len, "delivery_pct"))
+            {
+                out->delivery_pct = (value < 0) ? 0 : (value > 100) ? 100 : (uint8_t)value;
+            }
+            else if (key_is(key, key_len, "slope_mm_h"))
+            {
+                out->slope_mm_h = value;
+                out->has_slope = true;
+            }
+            else if (key_is(key, key_len, "seq"))
+            {
+                if (value < 0 || value > UINT8_MAX)
+                {
+                    return AGUADA_PROTO_ERR_FORMAT;
+                }
+                out->seq = (uint8_t)value;
+                out->has_seq = true;
+            }
+        }
+        else if (*s.p == 't' || *s.p == 'f' || *s.p == 'n')
+        {
+            // true/false/null em chaves desconhecidas
+            while (s.p < s.end && *s.p >= 'a' && *s.p <= 'z')
+            {
+                s.p++;
+            }
+        }
+        else
+        {
+            // Objetos/arrays aninhados não fazem parte do AGUADA-1
+            return AGUADA_PROTO_ERR_FORMAT;
+        }
+
+        if (expect_char(&s, ','))
+        {
+            continue;
+        }
+        if (expect_char(&s, '}'))
+        {
+            break;
+        }
+        return AGUADA_PROTO_ERR_FORMAT;
+    }
+
+    if (!has_mac || !has_distance)
+    {
+        return AGUADA_PROTO_ERR_FORMAT;
+    }
+    out->has_agg = (agg_fields == 0x7);
+    if (out->has_agg)
+    {
+        out->flags |= AGUADA_FLAG_AGGREGATED;
+    }
+    return AGUADA_PROTO_OK;
+}
+
+// ============================================================================
+// CODEC BINÁRIO
+// ============================================================================
+
+static int32_t clamp_i32(int32_t value, int32_t min, int32_t max)
+{
+    return (value < min) ? min : (value > max) ? max : value;
+}
+
+/**
+ * Byte de sequência dos frames: seq (v2) ou, sem has_seq, o RSSI (v1)
+ */
+static uint8_t seq_byte(const aguada_reading_t *reading)
+{
+    return reading->has_seq ? reading->seq : (uint8_t)(int8_t)clamp_i32(reading->rssi, INT8_MIN, INT8_MAX);
+}
+
+/**
+ * Lado do decoder: v2 traz a sequência, v1 o RSSI do node
+ */
+static void seq_parse(uint8_t version, uint8_t current, uint8_t value, aguada_reading_t *out)
+{
+    if (version == current)
+    {
+        out->has_seq = true;
+        out->seq = value;
+    }
+    else
+    {
+        out->rssi = (int8_t)value;
+    }
+}
+
+void aguada_bin_encode(const aguada_reading_t *reading, uint8_t *out)
+{
+    aguada_bin_frame_t frame;
+
+    frame.magic = reading->has_seq ? AGUADA_BIN_MAGIC : (AGUADA_BIN_MAGIC_HI << 8) | AGUADA_BIN_VERSION_RSSI;
+    memcpy(frame.mac, reading->mac, 6);
+    frame.distance_mm = (int16_t)clamp_i32(reading->distance_mm, INT16_MIN, INT16_MAX);
+    frame.vcc_mv = (uint16_t)clamp_i32(reading->vcc_bat_mv, 0, UINT16_MAX);
+    frame.seq = seq_byte(reading);
+    frame.flags = reading->flags;
+    frame.crc16 = aguada_crc16(&frame, AGUADA_BIN_SIZE - 2);
+
+    memcpy(out, &frame, AGUADA_BIN_SIZE);
+}
+
+bool aguada_bin_detect(const uint8_t *data, size_t len)
+{
+    return len == AGUADA_BIN_SIZE && data[1] == AGUADA_BIN_MAGIC_HI;
+}
+
+aguada_proto_err_t aguada_bin_decode(const uint8_t *data, size_t len, aguada_reading_t *out)
+{
+    aguada_bin_frame_t frame;
+
+    if (len != AGUADA_BIN_SIZE)
+    {
+        return AGUADA_PROTO_ERR_SIZE;
+    }
+    if (data[1] != AGUADA_BIN_MAGIC_HI)
+    {
+        return AGUADA_PROTO_ERR_MAGIC;
+    }
+    if (data[0] != AGUADA_BIN_VERSION && data[0] != AGUADA_BIN_VERSION_RSSI)
+    {
+        return AGUADA_PROTO_ERR_VERSION;
+    }
+
+    memcpy(&frame, data, AGUADA_BIN_SIZE);
+    if (aguada_crc16(data, AGUADA_BIN_SIZE - 2) != frame.crc16)
+    {
+        return AGUADA_PROTO_ERR_CRC;
+    }
+
+    memset(out, 0, sizeof(*out));
+    memcpy(out->mac, frame.mac, 6);
+    out->distance_mm = frame.distance_mm;
+    out->vcc_bat_mv = frame.vcc_mv;
+    seq_parse(data[0], AGUADA_BIN_VERSION, frame.seq, out);
+    out->flags = frame.flags;
+    return AGUADA_PROTO_OK;
+}
+
+// ============================================================================
+// CODEC EM LOTE
+// ============================================================================
+
+static uint8_t *put_varint(uint8_t *p, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        *p++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+/**
+ * Lê um varint de no máximo `max_bytes`; NULL se truncado ou longo demais
+ */
+static const uint8_t *get_varint(const uint8_t *p, const uint8_t *end, int max_bytes, uint32_t *value)
+{
+    uint32_t result = 0;
+    for (int i = 0; i < max_bytes && p < end; i++)
+    {
+        uint8_t byte = *p++;
+        result |= (uint32_t)(byte & 0x7F) << (7 * i);
+        if (!(byte & 0x80))
+        {
+            *value = result;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static inline uint32_t zigzag_encode(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t zigzag_decode(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static uint16_t batch_ticks(const aguada_batch_t *batch, uint32_t now_ms)
+{
+    uint32_t ticks = (now_ms - batch->start_ms) / AGUADA_BATCH_TICK_MS;
+    return (ticks > UINT16_MAX) ? UINT16_MAX : (uint16_t)ticks;
+}
+
+void aguada_batch_init(aguada_batch_t *batch)
+{
+    batch->len = AGUADA_BATCH_HEADER_SIZE;
+    batch->count = 0;
+    batch->flags = 0;
+    batch->last_mm = 0;
+    batch->start_ms = 0;
+    batch->last_tick = 0;
+}
+
+bool aguada_batch_add(aguada_batch_t *batch, int32_t distance_mm, uint8_t flags, uint32_t now_ms)
+{
+    if (aguada_batch_full(batch))
+    {
+        return false;
+    }
+    if (batch->count == 0)
+    {
+        batch->start_ms = now_ms;
+    }
+
+    int32_t mm = clamp_i32(distance_mm, INT16_MIN, INT16_MAX);
+    uint16_t tick = batch_ticks(batch, now_ms);
+
+    uint8_t *p = batch->buf + batch->len;
+    p = put_varint(p, (uint32_t)(tick - batch->last_tick));
+    p = put_varint(p, zigzag_encode(mm - batch->last_mm));
+
+    batch->len = (size_t)(p - batch->buf);
+    batch->count++;
+    batch->flags |= flags;
+    batch->last_mm = mm;
+    batch->last_tick = tick;
+    return true;
+}
+
+size_t aguada_batch_finish(aguada_batch_t *batch, const aguada_reading_t *status, uint32_t now_ms)
+{
+    aguada_batch_header_t header;
+
+    if (batch->count == 0)
+    {
+        return 0;
+    }
+
+    header.magic = status->has_seq ? AGUADA_BATCH_MAGIC : (AGUADA_BATCH_MAGIC_HI << 8) | AGUADA_BATCH_VERSION_RSSI;
+    memcpy(header.mac, status->mac, 6);
+    header.vcc_mv = (uint16_t)clamp_i32(status->vcc_bat_mv, 0, UINT16_MAX);
+    header.seq = seq_byte(status);
+    header.flags = batch->flags | status->flags;
+    header.count = batch->count;
+    header.span_ticks = batch_ticks(batch, now_ms);
+    memcpy(batch->buf, &header, AGUADA_BATCH_HEADER_SIZE);
+
+    uint16_t crc = aguada_crc16(batch->buf, batch->len);
+    batch->buf[batch->len] = (uint8_t)crc;
+    batch->buf[batch->len + 1] = (uint8_t)(crc >> 8);
+    return batch->len + 2;
+}
+
+bool aguada_batch_detect(const uint8_t *data, size_t len)
+{
+    return len >= AGUADA_BATCH_HEADER_SIZE + 2 && len <= AGUADA_ESPNOW_MAX_LEN &&
+           data[1] == AGUADA_BATCH_MAGIC_HI;
+}
+
+aguada_proto_err_t aguada_batch_decode(const uint8_t *data, size_t len, aguada_reading_t *header,
+                                       aguada_batch_item_t *items, size_t max_items, size_t *count)
+{
+    aguada_batch_header_t frame;
+
+    *count = 0;
+    if (len < AGUADA_BATCH_HEADER_SIZE + 2 || len > AGUADA_ESPNOW_MAX_LEN)
+    {
+        return AGUADA_PROTO_ERR_SIZE;
+    }
+    if (data[1] != AGUADA_BATCH_MAGIC_HI)
+    {
+        return AGUADA_PROTO_ERR_MAGIC;
+    }
+    if (data[0] != AGUADA_BATCH_VERSION && data[0] != AGUADA_BATCH_VERSION_RSSI)
+    {
+        return AGUADA_PROTO_ERR_VERSION;
+    }
+    if (aguada_crc16(data, len - 2) != (uint16_t)(data[len - 2] | data[len - 1] << 8))
+    {
+        return AGUADA_PROTO_ERR_CRC;
+    }
+
+    memcpy(&frame, data, AGUADA_BATCH_HEADER_SIZE);
+    if (frame.count == 0 || frame.count > max_items)
+    {
+        return AGUADA_PROTO_ERR_SIZE;
+    }
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->mac, frame.mac, 6);
+    header->vcc_bat_mv = frame.vcc_mv;
+    seq_parse(data[0], AGUADA_BATCH_VERSION, frame.seq, header);
+    header->flags = frame.flags;
+
+    const uint8_t *p = data + AGUADA_BATCH_HEADER_SIZE;
+    const uint8_t *end = data + len - 2;
+    uint32_t tick = 0;
+    int32_t mm = 0;
+
+    for (size_t i = 0; i < frame.count; i++)
+    {
+        uint32_t dt, delta;
+        if ((p = get_varint(p, end, 3, &dt)) == NULL || (p = get_varint(p, end, 3, &delta)) == NULL)
+        {
+            return AGUADA_PROTO_ERR_FORMAT;
+        }
+        tick += dt;
+        mm += zigzag_decode(delta);
+        if (tick > frame.span_ticks)
+        {
+            return AGUADA_PROTO_ERR_FORMAT;
+        }
+        items[i].distance_mm = mm;
+        items[i].age_ms = (int32_t)(frame.span_ticks - tick) * AGUADA_BATCH_TICK_MS;
+    }
+    if (p != end)
+    {
+        return AGUADA_PROTO_ERR_FORMAT;
+    }
+
+    *count = frame.count;
+    return AGUADA_PROTO_OK;
+}
+
+// ============================================================================
+// CODEC MULTICANAL
+// ============================================================================
+
+size_t aguada_multi_encode(const aguada_reading_t *node, const aguada_reading_t *channels, size_t count,
+                           uint8_t *out, size_t size)
+{
+    aguada_multi_header_t header;
+    aguada_multi_record_t record;
+
+    if (count == 0 || count > AGUADA_MULTI_MAX_CHANNELS || size < AGUADA_MULTI_SIZE(count))
+    {
+        return 0;
+    }
+
+    header.magic = node->has_seq ? AGUADA_MULTI_MAGIC : (AGUADA_MULTI_MAGIC_HI << 8) | AGUADA_MULTI_VERSION_RSSI;
+    memcpy(header.mac, node->mac, 6);
+    header.vcc_mv = (uint16_t)clamp_i32(node->vcc_bat_mv, 0, UINT16_MAX);
+    header.seq = seq_byte(node);
+    header.delivery_pct = node->delivery_pct;
+    header.flags = node->flags;
+    header.count = (uint8_t)count;
+    memcpy(out, &header, AGUADA_MULTI_HEADER_SIZE);
+
+    uint8_t *p = out + AGUADA_MULTI_HEADER_SIZE;
+    for (size_t i = 0; i < count; i++)
+    {
+        memcpy(record.mac, channels[i].mac, 6);
+        record.distance_mm = (int16_t)clamp_i32(channels[i].distance_mm, INT16_MIN, INT16_MAX);
+        record.rle = channels[i].rle;
+        record.flags = channels[i].flags;
+        memcpy(p, &record, AGUADA_MULTI_RECORD_SIZE);
+        p += AGUADA_MULTI_RECORD_SIZE;
+    }
+
+    size_t len = (size_t)(p - out);
+    uint16_t crc = aguada_crc16(out, len);
+    out[len] = (uint8_t)crc;
+    out[len + 1] = (uint8_t)(crc >> 8);
+    return len + 2;
+}
+
+bool aguada_multi_detect(const uint8_t *data, size_t len)
+{
+    return len >= AGUADA_MULTI_SIZE(1) && len <= AGUADA_ESPNOW_MAX_LEN && data[1] == AGUADA_MULTI_MAGIC_HI;
+}
+
+aguada_proto_err_t aguada_multi_decode(const uint8_t *data, size_t len, aguada_reading_t *node,
+                                       aguada_reading_t *channels, size_t max_channels, size_t *count)
+{
+    aguada_multi_header_t header;
+    aguada_multi_record_t record;
+
+    *count = 0;
+    if (len < AGUADA_MULTI_SIZE(1) || len > AGUADA_ESPNOW_MAX_LEN)
+    {
+        return AGUADA_PROTO_ERR_SIZE;
+    }
+    if (data[1] != AGUADA_MULTI_MAGIC_HI)
+    {
+        return AGUADA_PROTO_ERR_MAGIC;
+    }
+    if (data[0] != AGUADA_MULTI_VERSION && data[0] != AGUADA_MULTI_VERSION_RSSI)
+    {
+        return AGUADA_PROTO_ERR_VERSION;
+    }
+    if (aguada_crc16(data, len - 2) != (uint16_t)(data[len - 2] | data[len - 1] << 8))
+    {
+        return AGUADA_PROTO_ERR_CRC;
+    }
+
+    memcpy(&header, data, AGUADA_MULTI_HEADER_SIZE);
+    if (header.count == 0 || len != AGUADA_MULTI_SIZE(header.count))
+    {
+        return AGUADA_PROTO_ERR_FORMAT;
+    }
+    if (header.count > max_channels)
+    {
+        return AGUADA_PROTO_ERR_SIZE;
+    }
+
+    memset(node, 0, sizeof(*node));
+    memcpy(node->mac, header.mac, 6);
+    node->vcc_bat_mv = header.vcc_mv;
+    seq_parse(data[0], AGUADA_MULTI_VERSION, header.seq, node);
+    node->delivery_pct = header.delivery_pct;
+    node->flags = header.flags;
+
+    const uint8_t *p = data + AGUADA_MULTI_HEADER_SIZE;
+    for (size_t i = 0; i < header.count; i++)
+    {
+        memcpy(&record, p, AGUADA_MULTI_RECORD_SIZE);
+        p += AGUADA_MULTI_RECORD_SIZE;
+
+        channels[i] = *node;
+        memcpy(channels[i].mac, record.mac, 6);
+        channels[i].distance_mm = record.distance_mm;
+        channels[i].rle = record.rle;
+        channels[i].flags = node->flags | record.flags;
+    }
+
+    *count = header.count;
+    return AGUADA_PROTO_OK;
+}
+
+int aguada_multi_json_encode(const aguada_reading_t *node, const aguada_reading_t *channels, size_t count,
+                             char *out, size_t size)
+{
+    if (size < AGUADA_MULTI_JSON_MAX(count))
+    {
+        return AGUADA_PROTO_ERR_SIZE;
+    }
+
+    char *p = out;
+    p = PUT_LITERAL(p, "{\"mac\":\"");
+    aguada_mac_to_string(node->mac, p);
+    p += AGUADA_MAC_STR_LEN - 1;
+    p = PUT_LITERAL(p, "\",\"vcc_bat_mv\":");
+    p = put_i32(p, node->vcc_bat_mv);
+
+    if (node->rssi != 0)
+    {
+        p = PUT_LITERAL(p, ",\"rssi\":");
+        p = put_i32(p, node->rssi);
+    }
+
+    if (node->delivery_pct > 0)
+    {
+        p = PUT_LITERAL(p, ",\"delivery_pct\":");
+        p = put_i32(p, node->delivery_pct);
+    }
+
+    if (node->has_seq)
+    {
+        p = PUT_LITERAL(p, ",\"seq\":");
+        p = put_i32(p, node->seq);
+    }
+    p = PUT_LITERAL(p, ",\"channels\":[");
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (i > 0)
+        {
+            *p++ = ',';
+        }
+        p = PUT_LITERAL(p, "{\"mac\":\"");
+        aguada_mac_to_string(channels[i].mac, p);
+        p += AGUADA_MAC_STR_LEN - 1;
+        p = PUT_LITERAL(p, "\",\"distance_mm\":");
+        p = put_i32(p, channels[i].distance_mm);
+        if (channels[i].rle > 0)
+        {
+            p = PUT_LITERAL(p, ",\"rle\":");
+            p = put_i32(p, channels[i].rle);
+        }
+        *p++ = '}';
+    }
+    *p++ = ']';
+    *p++ = '}';
+    *p = '\0';
+    return (int)(p - out);
+}
+
+// ============================================================================
+// MENSAGENS DE ENLACE
+// ============================================================================
+
+void aguada_link_encode(aguada_link_msg_t *msg, uint8_t *out)
+{
+    msg->magic = AGUADA_LINK_MAGIC;
+    msg->crc16 = aguada_crc16(msg, AGUADA_LINK_SIZE - 2);
+    memcpy(out, msg, AGUADA_LINK_SIZE);
+}
+
+bool aguada_link_detect(const uint8_t *data, size_t len)
+{
+    return len == AGUADA_LINK_SIZE && data[1] == AGUADA_LINK_MAGIC_HI;
+}
+
+aguada_proto_err_t aguada_link_decode(const uint8_t *data, size_t len, aguada_link_msg_t *out)
+{
+    if (len != AGUADA_LINK_SIZE)
+    {
+        return AGUADA_PROTO_ERR_SIZE;
+    }
+    if (data[1] != AGUADA_LINK_MAGIC_HI)
+    {
+        return AGUADA_PROTO_ERR_MAGIC;
+    }
+    if (data[0] != AGUADA_LINK_VERSION)
+    {
+        return AGUADA_PROTO_ERR_VERSION;
+    }
+
+    memcpy(out, data, AGUADA_LINK_SIZE);
+    if (aguada_crc16(data, AGUADA_LINK_SIZE - 2) != out->crc16)
+    {
+        return AGUADA_PROTO_ERR_CRC;
+    }
+    return AGUADA_PROTO_OK;
+}
+
+// ============================================================================
+// CLASSIFICAÇÃO (prioridade no gateway)
+// ============================================================================
+
+#define ALARM_FLAGS (AGUADA_FLAG_ERROR | AGUADA_FLAG_LOW_BATTERY)
+#define ALARM_MAX_MM 1 // distance_mm 0/1 (e negativos): códigos de erro do sensor
+
+/**
+ * Algum "distance_mm" do JSON é código de erro? Varre o buffer sem exigir
+ * '\0' e sem validar o resto do objeto.
+ */
+static bool json_has_error_distance(const char *json, size_t len)
+{
+    static const char key[] = "\"distance_mm\"";
+    const size_t key_len = sizeof(key) - 1;
+
+    for (size_t i = 0; i + key_len <= len; i++)
+    {
+        if (memcmp(json + i, key, key_len) != 0)
+        {
+            continue;
+        }
+        size_t p = i + key_len;
+        while (p < len && (json[p] == ' ' || json[p] == ':'))
+        {
+            p++;
+        }
+        if (p < len && json[p] == '-')
+        {
+            return true;
+        }
+        int32_t value = 0;
+        size_t digits = 0;
+        while (p < len && json[p] >= '0' && json[p] <= '9' && digits < 6)
+        {
+            value = value * 10 + (json[p++] - '0');
+            digits++;
+        }
+        if (digits > 0 && value <= ALARM_MAX_MM)
+        {
+            return true;
+        }
+        i = p;
+    }
+    return false;
+}
+
+bool aguada_frame_is_alarm(const uint8_t *data, size_t len)
+{
+    if (aguada_bin_detect(data, len))
+    {
+        aguada_bin_frame_t frame;
+        memcpy(&frame, data, sizeof(frame));
+        return (frame.flags & ALARM_FLAGS) || frame.distance_mm <= ALARM_MAX_MM;
+    }
+    if (aguada_batch_detect(data, len))
+    {
+        aguada_batch_header_t header; // flags = OR das leituras do lote
+        memcpy(&header, data, sizeof(header));
+        return (header.flags & ALARM_FLAGS) != 0;
+    }
+    if (aguada_multi_detect(data, len))
+    {
+        aguada_multi_header_t header;
+        aguada_multi_record_t record;
+        memcpy(&header, data, sizeof(header));
+        if (header.flags & ALARM_FLAGS)
+        {
+            return true;
+        }
+        for (size_t i = 0; i < header.count && AGUADA_MULTI_SIZE(i + 1) <= len; i++)
+        {
+            memcpy(&record, data + AGUADA_MULTI_HEADER_SIZE + i * AGUADA_MULTI_RECORD_SIZE, sizeof(record));
+            if ((record.flags & AGUADA_FLAG_ERROR) || record.distance_mm <= ALARM_MAX_MM)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    if (len > 0 && data[0] == '{')
+    {
+        return json_has_error_distance((const char *)data, len);
+    }
+    return false;
+}
+
+const char *aguada_proto_err_name(aguada_proto_err_t err)
+{
+    switch (err)
+    {
+    case AGUADA_PROTO_OK:
+        return "ok";
+    case AGUADA_PROTO_ERR_SIZE:
+        return "tamanho";
+    case AGUADA_PROTO_ERR_MAGIC:
+        return "magic";
+    case AGUADA_PROTO_ERR_VERSION:
+        return "versão";
+    case AGUADA_PROTO_ERR_CRC:
+        return "crc";
+    case AGUADA_PROTO_ERR_FORMAT:
+        return "formato";
+    }
+    return "?";
+}
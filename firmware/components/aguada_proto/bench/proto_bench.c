@@ -0,0 +1,465 @@
+/**
+ * AGUADA - Bench de host dos codecs AGUADA-1
+ *
+ * Confere ida-e-volta dos codecs (aborta se divergir) e mede ns/op de cada
+ * um contra as implementações antigas dos firmwares (CRC bit a bit e
+ * snprintf), que ficam aqui só como referência.
+ *
+ * Uso: proto_bench [iterações]   (padrão 1000000)
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "aguada_proto.h"
+
+static volatile uint32_t sink; // Impede o compilador de eliminar os laços
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void report(const char *name, double elapsed_ns, long iterations, size_t bytes_per_op)
+{
+    double ns_op = elapsed_ns / (double)iterations;
+    printf("  %-28s %8.1f ns/op", name, ns_op);
+    if (bytes_per_op > 0)
+    {
+        printf("  %8.1f MB/s", (double)bytes_per_op * 1e3 / ns_op);
+    }
+    printf("\n");
+}
+
+#define CHECK(cond)                                                     \
+    do                                                                  \
+    {                                                                   \
+        if (!(cond))                                                    \
+        {                                                               \
+            fprintf(stderr, "FALHA %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                    \
+        }                                                               \
+    } while (0)
+
+// ============================================================================
+// REFERÊNCIAS (implementações antigas dos firmwares)
+// ============================================================================
+
+static uint16_t crc16_bitwise(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int j = 0; j < 8; j++)
+        {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static int json_encode_snprintf(const aguada_reading_t *r, char *out, size_t size)
+{
+    return snprintf(out, size,
+                    "{\"mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"distance_mm\":%ld,"
+                    "\"vcc_bat_mv\":%ld,\"rssi\":%ld,\"rle\":%d}",
+                    r->mac[0], r->mac[1], r->mac[2], r->mac[3], r->mac[4], r->mac[5],
+                    (long)r->distance_mm, (long)r->vcc_bat_mv, (long)r->rssi, r->rle);
+}
+
+// ============================================================================
+// CONFERÊNCIA
+// ============================================================================
+
+static void self_check(void)
+{
+    // Vetor padrão do CRC-16/CCITT-FALSE
+    CHECK(aguada_crc16("123456789", 9) == 0x29B1);
+
+    aguada_reading_t in = {
+        .mac = {0x20, 0x6E, 0xF1, 0x6B, 0x77, 0x58},
+        .distance_mm = 2450,
+        .vcc_bat_mv = 4900,
+        .rssi = -52,
+        .rle = 15,
+        .has_agg = true,
+        .min_mm = -2147483647 - 1,
+        .max_mm = 2500,
+        .avg_mm = 2450,
+    };
+    aguada_reading_t out;
+    char json[AGUADA_JSON_MAX];
+
+    int len = aguada_json_encode(&in, json, sizeof(json));
+    CHECK(len > 0 && (size_t)len == strlen(json));
+    CHECK(aguada_json_encode(&in, json, 16) == AGUADA_PROTO_ERR_SIZE);
+    len = aguada_json_encode(&in, json, sizeof(json));
+    CHECK(aguada_json_decode(json, len, &out) == AGUADA_PROTO_OK);
+    CHECK(memcmp(out.mac, in.mac, 6) == 0 && out.distance_mm == in.distance_mm &&
+          out.vcc_bat_mv == in.vcc_bat_mv && out.rssi == in.rssi && out.rle == in.rle &&
+          out.has_agg && out.min_mm == in.min_mm && out.avg_mm == in.avg_mm);
+
+    const char *extra = " { \"mac\" : \"dc:06:75:67:6a:cc\", \"type\":\"x\", \"ok\":true,"
+                        " \"distance_mm\": 12.7, \"vcc_bat_mv\":5000 } ";
+    CHECK(aguada_json_decode(extra, strlen(extra), &out) == AGUADA_PROTO_OK);
+    CHECK(out.mac[0] == 0xDC && out.distance_mm == 12 && !out.has_agg && out.rle == 0);
+    CHECK(aguada_json_decode("{\"mac\":\"AA\"}", 12, &out) == AGUADA_PROTO_ERR_FORMAT);
+    CHECK(aguada_json_decode("{\"distance_mm\":[1]}", 19, &out) == AGUADA_PROTO_ERR_FORMAT);
+
+    uint8_t frame[AGUADA_BIN_SIZE];
+    char hex[AGUADA_BIN_HEX_LEN];
+    in.flags = AGUADA_FLAG_HEARTBEAT;
+    aguada_bin_encode(&in, frame);
+    CHECK(aguada_hex_encode(frame, sizeof(frame), hex, sizeof(hex)) == 32);
+    CHECK(strncmp(hex, "01ad206ef16b7758", 16) == 0);
+    CHECK(crc16_bitwise(frame, 14) == (uint16_t)(frame[14] | frame[15] << 8));
+    CHECK(aguada_bin_detect(frame, sizeof(frame)));
+    CHECK(aguada_bin_decode(frame, sizeof(frame), &out) == AGUADA_PROTO_OK);
+    CHECK(out.distance_mm == 2450 && out.rssi == -52 && out.flags == AGUADA_FLAG_HEARTBEAT);
+    frame[9] ^= 0x01;
+    CHECK(aguada_bin_decode(frame, sizeof(frame), &out) == AGUADA_PROTO_ERR_CRC);
+    frame[0] = AGUADA_BIN_VERSION + 1;
+    CHECK(aguada_bin_decode(frame, sizeof(frame), &out) == AGUADA_PROTO_ERR_VERSION);
+
+    in.distance_mm = 100000;
+    aguada_bin_encode(&in, frame);
+    CHECK(aguada_bin_decode(frame, sizeof(frame), &out) == AGUADA_PROTO_OK && out.distance_mm == 32767);
+
+    char mac_str[AGUADA_MAC_STR_LEN];
+    aguada_mac_to_string(in.mac, mac_str);
+    CHECK(strcmp(mac_str, "20:6E:F1:6B:77:58") == 0);
+
+    in.distance_mm = 2450;
+    in.age_ms = 12300;
+    len = aguada_json_encode(&in, json, sizeof(json));
+    CHECK(aguada_json_decode(json, len, &out) == AGUADA_PROTO_OK && out.age_ms == 12300);
+    in.age_ms = 0;
+
+    // Predição dupla: inclinação negativa e zero (presente) passam pelo JSON
+    in.has_slope = true;
+    in.slope_mm_h = -2700;
+    len = aguada_json_encode(&in, json, sizeof(json));
+    CHECK(strstr(json, ",\"slope_mm_h\":-2700}") != NULL);
+    CHECK(aguada_json_decode(json, len, &out) == AGUADA_PROTO_OK && out.has_slope && out.slope_mm_h == -2700);
+    in.slope_mm_h = 0;
+    len = aguada_json_encode(&in, json, sizeof(json));
+    CHECK(aguada_json_decode(json, len, &out) == AGUADA_PROTO_OK && out.has_slope && out.slope_mm_h == 0);
+    in.has_slope = false;
+
+    // Lote: tempos relativos ao início, deltas negativos, saturação e erro (-1)
+    static const int32_t mm[] = {2450, 2448, 2455, 2455, 100000, -1, 0};
+    static const uint32_t at_ms[] = {1000, 3000, 5050, 7000, 9000, 11000, 11099};
+    const size_t n = sizeof(mm) / sizeof(mm[0]);
+    aguada_batch_t batch;
+    aguada_batch_item_t items[AGUADA_BATCH_MAX_READINGS];
+    size_t count;
+
+    aguada_batch_init(&batch);
+    CHECK(aguada_batch_finish(&batch, &in, 0) == 0);
+    for (size_t i = 0; i < n; i++)
+    {
+        CHECK(aguada_batch_add(&batch, mm[i], (i == 5) ? AGUADA_FLAG_ERROR : 0, at_ms[i]));
+    }
+    in.vcc_bat_mv = 4900;
+    in.rssi = -60;
+    in.flags = 0;
+    size_t frame_len = aguada_batch_finish(&batch, &in, 13000);
+    CHECK(aguada_batch_detect(batch.buf, frame_len) && !aguada_bin_detect(batch.buf, frame_len));
+    CHECK(aguada_batch_decode(batch.buf, frame_len, &out, items, AGUADA_BATCH_MAX_READINGS, &count) ==
+          AGUADA_PROTO_OK);
+    CHECK(count == n && memcmp(out.mac, in.mac, 6) == 0 && out.vcc_bat_mv == 4900 && out.rssi == -60);
+    CHECK(out.flags == AGUADA_FLAG_ERROR);
+    CHECK(items[0].distance_mm == 2450 && items[0].age_ms == 12000);
+    CHECK(items[2].distance_mm == 2455 && items[2].age_ms == 8000);
+    CHECK(items[4].distance_mm == 32767 && items[5].distance_mm == -1);
+    CHECK(items[6].distance_mm == 0 && items[6].age_ms == 2000);
+    CHECK(aguada_batch_decode(batch.buf, frame_len, &out, items, 3, &count) == AGUADA_PROTO_ERR_SIZE);
+    batch.buf[AGUADA_BATCH_HEADER_SIZE] ^= 0x01;
+    CHECK(aguada_batch_decode(batch.buf, frame_len, &out, items, AGUADA_BATCH_MAX_READINGS, &count) ==
+          AGUADA_PROTO_ERR_CRC);
+
+    // Sem RSSI no node (o gateway preenche) e com a entrega medida por ACK
+    aguada_reading_t node = {.mac = {0x20, 0x6E, 0xF1, 0x6B, 0x77, 0x58}, .distance_mm = 1200,
+                             .vcc_bat_mv = 5000, .delivery_pct = 97};
+    len = aguada_json_encode(&node, json, sizeof(json));
+    CHECK(strstr(json, "rssi") == NULL && strstr(json, "\"delivery_pct\":97") != NULL);
+    CHECK(aguada_json_decode(json, len, &out) == AGUADA_PROTO_OK && out.delivery_pct == 97 && out.rssi == 0);
+
+    // Mensagem de enlace: sonda/beacon
+    aguada_link_msg_t link = {.type = AGUADA_LINK_BEACON, .mac = {0x20, 0x6E, 0xF1, 0x6B, 0x77, 0x58},
+                              .rssi = -71, .loss_pct = 3};
+    aguada_link_msg_t link_out;
+    uint8_t link_buf[AGUADA_LINK_SIZE];
+    aguada_link_encode(&link, link_buf);
+    CHECK(link_buf[0] == AGUADA_LINK_VERSION && link_buf[1] == AGUADA_LINK_MAGIC_HI);
+    CHECK(aguada_link_detect(link_buf, sizeof(link_buf)) && !aguada_bin_detect(link_buf, sizeof(link_buf)) &&
+          !aguada_batch_detect(link_buf, sizeof(link_buf)));
+    CHECK(aguada_link_decode(link_buf, sizeof(link_buf), &link_out) == AGUADA_PROTO_OK);
+    CHECK(link_out.type == AGUADA_LINK_BEACON && link_out.rssi == -71 && link_out.loss_pct == 3 &&
+          memcmp(link_out.mac, link.mac, 6) == 0);
+    link_buf[9] ^= 0x80;
+    CHECK(aguada_link_decode(link_buf, sizeof(link_buf), &link_out) == AGUADA_PROTO_ERR_CRC);
+
+    // Frame multicanal: campos do node uma vez, MAC/distância/rle por canal
+    aguada_reading_t chans[3] = {
+        {.mac = {0x20, 0x6E, 0xF1, 0x6B, 0x77, 0x58}, .distance_mm = 1850, .rle = 4, .flags = AGUADA_FLAG_DELTA},
+        {.mac = {0xAA, 0xBB, 0xCC, 0xDD, 0x1E, 0x02}, .distance_mm = -1, .flags = AGUADA_FLAG_ERROR},
+        {.mac = {0xAA, 0xBB, 0xCC, 0xDD, 0x1E, 0x03}, .distance_mm = 40000, .rle = 255},
+    };
+    aguada_reading_t chans_out[AGUADA_MULTI_MAX_CHANNELS];
+    uint8_t multi_buf[AGUADA_ESPNOW_MAX_LEN];
+    char multi_json[AGUADA_MULTI_JSON_MAX(3)];
+    node.flags = AGUADA_FLAG_LOW_BATTERY;
+    frame_len = aguada_multi_encode(&node, chans, 3, multi_buf, sizeof(multi_buf));
+    CHECK(frame_len == AGUADA_MULTI_SIZE(3) && multi_buf[1] == AGUADA_MULTI_MAGIC_HI);
+    CHECK(aguada_multi_detect(multi_buf, frame_len) && !aguada_bin_detect(multi_buf, frame_len) &&
+          !aguada_batch_detect(multi_buf, frame_len) && !aguada_link_detect(multi_buf, frame_len));
+    CHECK(aguada_multi_decode(multi_buf, frame_len, &out, chans_out, AGUADA_MULTI_MAX_CHANNELS, &count) ==
+          AGUADA_PROTO_OK && count == 3 && memcmp(out.mac, node.mac, 6) == 0 && out.delivery_pct == 97);
+    CHECK(memcmp(chans_out[1].mac, chans[1].mac, 6) == 0 && chans_out[1].distance_mm == -1 &&
+          chans_out[1].vcc_bat_mv == 5000 && chans_out[1].delivery_pct == 97 &&
+          chans_out[1].flags == (AGUADA_FLAG_LOW_BATTERY | AGUADA_FLAG_ERROR));
+    CHECK(chans_out[0].rle == 4 && chans_out[2].distance_mm == 32767);
+    CHECK(aguada_multi_decode(multi_buf, frame_len, &out, chans_out, 2, &count) == AGUADA_PROTO_ERR_SIZE);
+    CHECK(aguada_multi_decode(multi_buf, frame_len - AGUADA_MULTI_RECORD_SIZE, &out, chans_out, 3, &count) !=
+          AGUADA_PROTO_OK);
+    multi_buf[AGUADA_MULTI_HEADER_SIZE + 6] ^= 0x01;
+    CHECK(aguada_multi_decode(multi_buf, frame_len, &out, chans_out, 3, &count) == AGUADA_PROTO_ERR_CRC);
+    CHECK(aguada_multi_encode(&node, chans, 0, multi_buf, sizeof(multi_buf)) == 0 &&
+          aguada_multi_encode(&node, chans, 3, multi_buf, AGUADA_MULTI_SIZE(3) - 1) == 0);
+
+    len = aguada_multi_json_encode(&node, chans, 2, multi_json, sizeof(multi_json));
+    CHECK(len > 0 && strcmp(multi_json,
+                            "{\"mac\":\"20:6E:F1:6B:77:58\",\"vcc_bat_mv\":5000,\"delivery_pct\":97,\"channels\":["
+                            "{\"mac\":\"20:6E:F1:6B:77:58\",\"distance_mm\":1850,\"rle\":4},"
+                            "{\"mac\":\"AA:BB:CC:DD:1E:02\",\"distance_mm\":-1}]}") == 0);
+    CHECK(aguada_multi_json_encode(&node, chans, 3, multi_json, AGUADA_MULTI_JSON_MAX(2)) == AGUADA_PROTO_ERR_SIZE);
+
+    // Sequência do frame: v2 nos três formatos binários e "seq" no JSON
+    node.has_seq = true;
+    node.seq = 255;
+    aguada_bin_encode(&node, frame);
+    CHECK(frame[0] == AGUADA_BIN_VERSION && frame[12] == 255);
+    CHECK(aguada_bin_decode(frame, sizeof(frame), &out) == AGUADA_PROTO_OK && out.has_seq && out.seq == 255 &&
+          out.rssi == 0);
+    frame_len = aguada_multi_encode(&node, chans, 3, multi_buf, sizeof(multi_buf));
+    CHECK(multi_buf[0] == AGUADA_MULTI_VERSION);
+    CHECK(aguada_multi_decode(multi_buf, frame_len, &out, chans_out, 3, &count) == AGUADA_PROTO_OK &&
+          out.has_seq && out.seq == 255 && chans_out[2].has_seq && chans_out[2].seq == 255);
+    len = aguada_multi_json_encode(&node, chans, 1, multi_json, sizeof(multi_json));
+    CHECK(strstr(multi_json, ",\"seq\":255,\"channels\":[") != NULL);
+    aguada_batch_init(&batch);
+    CHECK(aguada_batch_add(&batch, 1200, 0, 0));
+    frame_len = aguada_batch_finish(&batch, &node, 100);
+    CHECK(batch.buf[0] == AGUADA_BATCH_VERSION);
+    CHECK(aguada_batch_decode(batch.buf, frame_len, &out, items, AGUADA_BATCH_MAX_READINGS, &count) ==
+          AGUADA_PROTO_OK && out.has_seq && out.seq == 255);
+    len = aguada_json_encode(&node, json, sizeof(json));
+    CHECK(strstr(json, ",\"seq\":255}") != NULL);
+    CHECK(aguada_json_decode(json, len, &out) == AGUADA_PROTO_OK && out.has_seq && out.seq == 255);
+    CHECK(aguada_json_decode("{\"mac\":\"20:6E:F1:6B:77:58\",\"distance_mm\":1,\"seq\":256}", 53, &out) ==
+          AGUADA_PROTO_ERR_FORMAT);
+    node.has_seq = false;
+    aguada_bin_encode(&node, frame);
+    CHECK(frame[0] == AGUADA_BIN_VERSION_RSSI);
+    CHECK(aguada_bin_decode(frame, sizeof(frame), &out) == AGUADA_PROTO_OK && !out.has_seq);
+
+    // Classificação de alarme: flags, códigos de erro e JSON sem '\0'
+    node.flags = 0;
+    node.distance_mm = 1200;
+    aguada_bin_encode(&node, frame);
+    CHECK(!aguada_frame_is_alarm(frame, sizeof(frame)));
+    node.flags = AGUADA_FLAG_LOW_BATTERY;
+    aguada_bin_encode(&node, frame);
+    CHECK(aguada_frame_is_alarm(frame, sizeof(frame)));
+    node.flags = AGUADA_FLAG_HEARTBEAT;
+    node.distance_mm = 0;
+    aguada_bin_encode(&node, frame);
+    CHECK(aguada_frame_is_alarm(frame, sizeof(frame)));
+    node.distance_mm = 1200;
+    node.flags = 0;
+    frame_len = aguada_multi_encode(&node, chans, 1, multi_buf, sizeof(multi_buf));
+    CHECK(!aguada_frame_is_alarm(multi_buf, frame_len));
+    frame_len = aguada_multi_encode(&node, chans, 2, multi_buf, sizeof(multi_buf));
+    CHECK(aguada_frame_is_alarm(multi_buf, frame_len)); // Canal 2 com erro
+    CHECK(!aguada_frame_is_alarm(batch.buf, aguada_batch_finish(&batch, &node, 200)));
+    static const char calm[] = "{\"mac\":\"20:6E:F1:6B:77:58\",\"distance_mm\":10,\"seq\":1}";
+    static const char fault[] = "{\"mac\":\"20:6E:F1:6B:77:58\",\"distance_mm\": 1}";
+    static const char channel[] = "{\"channels\":[{\"distance_mm\":1850},{\"distance_mm\":-1}]}";
+    CHECK(!aguada_frame_is_alarm((const uint8_t *)calm, sizeof(calm) - 1));
+    CHECK(aguada_frame_is_alarm((const uint8_t *)fault, sizeof(fault) - 1));
+    CHECK(aguada_frame_is_alarm((const uint8_t *)channel, sizeof(channel) - 1));
+    CHECK(!aguada_frame_is_alarm((const uint8_t *)fault, sizeof(fault) - 4)); // Cortado antes do valor
+
+    // Enche até o limite do ESP-NOW com deltas de pior caso
+    aguada_batch_init(&batch);
+    size_t added = 0;
+    while (!aguada_batch_full(&batch))
+    {
+        CHECK(aguada_batch_add(&batch, (added & 1) ? 32767 : -32768, 0, (uint32_t)added * 6553600u));
+        added++;
+    }
+    in.flags = AGUADA_FLAG_HEARTBEAT;
+    frame_len = aguada_batch_finish(&batch, &in, (uint32_t)added * 6553600u);
+    CHECK(frame_len <= AGUADA_ESPNOW_MAX_LEN && added >= 30);
+    CHECK(aguada_batch_decode(batch.buf, frame_len, &out, items, AGUADA_BATCH_MAX_READINGS, &count) ==
+          AGUADA_PROTO_OK && count == added && out.flags == AGUADA_FLAG_HEARTBEAT && items[count - 1].distance_mm == ((added - 1) & 1 ? 32767 : -32768));
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main(int argc, char **argv)
+{
+    long iterations = (argc > 1) ? atol(argv[1]) : 1000000;
+    if (iterations <= 0)
+    {
+        iterations = 1000000;
+    }
+
+    self_check();
+    printf("aguada_proto bench (%ld iterações)\n", iterations);
+
+    aguada_reading_t reading = {
+        .mac = {0x20, 0x6E, 0xF1, 0x6B, 0x77, 0x58},
+        .distance_mm = 2450,
+        .vcc_bat_mv = 4900,
+        .rssi = -52,
+        .rle = 15,
+    };
+    char json[AGUADA_JSON_MAX];
+    uint8_t frame[AGUADA_BIN_SIZE];
+    aguada_reading_t decoded;
+    double t0;
+
+    // CRC sobre um registro de 256 bytes (tamanho do payload do flash log)
+    uint8_t block[256];
+    for (size_t i = 0; i < sizeof(block); i++)
+    {
+        block[i] = (uint8_t)(i * 31 + 7);
+    }
+    CHECK(aguada_crc16(block, sizeof(block)) == crc16_bitwise(block, sizeof(block)));
+
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        block[0] = (uint8_t)i;
+        sink += aguada_crc16(block, sizeof(block));
+    }
+    report("crc16 tabela (256 B)", now_ns() - t0, iterations, sizeof(block));
+
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        block[0] = (uint8_t)i;
+        sink += crc16_bitwise(block, sizeof(block));
+    }
+    report("crc16 bit a bit (256 B)", now_ns() - t0, iterations, sizeof(block));
+
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        reading.distance_mm = (int32_t)(i & 0xFFF);
+        sink += (uint32_t)aguada_json_encode(&reading, json, sizeof(json));
+    }
+    report("json encode", now_ns() - t0, iterations, 0);
+
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        reading.distance_mm = (int32_t)(i & 0xFFF);
+        sink += (uint32_t)json_encode_snprintf(&reading, json, sizeof(json));
+    }
+    report("json encode (snprintf)", now_ns() - t0, iterations, 0);
+
+    int json_len = aguada_json_encode(&reading, json, sizeof(json));
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        sink += (uint32_t)aguada_json_decode(json, json_len, &decoded) + (uint32_t)decoded.distance_mm;
+    }
+    report("json decode", now_ns() - t0, iterations, (size_t)json_len);
+
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        reading.distance_mm = (int32_t)(i & 0xFFF);
+        aguada_bin_encode(&reading, frame);
+        sink += frame[15];
+    }
+    report("bin encode", now_ns() - t0, iterations, 0);
+
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        sink += (uint32_t)aguada_bin_decode(frame, sizeof(frame), &decoded) + (uint32_t)decoded.distance_mm;
+    }
+    report("bin decode (+crc)", now_ns() - t0, iterations, AGUADA_BIN_SIZE);
+
+    // Lote típico: leitura a cada 2 s variando alguns mm
+    aguada_batch_t batch;
+    aguada_batch_item_t items[AGUADA_BATCH_MAX_READINGS];
+    size_t batch_len = 0, batch_count = 0;
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        aguada_batch_init(&batch);
+        for (uint32_t k = 0; k < 32; k++)
+        {
+            aguada_batch_add(&batch, 2450 + (int32_t)((k * 7 + (uint32_t)i) & 7), 0, k * 2000);
+        }
+        batch_len = aguada_batch_finish(&batch, &reading, 64000);
+        sink += batch.buf[batch_len - 1];
+    }
+    report("batch encode (32 leituras)", now_ns() - t0, iterations, 0);
+
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        sink += (uint32_t)aguada_batch_decode(batch.buf, batch_len, &decoded, items,
+                                              AGUADA_BATCH_MAX_READINGS, &batch_count);
+        sink += (uint32_t)items[batch_count - 1].distance_mm;
+    }
+    report("batch decode (32 leituras)", now_ns() - t0, iterations, batch_len);
+
+    // Node de 8 canais: um frame multicanal por ciclo
+    aguada_reading_t chans[8];
+    uint8_t multi_buf[AGUADA_ESPNOW_MAX_LEN];
+    size_t multi_len = 0, multi_count = 0;
+    for (int c = 0; c < 8; c++)
+    {
+        chans[c] = reading;
+        chans[c].mac[5] = (uint8_t)c;
+    }
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        chans[i & 7].distance_mm = 2450 + (int32_t)(i & 15);
+        multi_len = aguada_multi_encode(&reading, chans, 8, multi_buf, sizeof(multi_buf));
+        sink += multi_buf[multi_len - 1];
+    }
+    report("multi encode (8 canais)", now_ns() - t0, iterations, 0);
+
+    aguada_reading_t chans_out[AGUADA_MULTI_MAX_CHANNELS];
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        sink += (uint32_t)aguada_multi_decode(multi_buf, multi_len, &decoded, chans_out,
+                                              AGUADA_MULTI_MAX_CHANNELS, &multi_count);
+        sink += (uint32_t)chans_out[multi_count - 1].distance_mm;
+    }
+    report("multi decode (8 canais)", now_ns() - t0, iterations, multi_len);
+
+    printf("  json %d bytes, binário %d bytes, lote de 32 leituras %zu bytes (%.1f B/leitura)\n",
+           json_len, AGUADA_BIN_SIZE, batch_len, (double)batch_len / 32.0);
+    printf("  multicanal de 8 canais %zu bytes num frame (%.1f B/canal) vs 8 frames JSON de %d bytes\n",
+           multi_len, (double)multi_len / 8.0, json_len);
+    return 0;
+}
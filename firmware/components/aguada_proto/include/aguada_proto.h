@@ -0,0 +1,459 @@
+/**
+ * AGUADA - Protocolo AGUADA-1 (codecs compartilhados)
+ *
+ * Fonte única do formato de telemetria para os nodes e gateways:
+ * - Leitura (aguada_reading_t) ↔ JSON: {"mac":"..","distance_mm":N,
+ *   "vcc_bat_mv":N,"rssi":N[,"rle":N][,"min_mm":N,"max_mm":N,"avg_mm":N]
+ *   [,"age_ms":N][,"delivery_pct":N][,"slope_mm_h":N][,"seq":N]} - "rssi"
+ *   omitido = o gateway preenche
+ * - Leitura ↔ frame binário de 16 bytes (magic 0xAD + versão, CRC16)
+ * - Lote de leituras ↔ frame binário de até 250 bytes (magic 0xAB, tempos
+ *   relativos ao início do lote, distâncias em delta zigzag-varint, CRC16)
+ * - Frame multicanal: campos comuns do node uma vez + uma leitura por canal
+ *   (magic 0xAC, CRC16) e a forma JSON com "channels" para o backend
+ * - Mensagens de enlace node ↔ gateway (sonda/beacon/relatório, 13 bytes, CRC16)
+ * - CRC16-CCITT por tabela, MAC ↔ string, hex
+ *
+ * Sem dependências do ESP-IDF: compila também no host (ver bench/), para
+ * medir a vazão dos codecs fora do alvo. Todas as funções são reentrantes.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// VERSÕES E TAMANHOS
+// ============================================================================
+
+#define AGUADA_PROTO_NAME "AGUADA-1"
+
+// Frame binário: byte 0 = versão, byte 1 = 0xAD (magic 0xAD02 em little-endian).
+// v2 troca o RSSI estimado pelo node (o gateway mede o real) pela sequência
+// do frame; os decoders ainda aceitam v1. O mesmo vale para lote e multicanal.
+#define AGUADA_BIN_MAGIC_HI 0xAD
+#define AGUADA_BIN_VERSION 2
+#define AGUADA_BIN_VERSION_RSSI 1 // v1: byte de sequência era o RSSI do node
+#define AGUADA_BIN_MAGIC ((AGUADA_BIN_MAGIC_HI << 8) | AGUADA_BIN_VERSION)
+#define AGUADA_BIN_SIZE 16
+
+// Frame em lote: byte 0 = versão, byte 1 = 0xAB; cabeçalho fixo + registros
+// varint + CRC16. Cabe num único pacote ESP-NOW.
+#define AGUADA_BATCH_MAGIC_HI 0xAB
+#define AGUADA_BATCH_VERSION 2
+#define AGUADA_BATCH_VERSION_RSSI 1
+#define AGUADA_BATCH_MAGIC ((AGUADA_BATCH_MAGIC_HI << 8) | AGUADA_BATCH_VERSION)
+#define AGUADA_BATCH_HEADER_SIZE 15
+#define AGUADA_BATCH_RECORD_MAX 6  // dt (varint u16) + delta (zigzag varint de 17 bits)
+#define AGUADA_BATCH_RECORD_MIN 2
+#define AGUADA_BATCH_TICK_MS 100   // Resolução dos tempos do lote (décimos de segundo)
+
+// Frame multicanal: byte 0 = versão, byte 1 = 0xAC; cabeçalho do node +
+// COUNT registros de canal + CRC16
+#define AGUADA_MULTI_MAGIC_HI 0xAC
+#define AGUADA_MULTI_VERSION 2
+#define AGUADA_MULTI_VERSION_RSSI 1
+#define AGUADA_MULTI_MAGIC ((AGUADA_MULTI_MAGIC_HI << 8) | AGUADA_MULTI_VERSION)
+#define AGUADA_MULTI_HEADER_SIZE 14
+#define AGUADA_MULTI_RECORD_SIZE 11
+
+// Mensagem de enlace: byte 0 = versão, byte 1 = 0xA1
+#define AGUADA_LINK_MAGIC_HI 0xA1
+#define AGUADA_LINK_VERSION 1
+#define AGUADA_LINK_MAGIC ((AGUADA_LINK_MAGIC_HI << 8) | AGUADA_LINK_VERSION)
+#define AGUADA_LINK_SIZE 13
+
+#define AGUADA_MAC_STR_LEN 18      // "XX:XX:XX:XX:XX:XX" + '\0'
+#define AGUADA_JSON_MAX 250        // Pior caso do encoder JSON + '\0'
+#define AGUADA_BIN_HEX_LEN (AGUADA_BIN_SIZE * 2 + 1)
+#define AGUADA_ESPNOW_MAX_LEN 250  // ESP_NOW_MAX_DATA_LEN
+#define AGUADA_BATCH_MAX_READINGS ((AGUADA_ESPNOW_MAX_LEN - AGUADA_BATCH_HEADER_SIZE - 2) / AGUADA_BATCH_RECORD_MIN)
+#define AGUADA_MULTI_MAX_CHANNELS ((AGUADA_ESPNOW_MAX_LEN - AGUADA_MULTI_HEADER_SIZE - 2) / AGUADA_MULTI_RECORD_SIZE)
+#define AGUADA_MULTI_SIZE(count) (AGUADA_MULTI_HEADER_SIZE + (count) * AGUADA_MULTI_RECORD_SIZE + 2)
+#define AGUADA_MULTI_JSON_HEAD_MAX 114    // {"mac":..,"vcc_bat_mv":..,"rssi":..,"delivery_pct":..,"seq":..,"channels":[
+#define AGUADA_MULTI_JSON_CHANNEL_MAX 68  // {"mac":..,"distance_mm":..,"rle":..},
+#define AGUADA_MULTI_JSON_MAX(count) (AGUADA_MULTI_JSON_HEAD_MAX + (count) * AGUADA_MULTI_JSON_CHANNEL_MAX + 3)
+
+// Flags do frame binário
+#define AGUADA_FLAG_HEARTBEAT 0x01   // Envio por heartbeat
+#define AGUADA_FLAG_DELTA 0x02       // Envio por delta
+#define AGUADA_FLAG_ERROR 0x04       // Erro de leitura
+#define AGUADA_FLAG_AGGREGATED 0x08  // Contém dados agregados
+#define AGUADA_FLAG_LOW_BATTERY 0x10 // VCC abaixo do limite
+
+typedef enum
+{
+    AGUADA_PROTO_OK = 0,
+    AGUADA_PROTO_ERR_SIZE = -1,    // Buffer/frame com tamanho errado
+    AGUADA_PROTO_ERR_MAGIC = -2,   // Não é um frame AGUADA
+    AGUADA_PROTO_ERR_VERSION = -3, // Versão de frame não suportada
+    AGUADA_PROTO_ERR_CRC = -4,     // CRC não confere
+    AGUADA_PROTO_ERR_FORMAT = -5,  // JSON malformado ou sem campo obrigatório
+} aguada_proto_err_t;
+
+// ============================================================================
+// TIPOS
+// ============================================================================
+
+/**
+ * Leitura de um sensor (forma comum dos dois codecs)
+ */
+typedef struct
+{
+    uint8_t mac[6];
+    int32_t distance_mm; // Negativo = erro de leitura
+    int32_t vcc_bat_mv;
+    int32_t rssi;        // dBm medido no gateway (0 = ausente no JSON)
+    uint8_t flags;       // AGUADA_FLAG_* (só no binário)
+    uint16_t rle;        // Leituras estáveis consecutivas (0 = ausente)
+    int32_t age_ms;      // Idade na recepção (leitura de lote; 0 = atual/ausente)
+    uint8_t delivery_pct; // Entrega confirmada por ACK no node, 1-100 (0 = ausente)
+    bool has_slope;      // slope_mm_h presente (node em predição dupla)
+    int32_t slope_mm_h;  // Inclinação da reta compartilhada (aguada_predict)
+    bool has_seq;        // seq presente (frames v2 / JSON "seq")
+    uint8_t seq;         // Sequência do frame no node (igual nos reenvios)
+    bool has_agg;        // min/max/avg presentes
+    int32_t min_mm;
+    int32_t max_mm;
+    int32_t avg_mm;
+} aguada_reading_t;
+
+/**
+ * Frame binário v2 (little-endian, empacotado)
+ * [VER:1][0xAD:1][MAC:6][DIST:2][VCC:2][SEQ:1][FLAGS:1][CRC:2]
+ * (v1: RSSI do node no lugar de SEQ)
+ */
+typedef struct __attribute__((packed))
+{
+    uint16_t magic;      // AGUADA_BIN_MAGIC
+    uint8_t mac[6];
+    int16_t distance_mm; // ±32767 mm
+    uint16_t vcc_mv;
+    union
+    {
+        uint8_t seq;     // v2
+        int8_t rssi;     // v1
+    };
+    uint8_t flags;
+    uint16_t crc16;      // CRC16-CCITT dos 14 bytes anteriores
+} aguada_bin_frame_t;
+
+_Static_assert(sizeof(aguada_bin_frame_t) == AGUADA_BIN_SIZE, "frame binário deve ter 16 bytes");
+
+/**
+ * Cabeçalho do frame em lote (little-endian, empacotado)
+ * [VER:1][0xAB:1][MAC:6][VCC:2][SEQ:1][FLAGS:1][COUNT:1][SPAN:2] (v1: RSSI)
+ * seguido de COUNT registros [DT:varint][DELTA:zigzag varint] e [CRC:2].
+ * DT = décimos de segundo desde a leitura anterior (a 1ª conta do início do
+ * lote); DELTA = distância - distância anterior (a 1ª parte de 0);
+ * SPAN = décimos de segundo do início do lote até o fechamento do frame.
+ */
+typedef struct __attribute__((packed))
+{
+    uint16_t magic;      // AGUADA_BATCH_MAGIC
+    uint8_t mac[6];
+    uint16_t vcc_mv;     // Valores do fechamento do lote
+    union
+    {
+        uint8_t seq;     // v2
+        int8_t rssi;     // v1
+    };
+    uint8_t flags;       // OR das flags das leituras e do fechamento
+    uint8_t count;
+    uint16_t span_ticks;
+} aguada_batch_header_t;
+
+/**
+ * Montagem incremental de um frame em lote (estado do node)
+ */
+typedef struct
+{
+    uint8_t buf[AGUADA_ESPNOW_MAX_LEN];
+    size_t len;          // Bytes usados (cabeçalho + registros)
+    uint8_t count;
+    uint8_t flags;
+    int32_t last_mm;
+    uint32_t start_ms;   // Início do lote (relógio do node, ms)
+    uint16_t last_tick;  // Tempo da última leitura, em ticks desde start_ms
+} aguada_batch_t;
+
+/**
+ * Uma leitura desempacotada de um frame em lote
+ */
+typedef struct
+{
+    int32_t distance_mm;
+    int32_t age_ms;      // Antes do fechamento do frame
+} aguada_batch_item_t;
+
+_Static_assert(sizeof(aguada_batch_header_t) == AGUADA_BATCH_HEADER_SIZE, "cabeçalho do lote deve ter 15 bytes");
+
+/**
+ * Cabeçalho do frame multicanal (little-endian, empacotado)
+ * [VER:1][0xAC:1][MAC:6][VCC:2][SEQ:1][DELIVERY:1][FLAGS:1][COUNT:1] (v1: RSSI)
+ * seguido de COUNT registros aguada_multi_record_t e [CRC:2].
+ * MAC = rádio do node; VCC, SEQ, entrega e flags valem para todos os canais.
+ */
+typedef struct __attribute__((packed))
+{
+    uint16_t magic;       // AGUADA_MULTI_MAGIC
+    uint8_t mac[6];
+    uint16_t vcc_mv;
+    union
+    {
+        uint8_t seq;      // v2
+        int8_t rssi;      // v1
+    };
+    uint8_t delivery_pct;
+    uint8_t flags;        // Flags do node (ex.: LOW_BATTERY)
+    uint8_t count;
+} aguada_multi_header_t;
+
+/**
+ * Registro de um canal no frame multicanal
+ * [MAC:6][DIST:2][RLE:2][FLAGS:1] - MAC = identidade do sensor no backend
+ */
+typedef struct __attribute__((packed))
+{
+    uint8_t mac[6];
+    int16_t distance_mm;
+    uint16_t rle;
+    uint8_t flags;        // Motivo do envio (HEARTBEAT/DELTA) e ERROR do canal
+} aguada_multi_record_t;
+
+_Static_assert(sizeof(aguada_multi_header_t) == AGUADA_MULTI_HEADER_SIZE, "cabeçalho multicanal deve ter 14 bytes");
+_Static_assert(sizeof(aguada_multi_record_t) == AGUADA_MULTI_RECORD_SIZE, "registro multicanal deve ter 11 bytes");
+
+typedef enum
+{
+    AGUADA_LINK_PROBE = 1,  // Node → broadcast: procura um gateway
+    AGUADA_LINK_BEACON = 2, // Gateway → node: resposta à sonda (origem = MAC do gateway)
+    AGUADA_LINK_REPORT = 3, // Gateway → node: qualidade do enlace vista pelo gateway
+} aguada_link_type_t;
+
+/**
+ * Mensagem de enlace (little-endian, empacotada)
+ * [VER:1][0xA1:1][TYPE:1][MAC:6][RSSI:1][LOSS:1][CRC:2]
+ * MAC = node a que a mensagem se refere (o remetente, na sonda); RSSI e
+ * perda são as vistas pelo gateway (0 na sonda). Beacon e relatório vão em
+ * broadcast, com o MAC do node no corpo.
+ */
+typedef struct __attribute__((packed))
+{
+    uint16_t magic;   // AGUADA_LINK_MAGIC
+    uint8_t type;     // aguada_link_type_t
+    uint8_t mac[6];
+    int8_t rssi;      // dBm
+    uint8_t loss_pct; // 0-100
+    uint16_t crc16;   // CRC16-CCITT dos 11 bytes anteriores
+} aguada_link_msg_t;
+
+_Static_assert(sizeof(aguada_link_msg_t) == AGUADA_LINK_SIZE, "mensagem de enlace deve ter 13 bytes");
+_Static_assert(AGUADA_JSON_MAX <= AGUADA_ESPNOW_MAX_LEN, "JSON não cabe num pacote ESP-NOW");
+
+// ============================================================================
+// CRC / MAC / HEX
+// ============================================================================
+
+/**
+ * CRC16-CCITT (poly 0x1021, sem reflexão), incremental a partir de `crc`
+ */
+uint16_t aguada_crc16_update(uint16_t crc, const void *data, size_t len);
+
+/**
+ * CRC16-CCITT com init 0xFFFF (o usado no frame binário)
+ */
+static inline uint16_t aguada_crc16(const void *data, size_t len)
+{
+    return aguada_crc16_update(0xFFFF, data, len);
+}
+
+/**
+ * Formata o MAC como "XX:XX:XX:XX:XX:XX" (maiúsculas)
+ */
+void aguada_mac_to_string(const uint8_t *mac, char *out);
+
+/**
+ * Converte "XX:XX:XX:XX:XX:XX" (qualquer caixa) para bytes
+ */
+bool aguada_mac_parse(const char *str, uint8_t *mac);
+
+/**
+ * Hex minúsculo de `len` bytes
+ *
+ * @return comprimento escrito (sem '\0') ou AGUADA_PROTO_ERR_SIZE
+ */
+int aguada_hex_encode(const uint8_t *data, size_t len, char *out, size_t size);
+
+// ============================================================================
+// CODEC JSON
+// ============================================================================
+
+/**
+ * Codifica a leitura em JSON AGUADA-1. "rssi" só sai com rssi != 0, "rle" só
+ * com rle > 0, min/max/avg só com has_agg, "age_ms" só com age_ms > 0,
+ * "delivery_pct" só com delivery_pct > 0, "slope_mm_h" só com has_slope e
+ * "seq" só com has_seq.
+ * Um buffer de AGUADA_JSON_MAX sempre basta.
+ *
+ * @return comprimento escrito (sem '\0') ou AGUADA_PROTO_ERR_SIZE
+ */
+int aguada_json_encode(const aguada_reading_t *reading, char *out, size_t size);
+
+/**
+ * Decodifica um objeto JSON plano AGUADA-1 (mac e distance_mm obrigatórios;
+ * chaves desconhecidas são ignoradas)
+ */
+aguada_proto_err_t aguada_json_decode(const char *json, size_t len, aguada_reading_t *out);
+
+// ============================================================================
+// CODEC BINÁRIO
+// ============================================================================
+
+/**
+ * Codifica a leitura no frame (valores saturados aos tipos do frame):
+ * v2 com has_seq, senão v1 com o RSSI
+ */
+void aguada_bin_encode(const aguada_reading_t *reading, uint8_t *out);
+
+/**
+ * Parece um frame AGUADA? (tamanho + magic; não valida versão nem CRC)
+ */
+bool aguada_bin_detect(const uint8_t *data, size_t len);
+
+/**
+ * Valida tamanho, magic, versão (v1 ou v2) e CRC e decodifica o frame
+ */
+aguada_proto_err_t aguada_bin_decode(const uint8_t *data, size_t len, aguada_reading_t *out);
+
+// ============================================================================
+// CODEC EM LOTE
+// ============================================================================
+
+/**
+ * Começa um lote vazio (o relógio do lote parte da primeira leitura)
+ */
+void aguada_batch_init(aguada_batch_t *batch);
+
+/**
+ * Acrescenta uma leitura (distância saturada a ±32767 mm, tempo em ticks de
+ * AGUADA_BATCH_TICK_MS saturado a 16 bits)
+ *
+ * @return false se o registro não cabe mais no frame (lote inalterado)
+ */
+bool aguada_batch_add(aguada_batch_t *batch, int32_t distance_mm, uint8_t flags, uint32_t now_ms);
+
+/**
+ * Cheio = o próximo registro pode não caber (feche antes de acrescentar)
+ */
+static inline bool aguada_batch_full(const aguada_batch_t *batch)
+{
+    return batch->count == UINT8_MAX ||
+           batch->len + AGUADA_BATCH_RECORD_MAX + 2 > AGUADA_ESPNOW_MAX_LEN;
+}
+
+static inline uint32_t aguada_batch_age_ms(const aguada_batch_t *batch, uint32_t now_ms)
+{
+    return batch->count ? now_ms - batch->start_ms : 0;
+}
+
+/**
+ * Fecha o frame: MAC, VCC e seq (v2; sem has_seq, RSSI em v1) vêm de
+ * `status` (flags somadas às das leituras) e o CRC fecha o frame. O buffer continua válido até o próximo
+ * aguada_batch_init.
+ *
+ * @return tamanho do frame em batch->buf (0 se o lote está vazio)
+ */
+size_t aguada_batch_finish(aguada_batch_t *batch, const aguada_reading_t *status, uint32_t now_ms);
+
+/**
+ * Parece um frame em lote? (tamanho mínimo + magic; não valida versão nem CRC)
+ */
+bool aguada_batch_detect(const uint8_t *data, size_t len);
+
+/**
+ * Valida e desempacota um frame em lote. `header` recebe MAC, VCC, seq (ou
+ * RSSI, v1) e flags comuns; `items` (capacidade AGUADA_BATCH_MAX_READINGS basta) recebe
+ * as leituras em ordem cronológica.
+ *
+ * @return AGUADA_PROTO_OK ou erro; *count = leituras escritas
+ */
+aguada_proto_err_t aguada_batch_decode(const uint8_t *data, size_t len, aguada_reading_t *header,
+                                       aguada_batch_item_t *items, size_t max_items, size_t *count);
+
+// ============================================================================
+// CODEC MULTICANAL
+// ============================================================================
+
+/**
+ * Codifica um frame multicanal. `node` dá MAC do rádio, VCC, seq (v2; sem
+ * has_seq, RSSI em v1), entrega e flags comuns; cada `channels[i]` dá MAC, distância, rle e flags do canal
+ * (os demais campos são ignorados).
+ *
+ * @return tamanho do frame (AGUADA_MULTI_SIZE(count)) ou 0 se não cabe
+ */
+size_t aguada_multi_encode(const aguada_reading_t *node, const aguada_reading_t *channels, size_t count,
+                           uint8_t *out, size_t size);
+
+/**
+ * Parece um frame multicanal? (tamanho + magic; não valida versão nem CRC)
+ */
+bool aguada_multi_detect(const uint8_t *data, size_t len);
+
+/**
+ * Valida e desempacota um frame multicanal. `node` recebe os campos comuns;
+ * cada `channels[i]` sai como leitura completa de um sensor (MAC do canal,
+ * com VCC, seq/RSSI e entrega do node) - pronta para o JSON AGUADA-1.
+ *
+ * @return AGUADA_PROTO_OK ou erro; *count = canais escritos
+ */
+aguada_proto_err_t aguada_multi_decode(const uint8_t *data, size_t len, aguada_reading_t *node,
+                                       aguada_reading_t *channels, size_t max_channels, size_t *count);
+
+/**
+ * Forma JSON do frame multicanal (gateway → backend, que expande por canal):
+ * {"mac":"<node>","vcc_bat_mv":N[,"rssi":N][,"delivery_pct":N][,"seq":N],
+ *  "channels":[{"mac":"..","distance_mm":N[,"rle":N]},...]}
+ * Um buffer de AGUADA_MULTI_JSON_MAX(count) sempre basta.
+ *
+ * @return comprimento escrito (sem '\0') ou AGUADA_PROTO_ERR_SIZE
+ */
+int aguada_multi_json_encode(const aguada_reading_t *node, const aguada_reading_t *channels, size_t count,
+                             char *out, size_t size);
+
+// ============================================================================
+// MENSAGENS DE ENLACE
+// ============================================================================
+
+/**
+ * Codifica uma mensagem de enlace (o CRC é calculado aqui)
+ */
+void aguada_link_encode(aguada_link_msg_t *msg, uint8_t *out);
+
+/**
+ * Parece uma mensagem de enlace? (tamanho + magic)
+ */
+bool aguada_link_detect(const uint8_t *data, size_t len);
+
+/**
+ * Valida tamanho, magic, versão e CRC e decodifica a mensagem
+ */
+aguada_proto_err_t aguada_link_decode(const uint8_t *data, size_t len, aguada_link_msg_t *out);
+
+// ============================================================================
+// CLASSIFICAÇÃO
+// ============================================================================
+
+/**
+ * Frame recebido é alarme? (lane prioritária do gateway)
+ * Alarme = AGUADA_FLAG_ERROR ou AGUADA_FLAG_LOW_BATTERY no frame/canal, ou
+ * distance_mm ≤ 1 (códigos de erro do sensor) no binário, multicanal ou JSON.
+ * No lote só as flags (OR das leituras) contam. Só lê o frame: não valida
+ * versão nem CRC (o worker descarta o frame inválido depois), barato o
+ * bastante para o callback de recepção.
+ */
+bool aguada_frame_is_alarm(const uint8_t *data, size_t len);
+
+const char *aguada_proto_err_name(aguada_proto_err_t err);
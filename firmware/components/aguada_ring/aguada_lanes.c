@@ -0,0 +1,144 @@
+/**
+ * AGUADA - Lanes de prioridade sobre rings SPSC
+ *
+ * A escolha só lê as ocupações (head publicado com release em cada ring) e
+ * os contadores `skipped`, que só mudam no release: peeks repetidos sem
+ * release escolhem o mesmo slot, a menos que chegue algo numa lane acima.
+ */
+
+#include "aguada_lanes.h"
+
+#define WAIT_SHIFT 3 // EWMA da espera: peso 1/8
+
+esp_err_t aguada_lanes_init(aguada_lanes_t *lanes, aguada_ring_t *const *rings, uint8_t count, uint8_t burst_max)
+{
+    if (!lanes || !rings || count == 0 || count > AGUADA_LANES_MAX || burst_max == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (uint8_t i = 0; i < AGUADA_LANES_MAX; i++)
+    {
+        lanes->rings[i] = (i < count) ? rings[i] : NULL;
+        lanes->stats[i] = (aguada_lane_stats_t){0};
+    }
+    lanes->count = count;
+    lanes->burst_max = burst_max;
+    lanes->current = -1;
+    lanes->yields = 0;
+    return ESP_OK;
+}
+
+void aguada_lanes_bind_consumer(aguada_lanes_t *lanes)
+{
+    for (uint8_t i = 0; i < lanes->count; i++)
+    {
+        aguada_ring_bind_consumer(lanes->rings[i]);
+    }
+}
+
+/**
+ * Lane a servir agora (-1 se todas vazias): a mais alta que esgotou a
+ * paciência, senão a mais alta com itens
+ */
+static int pick(const aguada_lanes_t *lanes)
+{
+    int first = -1;
+    for (uint8_t i = 0; i < lanes->count; i++)
+    {
+        if (aguada_ring_count(lanes->rings[i]) == 0)
+        {
+            continue;
+        }
+        if (first < 0)
+        {
+            first = i;
+        }
+        else if (lanes->stats[i].skipped >= lanes->burst_max)
+        {
+            return i;
+        }
+    }
+    return first;
+}
+
+void *aguada_lanes_peek(aguada_lanes_t *lanes, TickType_t wait, uint8_t *lane)
+{
+    // Notificações acumuladas de publicações já consumidas podem acordar
+    // a task com as lanes vazias - repetir até o prazo
+    TickType_t start = xTaskGetTickCount();
+    int chosen;
+    while ((chosen = pick(lanes)) < 0)
+    {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (wait == 0 || elapsed >= wait)
+        {
+            lanes->current = -1;
+            return NULL;
+        }
+        ulTaskNotifyTake(pdTRUE, wait == portMAX_DELAY ? portMAX_DELAY : wait - elapsed);
+    }
+
+    lanes->current = (int8_t)chosen;
+    if (lane)
+    {
+        *lane = (uint8_t)chosen;
+    }
+    // Lane com itens: o peek do ring não bloqueia
+    return aguada_ring_peek(lanes->rings[chosen], 0);
+}
+
+void aguada_lanes_release(aguada_lanes_t *lanes)
+{
+    int served = lanes->current;
+    if (served < 0)
+    {
+        return;
+    }
+
+    // Lanes acima ainda com itens: esta entrega furou a prioridade estrita
+    for (int i = 0; i < served; i++)
+    {
+        if (aguada_ring_count(lanes->rings[i]) > 0)
+        {
+            lanes->yields++;
+            break;
+        }
+    }
+    for (int i = served + 1; i < lanes->count; i++)
+    {
+        if (aguada_ring_count(lanes->rings[i]) > 0)
+        {
+            lanes->stats[i].skipped++;
+        }
+    }
+
+    aguada_ring_release(lanes->rings[served]);
+    lanes->stats[served].served++;
+    lanes->stats[served].skipped = 0;
+    lanes->current = -1;
+}
+
+void aguada_lanes_record_wait(aguada_lanes_t *lanes, uint8_t lane, int64_t wait_us)
+{
+    if (lane >= lanes->count)
+    {
+        return;
+    }
+
+    aguada_lane_stats_t *stats = &lanes->stats[lane];
+    uint32_t wait = (wait_us < 0) ? 0 : (wait_us > UINT32_MAX) ? UINT32_MAX : (uint32_t)wait_us;
+    if (wait > stats->wait_max_us)
+    {
+        stats->wait_max_us = wait;
+    }
+    if (stats->served == 0)
+    {
+        stats->wait_avg_us = wait;
+    }
+    else
+    {
+        int64_t diff = (int64_t)wait - (int64_t)stats->wait_avg_us;
+        stats->wait_avg_us = (uint32_t)((int64_t)stats->wait_avg_us + diff / (1 << WAIT_SHIFT));
+    }
+}
@@ -0,0 +1,101 @@
+/**
+ * AGUADA - Ring SPSC de slots
+ *
+ * head/tail são contadores livres de 32 bits (overflow natural); o slot é
+ * `contador & mask`. head - tail dá a ocupação mesmo após o wrap.
+ *
+ * Ordem de memória: o produtor grava o slot e só então publica head
+ * (release); o consumidor lê head (acquire) antes de ler o slot. O mesmo
+ * vale no sentido inverso para tail, que libera o slot para reescrita.
+ */
+
+#include "aguada_ring.h"
+
+esp_err_t aguada_ring_init(aguada_ring_t *ring, void *slots, size_t slot_size, uint32_t capacity)
+{
+    if (!ring || !slots || slot_size == 0 || capacity == 0 || (capacity & (capacity - 1)) != 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ring->slots = (uint8_t *)slots;
+    ring->slot_size = slot_size;
+    ring->capacity = capacity;
+    ring->mask = capacity - 1;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->consumer = NULL;
+    ring->dropped = 0;
+    ring->high_water = 0;
+    return ESP_OK;
+}
+
+void aguada_ring_bind_consumer(aguada_ring_t *ring)
+{
+    ring->consumer = xTaskGetCurrentTaskHandle();
+}
+
+void *aguada_ring_claim(aguada_ring_t *ring)
+{
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if (head - tail >= ring->capacity)
+    {
+        ring->dropped++;
+        return NULL;
+    }
+    return ring->slots + (size_t)(head & ring->mask) * ring->slot_size;
+}
+
+void aguada_ring_publish(aguada_ring_t *ring)
+{
+    uint32_t head = ring->head + 1;
+    __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+
+    uint32_t used = head - ring->tail;
+    if (used > ring->high_water)
+    {
+        ring->high_water = used;
+    }
+
+    TaskHandle_t consumer = ring->consumer;
+    if (!consumer)
+    {
+        return;
+    }
+    if (xPortInIsrContext())
+    {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(consumer, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+    else
+    {
+        xTaskNotifyGive(consumer);
+    }
+}
+
+void *aguada_ring_peek(aguada_ring_t *ring, TickType_t wait)
+{
+    uint32_t tail = ring->tail;
+
+    // Notificações acumuladas de publicações já consumidas podem acordar
+    // a task com o ring vazio - repetir até o prazo
+    TickType_t start = xTaskGetTickCount();
+    while (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail)
+    {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (wait == 0 || elapsed >= wait)
+        {
+            return NULL;
+        }
+        ulTaskNotifyTake(pdTRUE, wait == portMAX_DELAY ? portMAX_DELAY : wait - elapsed);
+    }
+    return ring->slots + (size_t)(tail & ring->mask) * ring->slot_size;
+}
+
+void aguada_ring_release(aguada_ring_t *ring)
+{
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,91 @@
+/**
+ * AGUADA - Lanes de prioridade sobre rings SPSC (ESP-NOW → worker)
+ *
+ * Um aguada_ring_t por lane (lane 0 = mais prioritária), todos com o mesmo
+ * produtor (callback, que escolhe a lane pelo conteúdo do frame) e o mesmo
+ * consumidor. O consumidor usa aguada_lanes_peek()/aguada_lanes_release()
+ * no lugar de aguada_ring_peek()/aguada_ring_release():
+ *
+ * - Prioridade estrita: entrega o slot mais antigo da lane mais alta com
+ *   itens.
+ * - Anti-starvation: uma lane com itens que já viu `burst_max` entregas de
+ *   lanes acima dela é servida antes (uma entrega; a contagem recomeça).
+ *   Com duas lanes, a de baixo espera no máximo burst_max entregas e a de
+ *   cima no máximo uma.
+ *
+ * As publicações de qualquer lane acordam o consumidor pela mesma task
+ * notification (índice 0), como no ring simples.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "aguada_ring.h"
+
+#define AGUADA_LANES_MAX 4
+
+typedef struct
+{
+    uint32_t served;      // Slots entregues ao consumidor
+    uint32_t skipped;     // Entregas de lanes acima com esta esperando (zera ao ser servida)
+    uint32_t wait_avg_us; // EWMA (1/8) da espera recepção → entrega
+    uint32_t wait_max_us; // Maior espera recepção → entrega
+} aguada_lane_stats_t;
+
+typedef struct
+{
+    aguada_ring_t *rings[AGUADA_LANES_MAX]; // Índice 0 = mais prioritária
+    aguada_lane_stats_t stats[AGUADA_LANES_MAX];
+    uint8_t count;
+    uint8_t burst_max; // Entregas acima de uma lane com itens antes de servi-la
+    int8_t current;    // Lane do último aguada_lanes_peek() (-1 = nenhuma)
+    uint32_t yields;   // Entregas fora da prioridade estrita (anti-starvation)
+} aguada_lanes_t;
+
+/**
+ * Agrupa `count` rings já inicializados em lanes
+ *
+ * @return ESP_ERR_INVALID_ARG se count fora de 1..AGUADA_LANES_MAX ou burst_max = 0
+ */
+esp_err_t aguada_lanes_init(aguada_lanes_t *lanes, aguada_ring_t *const *rings, uint8_t count, uint8_t burst_max);
+
+/**
+ * Registra a task atual como consumidora de todas as lanes
+ */
+void aguada_lanes_bind_consumer(aguada_lanes_t *lanes);
+
+/**
+ * [Consumidor] Próximo slot pela política acima. Bloqueia até `wait` ticks
+ * se todas as lanes estão vazias. Sem release, o mesmo slot pode voltar no
+ * próximo peek (ou outro de lane mais alta que chegou nesse meio tempo).
+ *
+ * @param lane Saída opcional: lane do slot
+ * @return Ponteiro para o slot (válido até aguada_lanes_release) ou NULL
+ */
+void *aguada_lanes_peek(aguada_lanes_t *lanes, TickType_t wait, uint8_t *lane);
+
+/**
+ * [Consumidor] Devolve o slot do último aguada_lanes_peek() e contabiliza a
+ * entrega (served/skipped/yields)
+ */
+void aguada_lanes_release(aguada_lanes_t *lanes);
+
+/**
+ * [Consumidor] Registra a espera (recepção → entrega) do slot da lane,
+ * antes do aguada_lanes_release()
+ */
+void aguada_lanes_record_wait(aguada_lanes_t *lanes, uint8_t lane, int64_t wait_us);
+
+/**
+ * Slots em todas as lanes
+ */
+static inline uint32_t aguada_lanes_count(const aguada_lanes_t *lanes)
+{
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < lanes->count; i++)
+    {
+        total += aguada_ring_count(lanes->rings[i]);
+    }
+    return total;
+}
@@ -0,0 +1,84 @@
+/**
+ * AGUADA - Ring SPSC de slots (ESP-NOW → worker)
+ *
+ * Pool de slots pré-alocado + índices head/tail de produtor único e
+ * consumidor único, sem locks:
+ *
+ * - Produtor (callback ESP-NOW): aguada_ring_claim() devolve o slot livre,
+ *   o callback escreve o pacote direto nele e chama aguada_ring_publish()
+ * - Consumidor (worker): aguada_ring_peek() devolve um ponteiro para o slot
+ *   mais antigo; o slot pertence ao worker até aguada_ring_release()
+ *
+ * Cada pacote é copiado uma única vez (rádio → slot). head só é escrito pelo
+ * produtor e tail só pelo consumidor, então não há corrida entre eles.
+ * O produtor acorda o consumidor por task notification (índice 0) - a task
+ * consumidora não deve usar notificações para outra finalidade.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+typedef struct
+{
+    uint8_t *slots;          // capacity * slot_size bytes
+    size_t slot_size;
+    uint32_t capacity;       // Potência de 2
+    uint32_t mask;
+    volatile uint32_t head;  // Próximo slot a publicar (só o produtor escreve)
+    volatile uint32_t tail;  // Próximo slot a consumir (só o consumidor escreve)
+    TaskHandle_t consumer;   // Task acordada a cada publicação
+    uint32_t dropped;        // claim() com ring cheio
+    uint32_t high_water;     // Maior ocupação observada
+} aguada_ring_t;
+
+/**
+ * Inicializa o ring sobre um pool de slots estático
+ *
+ * @param slots     Array de `capacity` elementos de `slot_size` bytes
+ * @param capacity  Número de slots (potência de 2)
+ * @return ESP_ERR_INVALID_ARG se capacity não for potência de 2
+ */
+esp_err_t aguada_ring_init(aguada_ring_t *ring, void *slots, size_t slot_size, uint32_t capacity);
+
+/**
+ * Registra a task atual como consumidora (chamar no início do worker)
+ */
+void aguada_ring_bind_consumer(aguada_ring_t *ring);
+
+/**
+ * [Produtor] Slot livre para escrita, ou NULL se o ring está cheio
+ * (conta em ring->dropped). Não bloqueia.
+ */
+void *aguada_ring_claim(aguada_ring_t *ring);
+
+/**
+ * [Produtor] Publica o slot obtido em aguada_ring_claim() e acorda o consumidor.
+ * Seguro em ISR ou em task (callback ESP-NOW roda na task do WiFi).
+ */
+void aguada_ring_publish(aguada_ring_t *ring);
+
+/**
+ * [Consumidor] Slot mais antigo publicado. Bloqueia até `wait` ticks se vazio.
+ *
+ * @return Ponteiro para o slot (válido até aguada_ring_release) ou NULL
+ */
+void *aguada_ring_peek(aguada_ring_t *ring, TickType_t wait);
+
+/**
+ * [Consumidor] Devolve o slot retornado por aguada_ring_peek() ao pool
+ */
+void aguada_ring_release(aguada_ring_t *ring);
+
+/**
+ * Slots publicados e ainda não liberados
+ */
+static inline uint32_t aguada_ring_count(const aguada_ring_t *ring)
+{
+    return ring->head - ring->tail;
+}
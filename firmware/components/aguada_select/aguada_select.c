@@ -0,0 +1,176 @@
+/**
+ * AGUADA - Seleção para N pequeno: quickselect e mediana móvel
+ */
+
+#include "aguada_select.h"
+
+#include <string.h>
+
+// ============================================================================
+// AUXILIARES
+// ============================================================================
+
+static inline void swap32(int32_t *a, int32_t *b)
+{
+    int32_t t = *a;
+    *a = *b;
+    *b = t;
+}
+
+/**
+ * Primeira posição de sorted[0..len) com valor >= x
+ */
+static size_t lower_bound(const int32_t *sorted, size_t len, int32_t x)
+{
+    size_t lo = 0;
+    size_t hi = len;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (sorted[mid] < x)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// ============================================================================
+// QUICKSELECT / ORDENAÇÃO
+// ============================================================================
+
+int32_t aguada_select_kth(int32_t *v, size_t n, size_t k)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+    if (k >= n)
+    {
+        k = n - 1;
+    }
+
+    size_t lo = 0;
+    size_t hi = n - 1;
+
+    while (hi > lo)
+    {
+        // Pivô mediana-de-3 (leva o pivô para v[hi])
+        size_t mid = lo + (hi - lo) / 2;
+        if (v[mid] < v[lo])
+        {
+            swap32(&v[mid], &v[lo]);
+        }
+        if (v[hi] < v[lo])
+        {
+            swap32(&v[hi], &v[lo]);
+        }
+        if (v[mid] < v[hi])
+        {
+            swap32(&v[mid], &v[hi]);
+        }
+        int32_t pivot = v[hi];
+
+        // Partição de Lomuto
+        size_t store = lo;
+        for (size_t i = lo; i < hi; i++)
+        {
+            if (v[i] < pivot)
+            {
+                swap32(&v[i], &v[store]);
+                store++;
+            }
+        }
+        swap32(&v[store], &v[hi]);
+
+        if (store == k)
+        {
+            return v[k];
+        }
+        if (k < store)
+        {
+            hi = store - 1;
+        }
+        else
+        {
+            lo = store + 1;
+        }
+    }
+
+    return v[k];
+}
+
+void aguada_select_sort(int32_t *v, size_t n)
+{
+#define AGUADA_SELECT_CASE(N)   \
+    case N:                     \
+        aguada_sort_net_##N(v); \
+        return;
+
+    switch (n)
+    {
+    case 0:
+        return;
+        AGUADA_SELECT_NET_SIZES(AGUADA_SELECT_CASE)
+    default:
+        break;
+    }
+#undef AGUADA_SELECT_CASE
+
+    // Acima das redes: inserção (fora do caminho quente dos nodes)
+    for (size_t i = 1; i < n; i++)
+    {
+        int32_t x = v[i];
+        size_t j = i;
+        while (j > 0 && v[j - 1] > x)
+        {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = x;
+    }
+}
+
+// ============================================================================
+// MEDIANA MÓVEL
+// ============================================================================
+
+void aguada_running_median_init(aguada_running_median_t *rm, size_t window)
+{
+    memset(rm, 0, sizeof(*rm));
+    if (window < 1)
+    {
+        window = 1;
+    }
+    if (window > AGUADA_RUNNING_MEDIAN_MAX)
+    {
+        window = AGUADA_RUNNING_MEDIAN_MAX;
+    }
+    rm->window = (uint8_t)window;
+}
+
+int32_t aguada_running_median_push(aguada_running_median_t *rm, int32_t x)
+{
+    if (rm->len == rm->window)
+    {
+        // Janela cheia: tirar a amostra mais antiga da parte ordenada
+        int32_t old = rm->ring[rm->pos];
+        size_t at = lower_bound(rm->sorted, rm->len, old);
+        memmove(&rm->sorted[at], &rm->sorted[at + 1], (rm->len - at - 1) * sizeof(int32_t));
+        rm->len--;
+    }
+
+    size_t at = lower_bound(rm->sorted, rm->len, x);
+    memmove(&rm->sorted[at + 1], &rm->sorted[at], (rm->len - at) * sizeof(int32_t));
+    rm->sorted[at] = x;
+    rm->len++;
+
+    rm->ring[rm->pos] = x;
+    rm->pos = (uint8_t)((rm->pos + 1) % rm->window);
+
+    return rm->sorted[rm->len / 2];
+}
@@ -0,0 +1,410 @@
+/**
+ * AGUADA - Redes de ordenação e de mediana por N (1..16)
+ *
+ * Ordenação: redes ótimas em número de comparadores para N <= 10; de 11 a
+ * 16, odd-even merge de Batcher podada. Mediana (posto N/2): a rede de
+ * ordenação sem os comparadores que não alcançam a saída N/2.
+ * Todas conferidas exaustivamente pelo princípio 0-1 no bench (bench/).
+ */
+
+#include "aguada_select.h"
+
+// Compara-troca: v[i] <= v[j] ao final
+#define CX(i, j)                          \
+    do                                    \
+    {                                     \
+        int32_t a_ = v[i], b_ = v[j];     \
+        v[i] = (a_ < b_) ? a_ : b_;       \
+        v[j] = (a_ < b_) ? b_ : a_;       \
+    } while (0)
+
+// ============================================================================
+// ORDENAÇÃO
+// ============================================================================
+
+void aguada_sort_net_1(int32_t *v)
+{
+    (void)v;
+}
+
+void aguada_sort_net_2(int32_t *v)
+{
+    // 1 comparador
+    CX(0, 1);
+}
+
+void aguada_sort_net_3(int32_t *v)
+{
+    // 3 comparadores
+    CX(0, 2); CX(0, 1); CX(1, 2);
+}
+
+void aguada_sort_net_4(int32_t *v)
+{
+    // 5 comparadores
+    CX(0, 1); CX(2, 3); CX(0, 2); CX(1, 3);
+    CX(1, 2);
+}
+
+void aguada_sort_net_5(int32_t *v)
+{
+    // 9 comparadores
+    CX(0, 3); CX(1, 4); CX(0, 2); CX(1, 3);
+    CX(0, 1); CX(2, 4); CX(1, 2); CX(3, 4);
+    CX(2, 3);
+}
+
+void aguada_sort_net_6(int32_t *v)
+{
+    // 12 comparadores
+    CX(0, 5); CX(1, 3); CX(2, 4); CX(1, 2);
+    CX(3, 4); CX(0, 3); CX(2, 5); CX(0, 1);
+    CX(2, 3); CX(4, 5); CX(1, 2); CX(3, 4);
+}
+
+void aguada_sort_net_7(int32_t *v)
+{
+    // 16 comparadores
+    CX(0, 6); CX(2, 3); CX(4, 5); CX(0, 2);
+    CX(1, 4); CX(3, 6); CX(0, 1); CX(2, 5);
+    CX(3, 4); CX(1, 2); CX(4, 6); CX(2, 3);
+    CX(4, 5); CX(1, 2); CX(3, 4); CX(5, 6);
+}
+
+void aguada_sort_net_8(int32_t *v)
+{
+    // 19 comparadores
+    CX(0, 2); CX(1, 3); CX(4, 6); CX(5, 7);
+    CX(0, 4); CX(1, 5); CX(2, 6); CX(3, 7);
+    CX(0, 1); CX(2, 3); CX(4, 5); CX(6, 7);
+    CX(2, 4); CX(3, 5); CX(1, 4); CX(3, 6);
+    CX(1, 2); CX(3, 4); CX(5, 6);
+}
+
+void aguada_sort_net_9(int32_t *v)
+{
+    // 25 comparadores
+    CX(0, 3); CX(1, 7); CX(2, 5); CX(4, 8);
+    CX(0, 7); CX(2, 4); CX(3, 8); CX(5, 6);
+    CX(0, 2); CX(1, 3); CX(4, 5); CX(7, 8);
+    CX(1, 4); CX(3, 6); CX(5, 7); CX(0, 1);
+    CX(2, 4); CX(3, 5); CX(6, 8); CX(2, 3);
+    CX(4, 5); CX(6, 7); CX(1, 2); CX(3, 4);
+    CX(5, 6);
+}
+
+void aguada_sort_net_10(int32_t *v)
+{
+    // 29 comparadores
+    CX(0, 8); CX(1, 9); CX(2, 7); CX(3, 5);
+    CX(4, 6); CX(0, 2); CX(1, 4); CX(5, 8);
+    CX(7, 9); CX(0, 3); CX(2, 4); CX(5, 7);
+    CX(6, 9); CX(0, 1); CX(3, 6); CX(8, 9);
+    CX(1, 5); CX(2, 3); CX(4, 8); CX(6, 7);
+    CX(1, 2); CX(3, 5); CX(4, 6); CX(7, 8);
+    CX(2, 3); CX(4, 5); CX(6, 7); CX(3, 4);
+    CX(5, 6);
+}
+
+void aguada_sort_net_11(int32_t *v)
+{
+    // 38 comparadores
+    CX(0, 1); CX(2, 3); CX(4, 5); CX(6, 7);
+    CX(8, 9); CX(0, 2); CX(1, 3); CX(4, 6);
+    CX(5, 7); CX(8, 10); CX(1, 2); CX(5, 6);
+    CX(9, 10); CX(0, 4); CX(1, 5); CX(2, 6);
+    CX(3, 7); CX(2, 4); CX(3, 5); CX(1, 2);
+    CX(3, 4); CX(5, 6); CX(9, 10); CX(0, 8);
+    CX(1, 9); CX(2, 10); CX(4, 8); CX(5, 9);
+    CX(6, 10); CX(2, 4); CX(3, 5); CX(6, 8);
+    CX(7, 9); CX(1, 2); CX(3, 4); CX(5, 6);
+    CX(7, 8); CX(9, 10);
+}
+
+void aguada_sort_net_12(int32_t *v)
+{
+    // 42 comparadores
+    CX(0, 1); CX(2, 3); CX(4, 5); CX(6, 7);
+    CX(8, 9); CX(10, 11); CX(0, 2); CX(1, 3);
+    CX(4, 6); CX(5, 7); CX(8, 10); CX(9, 11);
+    CX(1, 2); CX(5, 6); CX(9, 10); CX(0, 4);
+    CX(1, 5); CX(2, 6); CX(3, 7); CX(2, 4);
+    CX(3, 5); CX(1, 2); CX(3, 4); CX(5, 6);
+    CX(9, 10); CX(0, 8); CX(1, 9); CX(2, 10);
+    CX(3, 11); CX(4, 8); CX(5, 9); CX(6, 10);
+    CX(7, 11); CX(2, 4); CX(3, 5); CX(6, 8);
+    CX(7, 9); CX(1, 2); CX(3, 4); CX(5, 6);
+    CX(7, 8); CX(9, 10);
+}
+
+void aguada_sort_net_13(int32_t *v)
+{
+    // 48 comparadores
+    CX(0, 1); CX(2, 3); CX(4, 5); CX(6, 7);
+    CX(8, 9); CX(10, 11); CX(0, 2); CX(1, 3);
+    CX(4, 6); CX(5, 7); CX(8, 10); CX(9, 11);
+    CX(1, 2); CX(5, 6); CX(9, 10); CX(0, 4);
+    CX(1, 5); CX(2, 6); CX(3, 7); CX(8, 12);
+    CX(2, 4); CX(3, 5); CX(10, 12); CX(1, 2);
+    CX(3, 4); CX(5, 6); CX(9, 10); CX(11, 12);
+    CX(0, 8); CX(1, 9); CX(2, 10); CX(3, 11);
+    CX(4, 12); CX(4, 8); CX(5, 9); CX(6, 10);
+    CX(7, 11); CX(2, 4); CX(3, 5); CX(6, 8);
+    CX(7, 9); CX(10, 12); CX(1, 2); CX(3, 4);
+    CX(5, 6); CX(7, 8); CX(9, 10); CX(11, 12);
+}
+
+void aguada_sort_net_14(int32_t *v)
+{
+    // 53 comparadores
+    CX(0, 1); CX(2, 3); CX(4, 5); CX(6, 7);
+    CX(8, 9); CX(10, 11); CX(12, 13); CX(0, 2);
+    CX(1, 3); CX(4, 6); CX(5, 7); CX(8, 10);
+    CX(9, 11); CX(1, 2); CX(5, 6); CX(9, 10);
+    CX(0, 4); CX(1, 5); CX(2, 6); CX(3, 7);
+    CX(8, 12); CX(9, 13); CX(2, 4); CX(3, 5);
+    CX(10, 12); CX(11, 13); CX(1, 2); CX(3, 4);
+    CX(5, 6); CX(9, 10); CX(11, 12); CX(0, 8);
+    CX(1, 9); CX(2, 10); CX(3, 11); CX(4, 12);
+    CX(5, 13); CX(4, 8); CX(5, 9); CX(6, 10);
+    CX(7, 11); CX(2, 4); CX(3, 5); CX(6, 8);
+    CX(7, 9); CX(10, 12); CX(11, 13); CX(1, 2);
+    CX(3, 4); CX(5, 6); CX(7, 8); CX(9, 10);
+    CX(11, 12);
+}
+
+void aguada_sort_net_15(int32_t *v)
+{
+    // 59 comparadores
+    CX(0, 1); CX(2, 3); CX(4, 5); CX(6, 7);
+    CX(8, 9); CX(10, 11); CX(12, 13); CX(0, 2);
+    CX(1, 3); CX(4, 6); CX(5, 7); CX(8, 10);
+    CX(9, 11); CX(12, 14); CX(1, 2); CX(5, 6);
+    CX(9, 10); CX(13, 14); CX(0, 4); CX(1, 5);
+    CX(2, 6); CX(3, 7); CX(8, 12); CX(9, 13);
+    CX(10, 14); CX(2, 4); CX(3, 5); CX(10, 12);
+    CX(11, 13); CX(1, 2); CX(3, 4); CX(5, 6);
+    CX(9, 10); CX(11, 12); CX(13, 14); CX(0, 8);
+    CX(1, 9); CX(2, 10); CX(3, 11); CX(4, 12);
+    CX(5, 13); CX(6, 14); CX(4, 8); CX(5, 9);
+    CX(6, 10); CX(7, 11); CX(2, 4); CX(3, 5);
+    CX(6, 8); CX(7, 9); CX(10, 12); CX(11, 13);
+    CX(1, 2); CX(3, 4); CX(5, 6); CX(7, 8);
+    CX(9, 10); CX(11, 12); CX(13, 14);
+}
+
+void aguada_sort_net_16(int32_t *v)
+{
+    // 63 comparadores
+    CX(0, 1); CX(2, 3); CX(4, 5); CX(6, 7);
+    CX(8, 9); CX(10, 11); CX(12, 13); CX(14, 15);
+    CX(0, 2); CX(1, 3); CX(4, 6); CX(5, 7);
+    CX(8, 10); CX(9, 11); CX(12, 14); CX(13, 15);
+    CX(1, 2); CX(5, 6); CX(9, 10); CX(13, 14);
+    CX(0, 4); CX(1, 5); CX(2, 6); CX(3, 7);
+    CX(8, 12); CX(9, 13); CX(10, 14); CX(11, 15);
+    CX(2, 4); CX(3, 5); CX(10, 12); CX(11, 13);
+    CX(1, 2); CX(3, 4); CX(5, 6); CX(9, 10);
+    CX(11, 12); CX(13, 14); CX(0, 8); CX(1, 9);
+    CX(2, 10); CX(3, 11); CX(4, 12); CX(5, 13);
+    CX(6, 14); CX(7, 15); CX(4, 8); CX(5, 9);
+    CX(6, 10); CX(7, 11); CX(2, 4); CX(3, 5);
+    CX(6, 8); CX(7, 9); CX(10, 12); CX(11, 13);
+    CX(1, 2); CX(3, 4); CX(5, 6); CX(7, 8);
+    CX(9, 10); CX(11, 12); CX(13, 14);
+}
+
+// ============================================================================
+// MEDIANA (posto N/2)
+// ============================================================================
+
+int32_t aguada_median_net_1(int32_t *v)
+{
+    return v[0];
+}
+
+int32_t aguada_median_net_2(int32_t *v)
+{
+    // 1 comparador
+    CX(0, 1);
+    return v[1];
+}
+
+int32_t aguada_median_net_3(int32_t *v)
+{
+    // 3 comparadores
+    CX(0, 2); CX(0, 1); CX(1, 2);
+    return v[1];
+}
+
+int32_t aguada_median_net_4(int32_t *v)
+{
+    // 5 comparadores
+    CX(0, 1); CX(2, 3); CX(0, 2); CX(1, 3);
+    CX(1, 2);
+    return v[2];
+}
+
+int32_t aguada_median_net_5(int32_t *v)
+{
+    // 9 comparadores
+    CX(0, 3); CX(1, 4); CX(0, 2); CX(1, 3);
+    CX(0, 1); CX(2, 4); CX(1, 2); CX(3, 4);
+    CX(2, 3);
+    return v[2];
+}
+
+int32_t aguada_median_net_6(int32_t *v)
+{
+    // 10 comparadores
+    CX(0, 5); CX(1, 3); CX(2, 4); CX(1, 2);
+    CX(3, 4); CX(0, 3); CX(2, 5); CX(2, 3);
+    CX(4, 5); CX(3, 4);
+    return v[3];
+}
+
+int32_t aguada_median_net_7(int32_t *v)
+{
+    // 14 comparadores
+    CX(0, 6); CX(2, 3); CX(4, 5); CX(0, 2);
+    CX(1, 4); CX(3, 6); CX(0, 1); CX(2, 5);
+    CX(3, 4); CX(1, 2); CX(4, 6); CX(2, 3);
+    CX(4, 5); CX(3, 4);
+    return v[3];
+}
+
+int32_t aguada_median_net_8(int32_t *v)
+{
+    // 17 comparadores
+    CX(0, 2); CX(1, 3); CX(4, 6); CX(5, 7);
+    CX(0, 4); CX(1, 5); CX(2, 6); CX(3, 7);
+    CX(0, 1); CX(2, 3); CX(4, 5); CX(6, 7);
+    CX(2, 4); CX(3, 5); CX(1, 4); CX(3, 6);
+    CX(3, 4);
+    return v[4];
+}
+
+int32_t aguada_median_net_9(int32_t *v)
+{
+    // 20 comparadores
+    CX(0, 3); CX(1, 7); CX(2, 5); CX(4, 8);
+    CX(0, 7); CX(2, 4); CX(3, 8); CX(5, 6);
+    CX(0, 2); CX(1, 3); CX(4, 5); CX(7, 8);
+    CX(1, 4); CX(3, 6); CX(5, 7); CX(2, 4);
+    CX(3, 5); CX(2, 3); CX(4, 5); CX(3, 4);
+    return v[4];
+}
+
+int32_t aguada_median_net_10(int32_t *v)
+{
+    // 26 comparadores
+    CX(0, 8); CX(1, 9); CX(2, 7); CX(3, 5);
+    CX(4, 6); CX(0, 2); CX(1, 4); CX(5, 8);
+    CX(7, 9); CX(0, 3); CX(2, 4); CX(5, 7);
+    CX(6, 9); CX(0, 1); CX(3, 6); CX(8, 9);
+    CX(1, 5); CX(2, 3); CX(4, 8); CX(6, 7);
+    CX(3, 5); CX(4, 6); CX(7, 8); CX(4, 5);
+    CX(6, 7); CX(5, 6);
+    return v[5];
+}
+
+int32_t aguada_median_net_11(int32_t *v)
+{
+    // 32 comparadores
+    CX(0, 1); CX(2, 3); CX(4, 5); CX(6, 7);
+    CX(8, 9); CX(0, 2); CX(1, 3); CX(4, 6);
+    CX(5, 7); CX(8, 10); CX(1, 2); CX(5, 6);
+    CX(9, 10); CX(0, 4); CX(1, 5); CX(2, 6);
+    CX(3, 7); CX(2, 4); CX(3, 5); CX(1, 2);
+    CX(3, 4); CX(5, 6); CX(9, 10); CX(0, 8);
+    CX(1, 9); CX(2, 10); CX(4, 8); CX(5, 9);
+    CX(6, 10); CX(3, 5); CX(6, 8); CX(5, 6);
+    return v[5];
+}
+
+int32_t aguada_median_net_12(int32_t *v)
+{
+    // 35 comparadores
+    CX(0, 1); CX(2, 3); CX(4, 5); CX(6, 7);
+    CX(8, 9); CX(10, 11); CX(0, 2); CX(1, 3);
+    CX(4, 6); CX(5, 7); CX(8, 10); CX(9, 11);
+    CX(1, 2); CX(5, 6); CX(9, 10); CX(0, 4);
+    CX(1, 5); CX(2, 6); CX(3, 7); CX(2, 4);
+    CX(3, 5); CX(1, 2); CX(3, 4); CX(5, 6);
+    CX(9, 10); CX(0, 8); CX(1, 9); CX(2, 10);
+    CX(3, 11); CX(4, 8); CX(5, 9); CX(6, 10);
+    CX(3, 5); CX(6, 8); CX(5, 6);
+    return v[6];
+}
+
+int32_t aguada_median_net_13(int32_t *v)
+{
+    // 39 comparadores
+    CX(0, 1); CX(2, 3); CX(4, 5); CX(6, 7);
+    CX(8, 9); CX(10, 11); CX(0, 2); CX(1, 3);
+    CX(4, 6); CX(5, 7); CX(8, 10); CX(9, 11);
+    CX(1, 2); CX(5, 6); CX(9, 10); CX(0, 4);
+    CX(1, 5); CX(2, 6); CX(3, 7); CX(8, 12);
+    CX(2, 4); CX(3, 5); CX(10, 12); CX(1, 2);
+    CX(3, 4); CX(5, 6); CX(9, 10); CX(11, 12);
+    CX(0, 8); CX(1, 9); CX(2, 10); CX(3, 11);
+    CX(4, 12); CX(4, 8); CX(5, 9); CX(6, 10);
+    CX(3, 5); CX(6, 8); CX(5, 6);
+    return v[6];
+}
+
+int32_t aguada_median_net_14(int32_t *v)
+{
+    // 44 comparadores
+    CX(0, 1); CX(2, 3); CX(4, 5); CX(6, 7);
+    CX(8, 9); CX(10, 11); CX(12, 13); CX(0, 2);
+    CX(1, 3); CX(4, 6); CX(5, 7); CX(8, 10);
+    CX(9, 11); CX(1, 2); CX(5, 6); CX(9, 10);
+    CX(0, 4); CX(1, 5); CX(2, 6); CX(3, 7);
+    CX(8, 12); CX(9, 13); CX(2, 4); CX(3, 5);
+    CX(10, 12); CX(11, 13); CX(1, 2); CX(3, 4);
+    CX(5, 6); CX(9, 10); CX(11, 12); CX(0, 8);
+    CX(1, 9); CX(2, 10); CX(3, 11); CX(4, 12);
+    CX(5, 13); CX(4, 8); CX(5, 9); CX(6, 10);
+    CX(7, 11); CX(6, 8); CX(7, 9); CX(7, 8);
+    return v[7];
+}
+
+int32_t aguada_median_net_15(int32_t *v)
+{
+    // 49 comparadores
+    CX(0, 1); CX(2, 3); CX(4, 5); CX(6, 7);
+    CX(8, 9); CX(10, 11); CX(12, 13); CX(0, 2);
+    CX(1, 3); CX(4, 6); CX(5, 7); CX(8, 10);
+    CX(9, 11); CX(12, 14); CX(1, 2); CX(5, 6);
+    CX(9, 10); CX(13, 14); CX(0, 4); CX(1, 5);
+    CX(2, 6); CX(3, 7); CX(8, 12); CX(9, 13);
+    CX(10, 14); CX(2, 4); CX(3, 5); CX(10, 12);
+    CX(11, 13); CX(1, 2); CX(3, 4); CX(5, 6);
+    CX(9, 10); CX(11, 12); CX(13, 14); CX(0, 8);
+    CX(1, 9); CX(2, 10); CX(3, 11); CX(4, 12);
+    CX(5, 13); CX(6, 14); CX(4, 8); CX(5, 9);
+    CX(6, 10); CX(7, 11); CX(6, 8); CX(7, 9);
+    CX(7, 8);
+    return v[7];
+}
+
+int32_t aguada_median_net_16(int32_t *v)
+{
+    // 53 comparadores
+    CX(0, 1); CX(2, 3); CX(4, 5); CX(6, 7);
+    CX(8, 9); CX(10, 11); CX(12, 13); CX(14, 15);
+    CX(0, 2); CX(1, 3); CX(4, 6); CX(5, 7);
+    CX(8, 10); CX(9, 11); CX(12, 14); CX(13, 15);
+    CX(1, 2); CX(5, 6); CX(9, 10); CX(13, 14);
+    CX(0, 4); CX(1, 5); CX(2, 6); CX(3, 7);
+    CX(8, 12); CX(9, 13); CX(10, 14); CX(11, 15);
+    CX(2, 4); CX(3, 5); CX(10, 12); CX(11, 13);
+    CX(1, 2); CX(3, 4); CX(5, 6); CX(9, 10);
+    CX(11, 12); CX(13, 14); CX(0, 8); CX(1, 9);
+    CX(2, 10); CX(3, 11); CX(4, 12); CX(5, 13);
+    CX(6, 14); CX(7, 15); CX(4, 8); CX(5, 9);
+    CX(6, 10); CX(7, 11); CX(6, 8); CX(7, 9);
+    CX(7, 8);
+    return v[8];
+}
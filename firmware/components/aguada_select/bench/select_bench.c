@@ -0,0 +1,210 @@
+/**
+ * AGUADA - Bench de host da seleção
+ *
+ * Confere todas as redes (ordenação e mediana, N = 1..16) exaustivamente
+ * pelo princípio 0-1, o quickselect e a mediana móvel contra qsort, e mede
+ * ns/op da mediana por rede/quickselect contra o qsort + compare_int antigo
+ * dos nodes. Aborta se qualquer conferência falhar.
+ *
+ * Uso: select_bench [iterações]   (padrão 1000000)
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "aguada_select.h"
+
+static volatile int32_t sink; // Impede o compilador de eliminar os laços
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void report(const char *name, size_t n, double elapsed_ns, long iterations)
+{
+    char label[40];
+    snprintf(label, sizeof(label), "%s, N=%zu", name, n);
+    printf("  %-28s %8.1f ns/op\n", label, elapsed_ns / (double)iterations);
+}
+
+#define CHECK(cond)                                                     \
+    do                                                                  \
+    {                                                                   \
+        if (!(cond))                                                    \
+        {                                                               \
+            fprintf(stderr, "FALHA %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                    \
+        }                                                               \
+    } while (0)
+
+// ============================================================================
+// REFERÊNCIA (qsort antigo dos nodes)
+// ============================================================================
+
+static int compare_int(const void *a, const void *b)
+{
+    return (*(int *)a - *(int *)b);
+}
+
+// Comparador sem overflow, para a conferência
+static int compare_i32(const void *a, const void *b)
+{
+    int32_t x = *(const int32_t *)a;
+    int32_t y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t rng_state = 12345;
+
+static uint32_t rng(void)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 16;
+}
+
+// ============================================================================
+// CONFERÊNCIA
+// ============================================================================
+
+static void self_check(void)
+{
+    int32_t v[64];
+    int32_t ref[64];
+
+    // Princípio 0-1: uma rede que ordena toda entrada binária ordena tudo
+    for (size_t n = 1; n <= AGUADA_SELECT_NET_MAX; n++)
+    {
+        for (uint32_t bits = 0; bits < (1u << n); bits++)
+        {
+            int ones = 0;
+            for (size_t i = 0; i < n; i++)
+            {
+                v[i] = (bits >> i) & 1;
+                ones += v[i];
+            }
+            aguada_select_sort(v, n);
+            for (size_t i = 0; i < n; i++)
+            {
+                CHECK(v[i] == (i >= n - (size_t)ones));
+            }
+
+            for (size_t i = 0; i < n; i++)
+            {
+                v[i] = (bits >> i) & 1;
+            }
+            CHECK(aguada_select_median(v, n) == (int32_t)(n / 2 >= n - (size_t)ones));
+        }
+    }
+
+    // Valores extremos (o comparador por subtração erra aqui)
+    int32_t extremes[] = {INT32_MAX, -5, INT32_MIN, 7, 0};
+    CHECK(aguada_select_median(extremes, 5) == 0);
+
+    // Quickselect e mediana móvel contra qsort
+    for (int round = 0; round < 2000; round++)
+    {
+        size_t n = 1 + rng() % 64;
+        size_t k = rng() % n;
+        for (size_t i = 0; i < n; i++)
+        {
+            v[i] = ref[i] = (int32_t)(rng() % 200) - 100;
+        }
+        qsort(ref, n, sizeof(int32_t), compare_i32);
+        CHECK(aguada_select_kth(v, n, k) == ref[k]);
+        memcpy(v, ref, n * sizeof(int32_t));
+        CHECK(aguada_select_median(v, n) == ref[n / 2]);
+    }
+
+    aguada_running_median_t rm;
+    int32_t history[1000];
+    for (size_t window = 1; window <= AGUADA_RUNNING_MEDIAN_MAX; window += 4)
+    {
+        aguada_running_median_init(&rm, window);
+        for (size_t t = 0; t < 1000; t++)
+        {
+            history[t] = (int32_t)(rng() % 5000);
+            int32_t got = aguada_running_median_push(&rm, history[t]);
+            size_t len = (t + 1 < window) ? t + 1 : window;
+            memcpy(ref, &history[t + 1 - len], len * sizeof(int32_t));
+            qsort(ref, len, sizeof(int32_t), compare_i32);
+            CHECK(got == ref[len / 2] && aguada_running_median_get(&rm) == got);
+        }
+        CHECK(aguada_running_median_full(&rm));
+    }
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main(int argc, char **argv)
+{
+    long iterations = (argc > 1) ? atol(argv[1]) : 1000000;
+    if (iterations <= 0)
+    {
+        iterations = 1000000;
+    }
+
+    self_check();
+    printf("aguada_select bench (%ld iterações)\n", iterations);
+
+    enum { SET = 1024, MAXN = 33 };
+    static int32_t inputs[SET][MAXN];
+    for (int s = 0; s < SET; s++)
+    {
+        for (int i = 0; i < MAXN; i++)
+        {
+            inputs[s][i] = 2000 + (int32_t)(rng() % 13) - 6;
+        }
+    }
+
+    static const size_t sizes[] = {5, 7, 11, 16, 33};
+    int32_t v[MAXN];
+    int w[MAXN];
+    double t0;
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        size_t n = sizes[s];
+
+        t0 = now_ns();
+        for (long i = 0; i < iterations; i++)
+        {
+            memcpy(v, inputs[i & (SET - 1)], n * sizeof(int32_t));
+            sink += aguada_select_median(v, n);
+        }
+        report(n <= AGUADA_SELECT_NET_MAX ? "mediana (rede)" : "mediana (quickselect)",
+               n, now_ns() - t0, iterations);
+
+        t0 = now_ns();
+        for (long i = 0; i < iterations; i++)
+        {
+            const int32_t *src = inputs[i & (SET - 1)];
+            for (size_t k = 0; k < n; k++)
+            {
+                w[k] = src[k];
+            }
+            qsort(w, n, sizeof(int), compare_int);
+            sink += w[n / 2];
+        }
+        report("mediana (qsort)", n, now_ns() - t0, iterations);
+    }
+
+    // Mediana móvel: um push por amostra (janela de 15 = 3 leituras de 5)
+    aguada_running_median_t rm;
+    aguada_running_median_init(&rm, 15);
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        sink += aguada_running_median_push(&rm, inputs[i & (SET - 1)][i % MAXN]);
+    }
+    report("mediana móvel push", 15, now_ns() - t0, iterations);
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+/**
+ * AGUADA - Seleção para N pequeno (mediana sem qsort)
+ *
+ * - N <= 16: redes de ordenação/mediana desenroladas (aguada_select_nets.c),
+ *   sem chamadas indiretas nem comparador por subtração (que estoura)
+ * - N > 16: quickselect iterativo com pivô mediana-de-3
+ * - Mediana móvel: janela deslizante sobre leituras sucessivas, para
+ *   reduzir as amostras por leitura sem perder robustez
+ *
+ * aguada_select_median() é inline: com N constante o switch some e a
+ * chamada vai direto para a rede daquele tamanho. Mediana = posto N/2
+ * (a superior para N par), como nos firmwares. Sem dependências do
+ * ESP-IDF: compila também no host (ver bench/).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define AGUADA_SELECT_NET_MAX 16       // Maior N com rede dedicada
+#define AGUADA_RUNNING_MEDIAN_MAX 33   // Maior janela da mediana móvel
+
+// Tamanhos com rede dedicada (X-macro)
+#define AGUADA_SELECT_NET_SIZES(X) \
+    X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) \
+    X(9) X(10) X(11) X(12) X(13) X(14) X(15) X(16)
+
+#define AGUADA_SELECT_DECLARE_NET(n)            \
+    void aguada_sort_net_##n(int32_t *v);      \
+    int32_t aguada_median_net_##n(int32_t *v);
+AGUADA_SELECT_NET_SIZES(AGUADA_SELECT_DECLARE_NET)
+#undef AGUADA_SELECT_DECLARE_NET
+
+// ============================================================================
+// SELEÇÃO
+// ============================================================================
+
+/**
+ * k-ésimo menor (posto k, 0 = mínimo) por quickselect; reordena o vetor
+ */
+int32_t aguada_select_kth(int32_t *v, size_t n, size_t k);
+
+/**
+ * Ordena n valores (rede até 16, inserção acima)
+ */
+void aguada_select_sort(int32_t *v, size_t n);
+
+/**
+ * Mediana (posto n/2) de n valores; reordena o vetor. n = 0 retorna 0.
+ */
+static inline int32_t aguada_select_median(int32_t *v, size_t n)
+{
+#define AGUADA_SELECT_CASE(N) \
+    case N:                   \
+        return aguada_median_net_##N(v);
+
+    switch (n)
+    {
+    case 0:
+        return 0;
+        AGUADA_SELECT_NET_SIZES(AGUADA_SELECT_CASE)
+    default:
+        return aguada_select_kth(v, n, n / 2);
+    }
+#undef AGUADA_SELECT_CASE
+}
+
+// ============================================================================
+// MEDIANA MÓVEL
+// ============================================================================
+
+/**
+ * Últimas `window` amostras em ordem de chegada e ordenadas. Cada push custa
+ * O(window) (busca binária + deslocamento); a mediana sai em O(1). Só
+ * inteiros: pode ficar em RTC RAM.
+ */
+typedef struct
+{
+    int32_t ring[AGUADA_RUNNING_MEDIAN_MAX];   // Ordem de chegada (circular)
+    int32_t sorted[AGUADA_RUNNING_MEDIAN_MAX]; // Mesma janela, ordenada
+    uint8_t window;
+    uint8_t len;
+    uint8_t pos;
+} aguada_running_median_t;
+
+/**
+ * @param window Tamanho da janela (1..AGUADA_RUNNING_MEDIAN_MAX, saturado)
+ */
+void aguada_running_median_init(aguada_running_median_t *rm, size_t window);
+
+/**
+ * Insere x (descartando a amostra mais antiga com a janela cheia) e
+ * devolve a mediana atual
+ */
+int32_t aguada_running_median_push(aguada_running_median_t *rm, int32_t x);
+
+static inline int32_t aguada_running_median_get(const aguada_running_median_t *rm)
+{
+    return (rm->len > 0) ? rm->sorted[rm->len / 2] : 0;
+}
+
+static inline bool aguada_running_median_full(const aguada_running_median_t *rm)
+{
+    return rm->len == rm->window;
+}
@@ -0,0 +1,161 @@
+/**
+ * AGUADA - Captura de eco ultrassônico por interrupção
+ *
+ * A ISR só carimba as bordas e acorda a task na descida. Borda de descida sem
+ * subida registrada (ruído antes do disparo) é ignorada. A medição desarma a
+ * interrupção ao terminar, então ecos atrasados de um ciclo com timeout não
+ * contaminam o próximo.
+ */
+
+#include "aguada_sonar.h"
+
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "hal/gpio_ll.h"
+#include "soc/gpio_struct.h"
+
+#define TAG "SONAR"
+
+#define TRIG_PULSE_US 10
+
+static void IRAM_ATTR echo_isr(void *arg)
+{
+    aguada_sonar_t *sonar = (aguada_sonar_t *)arg;
+    int64_t now = esp_timer_get_time();
+
+    // gpio_get_level() está em flash: com o cache desligado a ISR em IRAM travaria
+    if (gpio_ll_get_level(&GPIO, sonar->echo_pin))
+    {
+        sonar->rise_us = now;
+        return;
+    }
+
+    TaskHandle_t waiter = sonar->waiter;
+    if (sonar->rise_us == 0 || waiter == NULL)
+    {
+        return;
+    }
+
+    sonar->fall_us = now;
+    sonar->waiter = NULL;
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(waiter, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+esp_err_t aguada_sonar_init(aguada_sonar_t *sonar, gpio_num_t trig_pin, gpio_num_t echo_pin, uint32_t timeout_us)
+{
+    sonar->trig_pin = trig_pin;
+    sonar->echo_pin = echo_pin;
+    sonar->timeout_us = timeout_us;
+    sonar->rise_us = 0;
+    sonar->fall_us = 0;
+    sonar->waiter = NULL;
+    sonar->timeouts = 0;
+
+    gpio_config_t trig_cfg = {
+        .pin_bit_mask = 1ULL << trig_pin,
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    esp_err_t err = gpio_config(&trig_cfg);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    gpio_set_level(trig_pin, 0);
+
+    gpio_config_t echo_cfg = {
+        .pin_bit_mask = 1ULL << echo_pin,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_ENABLE, // ECHO em repouso = 0 com sensor desconectado
+        .intr_type = GPIO_INTR_ANYEDGE,
+    };
+    err = gpio_config(&echo_cfg);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    // Serviço compartilhado entre instâncias (INVALID_STATE = já instalado)
+    err = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE)
+    {
+        return err;
+    }
+
+    err = gpio_isr_handler_add(echo_pin, echo_isr, sonar);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    gpio_intr_disable(echo_pin);
+
+#if CONFIG_PM_ENABLE
+    err = esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "sonar", &sonar->pm_lock);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+#endif
+
+    ESP_LOGI(TAG, "✓ Sonar TRIG=%d ECHO=%d (captura por ISR, timeout %lu µs)",
+             trig_pin, echo_pin, (unsigned long)timeout_us);
+    return ESP_OK;
+}
+
+int32_t aguada_sonar_measure(aguada_sonar_t *sonar)
+{
+    // Eco ainda em nível alto (ciclo anterior não terminou) - não dá para medir
+    if (gpio_get_level(sonar->echo_pin))
+    {
+        sonar->timeouts++;
+        return AGUADA_SONAR_TIMEOUT;
+    }
+
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_acquire(sonar->pm_lock);
+#endif
+
+    // Armar: descarta notificação pendente e só então habilita a interrupção
+    sonar->rise_us = 0;
+    sonar->fall_us = 0;
+    ulTaskNotifyTake(pdTRUE, 0);
+    sonar->waiter = xTaskGetCurrentTaskHandle();
+    gpio_intr_enable(sonar->echo_pin);
+
+    // Pulso TRIG
+    gpio_set_level(sonar->trig_pin, 1);
+    esp_rom_delay_us(TRIG_PULSE_US);
+    gpio_set_level(sonar->trig_pin, 0);
+
+    // Espera início do eco + largura máxima (arredondado para cima em ticks)
+    TickType_t wait = pdMS_TO_TICKS((2 * sonar->timeout_us) / 1000) + 2;
+    bool got_echo = ulTaskNotifyTake(pdTRUE, wait) > 0;
+
+    gpio_intr_disable(sonar->echo_pin);
+    sonar->waiter = NULL;
+
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_release(sonar->pm_lock);
+#endif
+
+    if (!got_echo)
+    {
+        sonar->timeouts++;
+        return AGUADA_SONAR_TIMEOUT;
+    }
+
+    int64_t width_us = sonar->fall_us - sonar->rise_us;
+    if (width_us <= 0 || width_us > sonar->timeout_us)
+    {
+        sonar->timeouts++;
+        return AGUADA_SONAR_TIMEOUT;
+    }
+    return (int32_t)width_us;
+}
@@ -0,0 +1,71 @@
+/**
+ * AGUADA - Captura de eco ultrassônico por interrupção (AJ-SR04M / HC-SR04)
+ *
+ * Substitui o busy-wait em gpio_get_level(): o pino ECHO gera interrupção
+ * nas duas bordas e a ISR carimba cada uma com esp_timer (1 µs). A task que
+ * mede fica bloqueada em task notification durante o voo do pulso, liberando
+ * a CPU (idle/WFI) - e a largura medida não depende de preempção da task.
+ *
+ * Cada instância mede um par TRIG/ECHO; várias instâncias (node_sensor_21)
+ * compartilham o serviço de ISR do GPIO. A task que chama
+ * aguada_sonar_measure() não deve usar a notificação (índice 0) para outra
+ * finalidade durante a medição.
+ *
+ * O serviço de ISR é instalado com ESP_INTR_FLAG_IRAM: a ISR roda mesmo com
+ * o cache da flash desligado (gravação em NVS/flash) e por isso só chama
+ * código em IRAM - gpio_ll_get_level (inline), esp_timer_get_time e
+ * vTaskNotifyGiveFromISR (IRAM com CONFIG_FREERTOS_PLACE_FUNCTIONS_INTO_FLASH
+ * desligado, o padrão). A instância aguada_sonar_t precisa estar em RAM
+ * interna (estática ou na pilha, nunca em PSRAM).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "driver/gpio.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+
+#define AGUADA_SONAR_TIMEOUT (-1) // Sem eco (ou pulso maior que o timeout)
+
+typedef struct
+{
+    gpio_num_t trig_pin;
+    gpio_num_t echo_pin;
+    uint32_t timeout_us;          // Máximo para o eco começar e para a largura do pulso
+    volatile int64_t rise_us;     // Borda de subida (escrito pela ISR)
+    volatile int64_t fall_us;     // Borda de descida (escrito pela ISR)
+    volatile TaskHandle_t waiter; // Task bloqueada na medição (NULL = desarmado)
+    uint32_t timeouts;            // Medições sem eco
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_handle_t pm_lock; // Impede light-sleep durante o voo (clock do timer)
+#endif
+} aguada_sonar_t;
+
+/**
+ * Configura TRIG (saída) e ECHO (entrada com interrupção nas duas bordas)
+ * e registra a ISR. Instala o serviço de ISR do GPIO se necessário.
+ */
+esp_err_t aguada_sonar_init(aguada_sonar_t *sonar, gpio_num_t trig_pin, gpio_num_t echo_pin, uint32_t timeout_us);
+
+/**
+ * Dispara o sensor e bloqueia até a borda de descida do eco
+ *
+ * @return largura do pulso de eco em µs, ou AGUADA_SONAR_TIMEOUT
+ */
+int32_t aguada_sonar_measure(aguada_sonar_t *sonar);
+
+/**
+ * Largura do eco (µs) → distância (mm), som a 343 m/s, ida e volta,
+ * arredondado ao mm mais próximo
+ */
+static inline int32_t aguada_sonar_us_to_mm(int32_t echo_us)
+{
+    return (int32_t)(((int64_t)echo_us * 343 + 1000) / 2000);
+}
@@ -0,0 +1,144 @@
+/**
+ * AGUADA - Circuit breaker e controle de fluxo AIMD do uplink do gateway
+ */
+
+#include "aguada_uplink.h"
+
+#include <string.h>
+
+static void enter(aguada_uplink_t *up, aguada_uplink_state_t state, int64_t now_us)
+{
+    up->state_us[up->state] += now_us - up->state_since_us;
+    up->state = state;
+    up->state_since_us = now_us;
+    up->transitions++;
+}
+
+/**
+ * Abre o circuito por open_ms (ou pelo Retry-After, se maior)
+ */
+static void trip(aguada_uplink_t *up, uint32_t retry_after_ms, int64_t now_us)
+{
+    uint32_t wait_ms = (retry_after_ms > up->open_ms) ? retry_after_ms : up->open_ms;
+    if (wait_ms > up->cfg->open_max_ms)
+    {
+        wait_ms = up->cfg->open_max_ms;
+    }
+
+    enter(up, AGUADA_UPLINK_OPEN, now_us);
+    up->opens++;
+    up->failures = 0;
+    up->probe_at_us = now_us + (int64_t)wait_ms * 1000;
+}
+
+void aguada_uplink_init(aguada_uplink_t *up, const aguada_uplink_config_t *cfg, int64_t now_us)
+{
+    memset(up, 0, sizeof(*up));
+    up->cfg = cfg;
+    up->state = AGUADA_UPLINK_CLOSED;
+    up->state_since_us = now_us;
+    up->open_ms = cfg->open_ms;
+    up->batch = cfg->batch_max;
+    up->interval_ms = cfg->interval_min_ms;
+    up->send_at_us = now_us;
+}
+
+bool aguada_uplink_allow(aguada_uplink_t *up, int64_t now_us)
+{
+    if (up->state != AGUADA_UPLINK_OPEN)
+    {
+        return true;
+    }
+    if (now_us < up->probe_at_us)
+    {
+        return false;
+    }
+
+    enter(up, AGUADA_UPLINK_HALF_OPEN, now_us);
+    up->probes++;
+    return true;
+}
+
+int64_t aguada_uplink_deadline(const aguada_uplink_t *up)
+{
+    return (up->state == AGUADA_UPLINK_OPEN) ? up->probe_at_us : up->send_at_us;
+}
+
+bool aguada_uplink_report(aguada_uplink_t *up, int status, uint32_t retry_after_ms, int64_t now_us)
+{
+    aguada_uplink_state_t before = up->state;
+    const aguada_uplink_config_t *cfg = up->cfg;
+
+    if (status == 429 || status == 503)
+    {
+        // Multiplicative decrease: metade do lote, dobro do intervalo
+        up->throttled++;
+        up->batch = (up->batch > 1) ? up->batch / 2 : 1;
+
+        uint32_t interval = up->interval_ms ? up->interval_ms * 2 : cfg->interval_step_ms;
+        if (interval < retry_after_ms)
+        {
+            interval = retry_after_ms;
+        }
+        up->interval_ms = (interval > cfg->interval_max_ms) ? cfg->interval_max_ms : interval;
+    }
+    else if (status >= 200 && status < 500)
+    {
+        // Additive increase
+        if (up->batch < cfg->batch_max)
+        {
+            up->batch++;
+        }
+        up->interval_ms = (up->interval_ms > cfg->interval_min_ms + cfg->interval_step_ms)
+                              ? up->interval_ms - cfg->interval_step_ms
+                              : cfg->interval_min_ms;
+
+        up->failures = 0;
+        if (up->state == AGUADA_UPLINK_HALF_OPEN)
+        {
+            up->open_ms = cfg->open_ms;
+            enter(up, AGUADA_UPLINK_CLOSED, now_us);
+        }
+        up->send_at_us = now_us + (int64_t)up->interval_ms * 1000;
+        return up->state != before;
+    }
+
+    up->send_at_us = now_us + (int64_t)up->interval_ms * 1000;
+
+    if (up->state == AGUADA_UPLINK_HALF_OPEN)
+    {
+        // Sonda falhou: espera dobra até open_max_ms
+        up->open_ms = (up->open_ms > cfg->open_max_ms / 2) ? cfg->open_max_ms : up->open_ms * 2;
+        trip(up, retry_after_ms, now_us);
+    }
+    else if (up->state == AGUADA_UPLINK_CLOSED && ++up->failures >= cfg->failure_threshold)
+    {
+        trip(up, retry_after_ms, now_us);
+    }
+    return up->state != before;
+}
+
+int64_t aguada_uplink_state_ms(const aguada_uplink_t *up, aguada_uplink_state_t state, int64_t now_us)
+{
+    int64_t total_us = up->state_us[state];
+    if (up->state == state)
+    {
+        total_us += now_us - up->state_since_us;
+    }
+    return total_us / 1000;
+}
+
+const char *aguada_uplink_state_name(aguada_uplink_state_t state)
+{
+    switch (state)
+    {
+    case AGUADA_UPLINK_CLOSED:
+        return "closed";
+    case AGUADA_UPLINK_OPEN:
+        return "open";
+    case AGUADA_UPLINK_HALF_OPEN:
+        return "half_open";
+    default:
+        return "?";
+    }
+}
@@ -0,0 +1,219 @@
+/**
+ * AGUADA - Bench de host do circuit breaker/AIMD do uplink
+ *
+ * Confere as transições do circuito e o ritmo AIMD, e simula uma queda do
+ * backend: um envio por segundo, backend fora do ar por 5 minutos, cada
+ * falha custando um timeout HTTP inteiro. Compara tentativas de rede e
+ * tempo da task bloqueada em timeouts sem e com o circuito, e o atraso até
+ * o primeiro envio após a volta. Aborta se qualquer conferência falhar.
+ *
+ * Uso: uplink_bench
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "aguada_uplink.h"
+
+#define CHECK(cond)                                                     \
+    do                                                                  \
+    {                                                                   \
+        if (!(cond))                                                    \
+        {                                                               \
+            fprintf(stderr, "FALHA %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                    \
+        }                                                               \
+    } while (0)
+
+#define S(x) ((int64_t)(x) * 1000000)
+
+static const aguada_uplink_config_t cfg = {
+    .failure_threshold = 3,
+    .open_ms = 5000,
+    .open_max_ms = 60000,
+    .batch_max = 10,
+    .interval_min_ms = 0,
+    .interval_max_ms = 10000,
+    .interval_step_ms = 250,
+};
+
+// ============================================================================
+// CONFERÊNCIAS
+// ============================================================================
+
+static void self_check(void)
+{
+    aguada_uplink_t up;
+
+    // Circuito: abre na 3ª falha seguida, sucesso zera a contagem
+    aguada_uplink_init(&up, &cfg, 0);
+    CHECK(aguada_uplink_allow(&up, 0));
+    CHECK(!aguada_uplink_report(&up, -1, 0, S(1)));
+    CHECK(!aguada_uplink_report(&up, 500, 0, S(2)));
+    CHECK(!aguada_uplink_report(&up, 201, 0, S(3)));
+    CHECK(up.failures == 0);
+    CHECK(!aguada_uplink_report(&up, -1, 0, S(4)));
+    CHECK(!aguada_uplink_report(&up, -1, 0, S(5)));
+    CHECK(aguada_uplink_report(&up, -1, 0, S(6)));
+    CHECK(up.state == AGUADA_UPLINK_OPEN && up.opens == 1);
+
+    // Aberto: nega até open_ms, depois uma sonda (meio-aberto)
+    CHECK(aguada_uplink_deadline(&up) == S(11));
+    CHECK(!aguada_uplink_allow(&up, S(10)));
+    CHECK(aguada_uplink_allow(&up, S(11)));
+    CHECK(up.state == AGUADA_UPLINK_HALF_OPEN && up.probes == 1);
+
+    // Sonda falha: aberto de novo, espera dobra (10 s)
+    CHECK(aguada_uplink_report(&up, -1, 0, S(12)));
+    CHECK(up.state == AGUADA_UPLINK_OPEN && aguada_uplink_deadline(&up) == S(22));
+    CHECK(aguada_uplink_allow(&up, S(22)));
+
+    // Sonda ok: fechado, espera volta a open_ms
+    CHECK(aguada_uplink_report(&up, 200, 0, S(23)));
+    CHECK(up.state == AGUADA_UPLINK_CLOSED && up.open_ms == cfg.open_ms);
+    CHECK(up.transitions == 5);
+
+    // Tempo por estado: fechado 0-6 e 23-30, aberto 6-11 e 12-22, meio 11-12 e 22-23
+    CHECK(aguada_uplink_state_ms(&up, AGUADA_UPLINK_CLOSED, S(30)) == 13000);
+    CHECK(aguada_uplink_state_ms(&up, AGUADA_UPLINK_OPEN, S(30)) == 15000);
+    CHECK(aguada_uplink_state_ms(&up, AGUADA_UPLINK_HALF_OPEN, S(30)) == 2000);
+
+    // Espera da sonda satura em open_max_ms
+    for (int i = 0; i < 10; i++)
+    {
+        while (up.state != AGUADA_UPLINK_OPEN)
+        {
+            aguada_uplink_report(&up, -1, 0, S(40));
+        }
+        CHECK(aguada_uplink_allow(&up, up.probe_at_us));
+    }
+    CHECK(up.open_ms == cfg.open_max_ms);
+
+    // 4xx de conteúdo prova o backend vivo
+    aguada_uplink_init(&up, &cfg, 0);
+    for (int i = 0; i < 5; i++)
+    {
+        aguada_uplink_report(&up, 400, 0, S(i));
+    }
+    CHECK(up.state == AGUADA_UPLINK_CLOSED && up.failures == 0);
+
+    // AIMD: 429 corta o lote pela metade e respeita o Retry-After
+    aguada_uplink_init(&up, &cfg, 0);
+    CHECK(up.batch == 10 && up.interval_ms == 0);
+    aguada_uplink_report(&up, 429, 0, S(1));
+    CHECK(up.batch == 5 && up.interval_ms == 250 && up.throttled == 1);
+    aguada_uplink_report(&up, 503, 3000, S(2));
+    CHECK(up.batch == 2 && up.interval_ms == 3000);
+    CHECK(aguada_uplink_deadline(&up) == S(5));
+    aguada_uplink_report(&up, 429, 0, S(5));
+    aguada_uplink_report(&up, 429, 0, S(6));
+    CHECK(up.batch == 1 && up.interval_ms == cfg.interval_max_ms);
+    CHECK(up.state == AGUADA_UPLINK_OPEN); // 4 respostas 429/503 seguidas
+
+    // Retry-After acima do teto não prende o circuito além de open_max_ms
+    aguada_uplink_init(&up, &cfg, 0);
+    for (int i = 0; i < 3; i++)
+    {
+        aguada_uplink_report(&up, 503, 3600000, 0);
+    }
+    CHECK(up.state == AGUADA_UPLINK_OPEN && aguada_uplink_deadline(&up) == S(60));
+
+    // Additive increase: +1 no lote e -step no intervalo por sucesso
+    aguada_uplink_init(&up, &cfg, 0);
+    aguada_uplink_report(&up, 429, 1000, 0);
+    CHECK(up.batch == 5 && up.interval_ms == 1000);
+    for (int i = 0; i < 3; i++)
+    {
+        aguada_uplink_report(&up, 200, 0, S(1 + i));
+    }
+    CHECK(up.batch == 8 && up.interval_ms == 250);
+    for (int i = 0; i < 3; i++)
+    {
+        aguada_uplink_report(&up, 200, 0, S(4 + i));
+    }
+    CHECK(up.batch == 10 && up.interval_ms == 0);
+}
+
+// ============================================================================
+// SIMULAÇÃO DE QUEDA
+// ============================================================================
+
+enum
+{
+    SIM_END_S = 600,
+    DOWN_FROM_S = 60,
+    DOWN_UNTIL_S = 360,
+    TIMEOUT_S = 3, // HTTP_TIMEOUT_MS do gateway
+};
+
+typedef struct
+{
+    int attempts;    // Envios que tocaram a rede
+    int failed;      // Envios que falharam (cada um = um timeout)
+    int diverted;    // Envios desviados sem rede (circuito aberto)
+    int recovery_s;  // Atraso do primeiro sucesso após a volta do backend
+} sim_result_t;
+
+static sim_result_t simulate(bool breaker)
+{
+    sim_result_t r = {0};
+    aguada_uplink_t up;
+    aguada_uplink_init(&up, &cfg, 0);
+
+    r.recovery_s = -1;
+    int64_t busy_until = 0;
+    for (int t = 0; t < SIM_END_S; t++)
+    {
+        int64_t now = S(t);
+        if (now < busy_until)
+        {
+            continue; // Task presa num timeout: o envio deste segundo espera no ring
+        }
+        if (breaker && !aguada_uplink_allow(&up, now))
+        {
+            r.diverted++;
+            continue;
+        }
+
+        bool down = (t >= DOWN_FROM_S && t < DOWN_UNTIL_S);
+        r.attempts++;
+        if (down)
+        {
+            r.failed++;
+            busy_until = now + S(TIMEOUT_S);
+            aguada_uplink_report(&up, -1, 0, busy_until);
+        }
+        else
+        {
+            aguada_uplink_report(&up, 200, 0, now);
+            if (t >= DOWN_UNTIL_S && r.recovery_s < 0)
+            {
+                r.recovery_s = t - DOWN_UNTIL_S;
+            }
+        }
+    }
+    return r;
+}
+
+int main(void)
+{
+    self_check();
+    printf("aguada_uplink bench (1 envio/s, backend fora do ar de %ds a %ds, timeout %ds)\n",
+           DOWN_FROM_S, DOWN_UNTIL_S, TIMEOUT_S);
+
+    sim_result_t plain = simulate(false);
+    sim_result_t guarded = simulate(true);
+
+    printf("  %-14s %9s %7s %14s %10s %10s\n", "", "tentativas", "falhas", "bloqueado (s)", "desviados", "volta (s)");
+    printf("  %-14s %9d %7d %14d %10d %10d\n", "sem circuito", plain.attempts, plain.failed,
+           plain.failed * TIMEOUT_S, plain.diverted, plain.recovery_s);
+    printf("  %-14s %9d %7d %14d %10d %10d\n", "com circuito", guarded.attempts, guarded.failed,
+           guarded.failed * TIMEOUT_S, guarded.diverted, guarded.recovery_s);
+
+    // O circuito precisa cortar os timeouts na queda sem atrasar a volta além do teto da sonda
+    CHECK(guarded.failed * 5 <= plain.failed);
+    CHECK(guarded.recovery_s >= 0 && guarded.recovery_s <= (int)(cfg.open_max_ms / 1000));
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * AGUADA - Circuit breaker e controle de fluxo AIMD do uplink do gateway
+ *
+ * Com o backend fora do ar, cada envio gastava um timeout HTTP inteiro e
+ * cada pacote passava pelo retry heap antes de chegar ao flash log. O
+ * circuito tem três estados:
+ *
+ *   FECHADO  ──(failure_threshold falhas seguidas)──▶ ABERTO
+ *   ABERTO   ──(open_ms vencido: o próximo envio é a sonda)──▶ MEIO-ABERTO
+ *   MEIO-ABERTO ──(sucesso)──▶ FECHADO   ──(falha)──▶ ABERTO (open_ms dobra)
+ *
+ * Aberto, aguada_uplink_allow() nega envios e o gateway desvia os pacotes
+ * direto para o store-and-forward, sem tocar na rede.
+ *
+ * O ritmo segue AIMD sobre as respostas do backend: cada sucesso soma 1 ao
+ * lote e tira interval_step_ms do intervalo entre envios; 429/503 cortam o
+ * lote pela metade e dobram o intervalo (no mínimo o Retry-After). Erros
+ * de transporte contam para o circuito, mas não mexem no ritmo.
+ *
+ * Um só escritor (a task de uplink); leituras das métricas por outra task
+ * podem ver um campo meio atualizado. Sem dependências do ESP-IDF.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum
+{
+    AGUADA_UPLINK_CLOSED = 0,
+    AGUADA_UPLINK_OPEN,
+    AGUADA_UPLINK_HALF_OPEN,
+    AGUADA_UPLINK_STATES
+} aguada_uplink_state_t;
+
+typedef struct
+{
+    uint8_t failure_threshold; // Falhas seguidas que abrem o circuito
+    uint32_t open_ms;          // Espera inicial até a sonda
+    uint32_t open_max_ms;      // Teto da espera (e do Retry-After aceito)
+    uint8_t batch_max;         // Teto do lote (itens por envio)
+    uint32_t interval_min_ms;  // Intervalo mínimo entre envios
+    uint32_t interval_max_ms;  // Teto do intervalo após cortes
+    uint32_t interval_step_ms; // Redução aditiva do intervalo por sucesso
+} aguada_uplink_config_t;
+
+typedef struct
+{
+    const aguada_uplink_config_t *cfg;
+    aguada_uplink_state_t state;
+    uint8_t failures;                       // Falhas seguidas (fechado)
+    uint32_t open_ms;                       // Espera corrente até a sonda
+    int64_t state_since_us;                 // Entrada no estado atual
+    int64_t probe_at_us;                    // Próxima sonda (aberto)
+    int64_t state_us[AGUADA_UPLINK_STATES]; // Tempo em cada estado, sem o trecho atual
+    uint32_t transitions;                   // Mudanças de estado
+    uint32_t opens;                         // Aberturas do circuito
+    uint32_t probes;                        // Sondas (aberto → meio-aberto)
+    uint8_t batch;                          // Lote corrente (1..batch_max)
+    uint32_t interval_ms;                   // Intervalo corrente entre envios
+    int64_t send_at_us;                     // Próximo envio pelo ritmo AIMD
+    uint32_t throttled;                     // Respostas 429/503
+} aguada_uplink_t;
+
+/**
+ * Circuito fechado, lote em batch_max e intervalo em interval_min_ms
+ */
+void aguada_uplink_init(aguada_uplink_t *up, const aguada_uplink_config_t *cfg, int64_t now_us);
+
+/**
+ * true se um envio pode sair agora. Aberto com a espera vencida, passa a
+ * meio-aberto e o envio autorizado é a sonda.
+ */
+bool aguada_uplink_allow(aguada_uplink_t *up, int64_t now_us);
+
+/**
+ * Quando o próximo envio pode sair: a sonda (aberto) ou o ritmo AIMD
+ */
+int64_t aguada_uplink_deadline(const aguada_uplink_t *up);
+
+/**
+ * Resultado de um envio: status HTTP (>0) ou -1 em erro de transporte.
+ * 2xx e 4xx de conteúdo provam o backend vivo; 429/503 são
+ * contrapressão (retry_after_ms = Retry-After, 0 se ausente); o resto é
+ * falha.
+ *
+ * @return true se o estado do circuito mudou
+ */
+bool aguada_uplink_report(aguada_uplink_t *up, int status, uint32_t retry_after_ms, int64_t now_us);
+
+/**
+ * Tempo total (ms) em um estado, incluindo o trecho atual
+ */
+int64_t aguada_uplink_state_ms(const aguada_uplink_t *up, aguada_uplink_state_t state, int64_t now_us);
+
+/**
+ * Nome do estado para logs e métricas ("closed", "open", "half_open")
+ */
+const char *aguada_uplink_state_name(aguada_uplink_state_t state);
@@ -0,0 +1,569 @@
+/**
+ * AGUADA - Flash Log (store-and-forward)
+ *
+ * Ver flash_log.h para o formato. Resumo do anel:
+ *
+ *   tail (mais antigo pendente)            head (próxima gravação)
+ *        v                                      v
+ *   [S3: ....rrrr][S4: rrrrrrrrrrr][S5: rrrr.......][S6: vazio]...
+ *
+ * - A cabeça só avança; ao encher um setor, o próximo setor do anel é apagado.
+ *   Como todos os setores são reutilizados em ordem, o desgaste fica
+ *   uniforme em toda a partição (erase_count no cabeçalho de cada setor)
+ * - Log vazio não provoca apagamentos: a cabeça continua de onde parou
+ * - No boot, o setor com maior sequência é a cabeça; a cauda é o primeiro
+ *   registro gravado e não enviado em ordem de anel
+ */
+
+#include "flash_log.h"
+
+#include <string.h>
+#include <sys/time.h>
+
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+
+#include "aguada_proto.h"
+
+#define TAG "FLASH_LOG"
+
+// ============================================================================
+// FORMATO EM FLASH
+// ============================================================================
+
+#define LOG_SECTOR_SIZE 4096
+#define LOG_SECTOR_MAGIC 0x474C4741 // "AGLG"
+#define LOG_FORMAT_VERSION 2 // v2: instante da recepção no registro (v1 é descartado no boot)
+
+#define REC_STATE_FREE 0xFF     // Slot apagado
+#define REC_STATE_WRITTEN 0xFE  // Gravado, aguardando envio
+#define REC_STATE_CONSUMED 0x00 // Enviado (ou descartado)
+
+#define REC_CLOCK_UPTIME 0 // rx_ms = uptime no boot `boot`
+#define REC_CLOCK_WALL 1   // rx_ms = hora do relógio (Unix, ms)
+
+// Antes disso o relógio ainda não foi acertado pelo SNTP (2024-01-01)
+#define CLOCK_VALID_AFTER_S 1704067200
+
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;
+    uint32_t seq;         // Ordem de uso do setor no anel
+    uint32_t erase_count; // Apagamentos deste setor (desgaste)
+    uint16_t version;
+    uint16_t crc; // CRC16 dos campos anteriores
+} log_sector_hdr_t;
+
+typedef struct __attribute__((packed))
+{
+    uint8_t state; // REC_STATE_*
+    uint8_t version;
+    uint16_t len;
+    uint32_t seq;
+    uint8_t src_addr[6];
+    uint8_t clock; // REC_CLOCK_*
+    uint8_t reserved;
+    uint32_t boot; // Boot da gravação (REC_CLOCK_UPTIME)
+    int64_t rx_ms; // Recepção do payload
+    uint16_t crc;  // CRC16 de len..rx_ms + payload
+    uint16_t pad;
+} log_record_hdr_t;
+
+#define LOG_SECTOR_HDR_SIZE sizeof(log_sector_hdr_t)
+#define LOG_RECORD_HDR_SIZE sizeof(log_record_hdr_t)
+#define LOG_RECORD_SIZE (LOG_RECORD_HDR_SIZE + FLASH_LOG_PAYLOAD_MAX)
+#define LOG_SLOTS_PER_SECTOR ((LOG_SECTOR_SIZE - LOG_SECTOR_HDR_SIZE) / LOG_RECORD_SIZE)
+
+_Static_assert(sizeof(log_sector_hdr_t) == 16, "log_sector_hdr_t deve ter 16 bytes");
+_Static_assert(sizeof(log_record_hdr_t) == 32, "log_record_hdr_t deve ter 32 bytes");
+_Static_assert(LOG_SLOTS_PER_SECTOR == 14, "layout do setor mudou - revisar capacidade");
+
+// ============================================================================
+// ESTADO
+// ============================================================================
+
+static const esp_partition_t *log_part = NULL;
+static uint16_t sector_count = 0;
+
+static uint16_t head_sector = 0; // Próxima gravação
+static uint16_t head_slot = 0;
+static uint32_t head_sector_seq = 0;
+static uint16_t tail_sector = 0; // Registro pendente mais antigo (ou == head)
+static uint16_t tail_slot = 0;
+static uint32_t next_seq = 1;
+static uint32_t boot_id = 1; // Maior boot entre os pendentes + 1
+
+static flash_log_stats_t stats = {0};
+
+// Buffer de E/S de um registro (módulo é single-task)
+static uint8_t io_buf[LOG_RECORD_SIZE];
+
+// ============================================================================
+// UTILITIES
+// ============================================================================
+
+static uint16_t sector_hdr_crc(const log_sector_hdr_t *hdr)
+{
+    return aguada_crc16(hdr, offsetof(log_sector_hdr_t, crc));
+}
+
+static uint16_t record_crc(const log_record_hdr_t *hdr, const uint8_t *payload)
+{
+    uint16_t crc = aguada_crc16(&hdr->len, offsetof(log_record_hdr_t, crc) - offsetof(log_record_hdr_t, len));
+    return aguada_crc16_update(crc, payload, hdr->len);
+}
+
+static bool clock_valid(int64_t *wall_ms)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    *wall_ms = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    return tv.tv_sec >= CLOCK_VALID_AFTER_S;
+}
+
+/**
+ * Idade de um registro agora. Sem o relógio, um registro de outro boot tem
+ * pelo menos o uptime atual de idade (*exact = false).
+ */
+static int64_t record_age_ms(const log_record_hdr_t *hdr, bool *exact)
+{
+    int64_t uptime_ms = esp_timer_get_time() / 1000;
+    int64_t wall_ms;
+    bool wall = clock_valid(&wall_ms);
+
+    *exact = true;
+    if (hdr->clock == REC_CLOCK_WALL && wall)
+    {
+        return (wall_ms > hdr->rx_ms) ? wall_ms - hdr->rx_ms : 0;
+    }
+    if (hdr->clock == REC_CLOCK_UPTIME && hdr->boot == boot_id)
+    {
+        return (uptime_ms > hdr->rx_ms) ? uptime_ms - hdr->rx_ms : 0;
+    }
+    *exact = false;
+    return uptime_ms;
+}
+
+static inline size_t sector_offset(uint16_t sector)
+{
+    return (size_t)sector * LOG_SECTOR_SIZE;
+}
+
+static inline size_t slot_offset(uint16_t sector, uint16_t slot)
+{
+    return sector_offset(sector) + LOG_SECTOR_HDR_SIZE + (size_t)slot * LOG_RECORD_SIZE;
+}
+
+static inline uint16_t next_sector(uint16_t sector)
+{
+    return (uint16_t)((sector + 1) % sector_count);
+}
+
+static bool read_sector_hdr(uint16_t sector, log_sector_hdr_t *hdr)
+{
+    if (esp_partition_read(log_part, sector_offset(sector), hdr, sizeof(*hdr)) != ESP_OK)
+    {
+        return false;
+    }
+    return hdr->magic == LOG_SECTOR_MAGIC && hdr->crc == sector_hdr_crc(hdr);
+}
+
+/**
+ * Lê o cabeçalho de um slot e, se gravado, valida o payload (fica em io_buf)
+ *
+ * @return false em erro de leitura; *valid indica registro gravado e íntegro
+ */
+static bool read_record(uint16_t sector, uint16_t slot, log_record_hdr_t *hdr, bool *valid)
+{
+    *valid = false;
+    if (esp_partition_read(log_part, slot_offset(sector, slot), hdr, sizeof(*hdr)) != ESP_OK)
+    {
+        return false;
+    }
+    if (hdr->state != REC_STATE_WRITTEN)
+    {
+        return true;
+    }
+    if (hdr->len > FLASH_LOG_PAYLOAD_MAX ||
+        esp_partition_read(log_part, slot_offset(sector, slot) + LOG_RECORD_HDR_SIZE, io_buf, hdr->len) != ESP_OK)
+    {
+        return true;
+    }
+    *valid = (hdr->crc == record_crc(hdr, io_buf));
+    return true;
+}
+
+static void mark_consumed(uint16_t sector, uint16_t slot)
+{
+    uint8_t state = REC_STATE_CONSUMED;
+    esp_partition_write(log_part, slot_offset(sector, slot), &state, 1);
+}
+
+/**
+ * Apaga um setor e grava um cabeçalho novo com erase_count incrementado
+ */
+static esp_err_t format_sector(uint16_t sector, uint32_t seq)
+{
+    log_sector_hdr_t old;
+    uint32_t erase_count = read_sector_hdr(sector, &old) ? old.erase_count + 1 : 1;
+
+    esp_err_t err = esp_partition_erase_range(log_part, sector_offset(sector), LOG_SECTOR_SIZE);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Falha ao apagar setor %u: %s", sector, esp_err_to_name(err));
+        return err;
+    }
+
+    log_sector_hdr_t hdr = {
+        .magic = LOG_SECTOR_MAGIC,
+        .seq = seq,
+        .erase_count = erase_count,
+        .version = LOG_FORMAT_VERSION,
+    };
+    hdr.crc = sector_hdr_crc(&hdr);
+
+    if (erase_count > stats.max_erase)
+    {
+        stats.max_erase = erase_count;
+    }
+    return esp_partition_write(log_part, sector_offset(sector), &hdr, sizeof(hdr));
+}
+
+static inline bool cursor_at_head(const flash_log_cursor_t *cursor)
+{
+    return cursor->sector == head_sector && cursor->slot >= head_slot;
+}
+
+static inline void cursor_advance(flash_log_cursor_t *cursor)
+{
+    // No setor da cabeça o cursor para no fim (head_slot pode ser == SLOTS)
+    if (++cursor->slot >= LOG_SLOTS_PER_SECTOR && cursor->sector != head_sector)
+    {
+        cursor->slot = 0;
+        cursor->sector = next_sector(cursor->sector);
+    }
+}
+
+static void tail_reset_if_empty(void)
+{
+    if (stats.pending == 0)
+    {
+        tail_sector = head_sector;
+        tail_slot = head_slot;
+    }
+}
+
+/**
+ * Abre o próximo setor do anel para gravação. Se ele ainda contém
+ * registros pendentes (log cheio), eles são descartados e a cauda avança.
+ */
+static esp_err_t advance_head_sector(void)
+{
+    uint16_t next = next_sector(head_sector);
+
+    if (stats.pending > 0 && tail_sector == next)
+    {
+        uint32_t lost = 0;
+        for (uint16_t slot = 0; slot < LOG_SLOTS_PER_SECTOR; slot++)
+        {
+            log_record_hdr_t hdr;
+            bool valid;
+            if (read_record(next, slot, &hdr, &valid) && valid)
+            {
+                lost++;
+            }
+        }
+        stats.pending -= lost;
+        stats.overwritten += lost;
+        tail_sector = next_sector(next);
+        tail_slot = 0;
+        ESP_LOGW(TAG, "Log cheio - %lu registro(s) antigo(s) sobrescrito(s)", (unsigned long)lost);
+    }
+
+    esp_err_t err = format_sector(next, head_sector_seq + 1);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    head_sector_seq++;
+    head_sector = next;
+    head_slot = 0;
+    tail_reset_if_empty();
+    return ESP_OK;
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+esp_err_t flash_log_init(void)
+{
+    log_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                        FLASH_LOG_PARTITION_LABEL);
+    if (!log_part)
+    {
+        ESP_LOGE(TAG, "Partição '%s' não encontrada", FLASH_LOG_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    sector_count = (uint16_t)(log_part->size / LOG_SECTOR_SIZE);
+    if (sector_count < 2)
+    {
+        ESP_LOGE(TAG, "Partição muito pequena (%lu bytes)", (unsigned long)log_part->size);
+        log_part = NULL;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    stats.capacity = (uint32_t)sector_count * LOG_SLOTS_PER_SECTOR;
+
+    // 1. Cabeçalhos: setor com maior seq é a cabeça
+    bool found = false;
+    for (uint16_t sector = 0; sector < sector_count; sector++)
+    {
+        log_sector_hdr_t hdr;
+        if (!read_sector_hdr(sector, &hdr) || hdr.version != LOG_FORMAT_VERSION)
+        {
+            continue; // Vazio ou de formato anterior: reformatado quando a cabeça chegar nele
+        }
+        if (!found || hdr.seq > head_sector_seq)
+        {
+            head_sector = sector;
+            head_sector_seq = hdr.seq;
+            found = true;
+        }
+        if (hdr.erase_count > stats.max_erase)
+        {
+            stats.max_erase = hdr.erase_count;
+        }
+    }
+
+    if (!found)
+    {
+        ESP_LOGI(TAG, "Partição sem log - formatando setor 0");
+        head_sector = 0;
+        head_slot = 0;
+        head_sector_seq = 1;
+        next_seq = 1;
+        tail_reset_if_empty();
+        return format_sector(0, head_sector_seq);
+    }
+
+    // 2. Registros em ordem de anel (do setor após a cabeça até a cabeça):
+    //    conta pendentes, acha a cauda e a próxima posição de gravação
+    head_slot = 0;
+    uint16_t sector = next_sector(head_sector);
+    for (uint16_t n = 0; n < sector_count; n++, sector = next_sector(sector))
+    {
+        log_sector_hdr_t shdr;
+        if (!read_sector_hdr(sector, &shdr) || shdr.version != LOG_FORMAT_VERSION)
+        {
+            continue;
+        }
+
+        for (uint16_t slot = 0; slot < LOG_SLOTS_PER_SECTOR; slot++)
+        {
+            log_record_hdr_t hdr;
+            bool valid;
+            if (!read_record(sector, slot, &hdr, &valid) || hdr.state == REC_STATE_FREE)
+            {
+                continue;
+            }
+            if (sector == head_sector)
+            {
+                head_slot = slot + 1; // Grava após o último slot usado
+            }
+            if (hdr.state == REC_STATE_WRITTEN && !valid)
+            {
+                // Gravação interrompida (reset/queda de energia)
+                stats.crc_errors++;
+                mark_consumed(sector, slot);
+                continue;
+            }
+            if (hdr.seq >= next_seq)
+            {
+                next_seq = hdr.seq + 1;
+            }
+            if (hdr.state == REC_STATE_WRITTEN)
+            {
+                if (stats.pending == 0)
+                {
+                    tail_sector = sector;
+                    tail_slot = slot;
+                }
+                stats.pending++;
+                if (hdr.boot >= boot_id)
+                {
+                    boot_id = hdr.boot + 1; // Distinto de todo registro pendente
+                }
+            }
+        }
+    }
+    tail_reset_if_empty();
+
+    ESP_LOGI(TAG, "✓ Log '%s': %u setores, %lu pendente(s) de %lu, desgaste máx %lu, boot %lu",
+             FLASH_LOG_PARTITION_LABEL, sector_count, (unsigned long)stats.pending,
+             (unsigned long)stats.capacity, (unsigned long)stats.max_erase, (unsigned long)boot_id);
+    if (stats.crc_errors > 0)
+    {
+        ESP_LOGW(TAG, "%lu registro(s) corrompido(s) ignorado(s)", (unsigned long)stats.crc_errors);
+    }
+    return ESP_OK;
+}
+
+esp_err_t flash_log_append(const uint8_t *src_addr, const void *data, size_t len, int64_t rx_us)
+{
+    if (!log_part)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (len > FLASH_LOG_PAYLOAD_MAX)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (head_slot >= LOG_SLOTS_PER_SECTOR)
+    {
+        esp_err_t err = advance_head_sector();
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+    }
+
+    log_record_hdr_t hdr = {
+        .state = REC_STATE_WRITTEN,
+        .version = LOG_FORMAT_VERSION,
+        .len = (uint16_t)len,
+        .seq = next_seq,
+        .clock = REC_CLOCK_UPTIME,
+        .boot = boot_id,
+        .rx_ms = rx_us / 1000,
+    };
+    memcpy(hdr.src_addr, src_addr, sizeof(hdr.src_addr));
+
+    // Com o relógio acertado o instante vale em qualquer boot
+    int64_t wall_ms;
+    if (clock_valid(&wall_ms))
+    {
+        hdr.clock = REC_CLOCK_WALL;
+        hdr.rx_ms = wall_ms - (esp_timer_get_time() - rx_us) / 1000;
+    }
+    hdr.crc = record_crc(&hdr, data);
+
+    memcpy(io_buf, &hdr, LOG_RECORD_HDR_SIZE);
+    memcpy(io_buf + LOG_RECORD_HDR_SIZE, data, len);
+
+    // Slot consumido mesmo se a gravação falhar (bits já podem ter sido zerados)
+    uint16_t slot = head_slot++;
+    esp_err_t err = esp_partition_write(log_part, slot_offset(head_sector, slot), io_buf, LOG_RECORD_HDR_SIZE + len);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Falha ao gravar registro %lu: %s", (unsigned long)next_seq, esp_err_to_name(err));
+        return err;
+    }
+
+    if (stats.pending == 0)
+    {
+        tail_sector = head_sector;
+        tail_slot = slot;
+    }
+    next_seq++;
+    stats.pending++;
+    stats.appended++;
+    return ESP_OK;
+}
+
+void flash_log_cursor_begin(flash_log_cursor_t *cursor)
+{
+    cursor->sector = tail_sector;
+    cursor->slot = tail_slot;
+}
+
+bool flash_log_read_next(flash_log_cursor_t *cursor, flash_log_record_t *out)
+{
+    if (!log_part)
+    {
+        return false;
+    }
+
+    while (!cursor_at_head(cursor))
+    {
+        uint16_t sector = cursor->sector;
+        uint16_t slot = cursor->slot;
+        cursor_advance(cursor);
+
+        log_record_hdr_t hdr;
+        bool valid;
+        if (!read_record(sector, slot, &hdr, &valid) || hdr.state != REC_STATE_WRITTEN)
+        {
+            continue;
+        }
+        if (!valid)
+        {
+            // Corrompido após o boot: tira do caminho para não travar o dreno
+            stats.crc_errors++;
+            if (stats.pending > 0)
+            {
+                stats.pending--;
+            }
+            mark_consumed(sector, slot);
+            continue;
+        }
+
+        out->seq = hdr.seq;
+        memcpy(out->src_addr, hdr.src_addr, sizeof(out->src_addr));
+        out->len = hdr.len;
+        out->age_ms = record_age_ms(&hdr, &out->age_exact);
+        memcpy(out->payload, io_buf, hdr.len);
+        return true;
+    }
+    return false;
+}
+
+esp_err_t flash_log_consume(int count)
+{
+    if (!log_part)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    flash_log_cursor_t cursor;
+    flash_log_cursor_begin(&cursor);
+
+    while (count > 0 && !cursor_at_head(&cursor))
+    {
+        log_record_hdr_t hdr;
+        if (esp_partition_read(log_part, slot_offset(cursor.sector, cursor.slot), &hdr, sizeof(hdr)) == ESP_OK &&
+            hdr.state == REC_STATE_WRITTEN)
+        {
+            mark_consumed(cursor.sector, cursor.slot);
+            count--;
+            stats.pending--;
+            stats.consumed++;
+        }
+        cursor_advance(&cursor);
+    }
+
+    tail_sector = cursor.sector;
+    tail_slot = cursor.slot;
+    tail_reset_if_empty();
+    return ESP_OK;
+}
+
+bool flash_log_clock_valid(void)
+{
+    int64_t wall_ms;
+    return clock_valid(&wall_ms);
+}
+
+uint32_t flash_log_pending(void)
+{
+    return stats.pending;
+}
+
+void flash_log_get_stats(flash_log_stats_t *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,109 @@
+/**
+ * AGUADA - Flash Log (store-and-forward)
+ *
+ * Log circular append-only em partição dedicada ("aguada_log") para guardar
+ * leituras durante quedas de WiFi/backend e reenviá-las depois.
+ *
+ * Layout:
+ * - Setores de 4 KB usados em anel; cada setor tem um cabeçalho com
+ *   sequência e contador de apagamentos (wear)
+ * - Registros de tamanho fixo com número de sequência e CRC16
+ * - Estado do registro (livre/gravado/enviado) é um byte que só perde bits,
+ *   então marcar como enviado não exige apagar o setor
+ * - Instante da recepção em cada registro, válido entre reboots: hora do
+ *   relógio (após SNTP) ou, sem ela, boot + uptime. Na leitura vira a idade
+ *   do registro, que o dreno soma ao "age_ms" do payload
+ *
+ * Não é thread-safe: todas as chamadas devem vir da mesma task
+ * (http_post_task). Nunca chamar a partir do callback ESP-NOW.
+ * Exceção: flash_log_get_stats() só copia contadores (métricas).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define FLASH_LOG_PARTITION_LABEL "aguada_log"
+#define FLASH_LOG_PAYLOAD_MAX 256
+
+/**
+ * Registro lido do log
+ */
+typedef struct
+{
+    uint32_t seq;
+    uint8_t src_addr[6];
+    uint16_t len;
+    int64_t age_ms; // Desde a recepção (ver age_exact)
+    bool age_exact; // false: gravado em outro boot sem hora do relógio - age_ms é só o mínimo (uptime atual)
+    char payload[FLASH_LOG_PAYLOAD_MAX];
+} flash_log_record_t;
+
+/**
+ * Posição de leitura (iterador a partir do registro mais antigo)
+ */
+typedef struct
+{
+    uint16_t sector;
+    uint16_t slot;
+} flash_log_cursor_t;
+
+typedef struct
+{
+    uint32_t capacity;     // Registros que cabem na partição
+    uint32_t pending;      // Registros gravados e ainda não enviados
+    uint32_t appended;     // Registros gravados desde o boot
+    uint32_t consumed;     // Registros marcados como enviados desde o boot
+    uint32_t overwritten;  // Registros pendentes perdidos por log cheio
+    uint32_t crc_errors;   // Registros corrompidos ignorados
+    uint32_t max_erase;    // Maior contador de apagamentos entre os setores
+} flash_log_stats_t;
+
+/**
+ * Monta a partição e reconstrói cabeça/cauda a partir dos cabeçalhos
+ *
+ * @return ESP_ERR_NOT_FOUND se a partição não existir na tabela
+ */
+esp_err_t flash_log_init(void);
+
+/**
+ * Grava um registro no fim do log. Se o log estiver cheio, o setor mais
+ * antigo é apagado (os registros pendentes nele são perdidos).
+ *
+ * @param rx_us Instante (esp_timer_get_time) a partir do qual o payload
+ *              envelhece: o "age_ms" dele (ou 0) vale nesse instante
+ */
+esp_err_t flash_log_append(const uint8_t *src_addr, const void *data, size_t len, int64_t rx_us);
+
+/**
+ * Posiciona o cursor no registro pendente mais antigo
+ */
+void flash_log_cursor_begin(flash_log_cursor_t *cursor);
+
+/**
+ * Lê o próximo registro pendente e avança o cursor
+ *
+ * @return false quando não há mais registros
+ */
+bool flash_log_read_next(flash_log_cursor_t *cursor, flash_log_record_t *out);
+
+/**
+ * Marca os `count` registros pendentes mais antigos como enviados
+ */
+esp_err_t flash_log_consume(int count);
+
+/**
+ * Relógio acertado (SNTP): idades de registros de boots anteriores exatas
+ */
+bool flash_log_clock_valid(void);
+
+/**
+ * Registros aguardando envio
+ */
+uint32_t flash_log_pending(void);
+
+void flash_log_get_stats(flash_log_stats_t *out);
@@ -11,8 +11,11 @@
  * ESP32-C3 SuperMini
  */
 
+#include <stdarg.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 
 #include "esp_wifi.h"
@@ -21,227 +24,1594 @@
 #include "esp_log.h"
 #include "esp_mac.h"
 #include "esp_netif.h"
+#include "esp_netif_sntp.h"
 #include "esp_http_client.h"
 
 #include "nvs_flash.h"
 #include "driver/gpio.h"
 #include "esp_timer.h"
-#include "freertos/queue.h"
 #include "freertos/task.h"
 
+#include "aguada_proto.h"
+#include "aguada_ring.h"
+#include "flash_log.h"
+#include "mqtt_sink.h"
+#include "aguada_edge.h"
+#include "aguada_lanes.h"
+#include "aguada_link_table.h"
+#include "aguada_node_table.h"
+#include "aguada_uplink.h"
+
 #define TAG "AGUADA_GATEWAY"
 
-// ============================================================================
-// CONFIGURAÇÕES
-// ============================================================================
+// ============================================================================
+// CONFIGURAÇÕES
+// ============================================================================
+
+#define WIFI_SSID "luciano"
+#define WIFI_PASS "Luciano19852012"
+#define BACKEND_URL "http://192.168.0.117:3002/api/telemetry"
+#define BACKEND_BATCH_URL "http://192.168.0.117:3002/api/telemetry/batch"
+#define METRICS_URL "http://192.168.0.117:3002/api/gateway/metrics"
+#define ESPNOW_CHANNEL 11         // Fixed channel for SSID "luciano"
+#define METRICS_INTERVAL_MS 60000 // Enviar métricas a cada 60 segundos
+#define LED_BUILTIN GPIO_NUM_2    // ESP32 DevKit V1 uses GPIO2 for LED (GPIO8 is invalid on ESP32)
+#define HEARTBEAT_INTERVAL_MS 3000
+#define MAX_PAYLOAD_SIZE 256
+#define ESPNOW_RING_SIZE 64 // Slots do ring callback → worker, lane de rotina (potência de 2)
+#define LINK_REPORT_INTERVAL_MS 30000 // Relatório RSSI/perda: no máximo um por node neste intervalo
+#define MAX_RETRY_ATTEMPTS 3
+#define RETRY_BACKOFF_BASE_MS 1000 // 1s, 2s, 4s
+#define RETRY_BACKOFF_MAX_MS 8000
+#define RETRY_HEAP_SIZE 32         // Pacotes aguardando nova tentativa
+#define RETRY_MAX_AGE_MS 60000     // Idade máxima de um pacote (desde a recepção)
+#define UPLOAD_AGE_MIN_MS 1000     // Espera até o envio a partir da qual o item ganha "age_ms"
+#define HTTP_TIMEOUT_MS 3000
+#define HTTP_KEEPALIVE_IDLE_S 5     // TCP keep-alive: início das sondas após 5s ocioso
+#define HTTP_KEEPALIVE_INTERVAL_S 5 // Intervalo entre sondas
+#define HTTP_KEEPALIVE_COUNT 3      // Sondas sem resposta antes de derrubar a conexão
+
+// Upload em lote: drena até BATCH_MAX_PACKETS da fila (ou espera no máximo
+// BATCH_MAX_WAIT_MS após o primeiro pacote) e envia tudo como um JSON array
+#define USE_BATCH_UPLOAD 1
+#define BATCH_MAX_PACKETS 10
+#define BATCH_MAX_WAIT_MS 500
+
+// Store-and-forward em flash: pacotes que não puderam ser enviados (WiFi fora,
+// tentativas esgotadas) vão para a partição "aguada_log" e são drenados em lotes
+// após reconectar. Intervalo entre lotes respeita o rate limit do backend (60 req/min)
+#define USE_FLASH_LOG 1
+#define FLASH_LOG_DRAIN_INTERVAL_MS 2000
+#define FLASH_LOG_RETRY_MS 10000 // Espera após falha de um lote drenado
+// Hora do relógio para os registros: com ela a idade de um registro vale entre
+// reboots; sem ela (servidor "" ou sem acesso), só dentro do mesmo boot. O dreno
+// segura registros de outro boot até FLASH_LOG_CLOCK_WAIT_MS de uptime à espera
+// do SNTP; depois disso eles saem com a idade mínima (o uptime atual)
+#define SNTP_SERVER "pool.ntp.org"
+#define FLASH_LOG_CLOCK_WAIT_MS 60000
+
+// Circuit breaker do uplink: após UPLINK_BREAKER_FAILURES falhas seguidas o
+// circuito abre e os pacotes vão direto para o flash log, sem esperar timeouts.
+// O próximo envio após UPLINK_BREAKER_OPEN_MS é a sonda; cada sonda que falha
+// dobra a espera, até UPLINK_BREAKER_OPEN_MAX_MS
+#define UPLINK_BREAKER_FAILURES 3
+#define UPLINK_BREAKER_OPEN_MS 5000
+#define UPLINK_BREAKER_OPEN_MAX_MS 60000
+
+// Ritmo AIMD: cada sucesso aumenta o lote em 1 e reduz o intervalo entre envios
+// em UPLINK_PACE_STEP_MS; 429/503 cortam o lote pela metade e dobram o intervalo
+// (no mínimo o Retry-After), até UPLINK_PACE_MAX_MS
+#define UPLINK_PACE_MIN_MS 0
+#define UPLINK_PACE_MAX_MS 10000
+#define UPLINK_PACE_STEP_MS 250
+
+// Lanes de prioridade: alarmes (FLAG_ERROR/FLAG_LOW_BATTERY, distance_mm 0/1,
+// nodes de PRIORITY_NODES) vão num ring próprio, servido antes da rotina, na
+// frente dos retries, e fecham o lote na hora. Depois de LANE_BURST_MAX
+// alarmes seguidos a rotina leva uma entrega. Num envio com alarme o ritmo
+// AIMD segura no máximo ALARM_PACE_MAX_MS
+#define ALARM_RING_SIZE 16 // Slots da lane de alarmes (potência de 2)
+#define LANE_BURST_MAX 8
+#define ALARM_PACE_MAX_MS 1000
+
+// Compressão na borda: a regra de compression.service.js (deadband, janela de
+// estabilidade) roda aqui por sensor; leituras que só estenderiam o período
+// no backend não sobem. Uma por EDGE_KEEPALIVE_MS sobe como "hold" para o
+// sensor não cair em warning no status.service (60 s). Desligada por padrão:
+// muda o que chega a leituras_raw (só mudanças e keep-alives)
+#define USE_EDGE_COMPRESSION 0
+#define EDGE_DEADBAND_MM 20  // DEADBAND_CM = 2.0
+#define EDGE_STABILITY_MM 5  // STABILITY_STDDEV = 0.5 cm
+#define EDGE_WINDOW 11       // WINDOW_SIZE
+#define EDGE_KEEPALIVE_MS 55000
+
+// Sink do uplink: HTTP (backend direto) ou MQTT (broker Mosquitto).
+// MQTT: sessão persistente, QoS1 com janela de in-flight, um publish por node
+// por lote em MQTT_TOPIC_PREFIX/<MAC> (JSON array das leituras)
+#define UPLINK_SINK_HTTP 0
+#define UPLINK_SINK_MQTT 1
+#define UPLINK_SINK UPLINK_SINK_HTTP
+#define MQTT_BROKER_URI "mqtt://192.168.0.117:1883"
+#define MQTT_TOPIC_PREFIX "aguada/telemetry"
+#define MQTT_INFLIGHT_MAX 8       // Publicações sem PUBACK
+#define MQTT_WINDOW_WAIT_MS 500   // Espera máxima por janela antes de ir para retry
+
+#if UPLINK_SINK == UPLINK_SINK_MQTT
+#define UPLINK_NAME "MQTT"
+#else
+#define UPLINK_NAME "HTTP"
+#endif
+
+#if USE_BATCH_UPLOAD
+#define UPLOAD_URL BACKEND_BATCH_URL
+#define UPLOAD_MAX_ITEMS BATCH_MAX_PACKETS
+#else
+#define UPLOAD_URL BACKEND_URL
+#define UPLOAD_MAX_ITEMS 1
+#endif
+
+// ============================================================================
+// TYPES
+// ============================================================================
+
+typedef enum
+{
+    LANE_ALARM = 0, // Alarmes e nodes prioritários
+    LANE_ROUTINE,   // Telemetria de rotina
+    LANE_COUNT,
+} gateway_lane_t;
+
+typedef struct
+{
+    uint8_t src_addr[6];
+    char payload[MAX_PAYLOAD_SIZE];
+    int len;
+    int8_t rssi;   // RSSI medido na recepção (rx_ctrl)
+    int64_t rx_us; // Recepção (callback)
+} espnow_packet_t;
+
+/**
+ * Pacote em trânsito para o backend (novo ou aguardando retry)
+ */
+typedef struct
+{
+    espnow_packet_t packet;
+    int64_t first_seen_us;   // Recepção original (limite RETRY_MAX_AGE_MS)
+    int64_t age_ref_us;      // Instante em que o "age_ms" do payload (ou 0, sem o campo) vale
+    int64_t next_attempt_us; // Prazo da próxima tentativa (chave do heap)
+    uint8_t attempts;        // Tentativas já realizadas
+} upload_item_t;
+
+_Static_assert(MAX_PAYLOAD_SIZE <= FLASH_LOG_PAYLOAD_MAX, "payload não cabe num registro do flash log");
+
+// ============================================================================
+// GLOBALS
+// ============================================================================
+
+static uint8_t gateway_mac[6];
+static bool wifi_connected = false;
+static int64_t last_heartbeat = 0;
+// Note: last_metrics_send removed - metrics_task uses vTaskDelay instead
+static bool led_state = false;
+
+// Rings SPSC por lane: espnow_recv_cb escreve direto no slot, http_post_task
+// lê por ponteiro (aguada_lanes escolhe a lane)
+static espnow_packet_t espnow_slots[ESPNOW_RING_SIZE];
+static aguada_ring_t espnow_ring;
+static espnow_packet_t alarm_slots[ALARM_RING_SIZE];
+static aguada_ring_t alarm_ring;
+static aguada_lanes_t lanes;
+static const char *const LANE_NAMES[LANE_COUNT] = {"alarm", "routine"};
+
+// Nodes sempre na lane de alarmes (ex.: sensor da reserva de incêndio): MAC
+// de rádio "XX:XX:XX:XX:XX:XX"; entradas vazias são ignoradas
+static const char *const PRIORITY_NODES[] = {
+    "",
+};
+static uint8_t priority_macs[sizeof(PRIORITY_NODES) / sizeof(PRIORITY_NODES[0])][6];
+static int priority_count = 0;
+
+// Cliente HTTP persistente (keep-alive) - usado apenas pela http_post_task
+static esp_http_client_handle_t http_client = NULL;
+static bool http_client_used = false; // Conexão atual já completou ao menos uma requisição
+static uint32_t http_retry_after_ms = 0; // Retry-After da última resposta (0 = ausente)
+
+// Circuit breaker + ritmo AIMD do uplink - escrito apenas pela http_post_task
+static const aguada_uplink_config_t uplink_cfg = {
+    .failure_threshold = UPLINK_BREAKER_FAILURES,
+    .open_ms = UPLINK_BREAKER_OPEN_MS,
+    .open_max_ms = UPLINK_BREAKER_OPEN_MAX_MS,
+    .batch_max = UPLOAD_MAX_ITEMS,
+    .interval_min_ms = UPLINK_PACE_MIN_MS,
+    .interval_max_ms = UPLINK_PACE_MAX_MS,
+    .interval_step_ms = UPLINK_PACE_STEP_MS,
+};
+static aguada_uplink_t uplink;
+
+// Itens do envio corrente e corpo HTTP montado a partir deles
+// Lote: "[" + N payloads separados por "," + "]"
+static upload_item_t upload_items[UPLOAD_MAX_ITEMS];
+static char upload_body[UPLOAD_MAX_ITEMS * MAX_PAYLOAD_SIZE + 2];
+
+// Retry scheduler: min-heap de índices em retry_pool ordenado por next_attempt_us.
+// Pacotes que falharam esperam aqui sem bloquear a http_post_task.
+static upload_item_t retry_pool[RETRY_HEAP_SIZE];
+static uint8_t retry_heap[RETRY_HEAP_SIZE];
+static uint8_t retry_free[RETRY_HEAP_SIZE];
+static int retry_count = 0;
+static int retry_free_count = 0;
+
+// Frame em lote desempacotado: leituras ainda não aceitas no envio corrente
+// (acessado apenas pela http_post_task; drenado antes do ring)
+static struct
+{
+    aguada_reading_t header;
+    aguada_batch_item_t items[AGUADA_BATCH_MAX_READINGS];
+    uint8_t src_addr[6];
+    int8_t rssi;
+    size_t count;
+    size_t next;
+    int64_t rx_us; // Recepção do frame (instante em que os age_ms valem)
+} batch_pending;
+
+// Frame multicanal desempacotado: canais ainda não aceitos no envio corrente
+// (acessado apenas pela http_post_task; drenado antes do ring)
+static struct
+{
+    aguada_reading_t channels[AGUADA_MULTI_MAX_CHANNELS];
+    uint8_t src_addr[6]; // Rádio do node (chave de idempotência)
+    size_t count;
+    size_t next;
+    int64_t rx_us; // Recepção do frame
+} multi_pending;
+
+// Flash log (store-and-forward) - acessado apenas pela http_post_task
+static bool flash_log_ready = false;
+static volatile int64_t flash_drain_at_us = 0; // Próximo lote a drenar (0 = imediato)
+static flash_log_record_t flash_record;
+static char flash_json[MAX_PAYLOAD_SIZE]; // Payload com "age_ms" reescrito
+
+// Métricas do gateway
+static struct
+{
+    uint32_t packets_received; // Total de pacotes ESP-NOW recebidos
+    uint32_t packets_sent;     // Total de pacotes HTTP enviados com sucesso
+    uint32_t packets_failed;   // Total de pacotes HTTP que falharam
+    uint32_t packets_dropped;  // Total de pacotes descartados
+    uint32_t http_errors;      // Total de erros HTTP
+    uint32_t queue_full_count; // Vezes que a queue ficou cheia
+    uint32_t http_reused;      // Requisições que reaproveitaram a conexão keep-alive
+    uint32_t http_reconnects;  // Conexões HTTP (re)abertas
+    uint32_t batches_sent;     // Requisições HTTP bem-sucedidas (1 por lote)
+    uint32_t retry_scheduled;  // Pacotes reagendados após falha
+    uint32_t retry_expired;    // Descartados por tentativas/idade esgotadas
+    uint32_t retry_overflow;   // Descartados com heap de retry cheio
+    uint32_t flash_spooled;    // Pacotes guardados no flash log
+    uint32_t flash_drained;    // Pacotes do flash log entregues ao backend
+    uint32_t binary_frames;    // Frames binários AGUADA-1 válidos encaminhados
+    uint32_t crc_errors;       // Frames binários descartados por CRC inválido
+    uint32_t batch_frames;     // Frames em lote desempacotados
+    uint32_t batch_readings;   // Leituras vindas de frames em lote
+    uint32_t multi_frames;     // Frames multicanal desempacotados
+    uint32_t multi_readings;   // Leituras (canais) vindas de frames multicanal
+    uint32_t link_probes;      // Sondas aguada_link respondidas com beacon
+    uint32_t link_reports;     // Relatórios de enlace enviados aos nodes
+    uint32_t uplink_diverted;  // Pacotes desviados com o circuito aberto
+    uint32_t dup_dropped;      // Frames repetidos descartados (janela de seq do node)
+    uint32_t edge_dropped;     // Leituras retidas pela compressão na borda
+    int64_t last_packet_time;  // Timestamp do último pacote recebido
+    int64_t last_success_time; // Timestamp do último envio bem-sucedido
+} gateway_metrics = {0};
+
+// Qualidade do enlace por node (RSSI/perda vistos aqui)
+static aguada_link_table_t link_table;
+// Estado por node (seq, perda, intervalo, RSSI) - escrito apenas pela http_post_task
+static aguada_node_table_t node_table;
+#if USE_EDGE_COMPRESSION
+// Compressão na borda por sensor - escrita apenas pela http_post_task
+static const aguada_edge_config_t edge_cfg = {
+    .deadband_mm = EDGE_DEADBAND_MM,
+    .stability_mm = EDGE_STABILITY_MM,
+    .window_size = EDGE_WINDOW,
+    .keepalive_ms = EDGE_KEEPALIVE_MS,
+};
+static aguada_edge_t edge;
+#endif
+static const uint8_t BROADCAST_MAC[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// ============================================================================
+// ESP-NOW CALLBACK (Fast - just enqueue)
+// ============================================================================
+
+/**
+ * Responde a uma sonda aguada_link com um beacon em broadcast (o node ainda
+ * não é peer; a origem do frame é o MAC deste gateway). Leva o RSSI da sonda.
+ */
+static void link_reply(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len)
+{
+    aguada_link_msg_t msg;
+
+    if (aguada_link_decode(data, (size_t)len, &msg) != AGUADA_PROTO_OK || msg.type != AGUADA_LINK_PROBE)
+    {
+        return;
+    }
+
+    uint8_t frame[AGUADA_LINK_SIZE];
+    msg.type = AGUADA_LINK_BEACON;
+    memcpy(msg.mac, recv_info->src_addr, 6);
+    msg.rssi = recv_info->rx_ctrl ? (int8_t)recv_info->rx_ctrl->rssi : 0;
+    msg.loss_pct = 0;
+    aguada_link_encode(&msg, frame);
+
+    // Só enfileira no rádio (não bloqueia o callback)
+    esp_now_send(BROADCAST_MAC, frame, sizeof(frame));
+    gateway_metrics.link_probes++;
+}
+
+/**
+ * Node listado em PRIORITY_NODES?
+ */
+static bool priority_node(const uint8_t *mac)
+{
+    for (int i = 0; i < priority_count; i++)
+    {
+        if (memcmp(priority_macs[i], mac, 6) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void espnow_recv_cb(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len)
+{
+    if (!recv_info)
+    {
+        return;
+    }
+
+    // Sonda de enlace: responde já (o node espera poucos ms) e não vai ao ring
+    if (len > 0 && aguada_link_detect(data, (size_t)len))
+    {
+        link_reply(recv_info, data, len);
+        return;
+    }
+
+    // Atualizar métricas
+    gateway_metrics.packets_received++;
+    gateway_metrics.last_packet_time = esp_timer_get_time();
+
+    // Relatório de enlace para o node (sai logo após o frame dele, com o rádio do node ligado)
+    aguada_link_msg_t report;
+    int rssi = recv_info->rx_ctrl ? recv_info->rx_ctrl->rssi : 0;
+    if (rssi != 0 &&
+        aguada_link_table_rx(&link_table, recv_info->src_addr, rssi, gateway_metrics.last_packet_time, &report))
+    {
+        uint8_t frame[AGUADA_LINK_SIZE];
+        aguada_link_encode(&report, frame);
+        if (esp_now_send(BROADCAST_MAC, frame, sizeof(frame)) == ESP_OK)
+        {
+            gateway_metrics.link_reports++;
+        }
+    }
+
+    // Slot livre da lane (não bloqueia); lane de alarmes cheia cai na de rotina.
+    // Cheio = worker parado há ESPNOW_RING_SIZE pacotes; quedas longas de
+    // uplink já são absorvidas pelo flash log no worker.
+    aguada_ring_t *ring = &espnow_ring;
+    espnow_packet_t *packet = NULL;
+    if (len > 0 && (priority_node(recv_info->src_addr) || aguada_frame_is_alarm(data, (size_t)len)))
+    {
+        packet = aguada_ring_claim(&alarm_ring);
+        ring = &alarm_ring;
+    }
+    if (!packet)
+    {
+        ring = &espnow_ring;
+        packet = aguada_ring_claim(&espnow_ring);
+    }
+    if (!packet)
+    {
+        gateway_metrics.queue_full_count++;
+        gateway_metrics.packets_dropped++;
+        return;
+    }
+
+    if (len >= MAX_PAYLOAD_SIZE)
+    {
+        len = MAX_PAYLOAD_SIZE - 1;
+    }
+    memcpy(packet->src_addr, recv_info->src_addr, 6);
+    memcpy(packet->payload, data, len);
+    packet->payload[len] = '\0';
+    packet->len = len;
+    packet->rssi = recv_info->rx_ctrl ? recv_info->rx_ctrl->rssi : 0;
+    packet->rx_us = gateway_metrics.last_packet_time;
+
+    aguada_ring_publish(ring);
+}
+
+// ============================================================================
+// HTTP CLIENT (Keep-alive)
+// ============================================================================
+
+/**
+ * Guarda o Retry-After da resposta (429/503). Só a forma em segundos - o
+ * backend (express-rate-limit, fault injection) não usa a forma de data.
+ */
+static esp_err_t http_event_handler(esp_http_client_event_t *evt)
+{
+    if (evt->event_id == HTTP_EVENT_ON_HEADER && strcasecmp(evt->header_key, "Retry-After") == 0)
+    {
+        // Limitado à abertura máxima do breaker antes de virar ms (sem overflow)
+        unsigned long seconds = strtoul(evt->header_value, NULL, 10);
+        if (seconds > UPLINK_BREAKER_OPEN_MAX_MS / 1000)
+        {
+            seconds = UPLINK_BREAKER_OPEN_MAX_MS / 1000;
+        }
+        http_retry_after_ms = (uint32_t)seconds * 1000;
+    }
+    return ESP_OK;
+}
+
+/**
+ * Obtém o cliente HTTP persistente, criando-o se necessário.
+ * Cada criação conta como reconexão (novo handshake TCP).
+ */
+static esp_http_client_handle_t http_client_get(void)
+{
+    if (http_client)
+    {
+        return http_client;
+    }
+
+    esp_http_client_config_t config = {
+        .url = UPLOAD_URL,
+        .method = HTTP_METHOD_POST,
+        .timeout_ms = HTTP_TIMEOUT_MS,
+        .keep_alive_enable = true,
+        .keep_alive_idle = HTTP_KEEPALIVE_IDLE_S,
+        .keep_alive_interval = HTTP_KEEPALIVE_INTERVAL_S,
+        .keep_alive_count = HTTP_KEEPALIVE_COUNT,
+        .event_handler = http_event_handler,
+    };
+
+    http_client = esp_http_client_init(&config);
+    if (http_client)
+    {
+        esp_http_client_set_header(http_client, "Content-Type", "application/json");
+        esp_http_client_set_header(http_client, "Connection", "keep-alive");
+        http_client_used = false;
+        gateway_metrics.http_reconnects++;
+    }
+    return http_client;
+}
+
+/**
+ * Descarta o cliente HTTP após erro de transporte.
+ * A próxima requisição abre uma conexão nova.
+ */
+static void http_client_reset(void)
+{
+    if (http_client)
+    {
+        esp_http_client_cleanup(http_client);
+        http_client = NULL;
+    }
+    http_client_used = false;
+}
+
+/**
+ * POST de um payload pela conexão persistente.
+ *
+ * @return Status HTTP (>0) ou -1 em erro de transporte
+ */
+static int http_post_payload(const char *payload, int len)
+{
+    esp_http_client_handle_t client = http_client_get();
+    if (!client)
+    {
+        ESP_LOGW(TAG, "✗ Falha ao criar cliente HTTP");
+        return -1;
+    }
+
+    esp_http_client_set_post_field(client, payload, len);
+    http_retry_after_ms = 0;
+
+    bool reused = http_client_used;
+    esp_err_t err = esp_http_client_perform(client);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "✗ HTTP error: %s%s", esp_err_to_name(err), reused ? " (conexão reaproveitada)" : "");
+        http_client_reset();
+        return -1;
+    }
+
+    if (reused)
+    {
+        gateway_metrics.http_reused++;
+    }
+    http_client_used = true;
+
+    int status = esp_http_client_get_status_code(client);
+
+    // Resposta lida pela metade deixa o socket em estado inválido - reabrir na próxima
+    if (!esp_http_client_is_complete_data_received(client))
+    {
+        http_client_reset();
+    }
+
+    return status;
+}
+
+// ============================================================================
+// FLASH LOG (Store-and-forward)
+// ============================================================================
+
+/**
+ * Guarda um item no flash log para reenvio após a queda
+ *
+ * @return false se o log não está disponível (pacote perdido)
+ */
+static bool spool_item(const upload_item_t *item)
+{
+#if USE_FLASH_LOG
+    if (flash_log_ready &&
+        flash_log_append(item->packet.src_addr, item->packet.payload, item->packet.len, item->age_ref_us) == ESP_OK)
+    {
+        gateway_metrics.flash_spooled++;
+        return true;
+    }
+#endif
+    return false;
+}
+
+/**
+ * Prazo do próximo lote a drenar do flash log (INT64_MAX se nada a drenar)
+ */
+static int64_t flash_drain_deadline(void)
+{
+    // Retries pendentes indicam backend instável - esperar que se resolvam primeiro
+    if (!flash_log_ready || !wifi_connected || retry_count > 0 || flash_log_pending() == 0)
+    {
+        return INT64_MAX;
+    }
+    // Circuito aberto: o próximo lote é a sonda
+    int64_t uplink_at = aguada_uplink_deadline(&uplink);
+    return (uplink_at > flash_drain_at_us) ? uplink_at : flash_drain_at_us;
+}
+
+// ============================================================================
+// RETRY SCHEDULER (Min-heap por prazo)
+// ============================================================================
+
+static void retry_init(void)
+{
+    retry_count = 0;
+    retry_free_count = RETRY_HEAP_SIZE;
+    for (int i = 0; i < RETRY_HEAP_SIZE; i++)
+    {
+        retry_free[i] = (uint8_t)i;
+    }
+}
+
+static inline int64_t retry_key(int heap_pos)
+{
+    return retry_pool[retry_heap[heap_pos]].next_attempt_us;
+}
+
+static void retry_swap(int a, int b)
+{
+    uint8_t tmp = retry_heap[a];
+    retry_heap[a] = retry_heap[b];
+    retry_heap[b] = tmp;
+}
+
+/**
+ * Agenda um item para nova tentativa em item->next_attempt_us
+ *
+ * @return false se o heap estiver cheio
+ */
+static bool retry_push(const upload_item_t *item)
+{
+    if (retry_free_count == 0)
+    {
+        return false;
+    }
+
+    uint8_t slot = retry_free[--retry_free_count];
+    retry_pool[slot] = *item;
+
+    // Sift-up
+    int pos = retry_count++;
+    retry_heap[pos] = slot;
+    while (pos > 0)
+    {
+        int parent = (pos - 1) / 2;
+        if (retry_key(parent) <= retry_key(pos))
+        {
+            break;
+        }
+        retry_swap(parent, pos);
+        pos = parent;
+    }
+    return true;
+}
+
+/**
+ * Prazo do próximo retry (INT64_MAX se não houver nenhum)
+ */
+static int64_t retry_next_deadline(void)
+{
+    return retry_count > 0 ? retry_key(0) : INT64_MAX;
+}
+
+/**
+ * Remove o item com menor prazo
+ */
+static void retry_pop(upload_item_t *out)
+{
+    uint8_t slot = retry_heap[0];
+    *out = retry_pool[slot];
+    retry_free[retry_free_count++] = slot;
+
+    // Sift-down
+    retry_heap[0] = retry_heap[--retry_count];
+    int pos = 0;
+    while (1)
+    {
+        int left = 2 * pos + 1;
+        int right = left + 1;
+        int smallest = pos;
+        if (left < retry_count && retry_key(left) < retry_key(smallest))
+        {
+            smallest = left;
+        }
+        if (right < retry_count && retry_key(right) < retry_key(smallest))
+        {
+            smallest = right;
+        }
+        if (smallest == pos)
+        {
+            break;
+        }
+        retry_swap(pos, smallest);
+        pos = smallest;
+    }
+}
+
+/**
+ * Reagenda um item que falhou, ou descarta se esgotou tentativas/idade
+ */
+static void retry_schedule(upload_item_t *item, int64_t now)
+{
+    item->attempts++;
+
+    int64_t age_ms = (now - item->first_seen_us) / 1000;
+    if (item->attempts >= MAX_RETRY_ATTEMPTS || age_ms >= RETRY_MAX_AGE_MS)
+    {
+        gateway_metrics.retry_expired++;
+        if (spool_item(item))
+        {
+            ESP_LOGW(TAG, "→ Pacote para o flash log após %d tentativas", item->attempts);
+            return;
+        }
+        gateway_metrics.packets_failed++;
+        ESP_LOGE(TAG, "✗ Pacote descartado após %d tentativas (idade %lldms)", item->attempts, age_ms);
+        return;
+    }
+
+    // Backoff exponencial: 1s, 2s, 4s... (limitado a RETRY_BACKOFF_MAX_MS)
+    int64_t delay_ms = (int64_t)RETRY_BACKOFF_BASE_MS << (item->attempts - 1);
+    if (delay_ms > RETRY_BACKOFF_MAX_MS)
+    {
+        delay_ms = RETRY_BACKOFF_MAX_MS;
+    }
+    item->next_attempt_us = now + delay_ms * 1000;
+
+    if (!retry_push(item))
+    {
+        gateway_metrics.retry_overflow++;
+        if (spool_item(item))
+        {
+            return;
+        }
+        gateway_metrics.packets_failed++;
+        ESP_LOGE(TAG, "✗ Heap de retry cheio (%d) - pacote descartado", RETRY_HEAP_SIZE);
+        return;
+    }
+    gateway_metrics.retry_scheduled++;
+}
+
+// ============================================================================
+// HTTP POST TASK (Process queue and forward to backend)
+// ============================================================================
+
+/**
+ * Log do pacote recebido + saída TELEMETRY: para o Serial Bridge
+ */
+static void log_packet(const espnow_packet_t *packet)
+{
+    char src_mac_str[AGUADA_MAC_STR_LEN];
+    aguada_mac_to_string(packet->src_addr, src_mac_str);
+
+    // Log received packet
+    ESP_LOGI(TAG, "");
+    ESP_LOGI(TAG, "╔════════════════════════════════════════════════════╗");
+    ESP_LOGI(TAG, "║ ✓ ESP-NOW recebido de: %s (%d bytes)", src_mac_str, packet->len);
+    ESP_LOGI(TAG, "╠════════════════════════════════════════════════════╣");
+    ESP_LOGI(TAG, "║ Dados: %s", packet->payload);
+    ESP_LOGI(TAG, "╚════════════════════════════════════════════════════╝");
+
+    // Output JSON to Serial for backend Serial Bridge
+    // Use printf for clean output without ESP-IDF prefix
+    printf("TELEMETRY:%s\n", packet->payload);
+    fflush(stdout);
+}
+
+/**
+ * Frame binário AGUADA-1 (node com USE_BINARY_PAYLOAD=1): valida versão e
+ * CRC e reescreve como {"bin":"<hex>","rssi":N} - o backend decodifica
+ */
+static aguada_proto_err_t binary_to_json(espnow_packet_t *out, const espnow_packet_t *packet,
+                                         aguada_reading_t *reading)
+{
+    char bin_hex[AGUADA_BIN_HEX_LEN];
+
+    aguada_proto_err_t err = aguada_bin_decode((const uint8_t *)packet->payload, packet->len, reading);
+    if (err != AGUADA_PROTO_OK)
+    {
+        return err;
+    }
+
+    aguada_hex_encode((const uint8_t *)packet->payload, AGUADA_BIN_SIZE, bin_hex, sizeof(bin_hex));
+    memcpy(out->src_addr, packet->src_addr, 6);
+    out->rssi = packet->rssi;
+    out->len = snprintf(out->payload, sizeof(out->payload), "{\"bin\":\"%s\",\"rssi\":%d}",
+                        bin_hex, packet->rssi);
+    return AGUADA_PROTO_OK;
+}
+
+/**
+ * Registra um frame válido na tabela de nodes (has_seq = o frame trouxe seq)
+ *
+ * @return false se o frame é repetido (reenvio já recebido): descartar
+ */
+static bool node_rx(const espnow_packet_t *packet, bool has_seq, uint8_t seq)
+{
+    aguada_node_entry_t *entry;
+    aguada_node_rx_t rx = aguada_node_table_rx(&node_table, packet->src_addr, has_seq, seq, packet->rssi,
+                                               packet->rx_us, &entry);
+    if (rx == AGUADA_NODE_DUP)
+    {
+        gateway_metrics.dup_dropped++;
+        ESP_LOGD(TAG, "Frame repetido descartado (seq %u)", seq);
+        return false;
+    }
+    if (rx == AGUADA_NODE_GAP || rx == AGUADA_NODE_RESET)
+    {
+        char mac_str[AGUADA_MAC_STR_LEN];
+        aguada_mac_to_string(packet->src_addr, mac_str);
+        ESP_LOGW(TAG, "Node %s: seq %u (%s, %lu perdido(s), perda %u%%)", mac_str, seq,
+                 (rx == AGUADA_NODE_GAP) ? "salto" : "reinício", (unsigned long)entry->lost,
+                 aguada_node_loss_pct(entry));
+    }
+    return true;
+}
+
+/**
+ * Acrescenta campos (",\"k\":v...") ao objeto JSON do pacote antes do '}'
+ * final. Se não couber, mantém o original.
+ */
+static void json_append(espnow_packet_t *packet, const char *fmt, ...)
+{
+    if (packet->len < 2 || packet->payload[0] != '{' || packet->payload[packet->len - 1] != '}')
+    {
+        return;
+    }
+
+    int len = packet->len - 1;
+    va_list args;
+    va_start(args, fmt);
+    int added = vsnprintf(packet->payload + len, sizeof(packet->payload) - len, fmt, args);
+    va_end(args);
+    if (added < 0 || len + added + 1 >= (int)sizeof(packet->payload))
+    {
+        added = 0; // Não coube: mantém o original
+    }
+
+    packet->payload[len + added] = '}';
+    packet->payload[len + added + 1] = '\0';
+    packet->len = len + added + 1;
+}
+
+/**
+ * JSON de node sem "rssi" (o node não conhece o próprio sinal): acrescenta
+ * o RSSI medido na recepção
+ */
+static void json_add_rssi(espnow_packet_t *packet)
+{
+    if (strstr(packet->payload, "\"rssi\"") == NULL)
+    {
+        json_append(packet, ",\"rssi\":%d", packet->rssi);
+    }
+}
+
+/**
+ * Chave de idempotência da leitura: "<MAC do rádio>/<seq>/<índice no frame>".
+ * Igual em todos os gateways que receberem o frame - o backend descarta a
+ * segunda cópia por ela, sem consultar o Redis.
+ */
+static void json_add_idem(espnow_packet_t *packet, const uint8_t *radio_mac, uint8_t seq, unsigned index)
+{
+    char mac_str[AGUADA_MAC_STR_LEN];
+    aguada_mac_to_string(radio_mac, mac_str);
+    json_append(packet, ",\"idem\":\"%s/%u/%u\"", mac_str, seq, index);
+}
+
+/**
+ * Soma ao "age_ms" do payload a idade do registro no flash log (acrescenta o
+ * campo se não existir): o backend recua o datetime até a recepção, e não
+ * até o dreno. Se não couber, mantém o original.
+ */
+static void json_add_age(espnow_packet_t *packet, int64_t age_ms)
+{
+    char *field = strstr(packet->payload, "\"age_ms\":");
+    if (!field)
+    {
+        json_append(packet, ",\"age_ms\":%lld", (long long)age_ms);
+        return;
+    }
+
+    char *digits = field + strlen("\"age_ms\":");
+    char *end;
+    long long age = strtoll(digits, &end, 10);
+    int len = snprintf(flash_json, sizeof(flash_json), "%.*s%lld%s", (int)(digits - packet->payload),
+                       packet->payload, age + age_ms, end);
+    if (len < 0 || len >= (int)sizeof(flash_json))
+    {
+        return;
+    }
+    memcpy(packet->payload, flash_json, len + 1);
+    packet->len = len;
+}
+
+/**
+ * Soma ao "age_ms" de cada item a espera desde age_ref_us (fila, pacing,
+ * retries). Item sem o campo e enviado em menos de UPLOAD_AGE_MIN_MS segue
+ * sem ele; os demais são reancorados, então um novo retry só soma a espera
+ * seguinte.
+ */
+static void upload_items_age(int count)
+{
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < count; i++)
+    {
+        upload_item_t *item = &upload_items[i];
+        int64_t delay_ms = (now - item->age_ref_us) / 1000;
+        if (delay_ms <= 0 ||
+            (delay_ms < UPLOAD_AGE_MIN_MS && !strstr(item->packet.payload, "\"age_ms\":")))
+        {
+            continue;
+        }
+        json_add_age(&item->packet, delay_ms);
+        item->age_ref_us += delay_ms * 1000;
+    }
+}
+
+/**
+ * Compressão na borda (aguada_edge) de uma leitura já no item
+ *
+ * @return false se a leitura só estenderia o período no backend: descartar.
+ *         As repassadas levam "edge":"change"/"hold"; leituras em predição
+ *         dupla, com erro ou bateria baixa seguem sem marca.
+ */
+static bool edge_forward(espnow_packet_t *packet, const aguada_reading_t *reading, int64_t sample_us)
+{
+#if USE_EDGE_COMPRESSION
+    if (reading->has_slope || (reading->flags & (AGUADA_FLAG_ERROR | AGUADA_FLAG_LOW_BATTERY)))
+    {
+        return true; // Predição dupla (a reta já decide os envios) ou alarme
+    }
+
+    aguada_edge_verdict_t verdict = aguada_edge_filter(&edge, reading->mac, reading->distance_mm, sample_us);
+    if (verdict == AGUADA_EDGE_DROP)
+    {
+        gateway_metrics.edge_dropped++;
+        return false;
+    }
+    const char *tag = aguada_edge_tag(verdict);
+    if (tag)
+    {
+        json_append(packet, ",\"edge\":\"%s\"", tag);
+    }
+#else
+    (void)packet;
+    (void)reading;
+    (void)sample_us;
+#endif
+    return true;
+}
+
+/**
+ * Aceita um pacote novo da fila no envio corrente
+ *
+ * @return true se o pacote ocupou um item
+ */
+static bool upload_accept(upload_item_t *item, const espnow_packet_t *packet)
+{
+    if (aguada_bin_detect((const uint8_t *)packet->payload, packet->len))
+    {
+        aguada_reading_t reading;
+        aguada_proto_err_t err = binary_to_json(&item->packet, packet, &reading);
+        if (err != AGUADA_PROTO_OK)
+        {
+            if (err == AGUADA_PROTO_ERR_CRC)
+            {
+                gateway_metrics.crc_errors++;
+            }
+            gateway_metrics.packets_dropped++;
+            aguada_link_table_bad(&link_table, packet->src_addr);
+            ESP_LOGW(TAG, "✗ Frame binário descartado (%s)", aguada_proto_err_name(err));
+            return false;
+        }
+        gateway_metrics.binary_frames++;
+        if (!node_rx(packet, reading.has_seq, reading.seq))
+        {
+            return false;
+        }
+        if (!edge_forward(&item->packet, &reading, packet->rx_us))
+        {
+            return false;
+        }
+        if (reading.has_seq)
+        {
+            json_add_idem(&item->packet, packet->src_addr, reading.seq, 0);
+        }
+        log_packet(&item->packet);
+    }
+    else
+    {
+        // Seq e leitura para a borda; JSON que não decodifica segue como antes
+        aguada_reading_t reading;
+        bool decoded = aguada_json_decode(packet->payload, packet->len, &reading) == AGUADA_PROTO_OK;
+        bool has_seq = decoded && reading.has_seq;
+        if (!node_rx(packet, has_seq, has_seq ? reading.seq : 0))
+        {
+            return false;
+        }
+
+        log_packet(packet);
+
+#if USE_BATCH_UPLOAD || UPLINK_SINK == UPLINK_SINK_MQTT
+        // Um item que não é objeto JSON invalidaria o array inteiro no backend
+        if (packet->len <= 0 || packet->payload[0] != '{')
+        {
+            gateway_metrics.packets_dropped++;
+            ESP_LOGW(TAG, "Payload não-JSON fora do lote (%d bytes)", packet->len);
+            return false;
+        }
+#endif
+
+        item->packet = *packet;
+        if (decoded && !edge_forward(&item->packet, &reading, packet->rx_us))
+        {
+            return false;
+        }
+        json_add_rssi(&item->packet);
+        if (has_seq)
+        {
+            json_add_idem(&item->packet, packet->src_addr, reading.seq, 0);
+        }
+    }
+
+    item->first_seen_us = packet->rx_us;
+    item->age_ref_us = packet->rx_us;
+    item->next_attempt_us = 0;
+    item->attempts = 0;
+    return true;
+}
+
+/**
+ * Desempacota um frame em lote do ring em batch_pending (o slot do ring pode
+ * ser liberado em seguida). As leituras entram no envio por batch_drain.
+ */
+static void batch_unpack(const espnow_packet_t *packet)
+{
+    aguada_proto_err_t err = aguada_batch_decode((const uint8_t *)packet->payload, packet->len,
+                                                 &batch_pending.header, batch_pending.items,
+                                                 AGUADA_BATCH_MAX_READINGS, &batch_pending.count);
+    batch_pending.next = 0;
+    if (err != AGUADA_PROTO_OK)
+    {
+        if (err == AGUADA_PROTO_ERR_CRC)
+        {
+            gateway_metrics.crc_errors++;
+        }
+        gateway_metrics.packets_dropped++;
+        aguada_link_table_bad(&link_table, packet->src_addr);
+        ESP_LOGW(TAG, "✗ Frame em lote descartado (%s)", aguada_proto_err_name(err));
+        return;
+    }
+
+    if (!node_rx(packet, batch_pending.header.has_seq, batch_pending.header.seq))
+    {
+        batch_pending.count = 0;
+        return;
+    }
+    memcpy(batch_pending.src_addr, packet->src_addr, 6);
+    batch_pending.rssi = packet->rssi;
+    batch_pending.rx_us = packet->rx_us;
+    gateway_metrics.batch_frames++;
+    gateway_metrics.batch_readings += batch_pending.count;
+    ESP_LOGI(TAG, "Lote: %u leituras (%d bytes)", (unsigned)batch_pending.count, packet->len);
+}
+
+/**
+ * Aceita as leituras pendentes de um lote como itens AGUADA-1 JSON com
+ * "age_ms" (um item por leitura), até encher o envio corrente
+ *
+ * @return novo número de itens no envio
+ */
+static int batch_drain(int count)
+{
+    aguada_reading_t reading = batch_pending.header;
+    int64_t rx_us = batch_pending.rx_us;
+
+    while (batch_pending.next < batch_pending.count && count < uplink.batch)
+    {
+        const aguada_batch_item_t *entry = &batch_pending.items[batch_pending.next++];
+        upload_item_t *item = &upload_items[count];
+
+        reading.distance_mm = entry->distance_mm;
+        reading.age_ms = entry->age_ms; // Na recepção; upload_items_age soma a espera
+        reading.rssi = batch_pending.rssi; // Medido aqui (o node não sabe o seu)
+        memcpy(item->packet.src_addr, batch_pending.src_addr, 6);
+        item->packet.rssi = batch_pending.rssi;
+        item->packet.len = aguada_json_encode(&reading, item->packet.payload, sizeof(item->packet.payload));
+        if (!edge_forward(&item->packet, &reading, rx_us - (int64_t)reading.age_ms * 1000))
+        {
+            continue; // O item fica livre para a próxima leitura
+        }
+        count++;
+        if (reading.has_seq)
+        {
+            json_add_idem(&item->packet, batch_pending.src_addr, reading.seq, batch_pending.next - 1);
+        }
+        log_packet(&item->packet);
+
+        item->first_seen_us = rx_us;
+        item->age_ref_us = rx_us;
+        item->next_attempt_us = 0;
+        item->attempts = 0;
+    }
+    return count;
+}
+
+/**
+ * Desempacota um frame multicanal do ring em multi_pending: uma leitura por
+ * canal, com o MAC do canal e VCC/entrega do node. As leituras entram no
+ * envio por multi_drain.
+ */
+static void multi_unpack(const espnow_packet_t *packet)
+{
+    aguada_reading_t node;
+    aguada_proto_err_t err = aguada_multi_decode((const uint8_t *)packet->payload, packet->len, &node,
+                                                 multi_pending.channels, AGUADA_MULTI_MAX_CHANNELS,
+                                                 &multi_pending.count);
+    multi_pending.next = 0;
+    if (err != AGUADA_PROTO_OK)
+    {
+        if (err == AGUADA_PROTO_ERR_CRC)
+        {
+            gateway_metrics.crc_errors++;
+        }
+        gateway_metrics.packets_dropped++;
+        aguada_link_table_bad(&link_table, packet->src_addr);
+        ESP_LOGW(TAG, "✗ Frame multicanal descartado (%s)", aguada_proto_err_name(err));
+        return;
+    }
+
+    if (!node_rx(packet, node.has_seq, node.seq))
+    {
+        multi_pending.count = 0;
+        return;
+    }
+    memcpy(multi_pending.src_addr, packet->src_addr, 6);
+    multi_pending.rx_us = packet->rx_us;
+    for (size_t i = 0; i < multi_pending.count; i++)
+    {
+        multi_pending.channels[i].rssi = packet->rssi; // Medido aqui (o node não sabe o seu)
+    }
+    gateway_metrics.multi_frames++;
+    gateway_metrics.multi_readings += multi_pending.count;
+    ESP_LOGI(TAG, "Multicanal: %u canais (%d bytes)", (unsigned)multi_pending.count, packet->len);
+}
+
+/**
+ * Aceita os canais pendentes de um frame multicanal como itens AGUADA-1 JSON
+ * (um item por sensor, com o MAC do canal), até encher o envio corrente
+ *
+ * @return novo número de itens no envio
+ */
+static int multi_drain(int count)
+{
+    int64_t rx_us = multi_pending.rx_us;
 
-#define WIFI_SSID "luciano"
-#define WIFI_PASS "Luciano19852012"
-#define BACKEND_URL "http://192.168.0.117:3002/api/telemetry"
-#define METRICS_URL "http://192.168.0.117:3002/api/gateway/metrics"
-#define ESPNOW_CHANNEL 11         // Fixed channel for SSID "luciano"
-#define METRICS_INTERVAL_MS 60000 // Enviar métricas a cada 60 segundos
-#define LED_BUILTIN GPIO_NUM_2    // ESP32 DevKit V1 uses GPIO2 for LED (GPIO8 is invalid on ESP32)
-#define HEARTBEAT_INTERVAL_MS 3000
-#define MAX_PAYLOAD_SIZE 256
-#define MAX_RETRY_ATTEMPTS 3
-#define RETRY_BACKOFF_BASE_MS 1000 // 1s, 2s, 4s
+    while (multi_pending.next < multi_pending.count && count < uplink.batch)
+    {
+        const aguada_reading_t *reading = &multi_pending.channels[multi_pending.next++];
+        upload_item_t *item = &upload_items[count];
 
-// ============================================================================
-// TYPES
-// ============================================================================
+        memcpy(item->packet.src_addr, reading->mac, 6);
+        item->packet.rssi = (int8_t)reading->rssi;
+        item->packet.len = aguada_json_encode(reading, item->packet.payload, sizeof(item->packet.payload));
+        if (!edge_forward(&item->packet, reading, rx_us - (int64_t)reading->age_ms * 1000))
+        {
+            continue; // O item fica livre para a próxima leitura
+        }
+        count++;
+        if (reading->has_seq)
+        {
+            json_add_idem(&item->packet, multi_pending.src_addr, reading->seq, multi_pending.next - 1);
+        }
+        log_packet(&item->packet);
 
-typedef struct
+        item->first_seen_us = rx_us;
+        item->age_ref_us = rx_us;
+        item->next_attempt_us = 0;
+        item->attempts = 0;
+    }
+    return count;
+}
+
+/**
+ * Monta o corpo HTTP a partir dos itens (payload único ou JSON array)
+ */
+static int upload_build_body(int count)
 {
-    uint8_t src_addr[6];
-    char payload[MAX_PAYLOAD_SIZE];
-    int len;
-} espnow_packet_t;
+#if USE_BATCH_UPLOAD
+    int len = 0;
+    upload_body[len++] = '[';
+    for (int i = 0; i < count; i++)
+    {
+        if (i > 0)
+        {
+            upload_body[len++] = ',';
+        }
+        memcpy(upload_body + len, upload_items[i].packet.payload, upload_items[i].packet.len);
+        len += upload_items[i].packet.len;
+    }
+    upload_body[len++] = ']';
+    return len;
+#else
+    memcpy(upload_body, upload_items[0].packet.payload, upload_items[0].packet.len);
+    return upload_items[0].packet.len;
+#endif
+}
 
-// ============================================================================
-// GLOBALS
-// ============================================================================
+#if UPLINK_SINK == UPLINK_SINK_MQTT
+/**
+ * Publica os itens correntes agrupados por node: um publish QoS1 em
+ * MQTT_TOPIC_PREFIX/<MAC> com o JSON array das leituras daquele node.
+ * Espera janela para todos os grupos antes do primeiro publish, para que
+ * uma falha não deixe o lote pela metade.
+ *
+ * @return 200 se todos os grupos entraram no outbox, -1 caso contrário
+ */
+static int mqtt_items_publish(int count)
+{
+    bool taken[UPLOAD_MAX_ITEMS] = {0};
 
-static uint8_t gateway_mac[6];
-static bool wifi_connected = false;
-static int64_t last_heartbeat = 0;
-// Note: last_metrics_send removed - metrics_task uses vTaskDelay instead
-static bool led_state = false;
-static QueueHandle_t espnow_queue = NULL;
+    int groups = 0;
+    for (int i = 0; i < count; i++)
+    {
+        int j = 0;
+        while (j < i && memcmp(upload_items[j].packet.src_addr, upload_items[i].packet.src_addr, 6) != 0)
+        {
+            j++;
+        }
+        if (j == i)
+        {
+            groups++;
+        }
+    }
 
-// Buffer para pacotes quando queue está cheia (fallback em memória)
-// TODO: Implementar SPIFFS/LittleFS para persistência real
-#define FALLBACK_BUFFER_SIZE 20
-static espnow_packet_t fallback_buffer[FALLBACK_BUFFER_SIZE];
-static int fallback_buffer_count = 0;
+    if (!mqtt_sink_acquire(groups, pdMS_TO_TICKS(MQTT_WINDOW_WAIT_MS)))
+    {
+        ESP_LOGW(TAG, "✗ MQTT desconectado ou janela cheia");
+        return -1;
+    }
 
-// Métricas do gateway
-static struct
-{
-    uint32_t packets_received; // Total de pacotes ESP-NOW recebidos
-    uint32_t packets_sent;     // Total de pacotes HTTP enviados com sucesso
-    uint32_t packets_failed;   // Total de pacotes HTTP que falharam
-    uint32_t packets_dropped;  // Total de pacotes descartados
-    uint32_t http_errors;      // Total de erros HTTP
-    uint32_t queue_full_count; // Vezes que a queue ficou cheia
-    int64_t last_packet_time;  // Timestamp do último pacote recebido
-    int64_t last_success_time; // Timestamp do último envio bem-sucedido
-} gateway_metrics = {0};
+    for (int i = 0; i < count; i++)
+    {
+        if (taken[i])
+        {
+            continue;
+        }
 
-// ============================================================================
-// UTILITIES
-// ============================================================================
+        const uint8_t *mac = upload_items[i].packet.src_addr;
+        int len = 0;
+        upload_body[len++] = '[';
+        for (int j = i; j < count; j++)
+        {
+            if (taken[j] || memcmp(upload_items[j].packet.src_addr, mac, 6) != 0)
+            {
+                continue;
+            }
+            if (len > 1)
+            {
+                upload_body[len++] = ',';
+            }
+            memcpy(upload_body + len, upload_items[j].packet.payload, upload_items[j].packet.len);
+            len += upload_items[j].packet.len;
+            taken[j] = true;
+        }
+        upload_body[len++] = ']';
+
+        char topic[48];
+        snprintf(topic, sizeof(topic), "%s/%02X%02X%02X%02X%02X%02X", MQTT_TOPIC_PREFIX,
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        if (mqtt_sink_publish(topic, upload_body, len) < 0)
+        {
+            return -1;
+        }
+    }
+    return 200;
+}
+#endif
 
-static void mac_to_string(const uint8_t *mac, char *str)
+/**
+ * Envia os itens correntes pelo sink configurado; contabiliza sucesso/erro
+ *
+ * @return Status HTTP (>0) ou -1 em erro de transporte
+ *         (MQTT: 200 quando aceito no outbox QoS1)
+ */
+static int upload_items_post(int count)
 {
-    snprintf(str, 18, "%02X:%02X:%02X:%02X:%02X:%02X",
-             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    upload_items_age(count);
+
+#if UPLINK_SINK == UPLINK_SINK_MQTT
+    int status = mqtt_items_publish(count);
+    http_retry_after_ms = 0;
+#else
+    int len = upload_build_body(count);
+    int status = http_post_payload(upload_body, len);
+#endif
+
+    aguada_uplink_state_t before = uplink.state;
+    if (aguada_uplink_report(&uplink, status, http_retry_after_ms, esp_timer_get_time()))
+    {
+        ESP_LOGW(TAG, "Uplink: circuito %s → %s (status=%d)", aguada_uplink_state_name(before),
+                 aguada_uplink_state_name(uplink.state), status);
+    }
+    if (status == 429 || status == 503)
+    {
+        ESP_LOGW(TAG, "Uplink: contrapressão (status=%d, Retry-After=%lums) - lote %u, intervalo %lums", status,
+                 (unsigned long)http_retry_after_ms, uplink.batch, (unsigned long)uplink.interval_ms);
+    }
+
+    if (status == 200 || status == 201)
+    {
+        gateway_metrics.packets_sent += count;
+        gateway_metrics.batches_sent++;
+        gateway_metrics.last_success_time = esp_timer_get_time();
+        ESP_LOGI(TAG, "→ Enviado via %s (%d leitura(s), status=%d)", UPLINK_NAME, count, status);
+    }
+    else
+    {
+        gateway_metrics.http_errors++;
+    }
+    return status;
 }
 
-// ============================================================================
-// ESP-NOW CALLBACK (Fast - just enqueue)
-// ============================================================================
+/**
+ * 4xx (exceto 408/429) é rejeição do conteúdo - reenviar não resolve
+ */
+static inline bool http_status_permanent(int status)
+{
+    return status >= 400 && status < 500 && status != 408 && status != 429;
+}
 
-static void espnow_recv_cb(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len)
+/**
+ * Uma única tentativa de envio. Em falha, cada item volta ao retry heap -
+ * o worker nunca dorme esperando backoff, então pacotes novos continuam fluindo.
+ */
+static void upload_items_send(int count)
 {
-    if (!recv_info || !espnow_queue)
+    int status = upload_items_post(count);
+    int64_t now = esp_timer_get_time();
+
+    if (status == 200 || status == 201)
     {
         return;
     }
 
-    espnow_packet_t packet = {0};
-    memcpy(packet.src_addr, recv_info->src_addr, 6);
+    if (http_status_permanent(status))
+    {
+        gateway_metrics.packets_failed += count;
+        ESP_LOGE(TAG, "✗ HTTP status=%d - %d leitura(s) rejeitada(s)", status, count);
+        return;
+    }
 
-    if (len >= MAX_PAYLOAD_SIZE)
+    if (status > 0)
     {
-        len = MAX_PAYLOAD_SIZE - 1;
+        ESP_LOGW(TAG, "✗ HTTP status=%d - %d leitura(s) para retry", status, count);
     }
-    memcpy(packet.payload, data, len);
-    packet.payload[len] = '\0';
-    packet.len = len;
+    for (int i = 0; i < count; i++)
+    {
+        retry_schedule(&upload_items[i], now);
+    }
+}
 
-    // Atualizar métricas
-    gateway_metrics.packets_received++;
-    gateway_metrics.last_packet_time = esp_timer_get_time();
+/**
+ * Circuito aberto: o envio corrente vai para o flash log sem tocar na rede.
+ * Sem flash log, os itens esperam a sonda no retry heap (sem gastar tentativa).
+ */
+static void uplink_divert(int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        upload_item_t *item = &upload_items[i];
+        if (spool_item(item))
+        {
+            continue;
+        }
+        item->next_attempt_us = aguada_uplink_deadline(&uplink);
+        if (!retry_push(item))
+        {
+            gateway_metrics.packets_dropped++;
+        }
+    }
+    gateway_metrics.uplink_diverted += count;
+}
+
+/**
+ * Verifica o circuito antes de um envio; loga a passagem para meio-aberto
+ */
+static bool uplink_allow(void)
+{
+    aguada_uplink_state_t before = uplink.state;
+    bool allowed = aguada_uplink_allow(&uplink, esp_timer_get_time());
+    if (uplink.state != before)
+    {
+        ESP_LOGI(TAG, "Uplink: sonda ao backend (circuito %s)", aguada_uplink_state_name(uplink.state));
+    }
+    return allowed;
+}
+
+/**
+ * Envia o próximo lote do flash log, com o "age_ms" de cada leitura
+ * acrescido do tempo no flash. Só marca como enviado após 2xx;
+ * em falha os registros ficam no flash e o dreno espera FLASH_LOG_RETRY_MS.
+ */
+static void flash_log_drain(void)
+{
+    if (!uplink_allow())
+    {
+        return;
+    }
 
-    // Enqueue without blocking
-    BaseType_t result = xQueueSendFromISR(espnow_queue, &packet, NULL);
+    flash_log_cursor_t cursor;
+    flash_log_cursor_begin(&cursor);
 
-    // Se queue cheia, tentar salvar em buffer de fallback
-    if (result != pdTRUE)
+    int count = 0;
+    while (count < uplink.batch && flash_log_read_next(&cursor, &flash_record))
     {
-        gateway_metrics.queue_full_count++;
-        if (fallback_buffer_count < FALLBACK_BUFFER_SIZE)
+        // Registro de outro boot sem hora do relógio: dar tempo ao SNTP
+        if (!flash_record.age_exact && esp_timer_get_time() < (int64_t)FLASH_LOG_CLOCK_WAIT_MS * 1000)
+        {
+            break;
+        }
+
+        upload_item_t *item = &upload_items[count++];
+        int len = flash_record.len < MAX_PAYLOAD_SIZE ? flash_record.len : MAX_PAYLOAD_SIZE - 1;
+        memcpy(item->packet.src_addr, flash_record.src_addr, 6);
+        memcpy(item->packet.payload, flash_record.payload, len);
+        item->packet.payload[len] = '\0';
+        item->packet.len = len;
+        json_add_age(&item->packet, flash_record.age_ms);
+        item->age_ref_us = esp_timer_get_time();
+    }
+    int64_t now = esp_timer_get_time();
+    if (count == 0)
+    {
+        flash_drain_at_us = now + (int64_t)FLASH_LOG_DRAIN_INTERVAL_MS * 1000;
+        return;
+    }
+
+    int status = upload_items_post(count);
+    now = esp_timer_get_time();
+
+    if (status == 200 || status == 201 || http_status_permanent(status))
+    {
+        flash_log_consume(count);
+        if (status == 200 || status == 201)
         {
-            memcpy(&fallback_buffer[fallback_buffer_count], &packet, sizeof(espnow_packet_t));
-            fallback_buffer_count++;
-            ESP_LOGW(TAG, "Queue cheia - pacote salvo em buffer (total: %d)", fallback_buffer_count);
+            gateway_metrics.flash_drained += count;
         }
         else
         {
-            gateway_metrics.packets_dropped++;
-            ESP_LOGE(TAG, "Queue e buffer cheios - pacote descartado!");
+            gateway_metrics.packets_failed += count;
+            ESP_LOGE(TAG, "✗ HTTP status=%d - %d leitura(s) do flash log rejeitada(s)", status, count);
         }
+        flash_drain_at_us = now + (int64_t)FLASH_LOG_DRAIN_INTERVAL_MS * 1000;
+        ESP_LOGI(TAG, "Flash log: %lu pendente(s)", (unsigned long)flash_log_pending());
+        return;
     }
+
+    ESP_LOGW(TAG, "✗ Dreno do flash log falhou (status=%d) - nova tentativa em %ds", status, FLASH_LOG_RETRY_MS / 1000);
+    flash_drain_at_us = now + (int64_t)FLASH_LOG_RETRY_MS * 1000;
 }
 
-// ============================================================================
-// HTTP POST TASK (Process queue and forward to backend)
-// ============================================================================
+/**
+ * Devolve às lanes o slot entregue, registrando a espera dele desde a recepção
+ */
+static void lane_release(const espnow_packet_t *packet, uint8_t lane)
+{
+    aguada_lanes_record_wait(&lanes, lane, esp_timer_get_time() - packet->rx_us);
+    aguada_lanes_release(&lanes);
+}
 
 static void http_post_task(void *pvParameters)
 {
-    espnow_packet_t packet;
+    const espnow_packet_t *packet;
+    uint8_t lane;
+
+    retry_init();
+    aguada_uplink_init(&uplink, &uplink_cfg, esp_timer_get_time());
+    aguada_lanes_bind_consumer(&lanes);
 
     while (1)
     {
-        // Wait for packet (block until available)
-        if (xQueueReceive(espnow_queue, &packet, pdMS_TO_TICKS(1000)))
+        int count = 0;
+        int64_t now = esp_timer_get_time();
+        bool urgent = false; // Envio leva alarme: sem espera de lote, ritmo limitado
+
+        // 1. Retries vencidos têm prioridade (já esperaram o backoff), e o
+        //    restante de um frame em lote/multicanal que não coube no envio
+        //    anterior - exceto com alarme esperando, que passa na frente
+        if (aguada_ring_count(&alarm_ring) == 0)
         {
-            char src_mac_str[18];
-            mac_to_string(packet.src_addr, src_mac_str);
+            while (count < uplink.batch && retry_next_deadline() <= now)
+            {
+                retry_pop(&upload_items[count++]);
+            }
+            count = batch_drain(count);
+            count = multi_drain(count);
+        }
 
-            // Log received packet
-            ESP_LOGI(TAG, "");
-            ESP_LOGI(TAG, "╔════════════════════════════════════════════════════╗");
-            ESP_LOGI(TAG, "║ ✓ ESP-NOW recebido de: %s (%d bytes)", src_mac_str, packet.len);
-            ESP_LOGI(TAG, "╠════════════════════════════════════════════════════╣");
-            ESP_LOGI(TAG, "║ Dados: %s", packet.payload);
-            ESP_LOGI(TAG, "╚════════════════════════════════════════════════════╝");
+        // 2. Pacotes novos: bloqueia até 1s ou até o próximo retry/lote do flash vencer
+        int64_t next_deadline = retry_next_deadline();
+        int64_t drain_deadline = flash_drain_deadline();
+        if (drain_deadline < next_deadline)
+        {
+            next_deadline = drain_deadline;
+        }
 
-            // Output JSON to Serial for backend Serial Bridge
-            // Use printf for clean output without ESP-IDF prefix
-            printf("TELEMETRY:%s\n", packet.payload);
-            fflush(stdout);
+        TickType_t wait = pdMS_TO_TICKS(1000);
+        if (count > 0 || next_deadline <= now)
+        {
+            wait = 0;
+        }
+        else if (next_deadline != INT64_MAX)
+        {
+            int64_t until_deadline_ms = (next_deadline - now) / 1000;
+            if (until_deadline_ms < 1000)
+            {
+                wait = pdMS_TO_TICKS(until_deadline_ms) + 1;
+            }
+        }
 
-            // Skip HTTP POST if WiFi not connected
-            if (!wifi_connected)
+        if (count < uplink.batch && (packet = aguada_lanes_peek(&lanes, wait, &lane)) != NULL)
+        {
+            // Drenar a fila até encher o lote ou estourar o prazo do primeiro pacote
+            // (sem espera extra se já há retries a enviar). Enquanto o ritmo AIMD
+            // segura o envio, o lote continua enchendo.
+            int64_t deadline = (count > 0) ? 0 : esp_timer_get_time() + (int64_t)BATCH_MAX_WAIT_MS * 1000;
+            if (uplink.state == AGUADA_UPLINK_CLOSED && uplink.send_at_us > deadline)
             {
-                ESP_LOGW(TAG, "⚠ WiFi desconectado - usando Serial Bridge");
-                continue;
+                deadline = uplink.send_at_us;
             }
 
-            // Retry com backoff exponencial
-            bool success = false;
-            for (int attempt = 0; attempt < MAX_RETRY_ATTEMPTS && !success; attempt++)
+            while (1)
             {
-                if (attempt > 0)
+                if (lane == LANE_ALARM)
                 {
-                    // Backoff exponencial: 1s, 2s, 4s
-                    int delay_ms = RETRY_BACKOFF_BASE_MS * (1 << (attempt - 1));
-                    ESP_LOGW(TAG, "Tentativa %d/%d após %dms...", attempt + 1, MAX_RETRY_ATTEMPTS, delay_ms);
-                    vTaskDelay(pdMS_TO_TICKS(delay_ms));
+                    urgent = true;
+                    deadline = 0; // Fecha o lote com o que já está no ring
                 }
 
-                // Make HTTP POST request (timeout increased to 5s for better reliability)
-                esp_http_client_config_t config = {
-                    .url = BACKEND_URL,
-                    .method = HTTP_METHOD_POST,
-                    .timeout_ms = 5000, // 5 seconds (increased for better reliability)
-                };
-
-                esp_http_client_handle_t client = esp_http_client_init(&config);
-                if (client)
+                // Um alarme passou na frente do restante de um frame do mesmo
+                // tipo: termina o anterior antes de desempacotar este
+                if (aguada_batch_detect((const uint8_t *)packet->payload, packet->len))
                 {
-                    esp_http_client_set_header(client, "Content-Type", "application/json");
-                    esp_http_client_set_post_field(client, packet.payload, packet.len);
-
-                    esp_err_t err = esp_http_client_perform(client);
-                    if (err == ESP_OK)
+                    count = batch_drain(count);
+                    if (count >= uplink.batch)
                     {
-                        int status = esp_http_client_get_status_code(client);
-                        if (status == 200 || status == 201)
-                        {
-                            gateway_metrics.packets_sent++;
-                            gateway_metrics.last_success_time = esp_timer_get_time();
-                            ESP_LOGI(TAG, "→ Enviado via HTTP (status=%d, tentativa %d)", status, attempt + 1);
-                            success = true;
-                        }
-                        else
-                        {
-                            gateway_metrics.http_errors++;
-                            ESP_LOGW(TAG, "✗ HTTP status=%d (tentativa %d)", status, attempt + 1);
-                        }
+                        break; // O frame fica no ring para o próximo envio
                     }
-                    else
+                    batch_unpack(packet);
+                    lane_release(packet, lane);
+                    count = batch_drain(count);
+                }
+                else if (aguada_multi_detect((const uint8_t *)packet->payload, packet->len))
+                {
+                    count = multi_drain(count);
+                    if (count >= uplink.batch)
                     {
-                        gateway_metrics.http_errors++;
-                        ESP_LOGW(TAG, "✗ HTTP error: %s (tentativa %d)", esp_err_to_name(err), attempt + 1);
+                        break;
                     }
-                    esp_http_client_cleanup(client);
+                    multi_unpack(packet);
+                    lane_release(packet, lane);
+                    count = multi_drain(count);
                 }
                 else
                 {
-                    ESP_LOGW(TAG, "✗ Falha ao criar cliente HTTP (tentativa %d)", attempt + 1);
+                    if (upload_accept(&upload_items[count], packet))
+                    {
+                        count++;
+                    }
+                    lane_release(packet, lane);
+                }
+
+                if (count >= uplink.batch)
+                {
+                    break;
+                }
+                int64_t remaining_us = deadline - esp_timer_get_time();
+                TickType_t ticks = (remaining_us > 0) ? pdMS_TO_TICKS(remaining_us / 1000) + 1 : 0;
+                if ((packet = aguada_lanes_peek(&lanes, ticks, &lane)) == NULL)
+                {
+                    break;
                 }
             }
+        }
+
+        if (count == 0)
+        {
+            // 3. Ocioso: drenar o flash log (pacotes novos sempre têm prioridade)
+            if (flash_drain_deadline() <= esp_timer_get_time())
+            {
+                flash_log_drain();
+            }
+            continue;
+        }
 
-            if (!success)
+        // Skip HTTP POST if WiFi not connected
+        if (!wifi_connected)
+        {
+            ESP_LOGW(TAG, "⚠ WiFi desconectado - usando Serial Bridge");
+            http_client_reset();
+            for (int i = 0; i < count; i++)
             {
-                gateway_metrics.packets_failed++;
-                ESP_LOGE(TAG, "✗ Falha ao enviar após %d tentativas - pacote descartado", MAX_RETRY_ATTEMPTS);
+                if (!spool_item(&upload_items[i]))
+                {
+                    gateway_metrics.packets_dropped++;
+                }
             }
+            continue;
+        }
+
+        // Circuito aberto: direto para o store-and-forward
+        if (!uplink_allow())
+        {
+            uplink_divert(count);
+            continue;
+        }
+
+        // Ritmo AIMD (429/503): segura o envio até o intervalo corrente vencer
+        int64_t pace_us = uplink.send_at_us - esp_timer_get_time();
+        if (urgent && pace_us > (int64_t)ALARM_PACE_MAX_MS * 1000)
+        {
+            pace_us = (int64_t)ALARM_PACE_MAX_MS * 1000;
+        }
+        if (pace_us > 0)
+        {
+            vTaskDelay(pdMS_TO_TICKS(pace_us / 1000) + 1);
         }
+
+        upload_items_send(count);
     }
 }
 
@@ -270,29 +1640,8 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
         ESP_LOGI(TAG, "✓ WiFi connected! IP: " IPSTR, IP2STR(&event->ip_info.ip));
         wifi_connected = true;
 
-        // Tentar reenviar pacotes do buffer de fallback
-        if (fallback_buffer_count > 0)
-        {
-            ESP_LOGI(TAG, "Reenviando %d pacotes do buffer...", fallback_buffer_count);
-            for (int i = 0; i < fallback_buffer_count; i++)
-            {
-                // Tentar adicionar à queue novamente
-                if (xQueueSend(espnow_queue, &fallback_buffer[i], pdMS_TO_TICKS(100)) == pdTRUE)
-                {
-                    fallback_buffer_count--;
-                    // Shift array
-                    for (int j = i; j < fallback_buffer_count; j++)
-                    {
-                        fallback_buffer[j] = fallback_buffer[j + 1];
-                    }
-                    i--; // Re-check this index
-                }
-            }
-            if (fallback_buffer_count > 0)
-            {
-                ESP_LOGW(TAG, "%d pacotes ainda no buffer após reconexão", fallback_buffer_count);
-            }
-        }
+        // Drenar o flash log imediatamente (http_post_task)
+        flash_drain_at_us = 0;
     }
 }
 
@@ -316,6 +1665,15 @@ static void wifi_init_sta(void)
     // Initialize network interface
     ESP_ERROR_CHECK(esp_netif_init());
 
+#if USE_FLASH_LOG
+    // Hora do relógio para o flash log (sincroniza quando o IP chegar)
+    if (SNTP_SERVER[0] != '\0')
+    {
+        esp_sntp_config_t sntp_config = ESP_NETIF_SNTP_DEFAULT_CONFIG(SNTP_SERVER);
+        esp_netif_sntp_init(&sntp_config);
+    }
+#endif
+
     // Create default event loop
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
@@ -373,8 +1731,8 @@ static void espnow_init(void)
 
     // Get gateway MAC
     esp_wifi_get_mac(WIFI_IF_STA, gateway_mac);
-    char mac_str[18];
-    mac_to_string(gateway_mac, mac_str);
+    char mac_str[AGUADA_MAC_STR_LEN];
+    aguada_mac_to_string(gateway_mac, mac_str);
     ESP_LOGI(TAG, "Gateway MAC: %s", mac_str);
 
     // Initialize ESP-NOW
@@ -451,6 +1809,9 @@ static void heartbeat_task(void *pvParameters)
 
 static void metrics_task(void *pvParameters)
 {
+    // Métricas + um objeto por node (estático: não cabe na pilha da task)
+    static char metrics_json[2560 + AGUADA_NODE_TABLE_MAX_NODES * AGUADA_NODE_JSON_MAX];
+
     while (1)
     {
         vTaskDelay(pdMS_TO_TICKS(METRICS_INTERVAL_MS));
@@ -460,13 +1821,45 @@ static void metrics_task(void *pvParameters)
             continue;
         }
 
-        // Calcular uso da queue
-        UBaseType_t queue_messages = uxQueueMessagesWaiting(espnow_queue);
-        int queue_usage_percent = (queue_messages * 100) / 50; // 50 é o tamanho da queue
+        // Calcular uso dos rings (todas as lanes)
+        int queue_usage_percent = (aguada_lanes_count(&lanes) * 100) / (ESPNOW_RING_SIZE + ALARM_RING_SIZE);
+
+        // Profundidade, vazão e espera (recepção → worker) por lane
+        char lanes_json[LANE_COUNT * 144];
+        int lanes_len = 0;
+        for (int i = 0; i < LANE_COUNT; i++)
+        {
+            const aguada_ring_t *ring = lanes.rings[i];
+            const aguada_lane_stats_t *stats = &lanes.stats[i];
+            lanes_len += snprintf(lanes_json + lanes_len, sizeof(lanes_json) - lanes_len,
+                                  "%s{\"lane\":\"%s\",\"depth\":%lu,\"peak\":%lu,\"full\":%lu,\"served\":%lu,"
+                                  "\"wait_avg_ms\":%lu,\"wait_max_ms\":%lu}",
+                                  i ? "," : "", LANE_NAMES[i], (unsigned long)aguada_ring_count(ring),
+                                  (unsigned long)ring->high_water, (unsigned long)ring->dropped,
+                                  (unsigned long)stats->served, (unsigned long)(stats->wait_avg_us / 1000),
+                                  (unsigned long)(stats->wait_max_us / 1000));
+        }
+
+        mqtt_sink_stats_t mqtt_stats = {0};
+#if UPLINK_SINK == UPLINK_SINK_MQTT
+        mqtt_sink_get_stats(&mqtt_stats);
+#endif
+
+        flash_log_stats_t flash_stats = {0};
+        if (flash_log_ready)
+        {
+            flash_log_get_stats(&flash_stats);
+        }
+
+        int64_t now = esp_timer_get_time();
+
+        uint32_t edge_holds = 0;
+#if USE_EDGE_COMPRESSION
+        edge_holds = edge.holds;
+#endif
 
-        // Preparar JSON de métricas
-        char metrics_json[512];
-        snprintf(metrics_json, sizeof(metrics_json),
+        // Preparar JSON de métricas ("nodes" entra antes do fechamento)
+        int len = snprintf(metrics_json, sizeof(metrics_json),
                  "{"
                  "\"mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\","
                  "\"metrics\":{"
@@ -476,13 +1869,56 @@ static void metrics_task(void *pvParameters)
                  "\"packets_dropped\":%lu,"
                  "\"http_errors\":%lu,"
                  "\"queue_full_count\":%lu,"
+                 "\"http_reused\":%lu,"
+                 "\"http_reconnects\":%lu,"
+                 "\"batches_sent\":%lu,"
+                 "\"retry_pending\":%d,"
+                 "\"retry_scheduled\":%lu,"
+                 "\"retry_expired\":%lu,"
+                 "\"retry_overflow\":%lu,"
+                 "\"queue_peak\":%lu,"
+                 "\"flash_pending\":%lu,"
+                 "\"flash_spooled\":%lu,"
+                 "\"flash_drained\":%lu,"
+                 "\"flash_overwritten\":%lu,"
+                 "\"flash_max_erase\":%lu,"
+                 "\"binary_frames\":%lu,"
+                 "\"crc_errors\":%lu,"
+                 "\"batch_frames\":%lu,"
+                 "\"batch_readings\":%lu,"
+                 "\"multi_frames\":%lu,"
+                 "\"multi_readings\":%lu,"
+                 "\"link_probes\":%lu,"
+                 "\"link_reports\":%lu,"
+                 "\"mqtt_connected\":%s,"
+                 "\"mqtt_inflight\":%lu,"
+                 "\"mqtt_acked\":%lu,"
+                 "\"mqtt_deleted\":%lu,"
+                 "\"mqtt_connects\":%lu,"
+                 "\"uplink_state\":\"%s\","
+                 "\"uplink_transitions\":%lu,"
+                 "\"uplink_opens\":%lu,"
+                 "\"uplink_probes\":%lu,"
+                 "\"uplink_closed_ms\":%lld,"
+                 "\"uplink_open_ms\":%lld,"
+                 "\"uplink_half_open_ms\":%lld,"
+                 "\"uplink_diverted\":%lu,"
+                 "\"uplink_throttled\":%lu,"
+                 "\"uplink_batch\":%u,"
+                 "\"uplink_interval_ms\":%lu,"
+                 "\"nodes_tracked\":%u,"
+                 "\"nodes_untracked\":%lu,"
+                 "\"dup_dropped\":%lu,"
+                 "\"edge_dropped\":%lu,"
+                 "\"edge_holds\":%lu,"
                  "\"queue_usage_percent\":%d,"
+                 "\"lane_yields\":%lu,"
+                 "\"lanes\":[%s],"
                  "\"wifi_connected\":%s,"
                  "\"last_packet_time\":%lld,"
                  "\"last_success_time\":%lld,"
-                 "\"uptime_seconds\":%lld"
-                 "}"
-                 "}",
+                 "\"uptime_seconds\":%lld,"
+                 "\"nodes\":",
                  gateway_mac[0], gateway_mac[1], gateway_mac[2], gateway_mac[3], gateway_mac[4], gateway_mac[5],
                  gateway_metrics.packets_received,
                  gateway_metrics.packets_sent,
@@ -490,11 +1926,65 @@ static void metrics_task(void *pvParameters)
                  gateway_metrics.packets_dropped,
                  gateway_metrics.http_errors,
                  gateway_metrics.queue_full_count,
+                 gateway_metrics.http_reused,
+                 gateway_metrics.http_reconnects,
+                 gateway_metrics.batches_sent,
+                 retry_count,
+                 gateway_metrics.retry_scheduled,
+                 gateway_metrics.retry_expired,
+                 gateway_metrics.retry_overflow,
+                 espnow_ring.high_water,
+                 flash_stats.pending,
+                 gateway_metrics.flash_spooled,
+                 gateway_metrics.flash_drained,
+                 flash_stats.overwritten,
+                 flash_stats.max_erase,
+                 gateway_metrics.binary_frames,
+                 gateway_metrics.crc_errors,
+                 gateway_metrics.batch_frames,
+                 gateway_metrics.batch_readings,
+                 gateway_metrics.multi_frames,
+                 gateway_metrics.multi_readings,
+                 gateway_metrics.link_probes,
+                 gateway_metrics.link_reports,
+                 mqtt_stats.connected ? "true" : "false",
+                 mqtt_stats.inflight,
+                 mqtt_stats.acked,
+                 mqtt_stats.deleted,
+                 mqtt_stats.connects,
+                 aguada_uplink_state_name(uplink.state),
+                 uplink.transitions,
+                 uplink.opens,
+                 uplink.probes,
+                 aguada_uplink_state_ms(&uplink, AGUADA_UPLINK_CLOSED, now),
+                 aguada_uplink_state_ms(&uplink, AGUADA_UPLINK_OPEN, now),
+                 aguada_uplink_state_ms(&uplink, AGUADA_UPLINK_HALF_OPEN, now),
+                 gateway_metrics.uplink_diverted,
+                 uplink.throttled,
+                 uplink.batch,
+                 uplink.interval_ms,
+                 node_table.count,
+                 node_table.untracked,
+                 gateway_metrics.dup_dropped,
+                 gateway_metrics.edge_dropped,
+                 edge_holds,
                  queue_usage_percent,
+                 lanes.yields,
+                 lanes_json,
                  wifi_connected ? "true" : "false",
                  gateway_metrics.last_packet_time / 1000000, // Converter para segundos
                  gateway_metrics.last_success_time / 1000000,
-                 esp_timer_get_time() / 1000000);
+                 now / 1000000);
+
+        int nodes_len = aguada_node_table_json(&node_table, now, metrics_json + len, sizeof(metrics_json) - len - 2);
+        if (nodes_len < 0)
+        {
+            nodes_len = snprintf(metrics_json + len, sizeof(metrics_json) - len - 2, "[]");
+        }
+        len += nodes_len;
+        metrics_json[len++] = '}';
+        metrics_json[len++] = '}';
+        metrics_json[len] = '\0';
 
         // Enviar métricas via HTTP POST
         esp_http_client_config_t config = {
@@ -507,7 +1997,7 @@ static void metrics_task(void *pvParameters)
         if (client)
         {
             esp_http_client_set_header(client, "Content-Type", "application/json");
-            esp_http_client_set_post_field(client, metrics_json, strlen(metrics_json));
+            esp_http_client_set_post_field(client, metrics_json, len);
 
             esp_err_t err = esp_http_client_perform(client);
             if (err == ESP_OK)
@@ -537,18 +2027,39 @@ void app_main(void)
     ESP_LOGI(TAG, "╚═══════════════════════════════════════════════════════════╝");
     ESP_LOGI(TAG, "");
 
-    // Create packet queue (increased to 50 slots for better buffering)
-    espnow_queue = xQueueCreate(50, sizeof(espnow_packet_t));
-    if (!espnow_queue)
+    aguada_link_table_init(&link_table, LINK_REPORT_INTERVAL_MS);
+    aguada_node_table_init(&node_table);
+#if USE_EDGE_COMPRESSION
+    aguada_edge_init(&edge, &edge_cfg);
+#endif
+
+    // Ring de pacotes ESP-NOW (slots estáticos, sem cópia extra)
+    ESP_ERROR_CHECK(aguada_ring_init(&espnow_ring, espnow_slots, sizeof(espnow_packet_t), ESPNOW_RING_SIZE));
+    ESP_ERROR_CHECK(aguada_ring_init(&alarm_ring, alarm_slots, sizeof(espnow_packet_t), ALARM_RING_SIZE));
+    aguada_ring_t *const lane_rings[LANE_COUNT] = {[LANE_ALARM] = &alarm_ring, [LANE_ROUTINE] = &espnow_ring};
+    ESP_ERROR_CHECK(aguada_lanes_init(&lanes, lane_rings, LANE_COUNT, LANE_BURST_MAX));
+    for (size_t i = 0; i < sizeof(PRIORITY_NODES) / sizeof(PRIORITY_NODES[0]); i++)
     {
-        ESP_LOGE(TAG, "Falha ao criar fila ESP-NOW");
-        return;
+        if (PRIORITY_NODES[i][0] != '\0' && aguada_mac_parse(PRIORITY_NODES[i], priority_macs[priority_count]))
+        {
+            priority_count++;
+        }
     }
-    ESP_LOGI(TAG, "✓ Fila ESP-NOW criada (50 slots)");
+    ESP_LOGI(TAG, "✓ Rings ESP-NOW criados (rotina %d, alarmes %d slots, %d node(s) prioritário(s))",
+             ESPNOW_RING_SIZE, ALARM_RING_SIZE, priority_count);
 
     // Initialize GPIO
     gpio_init();
 
+#if USE_FLASH_LOG
+    // Flash log (store-and-forward) - antes da http_post_task
+    flash_log_ready = (flash_log_init() == ESP_OK);
+    if (!flash_log_ready)
+    {
+        ESP_LOGW(TAG, "⚠ Flash log indisponível - pacotes serão perdidos em quedas longas");
+    }
+#endif
+
     // Initialize WiFi (full STA mode for HTTP)
     wifi_init_sta();
 
@@ -559,6 +2070,17 @@ void app_main(void)
     // Initialize ESP-NOW (after WiFi is up)
     espnow_init();
 
+#if UPLINK_SINK == UPLINK_SINK_MQTT
+    // Sessão MQTT persistente: client_id fixo derivado do MAC do gateway
+    static char mqtt_client_id[32];
+    snprintf(mqtt_client_id, sizeof(mqtt_client_id), "aguada-gw-%02X%02X%02X",
+             gateway_mac[3], gateway_mac[4], gateway_mac[5]);
+    if (mqtt_sink_init(MQTT_BROKER_URI, mqtt_client_id, MQTT_INFLIGHT_MAX) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Falha ao iniciar MQTT sink");
+    }
+#endif
+
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "✓ Gateway inicializado e pronto!");
     ESP_LOGI(TAG, "  - Canal ESP-NOW: %d (fixo)", ESPNOW_CHANNEL);
@@ -572,7 +2094,7 @@ void app_main(void)
     xTaskCreate(http_post_task, "http_post", 4096, NULL, 5, NULL);
 
     // Create metrics task (send metrics periodically)
-    xTaskCreate(metrics_task, "metrics", 4096, NULL, 3, NULL);
+    xTaskCreate(metrics_task, "metrics", 6144, NULL, 3, NULL);
 
     // Keep main task alive
     while (1)
@@ -0,0 +1,171 @@
+/**
+ * AGUADA - MQTT Sink
+ *
+ * Ver mqtt_sink.h. A janela de in-flight é um contador: incrementado pela
+ * http_post_task a cada publish, decrementado na task do esp-mqtt a cada
+ * PUBACK (MQTT_EVENT_PUBLISHED) ou expiração no outbox (MQTT_EVENT_DELETED).
+ * Um semáforo binário acorda quem espera janela/conexão.
+ */
+
+#include "mqtt_sink.h"
+
+#include "esp_log.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "mqtt_client.h"
+
+#define TAG "MQTT_SINK"
+
+#define MQTT_KEEPALIVE_S 30
+#define MQTT_RECONNECT_MS 5000
+
+// Expiração do outbox (Kconfig do esp-mqtt): precisa cobrir quedas do broker
+#ifndef CONFIG_MQTT_OUTBOX_EXPIRED_TIMEOUT_MS
+#define CONFIG_MQTT_OUTBOX_EXPIRED_TIMEOUT_MS 30000
+#endif
+#define MQTT_OUTBOX_EXPIRY_MIN_MS (60 * 60 * 1000)
+
+static esp_mqtt_client_handle_t mqtt_client = NULL;
+static SemaphoreHandle_t window_sem = NULL;
+static uint32_t window_max = 0;
+
+static volatile bool connected = false;
+static uint32_t inflight = 0; // Acesso atômico (duas tasks)
+static mqtt_sink_stats_t stats = {0};
+
+static void window_release(void)
+{
+    uint32_t current = __atomic_load_n(&inflight, __ATOMIC_ACQUIRE);
+    while (current > 0 &&
+           !__atomic_compare_exchange_n(&inflight, &current, current - 1, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+    }
+    xSemaphoreGive(window_sem);
+}
+
+static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    esp_mqtt_event_handle_t event = (esp_mqtt_event_handle_t)event_data;
+
+    switch ((esp_mqtt_event_id_t)event_id)
+    {
+    case MQTT_EVENT_CONNECTED:
+        connected = true;
+        stats.connects++;
+        ESP_LOGI(TAG, "✓ Conectado ao broker (sessão %s)",
+                 event->session_present ? "retomada" : "nova");
+        xSemaphoreGive(window_sem);
+        break;
+
+    case MQTT_EVENT_DISCONNECTED:
+        connected = false;
+        ESP_LOGW(TAG, "Broker desconectado - %lu publicação(ões) no outbox",
+                 (unsigned long)__atomic_load_n(&inflight, __ATOMIC_ACQUIRE));
+        break;
+
+    case MQTT_EVENT_PUBLISHED:
+        stats.acked++;
+        window_release();
+        break;
+
+    case MQTT_EVENT_DELETED:
+        // Outbox descartou a mensagem sem PUBACK (expirou)
+        stats.deleted++;
+        ESP_LOGE(TAG, "✗ Publicação msg_id=%d expirou no outbox após %lus (perdida)", event->msg_id,
+                 (unsigned long)(CONFIG_MQTT_OUTBOX_EXPIRED_TIMEOUT_MS / 1000));
+        window_release();
+        break;
+
+    case MQTT_EVENT_ERROR:
+        ESP_LOGW(TAG, "Erro MQTT (tipo %d)", event->error_handle ? (int)event->error_handle->error_type : -1);
+        break;
+
+    default:
+        break;
+    }
+}
+
+esp_err_t mqtt_sink_init(const char *uri, const char *client_id, uint32_t inflight_max)
+{
+    window_sem = xSemaphoreCreateBinary();
+    if (!window_sem)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    window_max = inflight_max;
+
+    esp_mqtt_client_config_t config = {
+        .broker.address.uri = uri,
+        .credentials.client_id = client_id,
+        .session.disable_clean_session = true, // Sessão persistente no broker
+        .session.keepalive = MQTT_KEEPALIVE_S,
+        .network.reconnect_timeout_ms = MQTT_RECONNECT_MS,
+    };
+
+    mqtt_client = esp_mqtt_client_init(&config);
+    if (!mqtt_client)
+    {
+        return ESP_FAIL;
+    }
+
+    esp_mqtt_client_register_event(mqtt_client, ESP_EVENT_ANY_ID, mqtt_event_handler, NULL);
+    esp_err_t err = esp_mqtt_client_start(mqtt_client);
+    if (err == ESP_OK)
+    {
+        ESP_LOGI(TAG, "✓ MQTT sink: %s (client_id=%s, janela=%lu, outbox expira em %lus)", uri, client_id,
+                 (unsigned long)inflight_max, (unsigned long)(CONFIG_MQTT_OUTBOX_EXPIRED_TIMEOUT_MS / 1000));
+        if (CONFIG_MQTT_OUTBOX_EXPIRED_TIMEOUT_MS < MQTT_OUTBOX_EXPIRY_MIN_MS)
+        {
+            ESP_LOGW(TAG, "⚠ Outbox expira antes de 1 h - quedas do broker mais longas perdem publicações "
+                          "(ajustar CONFIG_MQTT_OUTBOX_EXPIRED_TIMEOUT_MS)");
+        }
+    }
+    return err;
+}
+
+bool mqtt_sink_acquire(int n, TickType_t wait)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    while (!connected || __atomic_load_n(&inflight, __ATOMIC_ACQUIRE) + n > window_max)
+    {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= wait)
+        {
+            return false;
+        }
+        xSemaphoreTake(window_sem, wait - elapsed);
+    }
+    return true;
+}
+
+int mqtt_sink_publish(const char *topic, const char *data, int len)
+{
+    if (!mqtt_client)
+    {
+        return -1;
+    }
+
+    // Conta na janela antes do enqueue: o PUBACK pode chegar antes do retorno
+    __atomic_fetch_add(&inflight, 1, __ATOMIC_ACQ_REL);
+
+    // store=true: fica no outbox e é retransmitida após reconexão
+    int msg_id = esp_mqtt_client_enqueue(mqtt_client, topic, data, len, 1, 0, true);
+    if (msg_id < 0)
+    {
+        __atomic_fetch_sub(&inflight, 1, __ATOMIC_ACQ_REL);
+        ESP_LOGW(TAG, "✗ Outbox recusou publicação em %s", topic);
+        return -1;
+    }
+
+    stats.published++;
+    return msg_id;
+}
+
+void mqtt_sink_get_stats(mqtt_sink_stats_t *out)
+{
+    *out = stats;
+    out->connected = connected;
+    out->inflight = __atomic_load_n(&inflight, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,56 @@
+/**
+ * AGUADA - MQTT Sink (uplink alternativo ao HTTP)
+ *
+ * Sessão MQTT persistente com o broker (Mosquitto):
+ * - clean_session=false + client_id fixo: o broker guarda a sessão entre
+ *   reconexões
+ * - Publicações QoS1 entram no outbox do esp-mqtt e são retransmitidas após
+ *   reconexão até o PUBACK - nada enfileirado se perde numa queda mais curta
+ *   que CONFIG_MQTT_OUTBOX_EXPIRED_TIMEOUT_MS (sdkconfig.defaults: 24 h; o
+ *   padrão do esp-mqtt, 30 s, perderia o outbox em qualquer queda do broker)
+ * - Janela de in-flight: no máximo `inflight_max` publicações sem PUBACK;
+ *   quem publica espera janela em mqtt_sink_acquire()
+ *
+ * Publicação deve vir de uma única task (http_post_task). Os eventos do
+ * esp-mqtt rodam na task do cliente MQTT e só atualizam contadores.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef struct
+{
+    bool connected;
+    uint32_t inflight;   // Publicações aguardando PUBACK
+    uint32_t published;  // Publicações aceitas no outbox
+    uint32_t acked;      // PUBACKs recebidos
+    uint32_t deleted;    // Expiradas no outbox sem PUBACK (perdidas)
+    uint32_t connects;   // Conexões estabelecidas com o broker
+} mqtt_sink_stats_t;
+
+/**
+ * Cria o cliente e inicia a conexão (reconecta sozinho; pode ser chamado
+ * antes do WiFi subir)
+ */
+esp_err_t mqtt_sink_init(const char *uri, const char *client_id, uint32_t inflight_max);
+
+/**
+ * Espera até `wait` ticks por conexão ativa e espaço para `n` publicações
+ *
+ * @return false se o broker está desconectado ou a janela continua cheia
+ */
+bool mqtt_sink_acquire(int n, TickType_t wait);
+
+/**
+ * Publica (QoS1, sem retain) via outbox, sem bloquear
+ *
+ * @return msg_id (>= 0) ou -1 se o outbox recusou
+ */
+int mqtt_sink_publish(const char *topic, const char *data, int len);
+
+void mqtt_sink_get_stats(mqtt_sink_stats_t *out);
@@ -4,6 +4,8 @@
  *
  * Firmware mínimo para gateway ESP32-C3 SuperMini:
  * - Recebe pacotes ESP-NOW de todos os nodes (broadcast)
+ * - Responde às sondas dos nodes (aguada_link) para que passem a unicast com ACK
+ * - Relata a cada node o RSSI/perda medidos aqui (potência de TX adaptativa)
  * - Envia JSON via USB Serial (printf)
  * - LED indica recepção
  * - NÃO precisa de WiFi/rede!
@@ -20,7 +22,6 @@
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
 #include "esp_system.h"
 #include "esp_log.h"
 #include "esp_netif.h"
@@ -31,6 +32,10 @@
 #include "esp_timer.h"
 #include "nvs_flash.h"
 #include "driver/gpio.h"
+#include "aguada_proto.h"
+#include "aguada_ring.h"
+#include "aguada_link_table.h"
+#include "aguada_node_table.h"
 
 // ============================================================================
 // CONFIGURAÇÃO
@@ -47,8 +52,14 @@
 #define ESPNOW_CHANNEL 11   // Mesmo canal dos sensores!
 #define MAX_PACKET_SIZE 250 // Tamanho máximo do pacote
 
-// Queue
-#define QUEUE_SIZE 30 // Tamanho da fila de pacotes
+// Ring de pacotes (callback → serial_task)
+#define RING_SIZE 32 // Slots do ring (potência de 2)
+
+// Campo ,"idem":"<MAC>/<seq>/<índice>" acrescentado às linhas com seq
+#define IDEM_FIELD_MAX 40
+
+// Relatório de enlace por node (RSSI/perda vistos aqui)
+#define LINK_REPORT_INTERVAL_MS 30000 // No máximo um por node neste intervalo
 
 // ============================================================================
 // ESTRUTURAS
@@ -57,7 +68,7 @@
 typedef struct
 {
     uint8_t mac[6];
-    uint8_t data[MAX_PACKET_SIZE];
+    uint8_t data[MAX_PACKET_SIZE + 1]; // +1 para o '\0' da serial_task
     int len;
     int rssi;
     int64_t timestamp;
@@ -68,18 +79,111 @@ typedef struct
 // ============================================================================
 
 static const char *TAG = "GW_USB";
-static QueueHandle_t packet_queue;
-static char gateway_mac_str[18];
+static espnow_packet_t packet_slots[RING_SIZE];
+static aguada_ring_t packet_ring;
+static char gateway_mac_str[AGUADA_MAC_STR_LEN];
 
 // Estatísticas
 static uint32_t packets_received = 0;
 static uint32_t packets_processed = 0;
 static uint32_t packets_dropped = 0;
+static uint32_t crc_errors = 0;
+static uint32_t batch_frames = 0;
+static uint32_t multi_frames = 0;
+static uint32_t link_probes = 0;
+static uint32_t dup_dropped = 0;
+static aguada_link_table_t link_table;
+
+// Estado por node (seq, perda, intervalo, RSSI) - escrito só pela serial_task
+static aguada_node_table_t node_table;
+static char nodes_json[AGUADA_NODE_TABLE_MAX_NODES * AGUADA_NODE_JSON_MAX + 3];
+
+static const uint8_t BROADCAST_MAC[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// Leituras de um frame em lote (usado só pela serial_task)
+static aguada_batch_item_t batch_items[AGUADA_BATCH_MAX_READINGS];
+
+// Canais de um frame multicanal e a linha JSON dele (usados só pela serial_task)
+static aguada_reading_t multi_channels[AGUADA_MULTI_MAX_CHANNELS];
+static char multi_json[AGUADA_MULTI_JSON_MAX(AGUADA_MULTI_MAX_CHANNELS)];
 
 // ============================================================================
 // FUNÇÕES ESP-NOW
 // ============================================================================
 
+/**
+ * @brief Registra um frame válido na tabela de nodes (has_seq = trouxe seq)
+ *
+ * @return false se o frame é repetido (reenvio já recebido): descartar
+ */
+static bool node_rx(const espnow_packet_t *pkt, const char *sender_mac, bool has_seq, uint8_t seq)
+{
+    aguada_node_entry_t *entry;
+    aguada_node_rx_t rx = aguada_node_table_rx(&node_table, pkt->mac, has_seq, seq, pkt->rssi, pkt->timestamp, &entry);
+    if (rx == AGUADA_NODE_DUP)
+    {
+        dup_dropped++;
+        ESP_LOGD(TAG, "Frame repetido de %s descartado (seq %u)", sender_mac, seq);
+        return false;
+    }
+    if (rx == AGUADA_NODE_GAP || rx == AGUADA_NODE_RESET)
+    {
+        ESP_LOGW(TAG, "Node %s: seq %u (%s, %lu perdido(s), perda %u%%)", sender_mac, seq,
+                 (rx == AGUADA_NODE_GAP) ? "salto" : "reinício", (unsigned long)entry->lost,
+                 aguada_node_loss_pct(entry));
+    }
+    return true;
+}
+
+/**
+ * @brief Campo da chave de idempotência: ,"idem":"<MAC do rádio>/<seq>[/<índice>]"
+ *
+ * Igual em todos os gateways que receberem o frame - o backend descarta a
+ * segunda cópia por ela. Sem seq, campo vazio. index < 0: sem índice (linha
+ * multicanal; o backend acrescenta o índice de cada canal).
+ */
+static void idem_field(char *out, size_t size, const char *radio_mac, bool has_seq, uint8_t seq, int index)
+{
+    if (!has_seq)
+    {
+        out[0] = '\0';
+    }
+    else if (index < 0)
+    {
+        snprintf(out, size, ",\"idem\":\"%s/%u\"", radio_mac, seq);
+    }
+    else
+    {
+        snprintf(out, size, ",\"idem\":\"%s/%u/%d\"", radio_mac, seq, index);
+    }
+}
+
+/**
+ * @brief Responde a uma sonda com um beacon em broadcast
+ *
+ * O node ainda não é peer, então o beacon vai em broadcast com o MAC dele no
+ * corpo; a origem do frame é o MAC deste gateway. Leva o RSSI da sonda.
+ */
+static void link_reply(const esp_now_recv_info_t *info, const uint8_t *data, int len)
+{
+    aguada_link_msg_t msg;
+    if (aguada_link_decode(data, (size_t)len, &msg) != AGUADA_PROTO_OK || msg.type != AGUADA_LINK_PROBE)
+    {
+        return;
+    }
+
+    uint8_t frame[AGUADA_LINK_SIZE];
+    msg.type = AGUADA_LINK_BEACON;
+    memcpy(msg.mac, info->src_addr, 6);
+    msg.rssi = (int8_t)info->rx_ctrl->rssi;
+    msg.loss_pct = 0;
+    aguada_link_encode(&msg, frame);
+
+    // Só enfileira no rádio (não bloqueia o callback)
+    esp_now_send(BROADCAST_MAC, frame, sizeof(frame));
+    link_probes++;
+}
+
 /**
  * @brief Callback de recepção ESP-NOW (ESP-IDF 6.x signature)
  */
@@ -91,25 +195,43 @@ static void espnow_recv_cb(const esp_now_recv_info_t *info, const uint8_t *data,
         return;
     }
 
+    // Sonda de enlace: responde já (o node espera poucos ms) e não vai ao ring
+    if (aguada_link_detect(data, (size_t)len))
+    {
+        link_reply(info, data, len);
+        return;
+    }
+
     packets_received++;
 
+    // Relatório de enlace para o node (sai logo após o frame dele, com o rádio do node ligado)
+    aguada_link_msg_t report;
+    if (aguada_link_table_rx(&link_table, info->src_addr, info->rx_ctrl->rssi, esp_timer_get_time(), &report))
+    {
+        uint8_t frame[AGUADA_LINK_SIZE];
+        aguada_link_encode(&report, frame);
+        esp_now_send(BROADCAST_MAC, frame, sizeof(frame));
+    }
+
     // Pisca LED
     gpio_set_level(GPIO_LED, 1);
 
-    // Cria pacote para a fila
-    espnow_packet_t pkt;
-    memcpy(pkt.mac, info->src_addr, 6);
-    memcpy(pkt.data, data, len);
-    pkt.len = len;
-    pkt.rssi = info->rx_ctrl->rssi;
-    pkt.timestamp = esp_timer_get_time();
-
-    // Envia para a fila (não bloqueia)
-    if (xQueueSend(packet_queue, &pkt, 0) != pdTRUE)
+    // Escreve direto no slot livre do ring (não bloqueia)
+    espnow_packet_t *pkt = aguada_ring_claim(&packet_ring);
+    if (pkt == NULL)
     {
         packets_dropped++;
-        ESP_LOGW(TAG, "Queue cheia, pacote descartado (drops=%lu)", (unsigned long)packets_dropped);
+        ESP_LOGW(TAG, "Ring cheio, pacote descartado (drops=%lu)", (unsigned long)packets_dropped);
+        return;
     }
+
+    memcpy(pkt->mac, info->src_addr, 6);
+    memcpy(pkt->data, data, len);
+    pkt->len = len;
+    pkt->rssi = info->rx_ctrl->rssi;
+    pkt->timestamp = esp_timer_get_time();
+
+    aguada_ring_publish(&packet_ring);
 }
 
 /**
@@ -149,6 +271,13 @@ static esp_err_t init_espnow(void)
     // Registra callback de recepção
     ESP_ERROR_CHECK(esp_now_register_recv_cb(espnow_recv_cb));
 
+    // Peer de broadcast para os beacons de resposta às sondas
+    esp_now_peer_info_t peer = {0};
+    memcpy(peer.peer_addr, BROADCAST_MAC, 6);
+    peer.channel = 0;
+    peer.encrypt = false;
+    ESP_ERROR_CHECK(esp_now_add_peer(&peer));
+
     ESP_LOGI(TAG, "ESP-NOW inicializado com sucesso");
     return ESP_OK;
 }
@@ -162,65 +291,182 @@ static esp_err_t init_espnow(void)
  *
  * Formato de saída:
  * - Se JSON válido: adiciona rssi e imprime
+ * - Se frame binário AGUADA-1 com CRC válido: {"mac","bin":"<hex>","rssi"}
+ *   (decodificado pelo backend); CRC inválido é descartado
+ * - Se frame em lote válido: uma linha JSON AGUADA-1 por leitura, com
+ *   "age_ms" = idade da leitura agora (idade no frame + espera no ring)
+ * - Se frame multicanal válido: uma linha {"mac","vcc_bat_mv","rssi",..,
+ *   "channels":[...]} (o backend expande em uma leitura por sensor)
  * - Se não-JSON: encapsula em JSON
+ *
+ * Frames com seq repetido (aguada_node_table) não saem; os demais levam
+ * "idem" = MAC do rádio/seq/índice da leitura no frame.
  */
 static void serial_task(void *pvParameters)
 {
-    espnow_packet_t pkt;
+    espnow_packet_t *pkt;
 
+    aguada_ring_bind_consumer(&packet_ring);
     ESP_LOGI(TAG, "Serial bridge task iniciada");
 
     while (1)
     {
-        // Aguarda pacote na fila
-        if (xQueueReceive(packet_queue, &pkt, portMAX_DELAY) == pdTRUE)
+        // Aguarda pacote no ring (slot é da task até o release)
+        if ((pkt = aguada_ring_peek(&packet_ring, portMAX_DELAY)) != NULL)
         {
             // Formata MAC do sender
-            char sender_mac[18];
-            snprintf(sender_mac, sizeof(sender_mac),
-                     "%02X:%02X:%02X:%02X:%02X:%02X",
-                     pkt.mac[0], pkt.mac[1], pkt.mac[2],
-                     pkt.mac[3], pkt.mac[4], pkt.mac[5]);
+            char sender_mac[AGUADA_MAC_STR_LEN];
+            aguada_mac_to_string(pkt->mac, sender_mac);
 
             // Garante null-termination
-            pkt.data[pkt.len] = '\0';
+            pkt->data[pkt->len] = '\0';
 
             // Log de debug
-            ESP_LOGD(TAG, "RX de %s: %s (rssi=%d)", sender_mac, (char *)pkt.data, pkt.rssi);
+            ESP_LOGD(TAG, "RX de %s: %d bytes (rssi=%d)", sender_mac, pkt->len, pkt->rssi);
 
             // Verifica se é JSON válido (começa com {)
-            if (pkt.data[0] == '{')
+            if (aguada_bin_detect(pkt->data, pkt->len))
             {
-                // JSON recebido - adiciona rssi se não existir
-                char *existing_rssi = strstr((char *)pkt.data, "\"rssi\"");
-
-                if (existing_rssi == NULL)
+                // Frame binário: valida versão/CRC e encaminha em hex
+                aguada_reading_t reading;
+                aguada_proto_err_t err = aguada_bin_decode(pkt->data, pkt->len, &reading);
+                if (err == AGUADA_PROTO_OK)
+                {
+                    if (node_rx(pkt, sender_mac, reading.has_seq, reading.seq))
+                    {
+                        char bin_hex[AGUADA_BIN_HEX_LEN];
+                        char idem[IDEM_FIELD_MAX];
+                        aguada_hex_encode(pkt->data, AGUADA_BIN_SIZE, bin_hex, sizeof(bin_hex));
+                        idem_field(idem, sizeof(idem), sender_mac, reading.has_seq, reading.seq, 0);
+                        printf("{\"mac\":\"%s\",\"bin\":\"%s\",\"rssi\":%d%s}\n", sender_mac, bin_hex, pkt->rssi, idem);
+                    }
+                }
+                else
+                {
+                    if (err == AGUADA_PROTO_ERR_CRC)
+                    {
+                        crc_errors++;
+                    }
+                    packets_dropped++;
+                    aguada_link_table_bad(&link_table, pkt->mac);
+                    ESP_LOGW(TAG, "Frame binário de %s descartado (%s)", sender_mac, aguada_proto_err_name(err));
+                }
+            }
+            else if (aguada_batch_detect(pkt->data, pkt->len))
+            {
+                aguada_reading_t reading;
+                size_t count;
+                aguada_proto_err_t err = aguada_batch_decode(pkt->data, pkt->len, &reading, batch_items,
+                                                             AGUADA_BATCH_MAX_READINGS, &count);
+                if (err == AGUADA_PROTO_OK)
+                {
+                    if (node_rx(pkt, sender_mac, reading.has_seq, reading.seq))
+                    {
+                        char json[AGUADA_JSON_MAX];
+                        char idem[IDEM_FIELD_MAX];
+                        reading.rssi = pkt->rssi; // Medido aqui (o node não sabe o seu)
+                        int32_t queued_ms = (int32_t)((esp_timer_get_time() - pkt->timestamp) / 1000);
+                        for (size_t i = 0; i < count; i++)
+                        {
+                            reading.distance_mm = batch_items[i].distance_mm;
+                            reading.age_ms = batch_items[i].age_ms + queued_ms;
+                            int len = aguada_json_encode(&reading, json, sizeof(json));
+                            idem_field(idem, sizeof(idem), sender_mac, reading.has_seq, reading.seq, (int)i);
+                            printf("%.*s%s}\n", len - 1, json, idem);
+                        }
+                        batch_frames++;
+                    }
+                }
+                else
+                {
+                    if (err == AGUADA_PROTO_ERR_CRC)
+                    {
+                        crc_errors++;
+                    }
+                    packets_dropped++;
+                    aguada_link_table_bad(&link_table, pkt->mac);
+                    ESP_LOGW(TAG, "Lote de %s descartado (%s)", sender_mac, aguada_proto_err_name(err));
+                }
+            }
+            else if (aguada_multi_detect(pkt->data, pkt->len))
+            {
+                aguada_reading_t node;
+                size_t count;
+                aguada_proto_err_t err = aguada_multi_decode(pkt->data, pkt->len, &node, multi_channels,
+                                                             AGUADA_MULTI_MAX_CHANNELS, &count);
+                if (err == AGUADA_PROTO_OK)
                 {
-                    // Remove o } final para adicionar rssi
-                    char *end_brace = strrchr((char *)pkt.data, '}');
+                    if (node_rx(pkt, sender_mac, node.has_seq, node.seq))
+                    {
+                        char idem[IDEM_FIELD_MAX];
+                        node.rssi = pkt->rssi; // Medido aqui (o node não sabe o seu)
+                        int len = aguada_multi_json_encode(&node, multi_channels, count, multi_json, sizeof(multi_json));
+                        idem_field(idem, sizeof(idem), sender_mac, node.has_seq, node.seq, -1);
+                        printf("%.*s%s}\n", len - 1, multi_json, idem);
+                        multi_frames++;
+                    }
+                }
+                else
+                {
+                    if (err == AGUADA_PROTO_ERR_CRC)
+                    {
+                        crc_errors++;
+                    }
+                    packets_dropped++;
+                    aguada_link_table_bad(&link_table, pkt->mac);
+                    ESP_LOGW(TAG, "Frame multicanal de %s descartado (%s)", sender_mac, aguada_proto_err_name(err));
+                }
+            }
+            else if (pkt->data[0] == '{')
+            {
+                // Só o seq interessa aqui; JSON que não decodifica segue como antes (sem seq)
+                aguada_reading_t reading;
+                bool has_seq = aguada_json_decode((char *)pkt->data, pkt->len, &reading) == AGUADA_PROTO_OK &&
+                               reading.has_seq;
+                char idem[IDEM_FIELD_MAX];
+                idem_field(idem, sizeof(idem), sender_mac, has_seq, has_seq ? reading.seq : 0, 0);
+
+                if (!node_rx(pkt, sender_mac, has_seq, has_seq ? reading.seq : 0))
+                {
+                    // Repetido: a primeira cópia já saiu
+                }
+                else if (strstr((char *)pkt->data, "\"rssi\"") == NULL)
+                {
+                    // JSON recebido - adiciona rssi (e idem); remove o } final
+                    char *end_brace = strrchr((char *)pkt->data, '}');
+                    if (end_brace)
+                    {
+                        *end_brace = '\0';
+                    }
+                    printf("%s,\"rssi\":%d%s}\n", (char *)pkt->data, pkt->rssi, idem);
+                }
+                else if (idem[0] != '\0')
+                {
+                    // JSON já tem rssi: só acrescenta o idem
+                    char *end_brace = strrchr((char *)pkt->data, '}');
                     if (end_brace)
                     {
                         *end_brace = '\0';
                     }
-                    // Envia JSON com RSSI adicionado
-                    printf("%s,\"rssi\":%d}\n", (char *)pkt.data, pkt.rssi);
+                    printf("%s%s}\n", (char *)pkt->data, idem);
                 }
                 else
                 {
                     // JSON já tem rssi, envia como está
-                    printf("%s\n", (char *)pkt.data);
+                    printf("%s\n", (char *)pkt->data);
                 }
             }
             else
             {
                 // Dados não-JSON: encapsula em JSON
                 printf("{\"mac\":\"%s\",\"raw\":\"%.*s\",\"rssi\":%d}\n",
-                       sender_mac, pkt.len, pkt.data, pkt.rssi);
+                       sender_mac, pkt->len, pkt->data, pkt->rssi);
             }
 
             // Flush para garantir envio imediato
             fflush(stdout);
 
+            aguada_ring_release(&packet_ring);
             packets_processed++;
 
             // LED OFF após processar
@@ -242,17 +488,33 @@ static void status_task(void *pvParameters)
 
         // Envia status do gateway via Serial
         printf("{\"mac\":\"%s\",\"type\":\"gateway_status\","
-               "\"rx\":%lu,\"proc\":%lu,\"drops\":%lu,\"uptime\":%lld,"
+               "\"rx\":%lu,\"proc\":%lu,\"drops\":%lu,\"crc_errors\":%lu,\"batch_frames\":%lu,\"multi_frames\":%lu,\"link_probes\":%lu,\"link_reports\":%lu,\"dup_dropped\":%lu,"
+               "\"ring_peak\":%lu,\"uptime\":%lld,"
                "\"channel\":%d,\"version\":\"%s\"}\n",
                gateway_mac_str,
                (unsigned long)packets_received,
                (unsigned long)packets_processed,
                (unsigned long)packets_dropped,
+               (unsigned long)crc_errors,
+               (unsigned long)batch_frames,
+               (unsigned long)multi_frames,
+               (unsigned long)link_probes,
+               (unsigned long)link_table.reports,
+               (unsigned long)dup_dropped,
+               (unsigned long)packet_ring.high_water,
                (long long)uptime_s,
                ESPNOW_CHANNEL,
                FIRMWARE_VERSION);
         fflush(stdout);
 
+        // Estado por node (seq/perda/intervalo/RSSI) numa linha própria
+        if (aguada_node_table_json(&node_table, esp_timer_get_time(), nodes_json, sizeof(nodes_json)) >= 0)
+        {
+            printf("{\"mac\":\"%s\",\"type\":\"gateway_nodes\",\"untracked\":%lu,\"nodes\":%s}\n",
+                   gateway_mac_str, (unsigned long)node_table.untracked, nodes_json);
+            fflush(stdout);
+        }
+
         ESP_LOGI(TAG, "Status: rx=%lu proc=%lu drops=%lu uptime=%llds",
                  (unsigned long)packets_received,
                  (unsigned long)packets_processed,
@@ -290,9 +552,7 @@ static void get_gateway_mac(void)
 {
     uint8_t mac[6];
     esp_read_mac(mac, ESP_MAC_WIFI_STA);
-    snprintf(gateway_mac_str, sizeof(gateway_mac_str),
-             "%02X:%02X:%02X:%02X:%02X:%02X",
-             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    aguada_mac_to_string(mac, gateway_mac_str);
 
     ESP_LOGI(TAG, "========================================");
     ESP_LOGI(TAG, "  GATEWAY MAC: %s", gateway_mac_str);
@@ -335,11 +595,13 @@ void app_main(void)
         vTaskDelay(pdMS_TO_TICKS(100));
     }
 
-    // Cria fila de pacotes
-    packet_queue = xQueueCreate(QUEUE_SIZE, sizeof(espnow_packet_t));
-    if (packet_queue == NULL)
+    aguada_link_table_init(&link_table, LINK_REPORT_INTERVAL_MS);
+    aguada_node_table_init(&node_table);
+
+    // Cria ring de pacotes (slots estáticos)
+    if (aguada_ring_init(&packet_ring, packet_slots, sizeof(espnow_packet_t), RING_SIZE) != ESP_OK)
     {
-        ESP_LOGE(TAG, "Erro ao criar queue de pacotes!");
+        ESP_LOGE(TAG, "Erro ao criar ring de pacotes!");
         return;
     }
 
@@ -4,7 +4,7 @@
  * Protocolo AGUADA-1 padronizado:
  * - distance_mm: Distância em milímetros (inteiro)
  * - vcc_bat_mv: Tensão da bateria/alimentação em mV
- * - rssi: Intensidade do sinal em dBm
+ * - delivery_pct: Entrega confirmada por ACK (o RSSI real é do gateway)
  *
  * Firmware universal para todos os reservatórios.
  * Diferenciação por MAC address (hardware).
@@ -25,16 +25,18 @@
 // ============================================================================
 // CONFIGURAÇÃO DO GATEWAY
 // ============================================================================
-// Opção 1: BROADCAST (envia para todos os gateways no canal)
-// Recomendado para teste e configuração inicial
-// Opção 2: UNICAST (envia para gateway específico - mais eficiente)
-// Após descobrir o MAC do gateway, configure aqui para unicast
+// Opção 1: DESCOBERTA (GATEWAY_MAC = broadcast)
+// O node sonda em broadcast, o gateway responde com um beacon e os envios
+// seguintes vão em unicast com ACK para ele (components/aguada_link).
+// Sem resposta, o pacote sai em broadcast (sem confirmação) e a sonda se
+// repete a cada LINK_PROBE_EVERY envios.
+// Opção 2: UNICAST FIXO (gateway específico, sem sonda)
 
-// Usar broadcast (0xFF:FF:FF:FF:FF:FF) ou unicast?
-#define USE_BROADCAST 1 // 1 = broadcast, 0 = unicast específico
+// Descobrir o gateway ou usar um MAC fixo?
+#define USE_BROADCAST 1 // 1 = descoberta por sonda, 0 = unicast específico
 
 #if USE_BROADCAST
-// Broadcast: qualquer gateway no canal 11 recebe
+// Descoberta: qualquer gateway no canal 11 que responder à sonda
 static const uint8_t GATEWAY_MAC[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 #else
 // Unicast: configure o MAC do seu gateway aqui
@@ -114,6 +116,12 @@ static const uint8_t GATEWAY_MAC[6] = {0x80, 0xF3, 0xDA, 0x62, 0xA7, 0x84};
 #define SAMPLES_PER_READ 11     // Número de amostras para mediana
 #define SAMPLE_INTERVAL_MS 100  // Intervalo entre amostras (100ms)
 
+// Mediana móvel entre leituras (components/aguada_select): a mediana sai das
+// últimas RUNNING_MEDIAN_WINDOW amostras, não só das desta leitura. Permite
+// baixar SAMPLES_PER_READ (ex.: 5 amostras, janela 15 = 3 leituras).
+#define USE_RUNNING_MEDIAN 0     // 1 = mediana móvel, 0 = mediana por leitura
+#define RUNNING_MEDIAN_WINDOW 15 // Amostras na janela (≤ AGUADA_RUNNING_MEDIAN_MAX)
+
 // ============================================================================
 // TEMPOS E INTERVALOS
 // ============================================================================
@@ -123,6 +131,27 @@ static const uint8_t GATEWAY_MAC[6] = {0x80, 0xF3, 0xDA, 0x62, 0xA7, 0x84};
 // Heartbeat (envio forçado mesmo sem mudança)
 #define HEARTBEAT_MS 30000 // Forçar envio a cada 30 segundos
 
+// Amostragem adaptativa (components/aguada_dsp, aguada_adapt.h)
+// A cada ADAPT_STABLE_READS leituras estáveis seguidas: metade das amostras
+// (mín. ADAPT_SPARSE_SAMPLES) e o dobro do intervalo, até ×2^ADAPT_MAX_STRETCH_LOG2.
+// Reset do RLE ou delta no should_send voltam ao denso na hora.
+// O intervalo base é READ_INTERVAL_MS (ou DEEP_SLEEP_INTERVAL_MS no modo bateria).
+#define USE_ADAPTIVE_SAMPLING 1
+#define ADAPT_STABLE_READS 15    // Leituras estáveis por degrau (~30s no denso)
+#define ADAPT_SPARSE_SAMPLES 3   // Mínimo de amostras por leitura
+#define ADAPT_MAX_STRETCH_LOG2 3 // Intervalo máximo = base × 8 (16s)
+
+// ============================================================================
+// MODO BATERIA (DEEP SLEEP)
+// ============================================================================
+// 0 = sempre ligado: rádio e CPU acordados, leitura a cada READ_INTERVAL_MS
+// 1 = duty cycle: acorda pelo timer, mede, envia só se should_send pedir
+//     (delta ou heartbeat) e volta a dormir. Sensor, EMA, RLE e agregação
+//     ficam na RTC RAM. O heartbeat sai no primeiro despertar após HEARTBEAT_MS.
+#define USE_DEEP_SLEEP 0
+#define DEEP_SLEEP_INTERVAL_MS 60000 // Tempo dormindo entre leituras
+#define DEEP_SLEEP_BUDGET_MS 1500    // Orçamento despertar→dormir (aviso no log)
+
 // ============================================================================
 // COMPRESSÃO DE DADOS (DEADBAND)
 // ============================================================================
@@ -130,18 +159,44 @@ static const uint8_t GATEWAY_MAC[6] = {0x80, 0xF3, 0xDA, 0x62, 0xA7, 0x84};
 #define DELTA_DISTANCE_MM 15 // ±15mm (1.5cm) de variação
 #define DELTA_VCC_MV 100     // ±100mV de variação
 
+// Predição dupla (components/aguada_dsp, aguada_predict.h): em vez do delta
+// contra o último valor enviado, node e backend seguem uma reta - último
+// valor + inclinação × tempo. Só envia quando a leitura se afasta da reta por
+// DELTA_DISTANCE_MM; o backend preenche os pontos previstos entre envios.
+// Num enchimento/esvaziamento constante a reta acompanha o nível e só o
+// heartbeat sai. A inclinação viaja no JSON ("slope_mm_h"): exige
+// USE_BINARY_PAYLOAD=0; com USE_BATCHING não se aplica (o lote leva tudo).
+// Desligada por padrão: muda quando o node envia e grava pontos "prevista"
+// em leituras_raw
+#define USE_DUAL_PREDICTION 0
+#define PREDICT_MAX_SLOPE_MM_H 20000 // Teto da inclinação (2 m/h)
+
 // Estabilidade (considerado estável se desvio padrão < threshold)
 #define STABLE_STDDEV_MM 5.0 // Desvio padrão para considerar estável
 
 // ============================================================================
 // ESP-NOW
 // ============================================================================
-#define ESPNOW_QUEUE_SIZE 6  // Tamanho da fila de pacotes
-#define ESPNOW_MAX_RETRIES 3 // Tentativas de envio
-#define ESPNOW_RETRY_MS 500  // Delay entre tentativas
+// Cada tentativa espera o ACK do gateway (callback de envio); só falha real
+// gera retry, com backoff exponencial + jitter: [B/2, B], [B, 2B], ...
+#define ESPNOW_QUEUE_SIZE 6       // Tamanho da fila de pacotes
+#define ESPNOW_MAX_RETRIES 3      // Tentativas de envio (transmissões)
+#define ESPNOW_ACK_TIMEOUT_MS 100 // Espera pelo callback de envio
+#define ESPNOW_BACKOFF_MS 100     // Base B do backoff entre tentativas
+#define LINK_PROBE_TIMEOUT_MS 200 // Espera pelo beacon do gateway
+#define LINK_PROBE_EVERY 10       // Envios em broadcast entre sondas
+#define LINK_REDISCOVER_AFTER 3   // Envios sem ACK seguidos até sondar de novo
 
-// Tamanho máximo do payload JSON
-#define MAX_PAYLOAD_SIZE 200
+// Potência de TX adaptativa: o gateway relata o RSSI/perda que mede; a
+// potência desce até o mínimo que mantém a entrega acima da meta. Unidades
+// de esp_wifi_set_max_tx_power (0,25 dBm): 8 = 2 dBm, 80 = 20 dBm
+#define USE_ADAPTIVE_TX_POWER 1
+#define TX_POWER_MIN_QDBM 8        // Piso
+#define TX_POWER_MAX_QDBM 80       // Teto (e potência inicial)
+#define TX_POWER_STEP_QDBM 8       // Passo de 2 dBm
+#define TX_DELIVERY_TARGET_PCT 95  // Meta de entrega confirmada por ACK
+#define TX_RSSI_TARGET_DBM -75     // RSSI no gateway que já basta
+#define TX_SETTLE_SENDS 4          // Envios entre ajustes
 
 // ============================================================================
 // BATERIA / ALIMENTAÇÃO (ADC)
@@ -160,11 +215,20 @@ static const uint8_t GATEWAY_MAC[6] = {0x80, 0xF3, 0xDA, 0x62, 0xA7, 0x84};
 // ============================================================================
 // FILTRAGEM AVANÇADA (EMA - Exponential Moving Average)
 // ============================================================================
+// Pipeline em ponto fixo (components/aguada_dsp): mediana → Hampel → EMA Q15
+// → deadband/histerese. As constantes abaixo são convertidas na compilação.
 // Suavização: 0.0 = sem suavização, 1.0 = máxima suavização
 // EMA = alpha * novo_valor + (1 - alpha) * valor_anterior
 #define EMA_ALPHA 0.3    // 30% novo, 70% histórico
 #define USE_EMA_FILTER 1 // 1 = usar EMA após mediana
 
+// Rejeição de picos entre leituras (Hampel): troca a mediana da leitura pela
+// do histórico se |x - mediana| > HAMPEL_K × 1,4826 × MAD
+#define USE_HAMPEL_FILTER 1 // 1 = Hampel antes da EMA
+#define HAMPEL_WINDOW 5     // Leituras no histórico (≤ AGUADA_DSP_HAMPEL_MAX)
+#define HAMPEL_K 3.0        // Limiar em desvios padrão
+#define HAMPEL_MIN_MM 30    // Piso do limiar (MAD = 0 com nível parado)
+
 // Histerese (previne oscilação no limiar do delta)
 // Só envia se delta > DELTA_MM + HISTERESE ao subir
 // Só envia se delta > DELTA_MM - HISTERESE ao descer
@@ -187,18 +251,23 @@ static const uint8_t GATEWAY_MAC[6] = {0x80, 0xF3, 0xDA, 0x62, 0xA7, 0x84};
 // ============================================================================
 // PAYLOAD BINÁRIO
 // ============================================================================
-// Reduz ~60 bytes JSON para ~16 bytes binário
-// Formato: [MAGIC(2)][MAC(6)][DIST(2)][VCC(2)][RSSI(1)][FLAGS(1)][CRC(2)]
-#define USE_BINARY_PAYLOAD 0   // 0 = JSON, 1 = binário
-#define BINARY_MAGIC 0xAD01    // "AGUADA-1" identifier
-#define BINARY_PAYLOAD_SIZE 16 // Bytes do payload binário
-
-// Flags do payload binário
-#define FLAG_HEARTBEAT 0x01   // Envio por heartbeat
-#define FLAG_DELTA 0x02       // Envio por delta
-#define FLAG_ERROR 0x04       // Erro de leitura
-#define FLAG_AGGREGATED 0x08  // Contém dados agregados
-#define FLAG_LOW_BATTERY 0x10 // VCC abaixo do limite
+// Reduz ~80 bytes JSON para 16 bytes binário
+// Formato e flags: components/aguada_proto (aguada_bin_frame_t, AGUADA_FLAG_*)
+// Binário: os gateways validam o CRC e encaminham {"bin":"<hex>"}; o backend
+// decodifica (services/aguada-binary.service.js). RLE/agregação são só JSON.
+#define USE_BINARY_PAYLOAD 0 // 0 = JSON, 1 = binário
+
+// ============================================================================
+// LOTES (VÁRIAS LEITURAS POR FRAME)
+// ============================================================================
+// Toda leitura entra num frame aguada_batch (tempo relativo ao início do lote
+// + delta da distância, ~2-3 bytes/leitura). O frame sai quando enche, quando
+// o lote mais antigo passa de BATCH_MAX_AGE_MS ou num evento (delta/heartbeat).
+// Os gateways desempacotam em uma leitura AGUADA-1 por registro, com "age_ms".
+// Substitui JSON/binário acima; RLE/agregação não viajam no lote.
+#define USE_BATCHING 0           // 1 = lotes, 0 = um pacote por envio
+#define BATCH_MAX_READINGS 32    // Leituras por frame (limite: 250 bytes)
+#define BATCH_MAX_AGE_MS 60000   // Latência máxima da leitura mais antiga
 
 // ============================================================================
 // DEBUG
@@ -2,10 +2,15 @@
  * AGUADA v1.1 - Firmware Universal para Sensor Nodes
  * 
  * Protocolo AGUADA-1:
- * - Pacote JSON padronizado com distance_mm, vcc_bat_mv, rssi
+ * - Pacote JSON padronizado com distance_mm, vcc_bat_mv, delivery_pct
+ * - Envio unicast com ACK ao gateway descoberto (aguada_link)
  * - Envio apenas de deltas (mudanças significativas)
  * - Heartbeat a cada 30 segundos
- * - Mediana de 11 amostras para filtragem
+ * - Mediana de 11 amostras → Hampel → EMA, tudo em ponto fixo (sem FPU)
+ * - Modo bateria opcional (USE_DEEP_SLEEP): dorme entre leituras
+ * - Lotes opcionais (USE_BATCHING): várias leituras por frame ESP-NOW
+ * - Predição dupla opcional (USE_DUAL_PREDICTION): envia só o que sai da
+ *   reta compartilhada com o backend
  * 
  * Hardware: ESP32-C3 SuperMini + AJ-SR04M
  * Protocolo: ESP-NOW → Gateway → HTTP/MQTT → Backend
@@ -25,9 +30,18 @@
 #include "nvs_flash.h"
 #include "driver/gpio.h"
 #include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_sleep.h"
 #include "esp_adc/adc_oneshot.h"
 #include "esp_adc/adc_cali.h"
 #include "esp_adc/adc_cali_scheme.h"
+#include "aguada_proto.h"
+#include "aguada_sonar.h"
+#include "aguada_dsp.h"
+#include "aguada_adapt.h"
+#include "aguada_predict.h"
+#include "aguada_select.h"
+#include "aguada_link.h"
 #include "config.h"
 
 static const char *TAG = "AGUADA_NODE";
@@ -38,13 +52,15 @@ static const char *TAG = "AGUADA_NODE";
 
 /**
  * Pacote de telemetria AGUADA-1
- * Formato JSON: {"mac":"XX:XX:XX:XX:XX:XX","distance_mm":2450,"vcc_bat_mv":4900,"rssi":-50}
+ * Formato JSON: {"mac":"XX:XX:XX:XX:XX:XX","distance_mm":2450,"vcc_bat_mv":4900,"delivery_pct":98}
  */
 typedef struct {
     int32_t distance_mm;    // Distância em mm (negativo = erro)
     int32_t vcc_bat_mv;     // Tensão em mV
-    int32_t rssi;           // RSSI em dBm
+    uint8_t delivery_pct;   // Entrega confirmada por ACK (0 = sem dados)
     int64_t timestamp;      // Timestamp em microsegundos
+    bool has_slope;         // Predição dupla: inclinação vai no pacote
+    int32_t slope_mm_h;     // Inclinação da reta a partir desta leitura
 } telemetry_data_t;
 
 /**
@@ -88,46 +104,128 @@ typedef struct {
     bool valid;                     // Se há dados válidos
 } aggregation_t;
 
-/**
- * Payload binário compacto (16 bytes)
- * Estrutura: [MAGIC:2][MAC:6][DIST:2][VCC:2][RSSI:1][FLAGS:1][CRC:2]
- */
-typedef struct __attribute__((packed)) {
-    uint16_t magic;                 // 0xAD01 = AGUADA-1
-    uint8_t mac[6];                 // MAC address
-    int16_t distance_mm;            // Distância (±32767mm)
-    uint16_t vcc_mv;                // Tensão (0-65535mV)
-    int8_t rssi;                    // RSSI (-128 a +127)
-    uint8_t flags;                  // Flags de status
-    uint16_t crc16;                 // CRC-16 para validação
-} binary_payload_t;
-
 // ============================================================================
 // VARIÁVEIS GLOBAIS
 // ============================================================================
 
+// Estado que precisa sobreviver ao deep sleep fica na RTC RAM
+// (zerado no power-on, preservado entre despertares)
+#if USE_DEEP_SLEEP
+#define NODE_RTC_ATTR RTC_DATA_ATTR
+#else
+#define NODE_RTC_ATTR
+#endif
+
 static uint8_t node_mac[6];
-static char node_mac_str[18];
-static sensor_state_t sensor_state = {0};
-static metrics_t metrics = {0};
+static char node_mac_str[AGUADA_MAC_STR_LEN];
+static NODE_RTC_ATTR sensor_state_t sensor_state = {0};
+static NODE_RTC_ATTR metrics_t metrics = {0};
+static aguada_sonar_t sonar;
+static bool espnow_ready = false;
+
+// Relógio do node: esp_timer zera a cada despertar, então o tempo já
+// dormido acumula aqui (heartbeat e last_send_time usam node_time_us)
+static NODE_RTC_ATTR int64_t clock_base_us = 0;
+
+#if USE_DEEP_SLEEP
+static int64_t cycle_start_us = 0; // Início do ciclo acordado
+#endif
+
+// Enlace com o gateway: descoberta, ACK, retries e taxa de entrega
+static const aguada_link_config_t link_config = {
+    .gateway = {GATEWAY_MAC[0], GATEWAY_MAC[1], GATEWAY_MAC[2],
+                GATEWAY_MAC[3], GATEWAY_MAC[4], GATEWAY_MAC[5]},
+    .max_attempts = ESPNOW_MAX_RETRIES,
+    .ack_timeout_ms = ESPNOW_ACK_TIMEOUT_MS,
+    .backoff_base_ms = ESPNOW_BACKOFF_MS,
+    .probe_timeout_ms = LINK_PROBE_TIMEOUT_MS,
+    .probe_every = LINK_PROBE_EVERY,
+    .rediscover_after = LINK_REDISCOVER_AFTER,
+#if USE_ADAPTIVE_TX_POWER
+    .tx_power_min = TX_POWER_MIN_QDBM,
+    .tx_power_max = TX_POWER_MAX_QDBM,
+    .tx_power_step = TX_POWER_STEP_QDBM,
+    .delivery_target_pct = TX_DELIVERY_TARGET_PCT,
+    .rssi_target_dbm = TX_RSSI_TARGET_DBM,
+    .tx_settle = TX_SETTLE_SENDS,
+#endif
+};
+static NODE_RTC_ATTR aguada_link_t link;
 
 // ADC handles
 static adc_oneshot_unit_handle_t adc_handle = NULL;
 static adc_cali_handle_t adc_cali_handle = NULL;
 static bool adc_calibrated = false;
 
-// EMA state
-static float ema_distance_mm = 0;
-static bool ema_initialized = false;
+// Filtragem em ponto fixo: Hampel, EMA e tendência da histerese
+#if USE_EMA_FILTER
+#define DSP_EMA_ALPHA EMA_ALPHA
+#else
+#define DSP_EMA_ALPHA 0.0   // EMA desligada
+#endif
+#if USE_HAMPEL_FILTER
+#define DSP_HAMPEL_WINDOW HAMPEL_WINDOW
+#else
+#define DSP_HAMPEL_WINDOW 0 // Hampel desligado
+#endif
+static const aguada_dsp_config_t dsp_config = AGUADA_DSP_CONFIG(
+    DSP_EMA_ALPHA, DSP_HAMPEL_WINDOW, HAMPEL_K, HAMPEL_MIN_MM,
+    DELTA_DISTANCE_MM, HYSTERESIS_MM);
+static NODE_RTC_ATTR aguada_dsp_t dsp;
+
+#if USE_RUNNING_MEDIAN
+static NODE_RTC_ATTR aguada_running_median_t running_median;
+#endif
+
+// Intervalo base entre leituras (denso)
+#if USE_DEEP_SLEEP
+#define BASE_READ_INTERVAL_MS DEEP_SLEEP_INTERVAL_MS
+#else
+#define BASE_READ_INTERVAL_MS READ_INTERVAL_MS
+#endif
+
+// Amostragem adaptativa: menos amostras e leituras mais espaçadas com o nível parado
+#if USE_ADAPTIVE_SAMPLING
+static const aguada_adapt_config_t adapt_config = {
+    .dense_samples = SAMPLES_PER_READ,
+    .sparse_samples = ADAPT_SPARSE_SAMPLES,
+    .base_interval_ms = BASE_READ_INTERVAL_MS,
+    .max_stretch_log2 = ADAPT_MAX_STRETCH_LOG2,
+    .stable_reads = ADAPT_STABLE_READS,
+};
+static NODE_RTC_ATTR aguada_adapt_t adapt;
+#endif
 
 // RLE state
 #if USE_RLE
-static rle_state_t rle_state = {0};
+static NODE_RTC_ATTR rle_state_t rle_state = {0};
 #endif
 
 // Aggregation state
 #if USE_AGGREGATION
-static aggregation_t agg_state = {0};
+static NODE_RTC_ATTR aggregation_t agg_state = {0};
+#endif
+
+// Sequência dos frames (8 bits, dá a volta): o gateway conta perdas e
+// reenvios por ela. Reinicia do zero só com reset de energia.
+static NODE_RTC_ATTR uint8_t frame_seq = 0;
+
+// Lote em montagem (sobrevive ao deep sleep entre as leituras)
+#if USE_BATCHING
+static NODE_RTC_ATTR aguada_batch_t batch;
+#endif
+
+// Predição dupla: reta ancorada no último envio confirmado (o lote já
+// leva todas as leituras, então não se aplica com USE_BATCHING)
+#define DUAL_PREDICTION (USE_DUAL_PREDICTION && !USE_BATCHING)
+_Static_assert(!(DUAL_PREDICTION && USE_BINARY_PAYLOAD), "USE_DUAL_PREDICTION exige JSON (USE_BINARY_PAYLOAD=0)");
+
+#if DUAL_PREDICTION
+static const aguada_predict_config_t predict_config = {
+    .deadband_mm = DELTA_DISTANCE_MM,
+    .max_slope_mm_h = PREDICT_MAX_SLOPE_MM_H,
+};
+static NODE_RTC_ATTR aguada_predict_t predict;
 #endif
 
 // ============================================================================
@@ -135,48 +233,10 @@ static aggregation_t agg_state = {0};
 // ============================================================================
 
 /**
- * Calcular CRC-16 (CCITT)
- */
-static uint16_t crc16_ccitt(const uint8_t *data, size_t len) {
-    uint16_t crc = 0xFFFF;
-    for (size_t i = 0; i < len; i++) {
-        crc ^= (uint16_t)data[i] << 8;
-        for (int j = 0; j < 8; j++) {
-            if (crc & 0x8000) {
-                crc = (crc << 1) ^ 0x1021;
-            } else {
-                crc <<= 1;
-            }
-        }
-    }
-    return crc;
-}
-
-/**
- * Formatar MAC address como string
- */
-static void mac_to_string(const uint8_t *mac, char *str) {
-    snprintf(str, 18, "%02X:%02X:%02X:%02X:%02X:%02X",
-             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-}
-
-/**
- * Obter RSSI
- * 
- * Nota: Sem WiFi conectado, não é possível ler RSSI diretamente.
- * O RSSI real é medido pelo gateway no momento da recepção.
- * Aqui retornamos um placeholder que pode ser substituído
- * por uma métrica de qualidade de link baseada em ACKs.
+ * Tempo do node em µs, contínuo através dos ciclos de deep sleep
  */
-static int get_rssi(void) {
-    // Calcular "pseudo-RSSI" baseado na taxa de sucesso
-    if (metrics.packets_sent + metrics.packets_failed > 0) {
-        float success_rate = (float)metrics.packets_sent / 
-                            (float)(metrics.packets_sent + metrics.packets_failed);
-        // Mapear: 100% sucesso = -30dBm, 0% = -90dBm
-        return (int)(-90 + success_rate * 60);
-    }
-    return -50;  // Valor inicial padrão
+static int64_t node_time_us(void) {
+    return clock_base_us + esp_timer_get_time();
 }
 
 /**
@@ -207,9 +267,9 @@ static int get_vcc_mv(void) {
         }
     }
     
-    // Média e aplicação do divisor
+    // Média e aplicação do divisor (razão em Q10, convertida na compilação)
     int avg_mv = sum_mv / VCC_ADC_SAMPLES;
-    int vcc_mv = (int)(avg_mv * VCC_DIVIDER_RATIO);
+    int vcc_mv = aguada_dsp_mul_fix(avg_mv, AGUADA_DSP_FIX(VCC_DIVIDER_RATIO, 10), 10);
     
     // Validar range
     if (vcc_mv < VCC_MIN_MV || vcc_mv > VCC_MAX_MV) {
@@ -220,30 +280,54 @@ static int get_vcc_mv(void) {
 }
 
 /**
- * Comparar ints para qsort
+ * Amostras da próxima leitura e espera até ela (fixas sem USE_ADAPTIVE_SAMPLING)
  */
-static int compare_int(const void *a, const void *b) {
-    return (*(int*)a - *(int*)b);
+static int read_samples(void) {
+#if USE_ADAPTIVE_SAMPLING
+    return adapt.samples;
+#else
+    return SAMPLES_PER_READ;
+#endif
+}
+
+static uint32_t read_interval_ms(void) {
+#if USE_ADAPTIVE_SAMPLING
+    return adapt.interval_ms;
+#else
+    return BASE_READ_INTERVAL_MS;
+#endif
 }
 
 // ============================================================================
 // INICIALIZAÇÃO GPIO
 // ============================================================================
 
+#define SEND_BLINK_US 50000  // LED aceso por envio confirmado
+
+// Apaga o LED do envio confirmado. One-shot do esp_timer: o callback de envio
+// roda na task do WiFi, que também entrega os beacons/relatórios do aguada_link
+// - não pode dormir ali
+static esp_timer_handle_t led_off_timer = NULL;
+
+static void led_off_cb(void *arg) {
+    gpio_set_level(PIN_LED_STATUS, 0);
+}
+
 static void init_gpio(void) {
-    // Sensor ultrassônico
-    gpio_reset_pin(PIN_TRIG);
-    gpio_set_direction(PIN_TRIG, GPIO_MODE_OUTPUT);
-    gpio_set_level(PIN_TRIG, 0);
-    
-    gpio_reset_pin(PIN_ECHO);
-    gpio_set_direction(PIN_ECHO, GPIO_MODE_INPUT);
+    // Sensor ultrassônico (ECHO com interrupção nas duas bordas)
+    ESP_ERROR_CHECK(aguada_sonar_init(&sonar, PIN_TRIG, PIN_ECHO, SENSOR_TIMEOUT_US));
     
     // LED Status
     gpio_reset_pin(PIN_LED_STATUS);
     gpio_set_direction(PIN_LED_STATUS, GPIO_MODE_OUTPUT);
     gpio_set_level(PIN_LED_STATUS, 0);
     
+    const esp_timer_create_args_t led_timer_args = {
+        .callback = led_off_cb,
+        .name = "led_off",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&led_timer_args, &led_off_timer));
+    
     ESP_LOGI(TAG, "✓ GPIO: TRIG=%d, ECHO=%d, LED=%d", 
              PIN_TRIG, PIN_ECHO, PIN_LED_STATUS);
 }
@@ -300,34 +384,8 @@ static void init_adc(void) {
     ESP_LOGW(TAG, "Calibração ADC não suportada neste chip");
 #endif
     
-    ESP_LOGI(TAG, "✓ ADC: GPIO%d, CH%d, divisor %.1f:1", 
-             PIN_VCC_ADC, ADC_CHANNEL, VCC_DIVIDER_RATIO);
-}
-
-// ============================================================================
-// FILTRAGEM EMA
-// ============================================================================
-
-/**
- * Aplicar filtro EMA (Exponential Moving Average)
- * 
- * Suaviza leituras, reduz ruído de alta frequência
- */
-static int apply_ema_filter(int new_value) {
-#if USE_EMA_FILTER
-    if (!ema_initialized) {
-        ema_distance_mm = (float)new_value;
-        ema_initialized = true;
-        return new_value;
-    }
-    
-    // EMA = alpha * novo + (1 - alpha) * anterior
-    ema_distance_mm = EMA_ALPHA * (float)new_value + (1.0f - EMA_ALPHA) * ema_distance_mm;
-    
-    return (int)(ema_distance_mm + 0.5f);  // Arredondar
-#else
-    return new_value;
-#endif
+    ESP_LOGI(TAG, "✓ ADC: GPIO%d, CH%d, divisor %d/1024", 
+             PIN_VCC_ADC, ADC_CHANNEL, (int)AGUADA_DSP_FIX(VCC_DIVIDER_RATIO, 10));
 }
 
 // ============================================================================
@@ -337,40 +395,21 @@ static int apply_ema_filter(int new_value) {
 /**
  * Leitura única do sensor ultrassônico
  * 
+ * O eco é capturado por interrupção (aguada_sonar): a task fica bloqueada
+ * durante o voo do pulso em vez de girar em gpio_get_level().
+ * 
  * @return Distância em mm, ou:
  *         -1: Timeout (sensor não respondeu)
  *         -2: Fora de range
  */
 static int read_ultrasonic_single(void) {
-    // Pulso TRIG (10μs)
-    gpio_set_level(PIN_TRIG, 0);
-    esp_rom_delay_us(2);
-    gpio_set_level(PIN_TRIG, 1);
-    esp_rom_delay_us(10);
-    gpio_set_level(PIN_TRIG, 0);
-    
-    // Aguardar ECHO subir
-    int64_t timeout_start = esp_timer_get_time();
-    while (gpio_get_level(PIN_ECHO) == 0) {
-        if ((esp_timer_get_time() - timeout_start) > SENSOR_TIMEOUT_US) {
-            return -1;  // Timeout
-        }
+    int32_t echo_us = aguada_sonar_measure(&sonar);
+    if (echo_us == AGUADA_SONAR_TIMEOUT) {
+        return -1;  // Timeout
     }
     
-    // Medir duração do pulso ECHO
-    int64_t pulse_start = esp_timer_get_time();
-    while (gpio_get_level(PIN_ECHO) == 1) {
-        if ((esp_timer_get_time() - pulse_start) > SENSOR_TIMEOUT_US) {
-            return -1;  // Timeout
-        }
-    }
-    int64_t duration_us = esp_timer_get_time() - pulse_start;
-    
-    // Calcular distância em mm
-    // Velocidade do som: 343 m/s = 0.343 mm/μs
-    // Distância = (duração × 0.343) / 2 = duração × 0.1715
-    // Para evitar float: distance_mm = (duration_us * 343) / 2000
-    int32_t distance_mm = (int32_t)((duration_us * 343) / 2000);
+    // Velocidade do som: 343 m/s → distância = duração × 0.1715 mm/μs
+    int32_t distance_mm = aguada_sonar_us_to_mm(echo_us);
     
     // Validar range
     if (distance_mm < SENSOR_MIN_MM || distance_mm > SENSOR_MAX_MM) {
@@ -381,18 +420,24 @@ static int read_ultrasonic_single(void) {
 }
 
 /**
- * Leitura filtrada com mediana
+ * Leitura filtrada
  * 
- * Coleta SAMPLES_PER_READ amostras e retorna a mediana
+ * Coleta `count` amostras (≤ SAMPLES_PER_READ) e passa pelo pipeline aguada_dsp:
+ * mediana (rede de seleção, ou móvel com USE_RUNNING_MEDIAN) →
+ * Hampel (picos entre leituras) → EMA Q15
  */
-static int read_ultrasonic_filtered(void) {
-    int samples[SAMPLES_PER_READ];
+static int read_ultrasonic_filtered(int count) {
+    int32_t samples[SAMPLES_PER_READ];
     int valid_count = 0;
     
+    if (count > SAMPLES_PER_READ) {
+        count = SAMPLES_PER_READ;
+    }
+    
     metrics.readings_total++;
     
     // Coletar amostras
-    for (int i = 0; i < SAMPLES_PER_READ; i++) {
+    for (int i = 0; i < count; i++) {
         int dist = read_ultrasonic_single();
         if (dist > 0) {
             samples[valid_count++] = dist;
@@ -401,22 +446,25 @@ static int read_ultrasonic_filtered(void) {
     }
     
     // Verificar se temos amostras suficientes
-    if (valid_count < (SAMPLES_PER_READ / 2)) {
-        ESP_LOGW(TAG, "Poucas amostras válidas: %d/%d", valid_count, SAMPLES_PER_READ);
+    if (valid_count < (count / 2) || valid_count == 0) {
+        ESP_LOGW(TAG, "Poucas amostras válidas: %d/%d", valid_count, count);
         return -1;
     }
     
-    // Ordenar para obter mediana
-    qsort(samples, valid_count, sizeof(int), compare_int);
-    
-    int median = samples[valid_count / 2];
-    
-    // Aplicar filtro EMA para suavização adicional
-    int filtered = apply_ema_filter(median);
+#if USE_RUNNING_MEDIAN
+    // Mediana das últimas RUNNING_MEDIAN_WINDOW amostras (várias leituras)
+    for (int i = 0; i < valid_count; i++) {
+        aguada_running_median_push(&running_median, samples[i]);
+    }
+    int32_t filtered = aguada_dsp_filter(&dsp, aguada_running_median_get(&running_median));
+#else
+    int32_t filtered = aguada_dsp_process(&dsp, samples, valid_count);
+#endif
     
     metrics.readings_valid++;
     
-    ESP_LOGD(TAG, "Distância: median=%d ema=%d mm (%d amostras)", median, filtered, valid_count);
+    ESP_LOGD(TAG, "Distância: %ld mm (%d amostras, %lu picos rejeitados)",
+             (long)filtered, valid_count, (unsigned long)dsp.outliers);
     
     return filtered;
 }
@@ -429,14 +477,27 @@ static int read_ultrasonic_filtered(void) {
  * Callback de envio ESP-NOW
  */
 static void espnow_send_cb(const esp_now_send_info_t *info, esp_now_send_status_t status) {
+    // Resultado da camada MAC (ACK do gateway no unicast) para o aguada_link
+    aguada_link_on_send(&link, status);
+    
     if (status == ESP_NOW_SEND_SUCCESS) {
         metrics.packets_sent++;
-        gpio_set_level(PIN_LED_STATUS, 1);
-        vTaskDelay(pdMS_TO_TICKS(50));
-        gpio_set_level(PIN_LED_STATUS, 0);
     } else {
         metrics.packets_failed++;
     }
+    
+    if (status == ESP_NOW_SEND_SUCCESS) {
+        gpio_set_level(PIN_LED_STATUS, 1);
+        esp_timer_stop(led_off_timer);  // Reinicia a piscada se ainda acesa
+        esp_timer_start_once(led_off_timer, SEND_BLINK_US);
+    }
+}
+
+/**
+ * Callback de recepção ESP-NOW (só beacons do gateway interessam)
+ */
+static void espnow_recv_cb(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    aguada_link_on_recv(&link, info, data, len);
 }
 
 /**
@@ -475,23 +536,26 @@ static void init_espnow(void) {
     
     // Obter MAC address do dispositivo
     ESP_ERROR_CHECK(esp_wifi_get_mac(WIFI_IF_STA, node_mac));
-    mac_to_string(node_mac, node_mac_str);
+    aguada_mac_to_string(node_mac, node_mac_str);
     ESP_LOGI(TAG, "✓ Node MAC: %s", node_mac_str);
     
     // Inicializar ESP-NOW
     ESP_ERROR_CHECK(esp_now_init());
     ESP_ERROR_CHECK(esp_now_register_send_cb(espnow_send_cb));
+    ESP_ERROR_CHECK(esp_now_register_recv_cb(espnow_recv_cb));
     
-    // Adicionar gateway como peer
-    esp_now_peer_info_t peer_info = {0};
-    memcpy(peer_info.peer_addr, GATEWAY_MAC, 6);
-    peer_info.channel = ESPNOW_CHANNEL;
-    peer_info.encrypt = false;
-    ESP_ERROR_CHECK(esp_now_add_peer(&peer_info));
+    // Peers de broadcast (sonda) e do gateway já conhecido
+    ESP_ERROR_CHECK(aguada_link_start(&link));
     
-    ESP_LOGI(TAG, "✓ Gateway: %02X:%02X:%02X:%02X:%02X:%02X (canal %d)",
-             GATEWAY_MAC[0], GATEWAY_MAC[1], GATEWAY_MAC[2],
-             GATEWAY_MAC[3], GATEWAY_MAC[4], GATEWAY_MAC[5], ESPNOW_CHANNEL);
+    if (link.has_gateway) {
+        char gw_str[AGUADA_MAC_STR_LEN];
+        aguada_mac_to_string(link.gateway, gw_str);
+        ESP_LOGI(TAG, "✓ Gateway: %s (canal %d)", gw_str, ESPNOW_CHANNEL);
+    } else {
+        ESP_LOGI(TAG, "✓ Gateway: descoberta por sonda (canal %d)", ESPNOW_CHANNEL);
+    }
+    
+    espnow_ready = true;
 }
 
 // ============================================================================
@@ -554,8 +618,9 @@ static void agg_update(int32_t distance_mm) {
     }
 }
 
+#if !USE_BATCHING
 /**
- * Obter e resetar agregação
+ * Obter e resetar agregação (o lote já leva todas as leituras)
  */
 static void agg_get_and_reset(int32_t *min, int32_t *max, int32_t *avg) {
     if (agg_state.valid && agg_state.count > 0) {
@@ -571,116 +636,125 @@ static void agg_get_and_reset(int32_t *min, int32_t *max, int32_t *avg) {
     agg_state.sum_mm = 0;
 }
 #endif
+#endif
 
-#if USE_BINARY_PAYLOAD
 /**
- * Enviar pacote binário compacto (16 bytes)
+ * Enviar payload ao gateway (aguada_link: ACK por tentativa, backoff com jitter)
+ * 
+ * Só retorna depois do callback de envio, então o deep sleep nunca corta
+ * um pacote ainda na fila do rádio.
  */
-static bool send_telemetry_binary(const telemetry_data_t *data, uint8_t flags) {
-    binary_payload_t pkt = {0};
-    
-    pkt.magic = BINARY_MAGIC;
-    memcpy(pkt.mac, node_mac, 6);
-    pkt.distance_mm = (int16_t)data->distance_mm;
-    pkt.vcc_mv = (uint16_t)data->vcc_bat_mv;
-    pkt.rssi = (int8_t)data->rssi;
-    pkt.flags = flags;
-    
-    // CRC sobre os primeiros 14 bytes
-    pkt.crc16 = crc16_ccitt((uint8_t*)&pkt, sizeof(pkt) - 2);
-    
-    ESP_LOGI(TAG, "→ BIN[%d]: dist=%d vcc=%d rssi=%d flags=0x%02X",
-             BINARY_PAYLOAD_SIZE, pkt.distance_mm, pkt.vcc_mv, pkt.rssi, pkt.flags);
+static bool espnow_send_payload(const uint8_t *payload, size_t len) {
+    esp_err_t result = aguada_link_send(&link, payload, len);
     
-    for (int retry = 0; retry < ESPNOW_MAX_RETRIES; retry++) {
-        esp_err_t result = esp_now_send(GATEWAY_MAC, (uint8_t*)&pkt, sizeof(pkt));
-        
-        if (result == ESP_OK) {
-            sensor_state.last_send_time = esp_timer_get_time();
-            return true;
-        }
-        
-        ESP_LOGW(TAG, "Retry %d/%d", retry + 1, ESPNOW_MAX_RETRIES);
-        vTaskDelay(pdMS_TO_TICKS(ESPNOW_RETRY_MS));
+    if (result == ESP_OK) {
+        sensor_state.last_send_time = node_time_us();
+        return true;
     }
     
+    ESP_LOGE(TAG, "Falha ao enviar após %d tentativas: %s", ESPNOW_MAX_RETRIES, esp_err_to_name(result));
     return false;
 }
-#endif
 
+#if !USE_BATCHING
 /**
- * Enviar pacote de telemetria (JSON ou binário)
+ * Enviar pacote de telemetria (JSON ou binário, via aguada_proto)
  * 
  * Formato AGUADA-1 JSON:
- * {"mac":"XX:XX:XX:XX:XX:XX","distance_mm":2450,"vcc_bat_mv":4900,"rssi":-50}
+ * {"mac":"XX:XX:XX:XX:XX:XX","distance_mm":2450,"vcc_bat_mv":4900,"delivery_pct":98}
  * 
  * Com RLE:
- * {"mac":"...","distance_mm":2450,"vcc_bat_mv":4900,"rssi":-50,"rle":15}
+ * {"mac":"...","distance_mm":2450,"vcc_bat_mv":4900,"delivery_pct":98,"rle":15}
  * 
  * Com Agregação (no heartbeat):
- * {"mac":"...","distance_mm":2450,"vcc_bat_mv":4900,"rssi":-50,"min_mm":2400,"max_mm":2500,"avg_mm":2450}
+ * {"mac":"...","distance_mm":2450,"vcc_bat_mv":4900,"delivery_pct":98,"min_mm":2400,"max_mm":2500,"avg_mm":2450}
+ * 
+ * Binário: frame de 16 bytes (aguada_bin_frame_t) com flags de status
  */
 static bool send_telemetry(const telemetry_data_t *data, bool is_heartbeat) {
+    aguada_reading_t reading = {
+        .distance_mm = data->distance_mm,
+        .vcc_bat_mv = data->vcc_bat_mv,
+        .delivery_pct = data->delivery_pct,
+        .has_seq = true,
+        .seq = frame_seq++,
+    };
+    memcpy(reading.mac, node_mac, 6);
+
 #if USE_BINARY_PAYLOAD
-    uint8_t flags = 0;
-    if (is_heartbeat) flags |= FLAG_HEARTBEAT;
-    else flags |= FLAG_DELTA;
-    if (data->distance_mm < 0) flags |= FLAG_ERROR;
-    if (data->vcc_bat_mv < VCC_MIN_MV) flags |= FLAG_LOW_BATTERY;
+    uint8_t frame[AGUADA_BIN_SIZE];
     
-    return send_telemetry_binary(data, flags);
-#else
-    char payload[MAX_PAYLOAD_SIZE];
-    int len = 0;
+    reading.flags = is_heartbeat ? AGUADA_FLAG_HEARTBEAT : AGUADA_FLAG_DELTA;
+    if (data->distance_mm < 0) reading.flags |= AGUADA_FLAG_ERROR;
+    if (data->vcc_bat_mv < VCC_MIN_MV) reading.flags |= AGUADA_FLAG_LOW_BATTERY;
+    
+    aguada_bin_encode(&reading, frame);
     
-    // Base do JSON
-    len = snprintf(payload, sizeof(payload),
-             "{\"mac\":\"%s\",\"distance_mm\":%ld,\"vcc_bat_mv\":%ld,\"rssi\":%ld",
-             node_mac_str, 
-             (long)data->distance_mm, 
-             (long)data->vcc_bat_mv, 
-             (long)data->rssi);
+    ESP_LOGI(TAG, "→ BIN[%d]: dist=%ld vcc=%ld flags=0x%02X",
+             AGUADA_BIN_SIZE, (long)reading.distance_mm, (long)reading.vcc_bat_mv,
+             reading.flags);
+    
+    return espnow_send_payload(frame, sizeof(frame));
+#else
+    char payload[AGUADA_JSON_MAX];
 
 #if USE_RLE
-    // Adicionar contador RLE
-    len += snprintf(payload + len, sizeof(payload) - len,
-                    ",\"rle\":%d", rle_state.stable_count);
+    // Contador RLE
+    reading.rle = rle_state.stable_count;
 #endif
 
 #if USE_AGGREGATION
-    // Adicionar agregação no heartbeat
+    // Agregação no heartbeat
     if (is_heartbeat && agg_state.valid) {
-        int32_t min_mm, max_mm, avg_mm;
-        agg_get_and_reset(&min_mm, &max_mm, &avg_mm);
-        len += snprintf(payload + len, sizeof(payload) - len,
-                        ",\"min_mm\":%ld,\"max_mm\":%ld,\"avg_mm\":%ld",
-                        (long)min_mm, (long)max_mm, (long)avg_mm);
+        agg_get_and_reset(&reading.min_mm, &reading.max_mm, &reading.avg_mm);
+        reading.has_agg = true;
     }
 #endif
 
-    // Fechar JSON
-    snprintf(payload + len, sizeof(payload) - len, "}");
+    // Predição dupla: o backend ancora a reta neste (valor, inclinação)
+    reading.has_slope = data->has_slope;
+    reading.slope_mm_h = data->slope_mm_h;
+
+    int len = aguada_json_encode(&reading, payload, sizeof(payload));
     
     ESP_LOGI(TAG, "→ %s", payload);
     
-    // Enviar com retries
-    for (int retry = 0; retry < ESPNOW_MAX_RETRIES; retry++) {
-        esp_err_t result = esp_now_send(GATEWAY_MAC, (uint8_t*)payload, strlen(payload));
-        
-        if (result == ESP_OK) {
-            sensor_state.last_send_time = esp_timer_get_time();
-            return true;
-        }
-        
-        ESP_LOGW(TAG, "Retry %d/%d", retry + 1, ESPNOW_MAX_RETRIES);
-        vTaskDelay(pdMS_TO_TICKS(ESPNOW_RETRY_MS));
-    }
-    
-    ESP_LOGE(TAG, "Falha ao enviar após %d tentativas", ESPNOW_MAX_RETRIES);
-    return false;
+    return espnow_send_payload((const uint8_t *)payload, len);
 #endif
 }
 
+#else
+/**
+ * Fechar o lote corrente e enviá-lo num único frame (aguada_batch_t)
+ * 
+ * VCC do frame é o da leitura que fechou o lote (o RSSI fica para o
+ * gateway); o lote seguinte começa vazio mesmo se o envio falhar.
+ * 
+ * @param reason AGUADA_FLAG_HEARTBEAT/AGUADA_FLAG_DELTA (0 = cheio ou idade)
+ */
+static bool send_batch(const telemetry_data_t *data, uint8_t reason) {
+    aguada_reading_t status = {
+        .vcc_bat_mv = data->vcc_bat_mv,
+        .flags = reason,
+        .has_seq = true,
+        .seq = frame_seq++,
+    };
+    memcpy(status.mac, node_mac, 6);
+    if (data->vcc_bat_mv < VCC_MIN_MV) status.flags |= AGUADA_FLAG_LOW_BATTERY;
+    
+    uint32_t now_ms = (uint32_t)(node_time_us() / 1000);
+    uint32_t age_ms = aguada_batch_age_ms(&batch, now_ms);
+    size_t len = aguada_batch_finish(&batch, &status, now_ms);
+    
+    ESP_LOGI(TAG, "→ LOTE[%u]: %u leituras em %lu ms flags=0x%02X",
+             (unsigned)len, batch.count, (unsigned long)age_ms, batch.flags | status.flags);
+    
+    bool ok = espnow_send_payload(batch.buf, len);
+    aguada_batch_init(&batch);
+    return ok;
+}
+#endif
+
 /**
  * Verificar se deve enviar (delta com histerese ou heartbeat)
  * 
@@ -690,8 +764,6 @@ static bool send_telemetry(const telemetry_data_t *data, bool is_heartbeat) {
  * @return true se deve enviar
  */
 static bool should_send(const telemetry_data_t *current, const telemetry_data_t *last, bool *is_heartbeat) {
-    static int32_t trend_direction = 0;  // -1 = descendo, 0 = estável, +1 = subindo
-    
     *is_heartbeat = false;
     
     // Primeira leitura - sempre enviar
@@ -701,38 +773,35 @@ static bool should_send(const telemetry_data_t *current, const telemetry_data_t
     }
     
     // Heartbeat (tempo desde último envio)
-    int64_t now = esp_timer_get_time();
+    int64_t now = node_time_us();
     int64_t elapsed_ms = (now - sensor_state.last_send_time) / 1000;
     
     if (elapsed_ms >= HEARTBEAT_MS) {
         metrics.heartbeats_sent++;
-        trend_direction = 0;  // Reset trend
+        aguada_dsp_reset_trend(&dsp);
         *is_heartbeat = true;
         ESP_LOGD(TAG, "Heartbeat (elapsed: %lld ms)", elapsed_ms);
         return true;
     }
     
-    // Delta na distância com histerese
-    int32_t delta_mm = current->distance_mm - last->distance_mm;
-    int32_t abs_delta = abs(delta_mm);
-    
-    // Determinar threshold baseado na direção da tendência
-    int32_t threshold = DELTA_DISTANCE_MM;
-    
-    if (delta_mm > 0 && trend_direction <= 0) {
-        // Mudando de direção (descendo→subindo) - usar threshold + histerese
-        threshold = DELTA_DISTANCE_MM + HYSTERESIS_MM;
-    } else if (delta_mm < 0 && trend_direction >= 0) {
-        // Mudando de direção (subindo→descendo) - usar threshold + histerese
-        threshold = DELTA_DISTANCE_MM + HYSTERESIS_MM;
+#if DUAL_PREDICTION
+    // Desvio da reta compartilhada com o backend (último envio + inclinação)
+    uint32_t now_ms = (uint32_t)(current->timestamp / 1000);
+    if (aguada_predict_deviates(&predict, current->distance_mm, now_ms)) {
+        metrics.deltas_detected++;
+        ESP_LOGD(TAG, "Desvio da previsão: %ld mm",
+                 (long)(current->distance_mm - aguada_predict_value(&predict, now_ms)));
+        return true;
     }
-    
-    if (abs_delta >= threshold) {
+#else
+    // Delta na distância com histerese (delta + HYSTERESIS_MM na inversão de tendência)
+    if (aguada_dsp_deadband(&dsp, current->distance_mm, last->distance_mm)) {
         metrics.deltas_detected++;
-        trend_direction = (delta_mm > 0) ? 1 : -1;
-        ESP_LOGD(TAG, "Delta distância: %ld mm (threshold: %ld)", (long)delta_mm, (long)threshold);
+        ESP_LOGD(TAG, "Delta distância: %ld mm",
+                 (long)(current->distance_mm - last->distance_mm));
         return true;
     }
+#endif
     
     // Delta na tensão
     int32_t delta_vcc = abs(current->vcc_bat_mv - last->vcc_bat_mv);
@@ -750,77 +819,192 @@ static bool should_send(const telemetry_data_t *current, const telemetry_data_t
 // ============================================================================
 
 /**
- * Task de telemetria
+ * Um ciclo de telemetria
  * 
- * Ciclo:
- * 1. Ler sensor (mediana de 11 amostras, ~1.1s)
+ * 1. Ler sensor (mediana de até 11 amostras, ~1.1s no denso)
  * 2. Atualizar RLE e agregação
  * 3. Verificar se deve enviar (delta ou heartbeat)
- * 4. Enviar se necessário
- * 5. Aguardar próximo ciclo
+ * 4. Enviar se necessário (o rádio só sobe aqui no modo deep sleep);
+ *    com USE_BATCHING a leitura entra no lote e o frame só sai cheio,
+ *    velho ou no evento de delta/heartbeat
+ * 5. Ajustar a densidade da próxima leitura (estável → esparsa, mudança → densa)
  */
-static void telemetry_task(void *pvParameters) {
-    ESP_LOGI(TAG, "Iniciando telemetria (intervalo: %d ms, heartbeat: %d ms)",
-             READ_INTERVAL_MS, HEARTBEAT_MS);
+static void telemetry_cycle(void) {
+    // Coletar dados atuais
+    telemetry_data_t current = {
+        .distance_mm = read_ultrasonic_filtered(read_samples()),
+        .vcc_bat_mv = get_vcc_mv(),
+        .delivery_pct = aguada_link_delivery_pct(&link),
+        .timestamp = node_time_us()
+    };
     
-    sensor_state.first_reading = true;
-    sensor_state.last_send_time = esp_timer_get_time();
+    // Tratar erros do sensor
+    bool read_error = current.distance_mm < 0;
+    if (read_error) {
+        // Sensor com erro - enviar código de erro
+        current.distance_mm = (current.distance_mm == -1) ? 0 : 1;
+    }
+    
+    bool changed = false;
     
-    while (1) {
-        // Coletar dados atuais
-        telemetry_data_t current = {
-            .distance_mm = read_ultrasonic_filtered(),
-            .vcc_bat_mv = get_vcc_mv(),
-            .rssi = get_rssi(),
-            .timestamp = esp_timer_get_time()
-        };
-        
-        // Tratar erros do sensor
-        if (current.distance_mm < 0) {
-            // Sensor com erro - enviar código de erro
-            current.distance_mm = (current.distance_mm == -1) ? 0 : 1;
-        }
-        
 #if USE_RLE
-        // Atualizar RLE (conta leituras estáveis)
-        rle_update(current.distance_mm);
+    // Atualizar RLE (conta leituras estáveis; false = reset por mudança)
+    changed = !rle_update(current.distance_mm);
 #endif
 
 #if USE_AGGREGATION
-        // Atualizar agregação temporal
-        if (current.distance_mm > 0) {
-            agg_update(current.distance_mm);
+    // Atualizar agregação temporal
+    if (current.distance_mm > 0) {
+        agg_update(current.distance_mm);
+    }
+#endif
+    
+    // Verificar se deve enviar
+    bool is_heartbeat = false;
+    bool event = should_send(&current, &sensor_state.last_sent, &is_heartbeat);
+    
+#if USE_BATCHING
+    uint32_t now_ms = (uint32_t)(current.timestamp / 1000);
+    aguada_batch_add(&batch, current.distance_mm, read_error ? AGUADA_FLAG_ERROR : 0, now_ms);
+    
+    bool flush = event || aguada_batch_full(&batch) || batch.count >= BATCH_MAX_READINGS ||
+                 aguada_batch_age_ms(&batch, now_ms) >= BATCH_MAX_AGE_MS;
+#else
+    (void)read_error;
+    bool flush = event;
+#endif
+    
+    if (flush) {
+        changed |= event && !is_heartbeat;  // Delta (ou primeira leitura)
+        if (!espnow_ready) {
+            init_espnow();
+        }
+#if USE_BATCHING
+        uint8_t reason = !event ? 0 : is_heartbeat ? AGUADA_FLAG_HEARTBEAT : AGUADA_FLAG_DELTA;
+        bool sent = send_batch(&current, reason);
+#else
+#if DUAL_PREDICTION
+        // Inclinação desde a âncora (erro de leitura: sem reta, o backend para de prever)
+        uint32_t now_ms = (uint32_t)(current.timestamp / 1000);
+        if (!read_error) {
+            current.has_slope = true;
+            current.slope_mm_h = aguada_predict_slope(&predict, current.distance_mm, now_ms);
         }
 #endif
-        
-        // Verificar se deve enviar
-        bool is_heartbeat = false;
-        if (should_send(&current, &sensor_state.last_sent, &is_heartbeat)) {
-            if (send_telemetry(&current, is_heartbeat)) {
-                sensor_state.last_sent = current;
-#if USE_RLE
-                // Reset RLE após envio por delta
-                if (!is_heartbeat) {
-                    rle_state.stable_count = 1;
-                }
+        bool sent = send_telemetry(&current, is_heartbeat);
 #endif
+        if (sent) {
+            sensor_state.last_sent = current;
+#if DUAL_PREDICTION
+            // A âncora só muda com o ACK (ACK perdido após a entrega: o backend
+            // reancora e o node não, até o próximo envio)
+            if (read_error) {
+                aguada_predict_hold(&predict, current.distance_mm, now_ms);
+            } else {
+                aguada_predict_commit(&predict, current.distance_mm, current.slope_mm_h, now_ms);
             }
-        } else {
-            ESP_LOGD(TAG, "Sem mudança significativa");
-        }
-        
-        // Log de estatísticas periodicamente
-        if (metrics.packets_sent > 0 && metrics.packets_sent % STATS_INTERVAL == 0) {
-            ESP_LOGI(TAG, "📊 Stats: TX=%lu OK=%lu FAIL=%lu Delta=%lu HB=%lu",
-                     metrics.readings_total, metrics.packets_sent, 
-                     metrics.packets_failed, metrics.deltas_detected,
-                     metrics.heartbeats_sent);
+#endif
+#if USE_RLE
+            // Reset RLE após envio por delta
+            if (event && !is_heartbeat) {
+                rle_state.stable_count = 1;
+            }
+#endif
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(READ_INTERVAL_MS));
+    } else {
+        ESP_LOGD(TAG, "Sem mudança significativa");
+    }
+    
+#if USE_ADAPTIVE_SAMPLING
+    bool level_changed = changed ? aguada_adapt_change(&adapt) : aguada_adapt_stable(&adapt);
+    if (level_changed) {
+        ESP_LOGI(TAG, "Amostragem: %d amostras a cada %lu ms (nível %d)",
+                 adapt.samples, (unsigned long)adapt.interval_ms, adapt.level);
+    }
+#else
+    (void)changed;
+#endif
+    
+    // Log de estatísticas periodicamente
+    if (metrics.packets_sent > 0 && metrics.packets_sent % STATS_INTERVAL == 0) {
+        ESP_LOGI(TAG, "📊 Stats: TX=%lu OK=%lu FAIL=%lu Delta=%lu HB=%lu",
+                 metrics.readings_total, metrics.packets_sent, 
+                 metrics.packets_failed, metrics.deltas_detected,
+                 metrics.heartbeats_sent);
+        ESP_LOGI(TAG, "📡 Enlace: entrega=%u%% retries=%lu timeouts=%lu sem_ACK=%lu sondas=%lu",
+                 aguada_link_delivery_pct(&link), link.retries, link.timeouts,
+                 link.unconfirmed, link.probes);
+        ESP_LOGI(TAG, "📶 TX: %d.%02d dBm (↑%lu ↓%lu) gateway: RSSI=%d perda=%u%% relatórios=%lu",
+                 link.tx_power / 4, (link.tx_power % 4) * 25, link.tx_raised, link.tx_lowered,
+                 link.gateway_rssi, link.gateway_loss, link.reports);
+#if DUAL_PREDICTION
+        ESP_LOGI(TAG, "📈 Previsão: %lu leituras dentro da reta, inclinação=%ld mm/h",
+                 predict.suppressed, (long)predict.slope_mm_h);
+#endif
+    }
+}
+
+#if !USE_DEEP_SLEEP
+/**
+ * Task de telemetria (modo sempre ligado)
+ */
+static void telemetry_task(void *pvParameters) {
+    ESP_LOGI(TAG, "Iniciando telemetria (intervalo: %d ms, heartbeat: %d ms)",
+             READ_INTERVAL_MS, HEARTBEAT_MS);
+    
+    sensor_state.first_reading = true;
+    sensor_state.last_send_time = node_time_us();
+    
+    while (1) {
+        telemetry_cycle();
+        vTaskDelay(pdMS_TO_TICKS(read_interval_ms()));
     }
 }
 
+#else
+/**
+ * Task de ciclo único (modo deep sleep)
+ * 
+ * Acorda pelo timer, mede, decide via should_send, transmite só se
+ * necessário e volta a dormir. Sensor, EMA, RLE e agregação vêm da RTC RAM.
+ */
+static void sleep_cycle_task(void *pvParameters) {
+    if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER) {
+        // Power-on/reset: RTC RAM zerada, começar do zero
+        sensor_state.first_reading = true;
+        sensor_state.last_send_time = node_time_us();
+    }
+    
+    telemetry_cycle();
+    
+    bool radio_used = espnow_ready;
+    if (espnow_ready) {
+        esp_now_deinit();
+        esp_wifi_stop();
+    }
+    
+    // Orçamento acordado: despertar → dormir
+    int64_t awake_us = esp_timer_get_time() - cycle_start_us;
+    int64_t awake_ms = awake_us / 1000;
+    if (awake_ms > DEEP_SLEEP_BUDGET_MS) {
+        ESP_LOGW(TAG, "⏱ Ciclo: %lld ms acordado (rádio: %s) > orçamento %d ms",
+                 awake_ms, radio_used ? "sim" : "não", DEEP_SLEEP_BUDGET_MS);
+    } else {
+        ESP_LOGI(TAG, "⏱ Ciclo: %lld ms acordado (rádio: %s), orçamento %d ms",
+                 awake_ms, radio_used ? "sim" : "não", DEEP_SLEEP_BUDGET_MS);
+    }
+    
+    // Avançar o relógio pelo tempo acordado + tempo que vamos dormir
+    int64_t sleep_us = (int64_t)read_interval_ms() * 1000;
+    clock_base_us += esp_timer_get_time() + sleep_us;
+    
+    ESP_LOGI(TAG, "💤 Deep sleep por %lu ms", (unsigned long)read_interval_ms());
+    esp_sleep_enable_timer_wakeup(sleep_us);
+    esp_deep_sleep_start();
+}
+#endif
+
+#if !USE_DEEP_SLEEP
 /**
  * Task de heartbeat LED
  * 
@@ -839,12 +1023,25 @@ static void heartbeat_led_task(void *pvParameters) {
         vTaskDelay(pdMS_TO_TICKS(2400));  // Total = 3s
     }
 }
+#endif
 
 // ============================================================================
 // MAIN
 // ============================================================================
 
 void app_main(void) {
+#if USE_DEEP_SLEEP
+    cycle_start_us = esp_timer_get_time();
+    
+    // Despertar do timer: sem banner nem animação, direto para a medição
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER) {
+        init_gpio();
+        init_adc();
+        xTaskCreate(sleep_cycle_task, "sleep_cycle", 4096, NULL, 5, NULL);
+        return;
+    }
+#endif
+    
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "╔══════════════════════════════════════════════════════╗");
     ESP_LOGI(TAG, "║           AGUADA - Universal Sensor Node             ║");
@@ -858,6 +1055,20 @@ void app_main(void) {
     // Inicializações
     init_gpio();
     init_adc();
+    aguada_link_init(&link, &link_config);
+    aguada_dsp_init(&dsp, &dsp_config);
+#if USE_RUNNING_MEDIAN
+    aguada_running_median_init(&running_median, RUNNING_MEDIAN_WINDOW);
+#endif
+#if USE_ADAPTIVE_SAMPLING
+    aguada_adapt_init(&adapt, &adapt_config);
+#endif
+#if USE_BATCHING
+    aguada_batch_init(&batch);
+#endif
+#if DUAL_PREDICTION
+    aguada_predict_init(&predict, &predict_config);
+#endif
     
     // Animação de boot (3 piscadas)
     for (int i = 0; i < 3; i++) {
@@ -867,6 +1078,14 @@ void app_main(void) {
         vTaskDelay(pdMS_TO_TICKS(150));
     }
     
+#if USE_DEEP_SLEEP
+    // Rádio só sobe quando há o que enviar
+    xTaskCreate(sleep_cycle_task, "sleep_cycle", 4096, NULL, 5, NULL);
+    
+    ESP_LOGI(TAG, "");
+    ESP_LOGI(TAG, "✓ Sistema pronto (modo deep sleep)!");
+    ESP_LOGI(TAG, "  - Leitura a cada %d ms (dormindo)", DEEP_SLEEP_INTERVAL_MS);
+#else
     init_espnow();
     
     // Criar tasks
@@ -876,7 +1095,12 @@ void app_main(void) {
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "✓ Sistema pronto!");
     ESP_LOGI(TAG, "  - Leitura a cada %d ms", READ_INTERVAL_MS);
+#endif
     ESP_LOGI(TAG, "  - Heartbeat a cada %d ms", HEARTBEAT_MS);
+#if DUAL_PREDICTION
+    ESP_LOGI(TAG, "  - Desvio máximo da previsão: %d mm (predição dupla)", DELTA_DISTANCE_MM);
+#else
     ESP_LOGI(TAG, "  - Delta mínimo: %d mm", DELTA_DISTANCE_MM);
+#endif
     ESP_LOGI(TAG, "");
 }
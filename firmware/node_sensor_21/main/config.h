@@ -1,8 +1,11 @@
 /**
- * AGUADA v1.2 - Node Sensor 21 (Dual Ultrasonic)
+ * AGUADA v1.3 - Node Sensor 21 (N canais ultrassônicos)
  * 
- * Firmware para monitoramento de 2 cisternas: IE01 e IE02
- * Cada sensor envia pacotes como se fosse um node separado:
+ * Firmware para monitoramento de até MAX_CHANNELS reservatórios por ESP32-C3.
+ * Configuração de fábrica: cisternas IE01 e IE02 (tabela SENSOR_CHANNELS).
+ * Os canais que enviam num ciclo saem juntos num frame multicanal
+ * (USE_MULTI_FRAME); o gateway expande uma leitura por canal, cada uma com
+ * o MAC do seu sensor, como se fosse um node separado:
  * - IE01: Usa MAC real do ESP32-C3
  * - IE02: Usa MAC virtual (AA:BB:CC:DD:1E:02)
  */
@@ -15,23 +18,17 @@
 // ============================================================================
 // VERSÃO E IDENTIFICAÇÃO
 // ============================================================================
-#define FIRMWARE_VERSION    "v1.2.0"
-#define FIRMWARE_NAME       "AGUADA Node Sensor 21 (Dual)"
+#define FIRMWARE_VERSION    "v1.3.0"
+#define FIRMWARE_NAME       "AGUADA Node Sensor 21 (Multi)"
 #define PROTOCOL_VERSION    "AGUADA-1"
 
 // ============================================================================
 // CONFIGURAÇÃO DO GATEWAY
 // ============================================================================
+// Unicast com ACK para este gateway; FF:FF:FF:FF:FF:FF = descobrir por sonda
 static const uint8_t GATEWAY_MAC[6] = {0x80, 0xf1, 0xb2, 0x50, 0x2e, 0xc4};
 #define ESPNOW_CHANNEL      11
 
-// ============================================================================
-// MAC VIRTUAL PARA IE02
-// ============================================================================
-// IE01: Usa MAC real do ESP32-C3
-// IE02: Usa MAC virtual para aparecer como node separado
-// AA:BB:CC:DD:1E:02 ("1E" = IE, "02" = cisterna 2)
-
 // ============================================================================
 // PINOS GPIO - DUAL ULTRASONIC
 // ============================================================================
@@ -55,14 +52,6 @@ static const uint8_t GATEWAY_MAC[6] = {0x80, 0xf1, 0xb2, 0x50, 0x2e, 0xc4};
 // │                                                                         │
 // └─────────────────────────────────────────────────────────────────────────┘
 
-// Sensor Ultrassônico IE01 (Cisterna 1)
-#define PIN_TRIG_IE01       GPIO_NUM_1
-#define PIN_ECHO_IE01       GPIO_NUM_0
-
-// Sensor Ultrassônico IE02 (Cisterna 2)
-#define PIN_TRIG_IE02       GPIO_NUM_3
-#define PIN_ECHO_IE02       GPIO_NUM_2
-
 // LED de Status
 #define PIN_LED_STATUS      GPIO_NUM_8
 
@@ -72,6 +61,24 @@ static const uint8_t GATEWAY_MAC[6] = {0x80, 0xf1, 0xb2, 0x50, 0x2e, 0xc4};
 #define ADC_UNIT            ADC_UNIT_1
 #define ADC_ATTEN           ADC_ATTEN_DB_12
 
+// ============================================================================
+// TABELA DE CANAIS
+// ============================================================================
+// Uma linha por sensor: { id, TRIG, ECHO, MAC, deadband_mm, histerese_mm }
+// MAC zerado = MAC real do ESP32-C3; os demais canais usam MAC virtual para
+// aparecer como node separado (AA:BB:CC:DD:1E:02: "1E" = IE, "02" = cisterna 2).
+//
+// Pinos livres no C3 SuperMini para mais canais: GPIO 5, 6, 7, 10, 20, 21
+// (evitar 9 = BOOT e 18/19 = USB). Com os 4 já usados, cabem até 5 sensores;
+// acima disso é preciso liberar o LED/ADC ou multiplexar ECHO.
+#define MAX_CHANNELS        8
+
+#define SENSOR_CHANNELS \
+    { "IE01", GPIO_NUM_1, GPIO_NUM_0, {0}, \
+      DELTA_DISTANCE_MM, HYSTERESIS_MM }, \
+    { "IE02", GPIO_NUM_3, GPIO_NUM_2, {0xAA, 0xBB, 0xCC, 0xDD, 0x1E, 0x02}, \
+      DELTA_DISTANCE_MM, HYSTERESIS_MM },
+
 // ============================================================================
 // SENSOR ULTRASSÔNICO AJ-SR04M
 // ============================================================================
@@ -79,7 +86,15 @@ static const uint8_t GATEWAY_MAC[6] = {0x80, 0xf1, 0xb2, 0x50, 0x2e, 0xc4};
 #define SENSOR_MAX_MM       4500
 #define SENSOR_TIMEOUT_US   60000
 #define SAMPLES_PER_READ    11
-#define SAMPLE_INTERVAL_MS  100
+#define SAMPLE_INTERVAL_MS  100     // Espaçamento entre amostras do mesmo sensor
+#define CROSSTALK_GUARD_MS  20      // Fim de um eco → próximo disparo (outro canal)
+#define USE_RUNNING_MEDIAN  0       // Mediana das últimas N amostras (entre leituras)
+#define RUNNING_MEDIAN_WINDOW 15
+
+// Aquisição intercalada: os canais disparam em sequência dentro de cada
+// SAMPLE_INTERVAL_MS. Cabe se N × (eco máximo + guarda) ≤ intervalo; eco
+// máximo a SENSOR_MAX_MM ≈ SENSOR_MAX_MM × 2 / 343 ms (~26 ms a 4,5 m).
+// Com 3+ canais, aumente SAMPLE_INTERVAL_MS (o boot avisa se não couber).
 
 // ============================================================================
 // TEMPOS E INTERVALOS
@@ -87,6 +102,13 @@ static const uint8_t GATEWAY_MAC[6] = {0x80, 0xf1, 0xb2, 0x50, 0x2e, 0xc4};
 #define READ_INTERVAL_MS    2000
 #define HEARTBEAT_MS        120000
 
+// Amostragem adaptativa por sensor (aguada_adapt.h): estável → menos amostras
+// e intervalo maior; mudança → denso. O ciclo espera o menor intervalo entre canais.
+#define USE_ADAPTIVE_SAMPLING   1
+#define ADAPT_STABLE_READS      15
+#define ADAPT_SPARSE_SAMPLES    3
+#define ADAPT_MAX_STRETCH_LOG2  3
+
 // ============================================================================
 // COMPRESSÃO DE DADOS (DEADBAND)
 // ============================================================================
@@ -97,10 +119,25 @@ static const uint8_t GATEWAY_MAC[6] = {0x80, 0xf1, 0xb2, 0x50, 0x2e, 0xc4};
 // ============================================================================
 // ESP-NOW
 // ============================================================================
+// Envio confirmado (components/aguada_link): cada tentativa espera o ACK;
+// só falha real gera retry, com backoff exponencial + jitter a partir de B
 #define ESPNOW_QUEUE_SIZE   6
-#define ESPNOW_MAX_RETRIES  3
-#define ESPNOW_RETRY_MS     500
-#define MAX_PAYLOAD_SIZE    200
+#define ESPNOW_MAX_RETRIES  3       // Transmissões por envio
+#define ESPNOW_ACK_TIMEOUT_MS 100   // Espera pelo callback de envio
+#define ESPNOW_BACKOFF_MS   100     // Base B do backoff
+#define LINK_PROBE_TIMEOUT_MS 200   // Espera pelo beacon (só com descoberta)
+#define LINK_PROBE_EVERY    10
+#define LINK_REDISCOVER_AFTER 3
+
+// Potência de TX adaptativa (0,25 dBm): desce até o mínimo que mantém a
+// entrega acima da meta, pelo RSSI/perda que o gateway relata
+#define USE_ADAPTIVE_TX_POWER 1
+#define TX_POWER_MIN_QDBM   8       // 2 dBm
+#define TX_POWER_MAX_QDBM   80      // 20 dBm (e potência inicial)
+#define TX_POWER_STEP_QDBM  8       // 2 dBm
+#define TX_DELIVERY_TARGET_PCT 95
+#define TX_RSSI_TARGET_DBM  -75
+#define TX_SETTLE_SENDS     4
 
 // ============================================================================
 // BATERIA / ALIMENTAÇÃO (ADC)
@@ -114,10 +151,35 @@ static const uint8_t GATEWAY_MAC[6] = {0x80, 0xf1, 0xb2, 0x50, 0x2e, 0xc4};
 // ============================================================================
 // FILTRAGEM
 // ============================================================================
+// Ponto fixo por canal (components/aguada_dsp):
+// mediana → Hampel → EMA Q15 → deadband (deadband/histerese da linha do canal)
 #define EMA_ALPHA           0.3
 #define USE_EMA_FILTER      1
+#define USE_HAMPEL_FILTER   1
+#define HAMPEL_WINDOW       5
+#define HAMPEL_K            3.0
+#define HAMPEL_MIN_MM       30
 #define USE_RLE             1
 #define RLE_MAX_COUNT       255
 #define STATS_INTERVAL      10
 
+// ============================================================================
+// FRAME MULTICANAL (VÁRIOS CANAIS POR FRAME)
+// ============================================================================
+// Os canais que decidem enviar num ciclo saem juntos num frame aguada_multi:
+// VCC/entrega uma vez + MAC/distância/rle por canal. Os gateways expandem em
+// uma leitura AGUADA-1 por sensor. 0 = um JSON por canal. USE_BATCHING=1 tem
+// prioridade (um lote por canal).
+#define USE_MULTI_FRAME     1
+
+// ============================================================================
+// LOTES (VÁRIAS LEITURAS POR FRAME)
+// ============================================================================
+// Um lote aguada_batch por canal (cada um com o seu MAC): toda leitura entra
+// e o frame sai cheio, com BATCH_MAX_AGE_MS ou num evento (delta/heartbeat).
+// Os gateways desempacotam em leituras AGUADA-1 com "age_ms". Sem RLE no lote.
+#define USE_BATCHING        0
+#define BATCH_MAX_READINGS  32
+#define BATCH_MAX_AGE_MS    60000
+
 #endif // CONFIG_H
@@ -1,12 +1,19 @@
 /**
- * AGUADA v1.2 - Node Sensor 21 (Dual Ultrasonic)
+ * AGUADA v1.3 - Node Sensor 21 (N canais ultrassônicos)
  * 
- * Firmware para 2 sensores ultrassônicos (IE01 + IE02)
- * Cada sensor envia pacotes como se fosse um node separado:
- * - IE01: Usa MAC real do ESP32-C3
- * - IE02: Usa MAC virtual (AA:BB:CC:DD:1E:02)
+ * Firmware genérico para até MAX_CHANNELS sensores ultrassônicos num ESP32-C3.
+ * Os canais vêm da tabela SENSOR_CHANNELS (config.h): TRIG, ECHO, id lógico,
+ * MAC do canal e parâmetros de filtro. Um só laço agenda todos:
+ * - Aquisição intercalada: os pings dos canais alternam dentro da mesma
+ *   janela de amostragem, separados por uma guarda anti-crosstalk
+ * - Estado por canal (sensor_state_t): filtro, RLE, amostragem adaptativa,
+ *   heartbeat e lote
  * 
- * Hardware: ESP32-C3 SuperMini + 2x AJ-SR04M
+ * Os canais dividem um só enlace (aguada_link): unicast com ACK ao
+ * gateway e uma taxa de entrega comum, reportada como "delivery_pct".
+ * Com USE_MULTI_FRAME, um só frame por ciclo leva todos os canais pendentes.
+ * 
+ * Hardware: ESP32-C3 SuperMini + N x AJ-SR04M (IE01 + IE02 na cisterna)
  * Protocolo: ESP-NOW → Gateway → HTTP/MQTT → Backend
  */
 
@@ -27,6 +34,12 @@
 #include "esp_adc/adc_oneshot.h"
 #include "esp_adc/adc_cali.h"
 #include "esp_adc/adc_cali_scheme.h"
+#include "aguada_proto.h"
+#include "aguada_sonar.h"
+#include "aguada_dsp.h"
+#include "aguada_adapt.h"
+#include "aguada_select.h"
+#include "aguada_link.h"
 #include "config.h"
 
 static const char *TAG = "AGUADA_NODE21";
@@ -38,7 +51,7 @@ static const char *TAG = "AGUADA_NODE21";
 typedef struct {
     int32_t distance_mm;
     int32_t vcc_bat_mv;
-    int32_t rssi;
+    uint8_t delivery_pct;   // Entrega confirmada por ACK (0 = sem dados)
     int64_t timestamp;
 } telemetry_data_t;
 
@@ -47,12 +60,44 @@ typedef struct {
     telemetry_data_t current;
     int64_t last_send_time;
     bool first_reading;
-    float ema_distance_mm;
-    bool ema_initialized;
+    aguada_dsp_t dsp;               // Hampel + EMA Q15 + tendência (por canal)
+#if USE_RUNNING_MEDIAN
+    aguada_running_median_t median; // Amostras das últimas leituras
+#endif
+#if USE_ADAPTIVE_SAMPLING
+    aguada_adapt_t adapt;           // Densidade de amostragem do canal
+#endif
+#if USE_BATCHING
+    aguada_batch_t batch;           // Leituras ainda não enviadas (frame em lote)
+#endif
     uint8_t rle_stable_count;
     int32_t rle_stable_value;
 } sensor_state_t;
 
+/**
+ * Linha da tabela de canais (SENSOR_CHANNELS em config.h)
+ */
+typedef struct {
+    const char *id;           // Identificador lógico (IE01, ...)
+    gpio_num_t trig_pin;
+    gpio_num_t echo_pin;
+    uint8_t mac[6];           // MAC do canal; zeros = MAC real do ESP32-C3
+    int32_t deadband_mm;      // Delta mínimo para envio
+    int32_t hysteresis_mm;    // Acréscimo na inversão de tendência
+} channel_config_t;
+
+/**
+ * Canal em execução: sensor, filtro e estado de envio
+ */
+typedef struct {
+    const channel_config_t *cfg;
+    aguada_dsp_config_t dsp_cfg;    // Config comum + deadband/histerese do canal
+    aguada_sonar_t sonar;           // Captura de eco (ISR compartilhada)
+    sensor_state_t state;
+    uint8_t mac[6];
+    char mac_str[AGUADA_MAC_STR_LEN];
+} channel_t;
+
 typedef struct {
     uint32_t packets_sent;
     uint32_t packets_failed;
@@ -66,19 +111,67 @@ typedef struct {
 // VARIÁVEIS GLOBAIS
 // ============================================================================
 
-// MAC addresses
-static uint8_t node_mac_ie01[6];        // MAC real do ESP32-C3 (IE01)
-static uint8_t node_mac_ie02[6] = {0xAA, 0xBB, 0xCC, 0xDD, 0x1E, 0x02};  // MAC virtual (IE02)
-static char mac_str_ie01[18];
-static char mac_str_ie02[18];
+// Tabela de canais e estado de cada um
+static const channel_config_t channel_table[] = { SENSOR_CHANNELS };
+#define CHANNEL_COUNT ((int)(sizeof(channel_table) / sizeof(channel_table[0])))
+_Static_assert(CHANNEL_COUNT >= 1 && CHANNEL_COUNT <= MAX_CHANNELS, "SENSOR_CHANNELS: 1 a MAX_CHANNELS canais");
+
+static channel_t channels[CHANNEL_COUNT];
+static uint8_t node_mac[6]; // MAC real do ESP32-C3
 
-// Estados dos sensores (separados)
-static sensor_state_t sensor_ie01 = {0};
-static sensor_state_t sensor_ie02 = {0};
+// Sequência dos frames deste rádio (8 bits, dá a volta), comum a todos os
+// canais: o gateway conta perdas e reenvios por ela
+static uint8_t frame_seq = 0;
+
+// Filtragem em ponto fixo (base comum; deadband/histerese vêm de cada canal)
+#if USE_EMA_FILTER
+#define DSP_EMA_ALPHA EMA_ALPHA
+#else
+#define DSP_EMA_ALPHA 0.0
+#endif
+#if USE_HAMPEL_FILTER
+#define DSP_HAMPEL_WINDOW HAMPEL_WINDOW
+#else
+#define DSP_HAMPEL_WINDOW 0
+#endif
+static const aguada_dsp_config_t dsp_config = AGUADA_DSP_CONFIG(
+    DSP_EMA_ALPHA, DSP_HAMPEL_WINDOW, HAMPEL_K, HAMPEL_MIN_MM,
+    DELTA_DISTANCE_MM, HYSTERESIS_MM);
+
+#if USE_ADAPTIVE_SAMPLING
+static const aguada_adapt_config_t adapt_config = {
+    .dense_samples = SAMPLES_PER_READ,
+    .sparse_samples = ADAPT_SPARSE_SAMPLES,
+    .base_interval_ms = READ_INTERVAL_MS,
+    .max_stretch_log2 = ADAPT_MAX_STRETCH_LOG2,
+    .stable_reads = ADAPT_STABLE_READS,
+};
+#endif
 
 // Métricas (compartilhadas)
 static metrics_t metrics = {0};
 
+// Enlace com o gateway (um rádio para todos os canais)
+static const aguada_link_config_t link_config = {
+    .gateway = {GATEWAY_MAC[0], GATEWAY_MAC[1], GATEWAY_MAC[2],
+                GATEWAY_MAC[3], GATEWAY_MAC[4], GATEWAY_MAC[5]},
+    .max_attempts = ESPNOW_MAX_RETRIES,
+    .ack_timeout_ms = ESPNOW_ACK_TIMEOUT_MS,
+    .backoff_base_ms = ESPNOW_BACKOFF_MS,
+    .probe_timeout_ms = LINK_PROBE_TIMEOUT_MS,
+    .probe_every = LINK_PROBE_EVERY,
+    .rediscover_after = LINK_REDISCOVER_AFTER,
+#if USE_ADAPTIVE_TX_POWER
+    .tx_power_min = TX_POWER_MIN_QDBM,
+    .tx_power_max = TX_POWER_MAX_QDBM,
+    .tx_power_step = TX_POWER_STEP_QDBM,
+    .delivery_target_pct = TX_DELIVERY_TARGET_PCT,
+    .rssi_target_dbm = TX_RSSI_TARGET_DBM,
+    .tx_settle = TX_SETTLE_SENDS,
+#endif
+};
+static aguada_link_t link;
+
 // ADC handles
 static adc_oneshot_unit_handle_t adc_handle = NULL;
 static adc_cali_handle_t adc_cali_handle = NULL;
@@ -88,20 +181,6 @@ static bool adc_calibrated = false;
 // FUNÇÕES AUXILIARES
 // ============================================================================
 
-static void mac_to_string(const uint8_t *mac, char *str) {
-    snprintf(str, 18, "%02X:%02X:%02X:%02X:%02X:%02X",
-             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-}
-
-static int get_rssi(void) {
-    if (metrics.packets_sent + metrics.packets_failed > 0) {
-        float success_rate = (float)metrics.packets_sent / 
-                            (float)(metrics.packets_sent + metrics.packets_failed);
-        return (int)(-90 + success_rate * 60);
-    }
-    return -50;
-}
-
 static int get_vcc_mv(void) {
     if (adc_handle == NULL) {
         return VCC_USB_MV;
@@ -123,7 +202,7 @@ static int get_vcc_mv(void) {
     }
     
     int avg_mv = sum_mv / VCC_ADC_SAMPLES;
-    int vcc_mv = (int)(avg_mv * VCC_DIVIDER_RATIO);
+    int vcc_mv = aguada_dsp_mul_fix(avg_mv, AGUADA_DSP_FIX(VCC_DIVIDER_RATIO, 10), 10);
     
     if (vcc_mv < VCC_MIN_MV || vcc_mv > VCC_MAX_MV) {
         ESP_LOGW(TAG, "VCC fora do range: %d mV", vcc_mv);
@@ -132,38 +211,41 @@ static int get_vcc_mv(void) {
     return vcc_mv;
 }
 
-static int compare_int(const void *a, const void *b) {
-    return (*(int*)a - *(int*)b);
-}
-
 // ============================================================================
 // INICIALIZAÇÃO GPIO
 // ============================================================================
 
+#define SEND_BLINK_US 30000  // LED aceso por envio confirmado
+
+// Apaga o LED do envio confirmado. One-shot do esp_timer: o callback de envio
+// roda na task do WiFi, que também entrega os beacons/relatórios do aguada_link
+// - não pode dormir ali
+static esp_timer_handle_t led_off_timer = NULL;
+
+static void led_off_cb(void *arg) {
+    gpio_set_level(PIN_LED_STATUS, 0);
+}
+
 static void init_gpio(void) {
-    // Sensor IE01
-    gpio_reset_pin(PIN_TRIG_IE01);
-    gpio_set_direction(PIN_TRIG_IE01, GPIO_MODE_OUTPUT);
-    gpio_set_level(PIN_TRIG_IE01, 0);
-    
-    gpio_reset_pin(PIN_ECHO_IE01);
-    gpio_set_direction(PIN_ECHO_IE01, GPIO_MODE_INPUT);
-    
-    // Sensor IE02
-    gpio_reset_pin(PIN_TRIG_IE02);
-    gpio_set_direction(PIN_TRIG_IE02, GPIO_MODE_OUTPUT);
-    gpio_set_level(PIN_TRIG_IE02, 0);
-    
-    gpio_reset_pin(PIN_ECHO_IE02);
-    gpio_set_direction(PIN_ECHO_IE02, GPIO_MODE_INPUT);
+    // Um sonar por canal (ECHO com interrupção nas duas bordas)
+    for (int i = 0; i < CHANNEL_COUNT; i++) {
+        channel_t *ch = &channels[i];
+        ch->cfg = &channel_table[i];
+        ESP_ERROR_CHECK(aguada_sonar_init(&ch->sonar, ch->cfg->trig_pin, ch->cfg->echo_pin, SENSOR_TIMEOUT_US));
+        ESP_LOGI(TAG, "✓ GPIO %s: TRIG=%d, ECHO=%d", ch->cfg->id, ch->cfg->trig_pin, ch->cfg->echo_pin);
+    }
     
     // LED Status
     gpio_reset_pin(PIN_LED_STATUS);
     gpio_set_direction(PIN_LED_STATUS, GPIO_MODE_OUTPUT);
     gpio_set_level(PIN_LED_STATUS, 0);
     
-    ESP_LOGI(TAG, "✓ GPIO IE01: TRIG=%d, ECHO=%d", PIN_TRIG_IE01, PIN_ECHO_IE01);
-    ESP_LOGI(TAG, "✓ GPIO IE02: TRIG=%d, ECHO=%d", PIN_TRIG_IE02, PIN_ECHO_IE02);
+    const esp_timer_create_args_t led_timer_args = {
+        .callback = led_off_cb,
+        .name = "led_off",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&led_timer_args, &led_off_timer));
+    
     ESP_LOGI(TAG, "✓ LED=%d", PIN_LED_STATUS);
 }
 
@@ -209,36 +291,25 @@ static void init_adc(void) {
     }
 #endif
     
-    ESP_LOGI(TAG, "✓ ADC: GPIO%d, divisor %.1f:1", PIN_VCC_ADC, VCC_DIVIDER_RATIO);
+    ESP_LOGI(TAG, "✓ ADC: GPIO%d, divisor %d/1024", PIN_VCC_ADC,
+             (int)AGUADA_DSP_FIX(VCC_DIVIDER_RATIO, 10));
 }
 
 // ============================================================================
 // SENSOR ULTRASSÔNICO (Genérico para qualquer pino)
 // ============================================================================
 
-static int read_ultrasonic_single(gpio_num_t trig_pin, gpio_num_t echo_pin) {
-    gpio_set_level(trig_pin, 0);
-    esp_rom_delay_us(2);
-    gpio_set_level(trig_pin, 1);
-    esp_rom_delay_us(10);
-    gpio_set_level(trig_pin, 0);
-    
-    int64_t timeout_start = esp_timer_get_time();
-    while (gpio_get_level(echo_pin) == 0) {
-        if ((esp_timer_get_time() - timeout_start) > SENSOR_TIMEOUT_US) {
-            return -1;
-        }
-    }
-    
-    int64_t pulse_start = esp_timer_get_time();
-    while (gpio_get_level(echo_pin) == 1) {
-        if ((esp_timer_get_time() - pulse_start) > SENSOR_TIMEOUT_US) {
-            return -1;
-        }
+/**
+ * Leitura única: eco capturado por interrupção (aguada_sonar), a task
+ * bloqueia durante o voo do pulso
+ */
+static int read_ultrasonic_single(aguada_sonar_t *sonar) {
+    int32_t echo_us = aguada_sonar_measure(sonar);
+    if (echo_us == AGUADA_SONAR_TIMEOUT) {
+        return -1;
     }
-    int64_t duration_us = esp_timer_get_time() - pulse_start;
     
-    int32_t distance_mm = (int32_t)((duration_us * 343) / 2000);
+    int32_t distance_mm = aguada_sonar_us_to_mm(echo_us);
     
     if (distance_mm < SENSOR_MIN_MM || distance_mm > SENSOR_MAX_MM) {
         return -2;
@@ -247,64 +318,140 @@ static int read_ultrasonic_single(gpio_num_t trig_pin, gpio_num_t echo_pin) {
     return distance_mm;
 }
 
-static int apply_ema_filter(sensor_state_t *state, int new_value) {
-#if USE_EMA_FILTER
-    if (!state->ema_initialized) {
-        state->ema_distance_mm = (float)new_value;
-        state->ema_initialized = true;
-        return new_value;
+/**
+ * Janela de amostras de um canal (aquisição intercalada)
+ */
+typedef struct {
+    int count;                          // Amostras pedidas nesta janela
+    int valid;                          // Amostras válidas coletadas
+    int32_t samples[SAMPLES_PER_READ];
+} sample_window_t;
+
+/**
+ * Espera o fim da guarda de crosstalk contada do fim do último eco
+ */
+static void crosstalk_guard(int64_t last_echo_end_us) {
+    int64_t wait_us = last_echo_end_us + (int64_t)CROSSTALK_GUARD_MS * 1000 - esp_timer_get_time();
+    if (wait_us > 0) {
+        uint32_t wait_ms = (uint32_t)((wait_us + 999) / 1000);
+        vTaskDelay((wait_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS + 1);
     }
-    
-    state->ema_distance_mm = EMA_ALPHA * (float)new_value + (1.0f - EMA_ALPHA) * state->ema_distance_mm;
-    return (int)(state->ema_distance_mm + 0.5f);
-#else
-    return new_value;
-#endif
 }
 
-static int read_ultrasonic_filtered(gpio_num_t trig_pin, gpio_num_t echo_pin, sensor_state_t *state) {
-    int samples[SAMPLES_PER_READ];
-    int valid_count = 0;
+/**
+ * Aquisição intercalada: numa só janela, a rodada i dispara os canais em
+ * ordem (cada um só enquanto i < count do canal), com CROSSTALK_GUARD_MS entre
+ * o fim de um eco e o próximo disparo. As rodadas são espaçadas de
+ * SAMPLE_INTERVAL_MS, então cada canal mantém o mesmo espaçamento entre
+ * amostras do node de sensor único e o ciclo dura ~count × SAMPLE_INTERVAL_MS
+ * em vez de N vezes isso. O eco continua capturado pela ISR de borda (aguada_sonar).
+ */
+static void acquire_interleaved(sample_window_t *windows) {
+    int rounds = 0;
+    for (int ch = 0; ch < CHANNEL_COUNT; ch++) {
+        windows[ch].valid = 0;
+        if (windows[ch].count > rounds) {
+            rounds = windows[ch].count;
+        }
+    }
     
-    metrics.readings_total++;
+    int64_t last_echo_end_us = 0;
+    TickType_t round_start = xTaskGetTickCount();
     
-    for (int i = 0; i < SAMPLES_PER_READ; i++) {
-        int dist = read_ultrasonic_single(trig_pin, echo_pin);
-        if (dist > 0) {
-            samples[valid_count++] = dist;
+    for (int i = 0; i < rounds; i++) {
+        for (int ch = 0; ch < CHANNEL_COUNT; ch++) {
+            sample_window_t *w = &windows[ch];
+            if (i >= w->count) {
+                continue;
+            }
+            
+            if (last_echo_end_us != 0) {
+                crosstalk_guard(last_echo_end_us);
+            }
+            int dist = read_ultrasonic_single(&channels[ch].sonar);
+            last_echo_end_us = esp_timer_get_time();
+            
+            if (dist > 0) {
+                w->samples[w->valid++] = dist;
+            }
+        }
+        
+        if (i + 1 < rounds) {
+            vTaskDelayUntil(&round_start, pdMS_TO_TICKS(SAMPLE_INTERVAL_MS));
         }
-        vTaskDelay(pdMS_TO_TICKS(SAMPLE_INTERVAL_MS));
     }
+}
+
+/**
+ * Leitura filtrada de uma janela: mediana (rede de seleção, ou móvel) →
+ * Hampel → EMA Q15 (aguada_dsp, por canal). Reordena as amostras.
+ */
+static int filter_window(sample_window_t *w, channel_t *ch) {
+    sensor_state_t *state = &ch->state;
+    metrics.readings_total++;
     
-    if (valid_count < (SAMPLES_PER_READ / 2)) {
-        ESP_LOGW(TAG, "Poucas amostras válidas: %d/%d", valid_count, SAMPLES_PER_READ);
+    if (w->valid < (w->count / 2) || w->valid == 0) {
+        ESP_LOGW(TAG, "[%s] Poucas amostras válidas: %d/%d", ch->cfg->id, w->valid, w->count);
         return -1;
     }
     
-    qsort(samples, valid_count, sizeof(int), compare_int);
-    int median = samples[valid_count / 2];
-    int filtered = apply_ema_filter(state, median);
+#if USE_RUNNING_MEDIAN
+    for (int i = 0; i < w->valid; i++) {
+        aguada_running_median_push(&state->median, w->samples[i]);
+    }
+    int32_t filtered = aguada_dsp_filter(&state->dsp, aguada_running_median_get(&state->median));
+#else
+    int32_t filtered = aguada_dsp_process(&state->dsp, w->samples, w->valid);
+#endif
     
     metrics.readings_valid++;
     
     return filtered;
 }
 
+/**
+ * Lê todos os canais numa janela intercalada e filtra cada um
+ * 
+ * @param distance_mm saída por canal (negativo = erro de leitura)
+ */
+static void read_channels_filtered(int32_t *distance_mm) {
+    sample_window_t windows[CHANNEL_COUNT];
+    
+    for (int i = 0; i < CHANNEL_COUNT; i++) {
+#if USE_ADAPTIVE_SAMPLING
+        windows[i].count = channels[i].state.adapt.samples;
+#else
+        windows[i].count = SAMPLES_PER_READ;
+#endif
+    }
+    
+    acquire_interleaved(windows);
+    for (int i = 0; i < CHANNEL_COUNT; i++) {
+        distance_mm[i] = filter_window(&windows[i], &channels[i]);
+    }
+}
+
 // ============================================================================
 // ESP-NOW
 // ============================================================================
 
 static void espnow_send_cb(const esp_now_send_info_t *info, esp_now_send_status_t status) {
+    aguada_link_on_send(&link, status);
+    
     if (status == ESP_NOW_SEND_SUCCESS) {
         metrics.packets_sent++;
         gpio_set_level(PIN_LED_STATUS, 1);
-        vTaskDelay(pdMS_TO_TICKS(30));
-        gpio_set_level(PIN_LED_STATUS, 0);
+        esp_timer_stop(led_off_timer);  // Reinicia a piscada se ainda acesa
+        esp_timer_start_once(led_off_timer, SEND_BLINK_US);
     } else {
         metrics.packets_failed++;
     }
 }
 
+static void espnow_recv_cb(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    aguada_link_on_recv(&link, info, data, len);
+}
+
 static void init_espnow(void) {
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
@@ -323,23 +470,25 @@ static void init_espnow(void) {
     ESP_ERROR_CHECK(esp_wifi_start());
     ESP_ERROR_CHECK(esp_wifi_set_channel(ESPNOW_CHANNEL, WIFI_SECOND_CHAN_NONE));
     
-    // Obter MAC real (para IE01)
-    ESP_ERROR_CHECK(esp_wifi_get_mac(WIFI_IF_STA, node_mac_ie01));
-    mac_to_string(node_mac_ie01, mac_str_ie01);
-    mac_to_string(node_mac_ie02, mac_str_ie02);
+    // MAC real; canais com MAC zerado na tabela usam este
+    static const uint8_t no_mac[6] = {0};
+    ESP_ERROR_CHECK(esp_wifi_get_mac(WIFI_IF_STA, node_mac));
     
     ESP_LOGI(TAG, "✓ Canal ESP-NOW: %d", ESPNOW_CHANNEL);
-    ESP_LOGI(TAG, "✓ IE01 MAC: %s (real)", mac_str_ie01);
-    ESP_LOGI(TAG, "✓ IE02 MAC: %s (virtual)", mac_str_ie02);
+    for (int i = 0; i < CHANNEL_COUNT; i++) {
+        channel_t *ch = &channels[i];
+        bool real = memcmp(ch->cfg->mac, no_mac, 6) == 0;
+        memcpy(ch->mac, real ? node_mac : ch->cfg->mac, 6);
+        aguada_mac_to_string(ch->mac, ch->mac_str);
+        ESP_LOGI(TAG, "✓ %s MAC: %s (%s)", ch->cfg->id, ch->mac_str, real ? "real" : "virtual");
+    }
     
     ESP_ERROR_CHECK(esp_now_init());
     ESP_ERROR_CHECK(esp_now_register_send_cb(espnow_send_cb));
+    ESP_ERROR_CHECK(esp_now_register_recv_cb(espnow_recv_cb));
     
-    esp_now_peer_info_t peer_info = {0};
-    memcpy(peer_info.peer_addr, GATEWAY_MAC, 6);
-    peer_info.channel = ESPNOW_CHANNEL;
-    peer_info.encrypt = false;
-    ESP_ERROR_CHECK(esp_now_add_peer(&peer_info));
+    aguada_link_init(&link, &link_config);
+    ESP_ERROR_CHECK(aguada_link_start(&link));
     
     ESP_LOGI(TAG, "✓ Gateway: %02X:%02X:%02X:%02X:%02X:%02X",
              GATEWAY_MAC[0], GATEWAY_MAC[1], GATEWAY_MAC[2],
@@ -350,8 +499,9 @@ static void init_espnow(void) {
 // TELEMETRIA
 // ============================================================================
 
-static bool rle_update(sensor_state_t *state, int32_t distance_mm) {
+static bool rle_update(channel_t *ch, int32_t distance_mm) {
 #if USE_RLE
+    sensor_state_t *state = &ch->state;
     if (state->rle_stable_count == 0) {
         state->rle_stable_value = distance_mm;
         state->rle_stable_count = 1;
@@ -360,7 +510,7 @@ static bool rle_update(sensor_state_t *state, int32_t distance_mm) {
     
     int32_t delta = abs(distance_mm - state->rle_stable_value);
     
-    if (delta < DELTA_DISTANCE_MM) {
+    if (delta < ch->cfg->deadband_mm) {
         if (state->rle_stable_count < RLE_MAX_COUNT) {
             state->rle_stable_count++;
         }
@@ -371,42 +521,196 @@ static bool rle_update(sensor_state_t *state, int32_t distance_mm) {
         return false;
     }
 #else
+    (void)ch;
+    (void)distance_mm;
     return true;
 #endif
 }
 
-static bool send_telemetry(const char *mac_str, const uint8_t *mac, 
-                          const telemetry_data_t *data, 
-                          sensor_state_t *state,
-                          const char *sensor_name) {
-    char payload[MAX_PAYLOAD_SIZE];
+/**
+ * Enviar ao gateway e esperar o ACK (retries com backoff no aguada_link)
+ */
+static bool espnow_send_payload(const uint8_t *payload, size_t len, const char *name) {
+    esp_err_t result = aguada_link_send(&link, payload, len);
+    
+    if (result == ESP_OK) {
+        return true;
+    }
+    
+    ESP_LOGE(TAG, "[%s] Falha ao enviar: %s", name, esp_err_to_name(result));
+    return false;
+}
+
+/**
+ * Leitura confirmada pelo gateway: vira a referência do deadband do canal
+ */
+static void channel_sent(channel_t *ch, const telemetry_data_t *data, bool delta) {
+    ch->state.last_sent = *data;
+    ch->state.last_send_time = esp_timer_get_time();
+    if (delta) {
+        ch->state.rle_stable_count = 1;
+    }
+}
+
+#if !USE_BATCHING && USE_MULTI_FRAME
+_Static_assert(CHANNEL_COUNT <= AGUADA_MULTI_MAX_CHANNELS, "canais demais para um frame multicanal");
+
+// Canais que decidiram enviar neste ciclo: saem juntos num frame multicanal
+static struct {
+    channel_t *ch[CHANNEL_COUNT];
+    telemetry_data_t data[CHANNEL_COUNT];
+    aguada_reading_t readings[CHANNEL_COUNT];
+    int count;
+} cycle;
+
+/**
+ * Guarda a leitura do canal no frame do ciclo (sai em cycle_flush)
+ * 
+ * @return false - o envio só é confirmado depois, para todos os canais
+ */
+static bool send_telemetry(channel_t *ch, const telemetry_data_t *data, uint8_t reason) {
+    aguada_reading_t *reading = &cycle.readings[cycle.count];
+    
+    memset(reading, 0, sizeof(*reading));
+    memcpy(reading->mac, ch->mac, 6);
+    reading->distance_mm = data->distance_mm;
+    reading->flags = reason;
+#if USE_RLE
+    reading->rle = ch->state.rle_stable_count;
+#endif
+    cycle.ch[cycle.count] = ch;
+    cycle.data[cycle.count] = *data;
+    cycle.count++;
+    return false;
+}
+
+/**
+ * Um frame por ciclo: VCC e entrega uma vez, uma leitura por canal pendente
+ */
+static void cycle_flush(int32_t vcc_mv, uint8_t delivery_pct) {
+    if (cycle.count == 0) {
+        return;
+    }
     
-    int len = snprintf(payload, sizeof(payload),
-             "{\"mac\":\"%s\",\"distance_mm\":%ld,\"vcc_bat_mv\":%ld,\"rssi\":%ld,\"rle\":%d}",
-             mac_str, 
-             (long)data->distance_mm, 
-             (long)data->vcc_bat_mv, 
-             (long)data->rssi,
-             state->rle_stable_count);
+    uint8_t frame[AGUADA_MULTI_SIZE(CHANNEL_COUNT)];
+    aguada_reading_t node = {
+        .vcc_bat_mv = vcc_mv,
+        .delivery_pct = delivery_pct,
+        .flags = (vcc_mv < VCC_MIN_MV) ? AGUADA_FLAG_LOW_BATTERY : 0,
+        .has_seq = true,
+        .seq = frame_seq++,
+    };
+    memcpy(node.mac, node_mac, 6);
     
-    ESP_LOGI(TAG, "[%s] → %s", sensor_name, payload);
+    size_t len = aguada_multi_encode(&node, cycle.readings, cycle.count, frame, sizeof(frame));
     
-    for (int retry = 0; retry < ESPNOW_MAX_RETRIES; retry++) {
-        esp_err_t result = esp_now_send(GATEWAY_MAC, (uint8_t*)payload, strlen(payload));
-        
-        if (result == ESP_OK) {
-            state->last_send_time = esp_timer_get_time();
-            return true;
+    ESP_LOGI(TAG, "[NODE] → MULTI[%u]: %d canais", (unsigned)len, cycle.count);
+    for (int i = 0; i < cycle.count; i++) {
+        ESP_LOGI(TAG, "  [%s] %ld mm (rle=%u)", cycle.ch[i]->cfg->id,
+                 (long)cycle.readings[i].distance_mm, cycle.readings[i].rle);
+    }
+    
+    if (espnow_send_payload(frame, len, "MULTI")) {
+        for (int i = 0; i < cycle.count; i++) {
+            channel_sent(cycle.ch[i], &cycle.data[i], cycle.readings[i].flags == AGUADA_FLAG_DELTA);
         }
-        
-        ESP_LOGW(TAG, "[%s] Retry %d/%d", sensor_name, retry + 1, ESPNOW_MAX_RETRIES);
-        vTaskDelay(pdMS_TO_TICKS(ESPNOW_RETRY_MS));
     }
+    cycle.count = 0;
+}
+
+#elif !USE_BATCHING
+static bool send_telemetry(channel_t *ch, const telemetry_data_t *data, uint8_t reason) {
+    char payload[AGUADA_JSON_MAX];
+    aguada_reading_t reading = {
+        .distance_mm = data->distance_mm,
+        .vcc_bat_mv = data->vcc_bat_mv,
+        .delivery_pct = data->delivery_pct,
+#if USE_RLE
+        .rle = ch->state.rle_stable_count,
+#endif
+        .has_seq = true,
+        .seq = frame_seq++,
+    };
+    memcpy(reading.mac, ch->mac, 6);
+    (void)reason;
     
-    ESP_LOGE(TAG, "[%s] Falha ao enviar", sensor_name);
-    return false;
+    int len = aguada_json_encode(&reading, payload, sizeof(payload));
+    
+    ESP_LOGI(TAG, "[%s] → %s", ch->cfg->id, payload);
+    
+    return espnow_send_payload((const uint8_t *)payload, len, ch->cfg->id);
+}
+
+#else
+/**
+ * Fechar o lote do canal e enviá-lo num único frame (VCC do fechamento)
+ * 
+ * @param reason AGUADA_FLAG_HEARTBEAT/AGUADA_FLAG_DELTA (0 = cheio ou idade)
+ */
+static bool send_telemetry(channel_t *ch, const telemetry_data_t *data, uint8_t reason) {
+    sensor_state_t *state = &ch->state;
+    aguada_reading_t status = {
+        .vcc_bat_mv = data->vcc_bat_mv,
+        .flags = reason,
+        .has_seq = true,
+        .seq = frame_seq++,
+    };
+    memcpy(status.mac, ch->mac, 6);
+    if (data->vcc_bat_mv < VCC_MIN_MV) status.flags |= AGUADA_FLAG_LOW_BATTERY;
+    
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    uint32_t age_ms = aguada_batch_age_ms(&state->batch, now_ms);
+    size_t len = aguada_batch_finish(&state->batch, &status, now_ms);
+    
+    ESP_LOGI(TAG, "[%s] → LOTE[%u]: %u leituras em %lu ms", ch->cfg->id,
+             (unsigned)len, state->batch.count, (unsigned long)age_ms);
+    
+    bool ok = espnow_send_payload(state->batch.buf, len, ch->cfg->id);
+    aguada_batch_init(&state->batch);
+    return ok;
 }
 
+/**
+ * Acrescentar a leitura ao lote do canal
+ * 
+ * @return true se o frame deve sair agora (evento, cheio ou velho)
+ */
+static bool batch_collect(channel_t *ch, const telemetry_data_t *current,
+                          bool event, bool read_error) {
+    sensor_state_t *state = &ch->state;
+    uint32_t now_ms = (uint32_t)(current->timestamp / 1000);
+    aguada_batch_add(&state->batch, current->distance_mm,
+                     read_error ? AGUADA_FLAG_ERROR : 0, now_ms);
+    
+    return event || aguada_batch_full(&state->batch) ||
+           state->batch.count >= BATCH_MAX_READINGS ||
+           aguada_batch_age_ms(&state->batch, now_ms) >= BATCH_MAX_AGE_MS;
+}
+#endif
+
+#if !USE_BATCHING
+/**
+ * Sem lotes: envia só no evento (delta/heartbeat)
+ */
+static bool batch_collect(channel_t *ch, const telemetry_data_t *current,
+                          bool event, bool read_error) {
+    (void)ch;
+    (void)current;
+    (void)read_error;
+    return event;
+}
+#endif
+
+#if USE_BATCHING || !USE_MULTI_FRAME
+/**
+ * Sem frame multicanal: cada canal já enviou o seu, nada a fechar no ciclo
+ */
+static void cycle_flush(int32_t vcc_mv, uint8_t delivery_pct) {
+    (void)vcc_mv;
+    (void)delivery_pct;
+}
+#endif
+
 static bool should_send(const telemetry_data_t *current, sensor_state_t *state, bool *is_heartbeat) {
     *is_heartbeat = false;
     
@@ -420,12 +724,13 @@ static bool should_send(const telemetry_data_t *current, sensor_state_t *state,
     
     if (elapsed_ms >= HEARTBEAT_MS) {
         metrics.heartbeats_sent++;
+        aguada_dsp_reset_trend(&state->dsp);
         *is_heartbeat = true;
         return true;
     }
     
-    int32_t delta_mm = abs(current->distance_mm - state->last_sent.distance_mm);
-    if (delta_mm >= DELTA_DISTANCE_MM) {
+    // Deadband com histerese do canal (hysteresis_mm na inversão de tendência)
+    if (aguada_dsp_deadband(&state->dsp, current->distance_mm, state->last_sent.distance_mm)) {
         metrics.deltas_detected++;
         return true;
     }
@@ -439,77 +744,127 @@ static bool should_send(const telemetry_data_t *current, sensor_state_t *state,
     return false;
 }
 
+/**
+ * Ajustar a densidade de amostragem do canal (estável → esparsa, mudança → densa)
+ */
+static void adapt_update(channel_t *ch, bool changed) {
+#if USE_ADAPTIVE_SAMPLING
+    sensor_state_t *state = &ch->state;
+    bool level_changed = changed ? aguada_adapt_change(&state->adapt)
+                                 : aguada_adapt_stable(&state->adapt);
+    if (level_changed) {
+        ESP_LOGI(TAG, "[%s] Amostragem: %d amostras (nível %d)",
+                 ch->cfg->id, state->adapt.samples, state->adapt.level);
+    }
+#else
+    (void)ch;
+    (void)changed;
+#endif
+}
+
+/**
+ * Espera até o próximo ciclo: o menor intervalo entre os canais
+ */
+static uint32_t next_interval_ms(void) {
+#if USE_ADAPTIVE_SAMPLING
+    uint32_t interval = channels[0].state.adapt.interval_ms;
+    for (int i = 1; i < CHANNEL_COUNT; i++) {
+        if (channels[i].state.adapt.interval_ms < interval) {
+            interval = channels[i].state.adapt.interval_ms;
+        }
+    }
+    return interval;
+#else
+    return READ_INTERVAL_MS;
+#endif
+}
+
+/**
+ * Decide e envia a leitura de um canal (deadband, heartbeat, lote)
+ */
+static void process_channel(channel_t *ch, telemetry_data_t *current) {
+    sensor_state_t *state = &ch->state;
+    
+    bool read_error = current->distance_mm < 0;
+    if (read_error) {
+        current->distance_mm = (current->distance_mm == -1) ? 0 : 1;
+    }
+    
+    bool changed = !rle_update(ch, current->distance_mm);
+    
+    bool is_heartbeat = false;
+    bool event = should_send(current, state, &is_heartbeat);
+    if (batch_collect(ch, current, event, read_error)) {
+        changed |= event && !is_heartbeat;
+        uint8_t reason = !event ? 0 : is_heartbeat ? AGUADA_FLAG_HEARTBEAT : AGUADA_FLAG_DELTA;
+        if (send_telemetry(ch, current, reason)) {
+            channel_sent(ch, current, event && !is_heartbeat);
+        }
+    }
+    
+    adapt_update(ch, changed);
+}
+
+/**
+ * Estado inicial de um canal (filtro com o deadband/histerese da tabela)
+ */
+static void channel_init(channel_t *ch) {
+    sensor_state_t *state = &ch->state;
+    
+    ch->dsp_cfg = dsp_config;
+    ch->dsp_cfg.deadband_mm = ch->cfg->deadband_mm;
+    ch->dsp_cfg.hysteresis_mm = ch->cfg->hysteresis_mm;
+    
+    state->first_reading = true;
+    state->last_send_time = esp_timer_get_time();
+    aguada_dsp_init(&state->dsp, &ch->dsp_cfg);
+#if USE_RUNNING_MEDIAN
+    aguada_running_median_init(&state->median, RUNNING_MEDIAN_WINDOW);
+#endif
+#if USE_ADAPTIVE_SAMPLING
+    aguada_adapt_init(&state->adapt, &adapt_config);
+#endif
+#if USE_BATCHING
+    aguada_batch_init(&state->batch);
+#endif
+}
+
 // ============================================================================
 // TASK PRINCIPAL
 // ============================================================================
 
 static void telemetry_task(void *pvParameters) {
-    ESP_LOGI(TAG, "Iniciando telemetria dual (intervalo: %d ms)", READ_INTERVAL_MS);
+    ESP_LOGI(TAG, "Iniciando telemetria: %d canais (intervalo: %d ms)", CHANNEL_COUNT, READ_INTERVAL_MS);
     
-    sensor_ie01.first_reading = true;
-    sensor_ie01.last_send_time = esp_timer_get_time();
+    for (int i = 0; i < CHANNEL_COUNT; i++) {
+        channel_init(&channels[i]);
+    }
     
-    sensor_ie02.first_reading = true;
-    sensor_ie02.last_send_time = esp_timer_get_time();
+    // Pior caso de uma rodada (um ping por canal + guardas) contra o espaçamento
+    int round_ms = CHANNEL_COUNT * (SENSOR_MAX_MM * 2 / 343 + 1 + CROSSTALK_GUARD_MS);
+    if (round_ms > SAMPLE_INTERVAL_MS) {
+        ESP_LOGW(TAG, "Rodada de %d canais leva até %d ms > SAMPLE_INTERVAL_MS (%d ms)",
+                 CHANNEL_COUNT, round_ms, SAMPLE_INTERVAL_MS);
+    }
     
     while (1) {
         int vcc_mv = get_vcc_mv();
-        int rssi = get_rssi();
-        
-        // ====== SENSOR IE01 ======
-        {
-            telemetry_data_t current = {
-                .distance_mm = read_ultrasonic_filtered(PIN_TRIG_IE01, PIN_ECHO_IE01, &sensor_ie01),
-                .vcc_bat_mv = vcc_mv,
-                .rssi = rssi,
-                .timestamp = esp_timer_get_time()
-            };
-            
-            if (current.distance_mm < 0) {
-                current.distance_mm = (current.distance_mm == -1) ? 0 : 1;
-            }
-            
-            rle_update(&sensor_ie01, current.distance_mm);
-            
-            bool is_heartbeat = false;
-            if (should_send(&current, &sensor_ie01, &is_heartbeat)) {
-                if (send_telemetry(mac_str_ie01, node_mac_ie01, &current, &sensor_ie01, "IE01")) {
-                    sensor_ie01.last_sent = current;
-                    if (!is_heartbeat) {
-                        sensor_ie01.rle_stable_count = 1;
-                    }
-                }
-            }
-        }
+        uint8_t delivery_pct = aguada_link_delivery_pct(&link);
         
-        // Pequeno delay entre sensores para evitar interferência
-        vTaskDelay(pdMS_TO_TICKS(100));
+        // Todos os sensores numa só janela de amostragem (pings intercalados)
+        int32_t distance_mm[CHANNEL_COUNT];
+        read_channels_filtered(distance_mm);
         
-        // ====== SENSOR IE02 ======
-        {
+        for (int i = 0; i < CHANNEL_COUNT; i++) {
             telemetry_data_t current = {
-                .distance_mm = read_ultrasonic_filtered(PIN_TRIG_IE02, PIN_ECHO_IE02, &sensor_ie02),
+                .distance_mm = distance_mm[i],
                 .vcc_bat_mv = vcc_mv,
-                .rssi = rssi,
+                .delivery_pct = delivery_pct,
                 .timestamp = esp_timer_get_time()
             };
-            
-            if (current.distance_mm < 0) {
-                current.distance_mm = (current.distance_mm == -1) ? 0 : 1;
-            }
-            
-            rle_update(&sensor_ie02, current.distance_mm);
-            
-            bool is_heartbeat = false;
-            if (should_send(&current, &sensor_ie02, &is_heartbeat)) {
-                if (send_telemetry(mac_str_ie02, node_mac_ie02, &current, &sensor_ie02, "IE02")) {
-                    sensor_ie02.last_sent = current;
-                    if (!is_heartbeat) {
-                        sensor_ie02.rle_stable_count = 1;
-                    }
-                }
-            }
+            process_channel(&channels[i], &current);
         }
+        cycle_flush(vcc_mv, delivery_pct);
         
         // Log de estatísticas
         if (metrics.packets_sent > 0 && metrics.packets_sent % STATS_INTERVAL == 0) {
@@ -517,16 +872,19 @@ static void telemetry_task(void *pvParameters) {
                      metrics.readings_total, metrics.packets_sent, 
                      metrics.packets_failed, metrics.deltas_detected,
                      metrics.heartbeats_sent);
+            ESP_LOGI(TAG, "📡 Enlace: entrega=%u%% retries=%lu timeouts=%lu TX=%d.%02d dBm RSSI_gw=%d",
+                     aguada_link_delivery_pct(&link), link.retries, link.timeouts,
+                     link.tx_power / 4, (link.tx_power % 4) * 25, link.gateway_rssi);
         }
         
-        vTaskDelay(pdMS_TO_TICKS(READ_INTERVAL_MS));
+        vTaskDelay(pdMS_TO_TICKS(next_interval_ms()));
     }
 }
 
 static void heartbeat_led_task(void *pvParameters) {
     while (1) {
-        // 3 piscadas rápidas (dual = 2 grupos)
-        for (int g = 0; g < 2; g++) {
+        // 3 piscadas rápidas por canal (um grupo por sensor)
+        for (int g = 0; g < CHANNEL_COUNT; g++) {
             for (int i = 0; i < 3; i++) {
                 gpio_set_level(PIN_LED_STATUS, 1);
                 vTaskDelay(pdMS_TO_TICKS(80));
@@ -547,19 +905,19 @@ static void heartbeat_led_task(void *pvParameters) {
 void app_main(void) {
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "╔══════════════════════════════════════════════════════╗");
-    ESP_LOGI(TAG, "║       AGUADA - Dual Sensor Node (IE01 + IE02)        ║");
+    ESP_LOGI(TAG, "║       AGUADA - Multi Sensor Node (%d canais)          ║", CHANNEL_COUNT);
     ESP_LOGI(TAG, "╠══════════════════════════════════════════════════════╣");
     ESP_LOGI(TAG, "║  Firmware:  %-40s ║", FIRMWARE_VERSION);
     ESP_LOGI(TAG, "║  Protocolo: %-40s ║", PROTOCOL_VERSION);
-    ESP_LOGI(TAG, "║  Hardware:  ESP32-C3 + 2x AJ-SR04M                   ║");
+    ESP_LOGI(TAG, "║  Hardware:  ESP32-C3 + %dx AJ-SR04M                   ║", CHANNEL_COUNT);
     ESP_LOGI(TAG, "╚══════════════════════════════════════════════════════╝");
     ESP_LOGI(TAG, "");
     
     init_gpio();
     init_adc();
     
-    // Animação de boot (6 piscadas = 2 sensores × 3)
-    for (int i = 0; i < 6; i++) {
+    // Animação de boot (3 piscadas por sensor)
+    for (int i = 0; i < CHANNEL_COUNT * 3; i++) {
         gpio_set_level(PIN_LED_STATUS, 1);
         vTaskDelay(pdMS_TO_TICKS(100));
         gpio_set_level(PIN_LED_STATUS, 0);
@@ -573,8 +931,10 @@ void app_main(void) {
     
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "✓ Sistema pronto!");
-    ESP_LOGI(TAG, "  - IE01: GPIO TRIG=%d ECHO=%d (MAC real)", PIN_TRIG_IE01, PIN_ECHO_IE01);
-    ESP_LOGI(TAG, "  - IE02: GPIO TRIG=%d ECHO=%d (MAC virtual)", PIN_TRIG_IE02, PIN_ECHO_IE02);
+    for (int i = 0; i < CHANNEL_COUNT; i++) {
+        ESP_LOGI(TAG, "  - %s: GPIO TRIG=%d ECHO=%d (%s)", channels[i].cfg->id,
+                 channels[i].cfg->trig_pin, channels[i].cfg->echo_pin, channels[i].mac_str);
+    }
     ESP_LOGI(TAG, "  - Leitura a cada %d ms", READ_INTERVAL_MS);
     ESP_LOGI(TAG, "  - Heartbeat a cada %d ms", HEARTBEAT_MS);
     ESP_LOGI(TAG, "");
@@ -0,0 +1,128 @@
+#!/bin/bash
+# =============================================================================
+# Script de Teste do Uplink MQTT AGUADA (gateway com UPLINK_SINK_MQTT)
+# Usa o container Mosquitto local (docker compose --profile mqtt)
+#
+# 1. Publica um lote no formato do gateway (JSON array por node, QoS1)
+# 2. Sessão persistente: publica com o assinante offline e verifica que
+#    nada se perde ao reconectar
+# 3. (Opcional) Backend com MQTT_ENABLED=true grava as leituras
+# =============================================================================
+
+set -e
+
+# Cores
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+BLUE='\033[0;34m'
+NC='\033[0m' # No Color
+
+echo -e "${BLUE}╔════════════════════════════════════════════════════════════╗${NC}"
+echo -e "${BLUE}║         AGUADA - Teste do Uplink MQTT                      ║${NC}"
+echo -e "${BLUE}╚════════════════════════════════════════════════════════════╝${NC}"
+
+# Configurações
+MQTT_CONTAINER="${MQTT_CONTAINER:-aguada-mqtt}"
+TOPIC_PREFIX="${TOPIC_PREFIX:-aguada/telemetry}"
+BACKEND_URL="${BACKEND_URL:-http://localhost:3000}"
+SUB_ID="aguada-test-sub-$$"
+
+# MACs dos sensores conhecidos (do banco de dados)
+MAC_RCON="20:6E:F1:6B:77:58"
+MAC_RCAV="DC:06:75:67:6A:CC"
+
+# Tópico do gateway: prefixo + MAC sem ':'
+topic_for() {
+    echo "${TOPIC_PREFIX}/$(echo "$1" | tr -d ':')"
+}
+
+# Lote do gateway: JSON array de leituras AGUADA-1 do mesmo node
+batch_for() {
+    local mac="$1"; shift
+    local items=""
+    for dist in "$@"; do
+        [ -n "$items" ] && items="${items},"
+        items="${items}{\"mac\":\"${mac}\",\"distance_mm\":${dist},\"vcc_bat_mv\":5000,\"rssi\":-45}"
+    done
+    echo "[${items}]"
+}
+
+mqtt_pub() {
+    docker exec "${MQTT_CONTAINER}" mosquitto_pub -q 1 -t "$1" -m "$2"
+}
+
+fail() {
+    echo -e "${RED}❌ $1${NC}"
+    exit 1
+}
+
+# Subir broker
+echo ""
+echo -e "${BLUE}🔍 Subindo Mosquitto (${MQTT_CONTAINER})...${NC}"
+docker compose --profile mqtt up -d mosquitto > /dev/null
+for i in $(seq 1 20); do
+    if docker exec "${MQTT_CONTAINER}" mosquitto_pub -t aguada/ping -m ping 2>/dev/null; then
+        break
+    fi
+    [ "$i" = "20" ] && fail "Broker não respondeu"
+    sleep 0.5
+done
+echo -e "${GREEN}✅ Broker pronto${NC}"
+
+# Teste 1: lote publicado e recebido por assinante QoS1
+echo ""
+echo -e "${BLUE}═══════════════════════════════════════════════════════════════${NC}"
+echo -e "${BLUE}Teste 1: Lote por node (QoS1)${NC}"
+echo -e "${BLUE}═══════════════════════════════════════════════════════════════${NC}"
+docker exec "${MQTT_CONTAINER}" mosquitto_sub -q 1 -t "${TOPIC_PREFIX}/+" -C 2 -W 10 -v > /tmp/aguada_mqtt_t1.txt &
+SUB_PID=$!
+sleep 1
+mqtt_pub "$(topic_for ${MAC_RCON})" "$(batch_for ${MAC_RCON} 2450 2465 2480)"
+mqtt_pub "$(topic_for ${MAC_RCAV})" "$(batch_for ${MAC_RCAV} 1850)"
+wait ${SUB_PID} || fail "Assinante não recebeu os 2 lotes"
+cat /tmp/aguada_mqtt_t1.txt
+grep -q "$(topic_for ${MAC_RCON}) \[.*2480" /tmp/aguada_mqtt_t1.txt || fail "Lote RCON ausente"
+echo -e "${GREEN}✅ 2 tópicos, 4 leituras${NC}"
+
+# Teste 2: sessão persistente - assinante offline não perde mensagens
+echo ""
+echo -e "${BLUE}═══════════════════════════════════════════════════════════════${NC}"
+echo -e "${BLUE}Teste 2: Sessão persistente (reconexão sem perda)${NC}"
+echo -e "${BLUE}═══════════════════════════════════════════════════════════════${NC}"
+# Registra a sessão (clean_session=false) e desconecta
+docker exec "${MQTT_CONTAINER}" mosquitto_sub -c -i "${SUB_ID}" -q 1 -t "${TOPIC_PREFIX}/+" -W 1 > /dev/null 2>&1 || true
+
+echo -e "${YELLOW}📤 Publicando 5 lotes com o assinante offline...${NC}"
+for dist in 2500 2510 2520 2530 2540; do
+    mqtt_pub "$(topic_for ${MAC_RCON})" "$(batch_for ${MAC_RCON} ${dist})"
+done
+
+received=$(docker exec "${MQTT_CONTAINER}" mosquitto_sub -c -i "${SUB_ID}" -q 1 -t "${TOPIC_PREFIX}/+" -C 5 -W 5 | wc -l)
+# Remove a sessão de teste do broker
+docker exec "${MQTT_CONTAINER}" mosquitto_sub -i "${SUB_ID}" -t "${TOPIC_PREFIX}/+" -W 1 > /dev/null 2>&1 || true
+
+if [ "${received}" = "5" ]; then
+    echo -e "${GREEN}✅ 5/5 lotes entregues após reconexão${NC}"
+else
+    fail "Apenas ${received}/5 lotes entregues após reconexão"
+fi
+
+# Teste 3: backend consumindo o tópico (opcional)
+echo ""
+echo -e "${BLUE}═══════════════════════════════════════════════════════════════${NC}"
+echo -e "${BLUE}Teste 3: Backend (MQTT_ENABLED=true)${NC}"
+echo -e "${BLUE}═══════════════════════════════════════════════════════════════${NC}"
+if curl -s "${BACKEND_URL}/api/health" > /dev/null 2>&1; then
+    mqtt_pub "$(topic_for ${MAC_RCON})" "$(batch_for ${MAC_RCON} 2600 2610)"
+    sleep 2
+    curl -s "${BACKEND_URL}/api/readings/latest" | python3 -m json.tool 2>/dev/null || \
+        curl -s "${BACKEND_URL}/api/readings/latest"
+else
+    echo -e "${YELLOW}⚠ Backend não está acessível em ${BACKEND_URL} - teste ignorado${NC}"
+fi
+
+echo ""
+echo -e "${GREEN}╔════════════════════════════════════════════════════════════╗${NC}"
+echo -e "${GREEN}║                 Teste concluído!                           ║${NC}"
+echo -e "${GREEN}╚════════════════════════════════════════════════════════════╝${NC}"